@@ -33,10 +33,13 @@
 #include <sys/time.h>
 #include <sys/ioctl.h>
 #include <sys/uio.h>
+#include <sys/syscall.h>
 
 #include "version.h"
 #include "dma_common_utils.h"
 #include "dma_perf.h"
+/* after dma_common_utils.h, its enum operation_arg has an ARG_MAX */
+#include <linux/io_uring.h>
 
 struct mdb5_dma_perf p;
 struct mdb5_dma_common h;
@@ -225,6 +228,15 @@ static int parse_config_file(char *cfg_fname, struct mdb5_dma_perf *p)
 					 "for SG DMA mode\n", value);
 				goto parse_cleanup;
 			}
+		} else if (!strncmp(config, "io_engine", 9)) {
+			if (!strncmp(value, "io_uring", 8)) {
+				p->io_engine = MDB5_IO_ENGINE_URING;
+			} else if (!strncmp(value, "aio", 3)) {
+				p->io_engine = MDB5_IO_ENGINE_AIO;
+			} else {
+				mdb5_dma_err("Invalid io_engine:%s\n", value);
+				goto parse_cleanup;
+			}
 		} else if (!strncmp(config, "dump_en", 7)) {
 			if (!strncmp(value, "true", 4)) {
 				h->dump_en = true;
@@ -1062,7 +1074,8 @@ static void io_proc_cleanup(struct io_info *_info, struct mdb5_dma_perf *p)
 	uint8_t is_ch_stop = (_info->ch_ctrl && _info->ch_started);
 
 	*p->io_exit = 1;
-	pthread_join(_info->evt_id, NULL);
+	if (p->io_engine == MDB5_IO_ENGINE_AIO)
+		pthread_join(_info->evt_id, NULL);
 	ch_lst_idx_base = ((((_info->pf & 0x0000F) - p->pf_start) * num_chan)
 			   /* TODO: + ch_offset */);
 
@@ -1107,6 +1120,226 @@ static void io_proc_cleanup(struct io_info *_info, struct mdb5_dma_perf *p)
 	memory_pool_free(&datahandle);
 }
 
+/*
+ * io_uring engine: a burst is one IORING_OP_READV/WRITEV, which the driver
+ * takes through the same read_iter/write_iter path as libaio. Up to
+ * URING_ENTRIES bursts are handed over per io_uring_enter() and completions
+ * are reaped by the submitting thread, without an event thread.
+ */
+#define URING_ENTRIES	64
+
+struct uring {
+	int fd;
+	uint32_t *sq_head;
+	uint32_t *sq_tail;
+	uint32_t *sq_mask;
+	uint32_t *sq_array;
+	uint32_t *cq_head;
+	uint32_t *cq_tail;
+	uint32_t *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sq_ptr;
+	void *cq_ptr;
+	size_t sq_sz;
+	size_t cq_sz;
+	size_t sqes_sz;
+	uint32_t sq_entries;
+	uint32_t to_submit;
+};
+
+static int uring_init(struct uring *r, uint32_t entries)
+{
+	struct io_uring_params prm;
+
+	memset(r, 0, sizeof(*r));
+	memset(&prm, 0, sizeof(prm));
+	r->fd = syscall(__NR_io_uring_setup, entries, &prm);
+	if (r->fd < 0)
+		return -errno;
+
+	r->sq_sz = prm.sq_off.array + prm.sq_entries * sizeof(uint32_t);
+	r->cq_sz = prm.cq_off.cqes +
+		   prm.cq_entries * sizeof(struct io_uring_cqe);
+	r->sqes_sz = prm.sq_entries * sizeof(struct io_uring_sqe);
+	r->sq_ptr = mmap(NULL, r->sq_sz, PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	r->cq_ptr = mmap(NULL, r->cq_sz, PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+	r->sqes = mmap(NULL, r->sqes_sz, PROT_READ | PROT_WRITE,
+		       MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if (r->sq_ptr == MAP_FAILED || r->cq_ptr == MAP_FAILED ||
+	    r->sqes == MAP_FAILED) {
+		close(r->fd);
+		return -ENOMEM;
+	}
+
+	r->sq_head = (uint32_t *)((char *)r->sq_ptr + prm.sq_off.head);
+	r->sq_tail = (uint32_t *)((char *)r->sq_ptr + prm.sq_off.tail);
+	r->sq_mask = (uint32_t *)((char *)r->sq_ptr + prm.sq_off.ring_mask);
+	r->sq_array = (uint32_t *)((char *)r->sq_ptr + prm.sq_off.array);
+	r->cq_head = (uint32_t *)((char *)r->cq_ptr + prm.cq_off.head);
+	r->cq_tail = (uint32_t *)((char *)r->cq_ptr + prm.cq_off.tail);
+	r->cq_mask = (uint32_t *)((char *)r->cq_ptr + prm.cq_off.ring_mask);
+	r->cqes = (struct io_uring_cqe *)((char *)r->cq_ptr + prm.cq_off.cqes);
+	r->sq_entries = prm.sq_entries;
+
+	return 0;
+}
+
+static void uring_exit(struct uring *r)
+{
+	munmap(r->sqes, r->sqes_sz);
+	munmap(r->cq_ptr, r->cq_sz);
+	munmap(r->sq_ptr, r->sq_sz);
+	close(r->fd);
+}
+
+static int uring_queue_rw(struct uring *r, struct io_info *_info,
+			  struct iovec *iov, uint32_t iovcnt)
+{
+	uint32_t tail = *r->sq_tail + r->to_submit;
+	uint32_t idx = tail & *r->sq_mask;
+	struct io_uring_sqe *sqe = &r->sqes[idx];
+
+	if (tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) >=
+	    r->sq_entries)
+		return -EBUSY;
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = (_info->dir == MDB5_CHAN_DIR_TO_DEV) ?
+			IORING_OP_WRITEV : IORING_OP_READV;
+	sqe->fd = _info->fd;
+	sqe->addr = (uintptr_t)iov;
+	sqe->len = iovcnt;
+	sqe->off = _info->offset;
+	sqe->user_data = (uintptr_t)iov;
+	r->sq_array[idx] = idx;
+	r->to_submit++;
+
+	return 0;
+}
+
+static int uring_submit(struct uring *r, uint32_t wait_nr)
+{
+	uint32_t to_submit = r->to_submit;
+	int ret;
+
+	__atomic_store_n(r->sq_tail, *r->sq_tail + to_submit,
+			 __ATOMIC_RELEASE);
+	r->to_submit = 0;
+	ret = syscall(__NR_io_uring_enter, r->fd, to_submit, wait_nr,
+		      wait_nr ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+	if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+		return -errno;
+
+	return 0;
+}
+
+static uint32_t uring_reap(struct uring *r, struct io_info *_info,
+			   uint32_t burst_cnt)
+{
+	uint32_t head = *r->cq_head;
+	uint32_t tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+	uint32_t cnt = 0, i;
+
+	for (; head != tail; head++, cnt++) {
+		struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+		struct iovec *iov = (struct iovec *)(uintptr_t)cqe->user_data;
+
+		if (cqe->res >= 0)
+			_info->num_req_completed += cqe->res;
+		else
+			mdb5_dma_err("%s: io_uring rw failed %d on %s\n",
+				 __func__, cqe->res, _info->ch_name);
+		for (i = 0; (i < burst_cnt) && iov[i].iov_base; i++)
+			memory_pool_free_block(&datahandle, iov[i].iov_base);
+		memory_pool_free_block(&iocbhandle, iov);
+	}
+	__atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+
+	return cnt;
+}
+
+static void io_uring_run(struct io_info *_info, uint32_t io_sz,
+			 uint32_t burst_cnt, uint32_t num_desc,
+			 uint32_t max_reqs)
+{
+	struct mdb5_dma_perf *p = _info->p;
+	struct uring r;
+	uint32_t inflight = 0, retry;
+	int ret;
+
+	ret = uring_init(&r, URING_ENTRIES);
+	if (ret < 0) {
+		mdb5_dma_err("io_uring setup error %d on %u\n", ret,
+			 _info->thread_id);
+		return;
+	}
+
+	sync_timer_wait_and_start(p->timer);
+
+	do {
+		uint32_t queued = 0;
+
+		if (sync_timer_check_elapsed(p->timer, p->tsecs))
+			break;
+
+		while (((_info->num_req_submitted - _info->num_req_completed) *
+			num_desc) <= max_reqs) {
+			struct iovec *iov;
+			uint32_t iovcnt;
+
+			/* the iocb pool blocks hold the iovec of a burst */
+			iov = memory_pool_alloc_block(&iocbhandle);
+			if (!iov)
+				break;
+			for (iovcnt = 0; iovcnt < burst_cnt; iovcnt++) {
+				iov[iovcnt].iov_base =
+				    memory_pool_alloc_block(&datahandle);
+				if (!iov[iovcnt].iov_base)
+					break;
+				iov[iovcnt].iov_len = io_sz;
+			}
+			if (!iovcnt || uring_queue_rw(&r, _info, iov, iovcnt)) {
+				while (iovcnt > 0) {
+					iovcnt--;
+					memory_pool_free_block(&datahandle,
+						 iov[iovcnt].iov_base);
+				}
+				memory_pool_free_block(&iocbhandle, iov);
+				break;
+			}
+			queued++;
+			inflight++;
+			_info->num_req_submitted += iovcnt;
+		}
+
+		/* all bursts in one syscall, wait only if none was queued */
+		ret = uring_submit(&r, queued ? 0 : 1);
+		if (ret < 0) {
+			mdb5_dma_err("pid=%d:%s:io_uring_enter error:%d on %s\n",
+				 getpid(), __func__, ret, _info->ch_name);
+			break;
+		}
+		inflight -= uring_reap(&r, _info, burst_cnt);
+	} while (p->tsecs && !p->force_exit);
+
+	/* drain what is still in flight, bounded like thread_exit_check() */
+	for (retry = 0; inflight && retry < 10000; retry++) {
+		uint32_t cnt = uring_reap(&r, _info, burst_cnt);
+
+		inflight -= cnt;
+		if (!cnt)
+			usleep(100);
+	}
+	if (inflight)
+		mdb5_dma_warn("thread %u: %u io_uring bursts still in flight\n",
+			  _info->thread_id, inflight);
+
+	uring_exit(&r);
+}
+
 static void *io_thread(void *argp)
 {
 	pthread_attr_t attr;
@@ -1144,6 +1377,11 @@ static void *io_thread(void *argp)
 		memory_pool_free(&ctxhandle);
 		return NULL;
 	}
+	if (p->io_engine == MDB5_IO_ENGINE_URING) {
+		io_uring_run(_info, io_sz, burst_cnt, num_desc, max_reqs);
+		io_proc_cleanup(_info, p);
+		return NULL;
+	}
 	s = pthread_attr_init(&attr);
 	if (s != 0)
 		mdb5_dma_err("pid=%d:%s: pthread_attr_init failed\n",
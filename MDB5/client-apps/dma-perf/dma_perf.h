@@ -44,6 +44,11 @@ struct list_head {
 
 struct mdb5_dma_perf;
 
+enum mdb5_io_engine {
+	MDB5_IO_ENGINE_AIO,	/* libaio, reaped by an event thread */
+	MDB5_IO_ENGINE_URING	/* io_uring, submitted and reaped inline */
+};
+
 struct io_info {
 	struct mdb5_dma_perf *p;
 	pthread_t evt_id;
@@ -95,6 +100,7 @@ struct mdb5_dma_perf {
 	uint32_t num_thrds;
 	uint32_t num_thrds_per_chan;
 	uint32_t marker_en;
+	enum mdb5_io_engine io_engine;
 #if THREADS_SET_CPU_AFFINITY
 	uint32_t num_processors;
 #endif
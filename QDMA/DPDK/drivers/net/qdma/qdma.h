@@ -64,6 +64,8 @@
 
 /* Descriptor Rings aligned to 4KB boundaries - only supported value */
 #define QDMA_ALIGN	(4096)
+/* Largest ring arena accepted by the ring_arena devarg, in MB */
+#define QDMA_RING_ARENA_MB_MAX	(4096)
 
 #define DEFAULT_TIMER_CNT_TRIG_MODE_TIMER	(5)
 #define DEFAULT_TIMER_CNT_TRIG_MODE_COUNT_TIMER	(30)
@@ -71,7 +73,13 @@
 #define MIN_RX_PIDX_UPDATE_THRESHOLD (1)
 #define MIN_TX_PIDX_UPDATE_THRESHOLD (1)
 #define DEFAULT_MM_CMPT_CNT_THRESHOLD	(2)
-#define QDMA_TXQ_PIDX_UPDATE_INTERVAL	(1000) //100 uSec
+
+/* Tx doorbell profiles, see the tx_db_profile devarg */
+#define QDMA_TX_DB_THRESH_LATENCY	MIN_TX_PIDX_UPDATE_THRESHOLD
+#define QDMA_TX_DB_HOLD_US_LATENCY	(0)
+#define QDMA_TX_DB_THRESH_THROUGHPUT	(32)
+#define QDMA_TX_DB_HOLD_US_THROUGHPUT	(100)
+#define QDMA_TX_DB_HOLD_US_MAX		(1000000)
 
 /** Delays **/
 #define MAILBOX_PF_MSG_DELAY		(20)
@@ -108,16 +116,6 @@
 
 #define DEFAULT_QDMA_CMPT_DESC_LEN (RTE_PMD_QDMA_CMPT_DESC_LEN_8B)
 
-#define LATENCY_MAX_QUEUES 4
-#define LATENCY_CNT 20
-
-#ifdef LATENCY_MEASUREMENT
-extern const struct rte_memzone *txq_lat_buf_mz;
-extern const struct rte_memzone *rxq_lat_buf_mz;
-extern double (*h2c_pidx_to_hw_cidx_lat)[LATENCY_CNT];
-extern double (*c2h_pidx_to_cmpt_pidx_lat)[LATENCY_CNT];
-#endif
-
 enum dma_data_direction {
 	DMA_BIDIRECTIONAL = 0,
 	DMA_TO_DEVICE = 1,
@@ -145,9 +143,41 @@ struct qdma_pkt_stats {
 	uint64_t bytes;
 };
 
-struct qdma_pkt_lat {
-	double prev;
-	double curr;
+/* Doorbell to completion latency of a queue in timer cycles, one
+ * measurement in flight at a time, see qdma_qlat_start()
+ */
+struct qdma_qlat {
+	uint64_t start_tsc; /* 0 while no measurement is in flight */
+	uint16_t idx; /* ring index the measurement waits for */
+	uint64_t samples;
+	uint64_t sum;
+	uint64_t min;
+	uint64_t max;
+	uint64_t bucket[RTE_PMD_QDMA_QLAT_BUCKETS];
+};
+
+/*
+ * Descriptor ring memory, carved from the port ring arena or held in a
+ * memzone of its own.
+ */
+struct qdma_ring_mem {
+	const struct rte_memzone *mz; /* NULL when carved from the arena */
+	struct qdma_ring_arena *arena;
+	void *addr;
+	rte_iova_t iova;
+};
+
+/*
+ * One IOVA contiguous memzone per port, enabled by the ring_arena devarg,
+ * that the descriptor and completion rings are carved from in QDMA_ALIGN
+ * pages, first fit.
+ */
+struct qdma_ring_arena {
+	const struct rte_memzone *mz;
+	uint32_t nb_pages;
+	uint32_t nb_free;
+	/* length of the ring starting at a page, 0 for free pages */
+	uint32_t run[];
 };
 
 struct qdma_txq_stats {
@@ -156,17 +186,12 @@ struct qdma_txq_stats {
 	uint16_t txq_tail;
 	uint16_t in_use_desc;
 	uint16_t nb_pkts;
-	uint16_t lat_cnt;
 	uint32_t ring_wrap_cnt;
 	uint32_t txq_full_cnt;
-#ifdef LATENCY_MEASUREMENT
-	uint32_t wrb_cidx_cnt_no_change;
-	uint32_t wrb_cidx_cnt_lt_8;
-	uint32_t wrb_cidx_cnt_8_to_32;
-	uint32_t wrb_cidx_cnt_32_to_64;
-	uint32_t wrb_cidx_cnt_gt_64;
-	struct qdma_pkt_lat pkt_lat;
-#endif
+	uint64_t db_cnt; /* PIDX doorbells written */
+	uint64_t db_desc_cnt; /* descriptors announced by the doorbells */
+	uint64_t db_hold_expired_cnt; /* doorbells forced by the hold time */
+	struct qdma_qlat lat; /* PIDX doorbell to CIDX writeback */
 };
 
 struct qdma_rxq_stats {
@@ -175,13 +200,10 @@ struct qdma_rxq_stats {
 	uint16_t wrb_cidx;
 	uint16_t rxq_cmpt_tail;
 	uint16_t pending_desc;
-	uint16_t lat_cnt;
 	uint32_t ring_wrap_cnt;
 	uint32_t mbuf_avail_cnt;
 	uint32_t mbuf_in_use_cnt;
-#ifdef LATENCY_MEASUREMENT
-	struct qdma_pkt_lat pkt_lat;
-#endif
+	struct qdma_qlat lat; /* C2H PIDX doorbell to CMPT writeback */
 };
 
 /*
@@ -206,8 +228,8 @@ struct qdma_cmpt_queue {
 	int8_t		threshidx;
 	int8_t		timeridx;
 	int8_t		triggermode;
-	/* completion descriptor memzone */
-	const struct rte_memzone *cmpt_mz;
+	/* completion descriptor ring */
+	struct qdma_ring_mem cmpt_mem;
 };
 
 /**
@@ -247,10 +269,12 @@ struct qdma_rx_queue {
 	uint8_t			en_bypass:1;
 	uint8_t			en_bypass_prefetch:1;
 	uint8_t			dis_overflow_check:1;
+	uint8_t			qlat_en:1; /**< record qstats.lat */
 
 	union qdma_ul_st_cmpt_ring cmpt_data[QDMA_MAX_BURST_SIZE];
 
 	uint8_t			func_id; /**< RX queue index. */
+	uint16_t		intr_vec; /**< MSI-X vector, 0 if Rx intr is off */
 	uint64_t		ep_addr;
 
 	int8_t			ringszidx;
@@ -260,9 +284,9 @@ struct qdma_rx_queue {
 	int8_t			timeridx;
 	int8_t			triggermode;
 
-	const struct rte_memzone *rx_mz;
+	struct qdma_ring_mem rx_mem;
 	/* C2H stream mode, completion descriptor result */
-	const struct rte_memzone *rx_cmpt_mz;
+	struct qdma_ring_mem rx_cmpt_mem;
 
 #ifdef QDMA_LATENCY_OPTIMIZED
 	/**< pend_pkt_moving_avg: average rate of packets received */
@@ -292,7 +316,12 @@ struct qdma_tx_queue {
 	struct rte_mbuf			**sw_ring;/* SW ring virtual address*/
 	uint16_t			tx_desc_pend;
 	uint16_t			nb_tx_desc; /* No of TX descriptors.*/
-	rte_spinlock_t			pidx_update_lock;
+	/* Doorbell once tx_db_thresh descriptors are pending or the
+	 * oldest one is pending for tx_db_hold_cycles
+	 */
+	uint16_t			tx_db_thresh;
+	uint64_t			tx_db_hold_cycles;
+	uint64_t			tx_db_pend_tsc;
 	uint64_t			offloads; /* Tx offloads */
 
 	struct rte_eth_dev		*dev;
@@ -301,6 +330,7 @@ struct qdma_tx_queue {
 	uint8_t				tx_deferred_start:1;
 	uint8_t				en_bypass:1;
 	uint8_t				status:1;
+	uint8_t				qlat_en:1; /* record qstats.lat */
 	uint16_t			port_id; /* Device port identifier. */
 	uint8_t				func_id; /* RX queue index. */
 	int8_t				ringszidx;
@@ -311,7 +341,7 @@ struct qdma_tx_queue {
 	uint64_t			ep_addr;
 	uint32_t			queue_id; /* TX queue index. */
 	uint32_t			num_queues; /* TX queue index. */
-	const struct rte_memzone	*tx_mz;
+	struct qdma_ring_mem		tx_mem;
 };
 
 struct qdma_vf_info {
@@ -359,6 +389,11 @@ struct qdma_pci_dev {
 #endif
 	uint8_t trigger_mode;
 	uint8_t timer_count;
+	/* Tx doorbell batching applied to new Tx queues */
+	uint16_t tx_db_thresh;
+	uint32_t tx_db_hold_us;
+	/* Latency histograms of new queues, see the qlat devarg */
+	uint8_t qlat_en;
 
 	uint8_t dev_configured:1;
 	uint8_t is_vf:1;
@@ -398,12 +433,23 @@ struct qdma_pci_dev {
 
 	uint8_t rx_vec_allowed:1;
 	uint8_t tx_vec_allowed:1;
+	/* Rx queue event fds bound to MSI-X vectors, see qdma_rx_intr_setup */
+	uint8_t rx_intr_en:1;
+
+	/* MM queues exposed through the dmadev, see qdma_dmadev.c */
+	uint16_t dma_queues;
+	struct rte_dma_dev *dmadev;
+
+	/* Size of the ring arena in MB, 0 for a memzone per ring */
+	uint32_t ring_arena_mb;
+	struct qdma_ring_arena *ring_arena;
 };
 
 void qdma_dev_ops_init(struct rte_eth_dev *dev);
 uint32_t qdma_read_reg(uint64_t reg_addr);
 void qdma_write_reg(uint64_t reg_addr, uint32_t val);
-void qdma_txq_pidx_update(void *arg);
+int qdma_rx_intr_setup(struct rte_eth_dev *dev);
+void qdma_rx_intr_teardown(struct rte_eth_dev *dev);
 int qdma_pf_csr_read(struct rte_eth_dev *dev);
 int qdma_vf_csr_read(struct rte_eth_dev *dev);
 
@@ -437,6 +483,8 @@ uint16_t qdma_xmit_pkts_st(struct qdma_tx_queue *txq, struct rte_mbuf **tx_pkts,
 				uint16_t nb_pkts);
 uint16_t qdma_xmit_pkts_mm(struct qdma_tx_queue *txq, struct rte_mbuf **tx_pkts,
 				uint16_t nb_pkts);
+void qdma_txq_doorbell(struct qdma_tx_queue *txq, uint16_t count,
+				bool force);
 
 #ifdef TEST_64B_DESC_BYPASS
 uint16_t qdma_xmit_64B_desc_bypass(struct qdma_tx_queue *txq,
@@ -452,19 +500,73 @@ int index_of_array(uint32_t *arr, uint32_t n, uint32_t element);
 int qdma_check_kvargs(struct rte_devargs *devargs,
 			struct qdma_pci_dev *qdma_dev);
 
-static inline const
-struct rte_memzone *qdma_zone_reserve(struct rte_eth_dev *dev,
-					const char *ring_name,
-					uint32_t queue_id,
-					uint32_t ring_size,
-					int socket_id)
+/* implemented in qdma_dmadev.c */
+int qdma_dmadev_create(struct rte_eth_dev *dev);
+void qdma_dmadev_stop(struct rte_eth_dev *dev);
+void qdma_dmadev_destroy(struct rte_eth_dev *dev);
+
+/* implemented in qdma_common.c */
+void *qdma_ring_reserve(struct rte_eth_dev *dev,
+			struct qdma_ring_mem *mem,
+			const char *ring_name,
+			uint32_t queue_id,
+			uint32_t ring_size,
+			int socket_id);
+void qdma_ring_release(struct qdma_ring_mem *mem);
+void qdma_ring_arena_free(struct rte_eth_dev *dev);
+
+/* Start a latency measurement at a doorbell unless one is in flight,
+ * idx is the ring index qdma_qlat_stop() is called for
+ */
+static inline void qdma_qlat_start(struct qdma_qlat *lat, uint16_t idx)
 {
-	char z_name[RTE_MEMZONE_NAMESIZE];
-	snprintf(z_name, sizeof(z_name), "%s%s%d_%u",
-			dev->device->driver->name, ring_name,
-			dev->data->port_id, queue_id);
-	return rte_memzone_reserve_aligned(z_name, (uint64_t)ring_size,
-						socket_id, 0, QDMA_ALIGN);
+	if (lat->start_tsc)
+		return;
+	lat->idx = idx;
+	lat->start_tsc = rte_get_timer_cycles();
+}
+
+/* Account the measurement in flight into its log2 bucket */
+static inline void qdma_qlat_stop(struct qdma_qlat *lat)
+{
+	uint64_t cycles = rte_get_timer_cycles() - lat->start_tsc;
+	uint32_t b = rte_fls_u64(cycles);
+
+	if (b >= RTE_PMD_QDMA_QLAT_BUCKETS)
+		b = RTE_PMD_QDMA_QLAT_BUCKETS - 1;
+	lat->bucket[b]++;
+	if (!lat->samples || cycles < lat->min)
+		lat->min = cycles;
+	if (cycles > lat->max)
+		lat->max = cycles;
+	lat->sum += cycles;
+	lat->samples++;
+	lat->start_tsc = 0;
+}
+
+/* Stop the Tx measurement once the CIDX writeback covers its doorbell */
+static inline void qdma_txq_qlat_check(struct qdma_tx_queue *txq,
+		uint16_t cidx)
+{
+	uint16_t n = txq->nb_tx_desc - 1;
+	uint16_t rem, in_use;
+
+	if (likely(!txq->qstats.lat.start_tsc))
+		return;
+
+	rem = (txq->qstats.lat.idx + n - cidx) % n;
+	in_use = (txq->q_pidx_info.pidx + n - cidx) % n;
+	if (rem == 0 || rem > in_use)
+		qdma_qlat_stop(&txq->qstats.lat);
+}
+
+/* Stop the Rx measurement at the first CMPT writeback after it started */
+static inline void qdma_rxq_qlat_check(struct qdma_rx_queue *rxq,
+		uint16_t cmpt_pidx)
+{
+	if (unlikely(rxq->qstats.lat.start_tsc) &&
+			cmpt_pidx != rxq->qstats.lat.idx)
+		qdma_qlat_stop(&rxq->qstats.lat);
 }
 
 bool is_qdma_supported(struct rte_eth_dev *dev);
@@ -491,6 +593,16 @@ uint16_t qdma_recv_pkts_vec(void *rx_queue,
 uint16_t qdma_recv_pkts_st_vec(struct qdma_rx_queue *rxq,
 		struct rte_mbuf **rx_pkts, uint16_t nb_pkts);
 
+/* AVX2 and AVX-512 Rx/Tx burst functions */
+uint16_t qdma_xmit_pkts_vec_avx2(void *tx_queue,
+		struct rte_mbuf **tx_pkts, uint16_t nb_pkts);
+uint16_t qdma_recv_pkts_vec_avx2(void *rx_queue,
+		struct rte_mbuf **rx_pkts, uint16_t nb_pkts);
+uint16_t qdma_xmit_pkts_vec_avx512(void *tx_queue,
+		struct rte_mbuf **tx_pkts, uint16_t nb_pkts);
+uint16_t qdma_recv_pkts_vec_avx512(void *rx_queue,
+		struct rte_mbuf **rx_pkts, uint16_t nb_pkts);
+
 void __rte_cold qdma_set_tx_function(struct rte_eth_dev *dev);
 void __rte_cold qdma_set_rx_function(struct rte_eth_dev *dev);
 
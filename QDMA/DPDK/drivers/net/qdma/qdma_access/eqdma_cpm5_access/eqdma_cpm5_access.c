@@ -2211,6 +2211,27 @@ static int eqdma_cpm5_indirect_reg_write(void *dev_hndl,
 	return QDMA_SUCCESS;
 }
 
+/*
+ * eqdma_cpm5_indirect_batch_cmd() - helper function to add an indirect
+ *				context command to a batch.
+ *
+ * return -QDMA_ERR_HWACC_BUSY_TIMEOUT if the previous command of the
+ *	batch didn't complete, QDMA_SUCCESS other wise
+ */
+static int eqdma_cpm5_indirect_batch_cmd(struct qdma_ind_ctxt_batch *batch,
+		enum ind_ctxt_cmd_sel sel, uint16_t hw_qid,
+		enum ind_ctxt_cmd_op op, uint32_t *data, uint16_t cnt)
+{
+	union qdma_ind_ctxt_cmd cmd;
+
+	cmd.word = 0;
+	cmd.bits.qid = hw_qid;
+	cmd.bits.op = op;
+	cmd.bits.sel = sel;
+
+	return qdma_ind_ctxt_batch_cmd(batch, cmd.word, data, cnt);
+}
+
 /*
  * eqdma_cpm5_fill_sw_ctxt() - Helper function to fill sw context into
  * structure
@@ -3098,12 +3119,14 @@ int eqdma_cpm5_get_version(void *dev_hndl, uint8_t is_vf,
  * @c2h:	is c2h queue
  * @hw_qid:	hardware qid of the queue
  * @ctxt:	pointer to the SW context data strucutre
+ * @batch:	batch to add the write to, NULL to write it directly
  *
  * Return:	0   - success and < 0 - failure
  *****************************************************************************/
 static int eqdma_cpm5_sw_context_write(void *dev_hndl, uint8_t c2h,
 			 uint16_t hw_qid,
-			 const struct qdma_descq_sw_ctxt *ctxt)
+			 const struct qdma_descq_sw_ctxt *ctxt,
+			 struct qdma_ind_ctxt_batch *batch)
 {
 	uint32_t sw_ctxt[EQDMA_CPM5_SW_CONTEXT_NUM_WORDS] = {0};
 	uint16_t num_words_count = 0;
@@ -3220,6 +3243,10 @@ static int eqdma_cpm5_sw_context_write(void *dev_hndl, uint8_t c2h,
 	qdma_log_debug("%s: vec=%x, intr_aggr=%x\n",
 			__func__, ctxt->vec, ctxt->intr_aggr);
 
+	if (batch)
+		return eqdma_cpm5_indirect_batch_cmd(batch, sel, hw_qid,
+				QDMA_CTXT_CMD_WR, sw_ctxt, num_words_count);
+
 	return eqdma_cpm5_indirect_reg_write(dev_hndl, sel, hw_qid,
 			sw_ctxt, num_words_count);
 }
@@ -3459,7 +3486,7 @@ int eqdma_cpm5_sw_ctx_conf(void *dev_hndl, uint8_t c2h, uint16_t hw_qid,
 		break;
 	case QDMA_HW_ACCESS_WRITE:
 		rv = eqdma_cpm5_sw_context_write(dev_hndl, c2h, hw_qid,
-				ctxt);
+				ctxt, NULL);
 		break;
 	case QDMA_HW_ACCESS_CLEAR:
 		rv = eqdma_cpm5_sw_context_clear(dev_hndl, c2h, hw_qid);
@@ -3488,11 +3515,13 @@ int eqdma_cpm5_sw_ctx_conf(void *dev_hndl, uint8_t c2h, uint16_t hw_qid,
  * @dev_hndl:	device handle
  * @hw_qid:	hardware qid of the queue
  * @ctxt:	pointer to the prefetch context data strucutre
+ * @batch:	batch to add the write to, NULL to write it directly
  *
  * Return:	0   - success and < 0 - failure
  *****************************************************************************/
 static int eqdma_cpm5_pfetch_context_write(void *dev_hndl, uint16_t hw_qid,
-		const struct qdma_descq_prefetch_ctxt *ctxt)
+		const struct qdma_descq_prefetch_ctxt *ctxt,
+		struct qdma_ind_ctxt_batch *batch)
 {
 	uint32_t pfetch_ctxt[EQDMA_CPM5_PFETCH_CONTEXT_NUM_WORDS] = {0};
 	enum ind_ctxt_cmd_sel sel = QDMA_CTXT_SEL_PFTCH;
@@ -3537,6 +3566,10 @@ static int eqdma_cpm5_pfetch_context_write(void *dev_hndl, uint16_t hw_qid,
 		FIELD_SET(PREFETCH_CTXT_DATA_W1_SW_CRDT_H_MASK, sw_crdt_h) |
 		FIELD_SET(PREFETCH_CTXT_DATA_W1_VALID_MASK, ctxt->valid);
 
+	if (batch)
+		return eqdma_cpm5_indirect_batch_cmd(batch, sel, hw_qid,
+				QDMA_CTXT_CMD_WR, pfetch_ctxt, num_words_count);
+
 	return eqdma_cpm5_indirect_reg_write(dev_hndl, sel, hw_qid,
 			pfetch_ctxt, num_words_count);
 }
@@ -3684,7 +3717,7 @@ int eqdma_cpm5_pfetch_ctx_conf(void *dev_hndl, uint16_t hw_qid,
 		break;
 	case QDMA_HW_ACCESS_WRITE:
 		rv = eqdma_cpm5_pfetch_context_write(dev_hndl, hw_qid,
-				ctxt);
+				ctxt, NULL);
 		break;
 	case QDMA_HW_ACCESS_CLEAR:
 		rv = eqdma_cpm5_pfetch_context_clear(dev_hndl, hw_qid);
@@ -3713,11 +3746,13 @@ int eqdma_cpm5_pfetch_ctx_conf(void *dev_hndl, uint16_t hw_qid,
  * @dev_hndl:	device handle
  * @hw_qid:	hardware qid of the queue
  * @ctxt:	pointer to the cmpt context data strucutre
+ * @batch:	batch to add the write to, NULL to write it directly
  *
  * Return:	0   - success and < 0 - failure
  *****************************************************************************/
 static int eqdma_cpm5_cmpt_context_write(void *dev_hndl, uint16_t hw_qid,
-			   const struct qdma_descq_cmpt_ctxt *ctxt)
+			   const struct qdma_descq_cmpt_ctxt *ctxt,
+			   struct qdma_ind_ctxt_batch *batch)
 {
 	uint32_t cmpt_ctxt[EQDMA_CPM5_CMPT_CONTEXT_NUM_WORDS] = {0};
 	uint16_t num_words_count = 0;
@@ -3832,6 +3867,10 @@ static int eqdma_cpm5_cmpt_context_write(void *dev_hndl, uint16_t hw_qid,
 		FIELD_SET(CMPL_CTXT_DATA_W5_VIO_EOP_MASK, ctxt->vio_eop) |
 		FIELD_SET(CMPL_CTXT_DATA_W5_SH_CMPT_MASK, ctxt->sh_cmpt);
 
+	if (batch)
+		return eqdma_cpm5_indirect_batch_cmd(batch, sel, hw_qid,
+				QDMA_CTXT_CMD_WR, cmpt_ctxt, num_words_count);
+
 	return eqdma_cpm5_indirect_reg_write(dev_hndl, sel, hw_qid,
 			cmpt_ctxt, num_words_count);
 }
@@ -4042,7 +4081,7 @@ int eqdma_cpm5_cmpt_ctx_conf(void *dev_hndl, uint16_t hw_qid,
 		rv = eqdma_cpm5_cmpt_context_read(dev_hndl, hw_qid, ctxt);
 		break;
 	case QDMA_HW_ACCESS_WRITE:
-		rv = eqdma_cpm5_cmpt_context_write(dev_hndl, hw_qid, ctxt);
+		rv = eqdma_cpm5_cmpt_context_write(dev_hndl, hw_qid, ctxt, NULL);
 		break;
 	case QDMA_HW_ACCESS_CLEAR:
 		rv = eqdma_cpm5_cmpt_context_clear(dev_hndl, hw_qid);
@@ -4062,6 +4101,114 @@ int eqdma_cpm5_cmpt_ctx_conf(void *dev_hndl, uint16_t hw_qid,
 	return rv;
 }
 
+/*
+ * eqdma_cpm5_queue_ctxt_prog_one() - add the context clear and write commands
+ *				of one queue to a batch.
+ *
+ * return < 0 on failure, QDMA_SUCCESS other wise
+ */
+static int eqdma_cpm5_queue_ctxt_prog_one(struct qdma_ind_ctxt_batch *batch,
+		struct qdma_descq_ctxt_prog *q)
+{
+	enum ind_ctxt_cmd_sel clr_sel[5];
+	uint8_t c2h = (q->q_type == QDMA_DEV_Q_TYPE_C2H) ? 1 : 0;
+	uint8_t st_c2h = (q->st && c2h) ? 1 : 0;
+	uint8_t cmpt = (st_c2h ||
+			(!q->st && (q->q_type == QDMA_DEV_Q_TYPE_CMPT))) ? 1 : 0;
+	uint8_t num_clr = 0, i;
+	int rv;
+
+	if (q->q_type != QDMA_DEV_Q_TYPE_CMPT) {
+		clr_sel[num_clr++] = c2h ?
+			QDMA_CTXT_SEL_SW_C2H : QDMA_CTXT_SEL_SW_H2C;
+		clr_sel[num_clr++] = c2h ?
+			QDMA_CTXT_SEL_HW_C2H : QDMA_CTXT_SEL_HW_H2C;
+		clr_sel[num_clr++] = c2h ?
+			QDMA_CTXT_SEL_CR_C2H : QDMA_CTXT_SEL_CR_H2C;
+	}
+	if (st_c2h)
+		clr_sel[num_clr++] = QDMA_CTXT_SEL_PFTCH;
+	if (cmpt)
+		clr_sel[num_clr++] = QDMA_CTXT_SEL_CMPT;
+
+	for (i = 0; i < num_clr; i++) {
+		rv = eqdma_cpm5_indirect_batch_cmd(batch, clr_sel[i], q->hw_qid,
+				QDMA_CTXT_CMD_CLR, NULL, 0);
+		if (rv < 0)
+			return rv;
+	}
+
+	if (!q->ctxt)
+		return QDMA_SUCCESS;
+
+	if (q->q_type != QDMA_DEV_Q_TYPE_CMPT) {
+		rv = eqdma_cpm5_sw_context_write(batch->dev_hndl, c2h, q->hw_qid,
+				&q->ctxt->sw_ctxt, batch);
+		if (rv < 0)
+			return rv;
+	}
+	if (st_c2h) {
+		rv = eqdma_cpm5_pfetch_context_write(batch->dev_hndl, q->hw_qid,
+				&q->ctxt->pfetch_ctxt, batch);
+		if (rv < 0)
+			return rv;
+	}
+	if (cmpt) {
+		rv = eqdma_cpm5_cmpt_context_write(batch->dev_hndl, q->hw_qid,
+				&q->ctxt->cmpt_ctxt, batch);
+		if (rv < 0)
+			return rv;
+	}
+
+	return QDMA_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+ * eqdma_cpm5_queue_ctxt_prog_batch() - clear and program the queue contexts of
+ *	a list of queues as one indirect context programming sequence
+ *
+ * @dev_hndl:	device handle
+ * @q_list:	list of queues and their contexts
+ * @num_q:	number of entries in q_list
+ *
+ * Return:	0   - success and < 0 - failure
+ *****************************************************************************/
+int eqdma_cpm5_queue_ctxt_prog_batch(void *dev_hndl,
+		struct qdma_descq_ctxt_prog *q_list, uint16_t num_q)
+{
+	struct qdma_ind_ctxt_batch batch;
+	uint16_t i;
+	int rv = QDMA_SUCCESS, ret;
+
+	if (!dev_hndl || !q_list || !num_q) {
+		qdma_log_error("%s: dev_handle=%p q_list=%p num_q=%u, err:%d\n",
+					   __func__, dev_hndl, q_list, num_q,
+					   -QDMA_ERR_INV_PARAM);
+		return -QDMA_ERR_INV_PARAM;
+	}
+
+	qdma_ind_ctxt_batch_start(&batch, dev_hndl,
+			EQDMA_CPM5_IND_CTXT_DATA_ADDR,
+			EQDMA_CPM5_IND_CTXT_MASK_ADDR,
+			EQDMA_CPM5_IND_CTXT_CMD_ADDR,
+			IND_CTXT_CMD_BUSY_MASK,
+			QDMA_IND_CTXT_DATA_NUM_REGS);
+
+	for (i = 0; i < num_q; i++) {
+		rv = eqdma_cpm5_queue_ctxt_prog_one(&batch, &q_list[i]);
+		if (rv < 0) {
+			qdma_log_error("%s: hw_qid=%u failed, err:%d\n",
+					__func__, q_list[i].hw_qid, rv);
+			break;
+		}
+	}
+
+	ret = qdma_ind_ctxt_batch_end(&batch);
+
+	return (rv < 0) ? rv : ret;
+}
+
 /*****************************************************************************/
 /**
  * eqdma_cpm5_hw_context_read() - read hardware context
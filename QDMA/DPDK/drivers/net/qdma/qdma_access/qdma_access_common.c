@@ -94,6 +94,144 @@ int hw_monitor_reg(void *dev_hndl, uint32_t reg, uint32_t mask,
 	return -QDMA_ERR_HWACC_BUSY_TIMEOUT;
 }
 
+/*****************************************************************************/
+/**
+ * qdma_ind_ctxt_batch_start() - start a batched indirect context
+ *	programming sequence, takes the register access lock
+ *
+ * @batch:	batch state to be initialized
+ * @dev_hndl:	device handle
+ * @data_addr:	address of the first context data register
+ * @mask_addr:	address of the first context mask register
+ * @cmd_addr:	address of the context command register
+ * @busy_mask:	busy bit of the context command register
+ * @num_regs:	number of context data/mask registers
+ *
+ * Return:	Nothing
+ *****************************************************************************/
+void qdma_ind_ctxt_batch_start(struct qdma_ind_ctxt_batch *batch,
+		void *dev_hndl, uint32_t data_addr, uint32_t mask_addr,
+		uint32_t cmd_addr, uint32_t busy_mask, uint16_t num_regs)
+{
+	qdma_memset(batch, 0, sizeof(struct qdma_ind_ctxt_batch));
+	batch->dev_hndl = dev_hndl;
+	batch->data_addr = data_addr;
+	batch->mask_addr = mask_addr;
+	batch->cmd_addr = cmd_addr;
+	batch->busy_mask = busy_mask;
+	batch->num_regs = num_regs;
+
+	qdma_reg_access_lock(dev_hndl);
+}
+
+/*
+ * qdma_ind_ctxt_batch_wait() - wait for the previous command of the batch
+ *
+ * return -QDMA_ERR_HWACC_BUSY_TIMEOUT if the command did not complete,
+ *	QDMA_SUCCESS other wise
+ */
+static int qdma_ind_ctxt_batch_wait(struct qdma_ind_ctxt_batch *batch)
+{
+	if (!batch->cmd_pend)
+		return QDMA_SUCCESS;
+
+	batch->cmd_pend = 0;
+	if (hw_monitor_reg(batch->dev_hndl, batch->cmd_addr,
+			batch->busy_mask, 0,
+			QDMA_REG_POLL_DFLT_INTERVAL_US,
+			QDMA_REG_POLL_DFLT_TIMEOUT_US)) {
+		qdma_log_error("%s: hw_monitor_reg failed with err:%d\n",
+				__func__, -QDMA_ERR_HWACC_BUSY_TIMEOUT);
+		return -QDMA_ERR_HWACC_BUSY_TIMEOUT;
+	}
+
+	return QDMA_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+ * qdma_ind_ctxt_batch_cmd() - issue one indirect context command as part
+ *	of a batch
+ *
+ * Clear and invalidate commands do not use the data registers and are
+ * issued back to back. The outstanding commands are only waited for
+ * before the data registers are rewritten for the next write command and
+ * by qdma_ind_ctxt_batch_end(), so a queue costs one busy poll per
+ * context it writes.
+ *
+ * Read commands are not supported, they would overwrite the data
+ * registers the batch keeps track of.
+ *
+ * @batch:	batch state
+ * @cmd:	encoded context command register value
+ * @data:	context data for write commands, NULL otherwise
+ * @cnt:	number of valid words in @data
+ *
+ * Return:	0   - success and < 0 - failure
+ *****************************************************************************/
+int qdma_ind_ctxt_batch_cmd(struct qdma_ind_ctxt_batch *batch,
+		uint32_t cmd, const uint32_t *data, uint16_t cnt)
+{
+	uint32_t index, val;
+	int rv;
+
+	if (cnt > batch->num_regs) {
+		qdma_log_error("%s: cnt(%d) > num_regs(%d), err:%d\n",
+				__func__, cnt, batch->num_regs,
+				-QDMA_ERR_INV_PARAM);
+		return -QDMA_ERR_INV_PARAM;
+	}
+
+	if (data) {
+		rv = qdma_ind_ctxt_batch_wait(batch);
+		if (rv < 0)
+			return rv;
+
+		for (index = 0; index < batch->num_regs; index++) {
+			val = (index < cnt) ? data[index] : 0;
+			if ((batch->data_valid & (1U << index)) &&
+					(batch->data[index] == val))
+				continue;
+			qdma_reg_write(batch->dev_hndl, batch->data_addr +
+					(index * sizeof(uint32_t)), val);
+			batch->data[index] = val;
+			batch->data_valid |= (1U << index);
+		}
+
+		if (!batch->mask_valid) {
+			for (index = 0; index < batch->num_regs; index++)
+				qdma_reg_write(batch->dev_hndl,
+						batch->mask_addr +
+						(index * sizeof(uint32_t)),
+						0xFFFFFFFF);
+			batch->mask_valid = 1;
+		}
+	}
+
+	qdma_reg_write(batch->dev_hndl, batch->cmd_addr, cmd);
+	batch->cmd_pend = 1;
+
+	return QDMA_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+ * qdma_ind_ctxt_batch_end() - complete a batched indirect context
+ *	programming sequence and release the register access lock
+ *
+ * @batch:	batch state
+ *
+ * Return:	0   - success and < 0 - failure
+ *****************************************************************************/
+int qdma_ind_ctxt_batch_end(struct qdma_ind_ctxt_batch *batch)
+{
+	int rv = qdma_ind_ctxt_batch_wait(batch);
+
+	qdma_reg_access_release(batch->dev_hndl);
+
+	return rv;
+}
+
 /*****************************************************************************/
 /**
  * qdma_get_rtl_version() - Function to get the rtl_version in
@@ -1353,6 +1491,7 @@ int qdma_hw_access_init(void *dev_hndl, uint8_t is_vf,
 	hw_access->qdma_hw_ctx_conf = &qdma_hw_ctx_conf;
 	hw_access->qdma_credit_ctx_conf = &qdma_credit_ctx_conf;
 	hw_access->qdma_indirect_intr_ctx_conf = &qdma_indirect_intr_ctx_conf;
+	hw_access->qdma_queue_ctxt_prog_batch = &qdma_queue_ctxt_prog_batch;
 	hw_access->qdma_set_default_global_csr = &qdma_set_default_global_csr;
 	hw_access->qdma_global_csr_conf = &qdma_global_csr_conf;
 	hw_access->qdma_global_writeback_interval_conf =
@@ -1414,6 +1553,8 @@ int qdma_hw_access_init(void *dev_hndl, uint8_t is_vf,
 				&qdma_cpm4_credit_ctx_conf;
 		hw_access->qdma_indirect_intr_ctx_conf =
 				&qdma_cpm4_indirect_intr_ctx_conf;
+		hw_access->qdma_queue_ctxt_prog_batch =
+				&qdma_cpm4_queue_ctxt_prog_batch;
 		hw_access->qdma_set_default_global_csr =
 					&qdma_cpm4_set_default_global_csr;
 		hw_access->qdma_queue_pidx_update =
@@ -1462,6 +1603,8 @@ int qdma_hw_access_init(void *dev_hndl, uint8_t is_vf,
 		hw_access->qdma_cmpt_ctx_conf = &eqdma_cpm5_cmpt_ctx_conf;
 		hw_access->qdma_indirect_intr_ctx_conf =
 				&eqdma_cpm5_indirect_intr_ctx_conf;
+		hw_access->qdma_queue_ctxt_prog_batch =
+				&eqdma_cpm5_queue_ctxt_prog_batch;
 		hw_access->qdma_dump_config_regs =
 			&eqdma_cpm5_dump_config_regs;
 		hw_access->qdma_dump_intr_context =
@@ -1508,6 +1651,8 @@ int qdma_hw_access_init(void *dev_hndl, uint8_t is_vf,
 		hw_access->qdma_cmpt_ctx_conf = &eqdma_cmpt_ctx_conf;
 		hw_access->qdma_indirect_intr_ctx_conf =
 				&eqdma_indirect_intr_ctx_conf;
+		hw_access->qdma_queue_ctxt_prog_batch =
+				&eqdma_queue_ctxt_prog_batch;
 		hw_access->qdma_dump_config_regs = &eqdma_dump_config_regs;
 		hw_access->qdma_dump_intr_context = &eqdma_dump_intr_context;
 		hw_access->qdma_hw_error_enable = &eqdma_hw_error_enable;
@@ -2455,6 +2455,27 @@ static int qdma_indirect_reg_write(void *dev_hndl, enum ind_ctxt_cmd_sel sel,
 	return QDMA_SUCCESS;
 }
 
+/*
+ * qdma_indirect_batch_cmd() - helper function to add an indirect
+ *				context command to a batch.
+ *
+ * return -QDMA_ERR_HWACC_BUSY_TIMEOUT if the previous command of the
+ *	batch didn't complete, QDMA_SUCCESS other wise
+ */
+static int qdma_indirect_batch_cmd(struct qdma_ind_ctxt_batch *batch,
+		enum ind_ctxt_cmd_sel sel, uint16_t hw_qid,
+		enum ind_ctxt_cmd_op op, uint32_t *data, uint16_t cnt)
+{
+	union qdma_ind_ctxt_cmd cmd;
+
+	cmd.word = 0;
+	cmd.bits.qid = hw_qid;
+	cmd.bits.op = op;
+	cmd.bits.sel = sel;
+
+	return qdma_ind_ctxt_batch_cmd(batch, cmd.word, data, cnt);
+}
+
 /*****************************************************************************/
 /**
  * qdma_get_version() - Function to get the qdma version
@@ -2630,12 +2651,14 @@ int qdma_fmap_conf(void *dev_hndl, uint16_t func_id,
  * @c2h:	is c2h queue
  * @hw_qid:	hardware qid of the queue
  * @ctxt:	pointer to the SW context data strucutre
+ * @batch:	batch to add the write to, NULL to write it directly
  *
  * Return:	0   - success and < 0 - failure
  *****************************************************************************/
 static int qdma_sw_context_write(void *dev_hndl, uint8_t c2h,
 			 uint16_t hw_qid,
-			 const struct qdma_descq_sw_ctxt *ctxt)
+			 const struct qdma_descq_sw_ctxt *ctxt,
+			 struct qdma_ind_ctxt_batch *batch)
 {
 	uint32_t sw_ctxt[QDMA_SW_CONTEXT_NUM_WORDS] = {0};
 	uint16_t num_words_count = 0;
@@ -2708,6 +2731,10 @@ static int qdma_sw_context_write(void *dev_hndl, uint8_t c2h,
 	qdma_log_debug("%s: vec=%x, intr_aggr=%x\n",
 			__func__, ctxt->vec, ctxt->intr_aggr);
 
+	if (batch)
+		return qdma_indirect_batch_cmd(batch, sel, hw_qid,
+				QDMA_CTXT_CMD_WR, sw_ctxt, num_words_count);
+
 	return qdma_indirect_reg_write(dev_hndl, sel, hw_qid,
 			sw_ctxt, num_words_count);
 }
@@ -2902,7 +2929,7 @@ int qdma_sw_ctx_conf(void *dev_hndl, uint8_t c2h, uint16_t hw_qid,
 		rv = qdma_sw_context_read(dev_hndl, c2h, hw_qid, ctxt);
 		break;
 	case QDMA_HW_ACCESS_WRITE:
-		rv = qdma_sw_context_write(dev_hndl, c2h, hw_qid, ctxt);
+		rv = qdma_sw_context_write(dev_hndl, c2h, hw_qid, ctxt, NULL);
 		break;
 	case QDMA_HW_ACCESS_CLEAR:
 		rv = qdma_sw_context_clear(dev_hndl, c2h, hw_qid);
@@ -2929,11 +2956,13 @@ int qdma_sw_ctx_conf(void *dev_hndl, uint8_t c2h, uint16_t hw_qid,
  * @dev_hndl:	device handle
  * @hw_qid:	hardware qid of the queue
  * @ctxt:	pointer to the prefetch context data strucutre
+ * @batch:	batch to add the write to, NULL to write it directly
  *
  * Return:	0   - success and < 0 - failure
  *****************************************************************************/
 static int qdma_pfetch_context_write(void *dev_hndl, uint16_t hw_qid,
-		const struct qdma_descq_prefetch_ctxt *ctxt)
+		const struct qdma_descq_prefetch_ctxt *ctxt,
+		struct qdma_ind_ctxt_batch *batch)
 {
 	uint32_t pfetch_ctxt[QDMA_PFETCH_CONTEXT_NUM_WORDS] = {0};
 	enum ind_ctxt_cmd_sel sel = QDMA_CTXT_SEL_PFTCH;
@@ -2974,6 +3003,10 @@ static int qdma_pfetch_context_write(void *dev_hndl, uint16_t hw_qid,
 		FIELD_SET(QDMA_PFTCH_CTXT_W1_SW_CRDT_H_MASK, sw_crdt_h) |
 		FIELD_SET(QDMA_PFTCH_CTXT_W1_VALID_MASK, ctxt->valid);
 
+	if (batch)
+		return qdma_indirect_batch_cmd(batch, sel, hw_qid,
+				QDMA_CTXT_CMD_WR, pfetch_ctxt, num_words_count);
+
 	return qdma_indirect_reg_write(dev_hndl, sel, hw_qid,
 			pfetch_ctxt, num_words_count);
 }
@@ -3112,7 +3145,7 @@ int qdma_pfetch_ctx_conf(void *dev_hndl, uint16_t hw_qid,
 		rv = qdma_pfetch_context_read(dev_hndl, hw_qid, ctxt);
 		break;
 	case QDMA_HW_ACCESS_WRITE:
-		rv = qdma_pfetch_context_write(dev_hndl, hw_qid, ctxt);
+		rv = qdma_pfetch_context_write(dev_hndl, hw_qid, ctxt, NULL);
 		break;
 	case QDMA_HW_ACCESS_CLEAR:
 		rv = qdma_pfetch_context_clear(dev_hndl, hw_qid);
@@ -3139,11 +3172,13 @@ int qdma_pfetch_ctx_conf(void *dev_hndl, uint16_t hw_qid,
  * @dev_hndl:	device handle
  * @hw_qid:	hardware qid of the queue
  * @ctxt:	pointer to the cmpt context data strucutre
+ * @batch:	batch to add the write to, NULL to write it directly
  *
  * Return:	0   - success and < 0 - failure
  *****************************************************************************/
 static int qdma_cmpt_context_write(void *dev_hndl, uint16_t hw_qid,
-			   const struct qdma_descq_cmpt_ctxt *ctxt)
+			   const struct qdma_descq_cmpt_ctxt *ctxt,
+			   struct qdma_ind_ctxt_batch *batch)
 {
 	uint32_t cmpt_ctxt[QDMA_CMPT_CONTEXT_NUM_WORDS] = {0};
 	uint16_t num_words_count = 0;
@@ -3228,6 +3263,10 @@ static int qdma_cmpt_context_write(void *dev_hndl, uint16_t hw_qid,
 		FIELD_SET(QDMA_COMPL_CTXT_W4_INTR_AGGR_MASK,
 				ctxt->higher_dword.bit.int_aggr);
 
+	if (batch)
+		return qdma_indirect_batch_cmd(batch, sel, hw_qid,
+				QDMA_CTXT_CMD_WR, cmpt_ctxt, num_words_count);
+
 	return qdma_indirect_reg_write(dev_hndl, sel, hw_qid,
 			cmpt_ctxt, num_words_count);
 }
@@ -3396,7 +3435,7 @@ int qdma_cmpt_ctx_conf(void *dev_hndl, uint16_t hw_qid,
 		rv = qdma_cmpt_context_read(dev_hndl, hw_qid, ctxt);
 		break;
 	case QDMA_HW_ACCESS_WRITE:
-		rv = qdma_cmpt_context_write(dev_hndl, hw_qid, ctxt);
+		rv = qdma_cmpt_context_write(dev_hndl, hw_qid, ctxt, NULL);
 		break;
 	case QDMA_HW_ACCESS_CLEAR:
 		rv = qdma_cmpt_context_clear(dev_hndl, hw_qid);
@@ -3416,6 +3455,114 @@ int qdma_cmpt_ctx_conf(void *dev_hndl, uint16_t hw_qid,
 	return rv;
 }
 
+/*
+ * qdma_queue_ctxt_prog_one() - add the context clear and write commands
+ *				of one queue to a batch.
+ *
+ * return < 0 on failure, QDMA_SUCCESS other wise
+ */
+static int qdma_queue_ctxt_prog_one(struct qdma_ind_ctxt_batch *batch,
+		struct qdma_descq_ctxt_prog *q)
+{
+	enum ind_ctxt_cmd_sel clr_sel[5];
+	uint8_t c2h = (q->q_type == QDMA_DEV_Q_TYPE_C2H) ? 1 : 0;
+	uint8_t st_c2h = (q->st && c2h) ? 1 : 0;
+	uint8_t cmpt = (st_c2h ||
+			(!q->st && (q->q_type == QDMA_DEV_Q_TYPE_CMPT))) ? 1 : 0;
+	uint8_t num_clr = 0, i;
+	int rv;
+
+	if (q->q_type != QDMA_DEV_Q_TYPE_CMPT) {
+		clr_sel[num_clr++] = c2h ?
+			QDMA_CTXT_SEL_SW_C2H : QDMA_CTXT_SEL_SW_H2C;
+		clr_sel[num_clr++] = c2h ?
+			QDMA_CTXT_SEL_HW_C2H : QDMA_CTXT_SEL_HW_H2C;
+		clr_sel[num_clr++] = c2h ?
+			QDMA_CTXT_SEL_CR_C2H : QDMA_CTXT_SEL_CR_H2C;
+	}
+	if (st_c2h)
+		clr_sel[num_clr++] = QDMA_CTXT_SEL_PFTCH;
+	if (cmpt)
+		clr_sel[num_clr++] = QDMA_CTXT_SEL_CMPT;
+
+	for (i = 0; i < num_clr; i++) {
+		rv = qdma_indirect_batch_cmd(batch, clr_sel[i], q->hw_qid,
+				QDMA_CTXT_CMD_CLR, NULL, 0);
+		if (rv < 0)
+			return rv;
+	}
+
+	if (!q->ctxt)
+		return QDMA_SUCCESS;
+
+	if (q->q_type != QDMA_DEV_Q_TYPE_CMPT) {
+		rv = qdma_sw_context_write(batch->dev_hndl, c2h, q->hw_qid,
+				&q->ctxt->sw_ctxt, batch);
+		if (rv < 0)
+			return rv;
+	}
+	if (st_c2h) {
+		rv = qdma_pfetch_context_write(batch->dev_hndl, q->hw_qid,
+				&q->ctxt->pfetch_ctxt, batch);
+		if (rv < 0)
+			return rv;
+	}
+	if (cmpt) {
+		rv = qdma_cmpt_context_write(batch->dev_hndl, q->hw_qid,
+				&q->ctxt->cmpt_ctxt, batch);
+		if (rv < 0)
+			return rv;
+	}
+
+	return QDMA_SUCCESS;
+}
+
+/*****************************************************************************/
+/**
+ * qdma_queue_ctxt_prog_batch() - clear and program the queue contexts of
+ *	a list of queues as one indirect context programming sequence
+ *
+ * @dev_hndl:	device handle
+ * @q_list:	list of queues and their contexts
+ * @num_q:	number of entries in q_list
+ *
+ * Return:	0   - success and < 0 - failure
+ *****************************************************************************/
+int qdma_queue_ctxt_prog_batch(void *dev_hndl,
+		struct qdma_descq_ctxt_prog *q_list, uint16_t num_q)
+{
+	struct qdma_ind_ctxt_batch batch;
+	uint16_t i;
+	int rv = QDMA_SUCCESS, ret;
+
+	if (!dev_hndl || !q_list || !num_q) {
+		qdma_log_error("%s: dev_handle=%p q_list=%p num_q=%u, err:%d\n",
+					   __func__, dev_hndl, q_list, num_q,
+					   -QDMA_ERR_INV_PARAM);
+		return -QDMA_ERR_INV_PARAM;
+	}
+
+	qdma_ind_ctxt_batch_start(&batch, dev_hndl,
+			QDMA_OFFSET_IND_CTXT_DATA,
+			QDMA_OFFSET_IND_CTXT_MASK,
+			QDMA_OFFSET_IND_CTXT_CMD,
+			QDMA_IND_CTXT_CMD_BUSY_MASK,
+			QDMA_IND_CTXT_DATA_NUM_REGS);
+
+	for (i = 0; i < num_q; i++) {
+		rv = qdma_queue_ctxt_prog_one(&batch, &q_list[i]);
+		if (rv < 0) {
+			qdma_log_error("%s: hw_qid=%u failed, err:%d\n",
+					__func__, q_list[i].hw_qid, rv);
+			break;
+		}
+	}
+
+	ret = qdma_ind_ctxt_batch_end(&batch);
+
+	return (rv < 0) ? rv : ret;
+}
+
 /*****************************************************************************/
 /**
  * qdma_hw_context_read() - read hardware context
@@ -36,10 +36,12 @@
 #include <rte_common.h>
 #include <rte_cycles.h>
 #include <rte_kvargs.h>
+#include <rte_memzone.h>
 #include "qdma.h"
 #include "qdma_access_common.h"
 #include <fcntl.h>
 #include <unistd.h>
+#include <string.h>
 
 /* Read register */
 uint32_t qdma_read_reg(uint64_t reg_addr)
@@ -262,6 +264,7 @@ void qdma_reset_tx_queue(struct qdma_tx_queue *txq)
 	uint32_t sz;
 
 	txq->tx_fl_tail = 0;
+	txq->tx_desc_pend = 0;
 	if (txq->st_mode) {  /** ST-mode **/
 		sz = sizeof(struct qdma_ul_st_h2c_desc);
 		/* Zero out HW ring memory */
@@ -339,6 +342,181 @@ int index_of_array(uint32_t *arr, uint32_t n, uint32_t element)
 	return -1;
 }
 
+static const struct rte_memzone *qdma_zone_reserve(struct rte_eth_dev *dev,
+					const char *ring_name,
+					uint32_t queue_id,
+					uint64_t size,
+					int socket_id,
+					unsigned int flags)
+{
+	char z_name[RTE_MEMZONE_NAMESIZE];
+
+	snprintf(z_name, sizeof(z_name), "%s%s%d_%u",
+			dev->device->driver->name, ring_name,
+			dev->data->port_id, queue_id);
+	return rte_memzone_reserve_aligned(z_name, size, socket_id, flags,
+						QDMA_ALIGN);
+}
+
+/* Returns the ring arena of the port, reserving it on first use */
+static struct qdma_ring_arena *qdma_ring_arena_get(struct rte_eth_dev *dev,
+					int socket_id)
+{
+	struct qdma_pci_dev *qdma_dev = dev->data->dev_private;
+	struct qdma_ring_arena *arena = qdma_dev->ring_arena;
+	const struct rte_memzone *mz;
+	uint32_t nb_pages;
+	int arena_socket;
+
+	if (arena != NULL) {
+		if (socket_id != SOCKET_ID_ANY &&
+				socket_id != arena->mz->socket_id)
+			return NULL;
+		return arena;
+	}
+
+	if (!qdma_dev->ring_arena_mb)
+		return NULL;
+
+	/* Place the arena next to the device, the queue socket is only
+	 * used if the device does not report one
+	 */
+	arena_socket = dev->device->numa_node;
+	if (arena_socket < 0)
+		arena_socket = socket_id;
+
+	nb_pages = (uint32_t)(((uint64_t)qdma_dev->ring_arena_mb << 20) /
+				QDMA_ALIGN);
+	mz = qdma_zone_reserve(dev, "RingArena", 0,
+			(uint64_t)nb_pages * QDMA_ALIGN, arena_socket,
+			RTE_MEMZONE_IOVA_CONTIG);
+	if (mz == NULL) {
+		PMD_DRV_LOG(ERR, "Unable to reserve a ring arena of %u MB on "
+				"socket %d, falling back to a memzone per "
+				"ring\n", qdma_dev->ring_arena_mb, arena_socket);
+		qdma_dev->ring_arena_mb = 0;
+		return NULL;
+	}
+
+	arena = rte_zmalloc_socket("RingArena", sizeof(*arena) +
+				nb_pages * sizeof(arena->run[0]),
+				RTE_CACHE_LINE_SIZE, mz->socket_id);
+	if (arena == NULL) {
+		rte_memzone_free(mz);
+		qdma_dev->ring_arena_mb = 0;
+		return NULL;
+	}
+	arena->mz = mz;
+	arena->nb_pages = nb_pages;
+	arena->nb_free = nb_pages;
+	qdma_dev->ring_arena = arena;
+
+	PMD_DRV_LOG(INFO, "Ring arena of %u MB reserved on socket %d\n",
+			qdma_dev->ring_arena_mb, mz->socket_id);
+
+	if (socket_id != SOCKET_ID_ANY && socket_id != mz->socket_id)
+		return NULL;
+	return arena;
+}
+
+static int qdma_ring_arena_carve(struct qdma_ring_arena *arena,
+			struct qdma_ring_mem *mem, uint32_t ring_size)
+{
+	uint32_t n = RTE_ALIGN_CEIL(ring_size, QDMA_ALIGN) / QDMA_ALIGN;
+	uint32_t pg = 0, len = 0;
+
+	if (n > arena->nb_free)
+		return -ENOMEM;
+
+	/* Allocated rings are skipped as a whole, so a non zero run is
+	 * always met at the start of a ring
+	 */
+	while (pg + len < arena->nb_pages) {
+		if (arena->run[pg + len]) {
+			pg += len + arena->run[pg + len];
+			len = 0;
+			continue;
+		}
+		if (++len == n)
+			break;
+	}
+	if (len < n)
+		return -ENOMEM;
+
+	arena->run[pg] = n;
+	arena->nb_free -= n;
+	mem->mz = NULL;
+	mem->arena = arena;
+	mem->addr = RTE_PTR_ADD(arena->mz->addr, (size_t)pg * QDMA_ALIGN);
+	mem->iova = arena->mz->iova + (rte_iova_t)pg * QDMA_ALIGN;
+	memset(mem->addr, 0, (size_t)n * QDMA_ALIGN);
+
+	return 0;
+}
+
+/* Reserves a descriptor ring from the ring arena of the port, or from a
+ * memzone of its own if there is no arena on the requested socket or it
+ * is full. Returns the virtual address of the ring, NULL on failure.
+ */
+void *qdma_ring_reserve(struct rte_eth_dev *dev,
+			struct qdma_ring_mem *mem,
+			const char *ring_name,
+			uint32_t queue_id,
+			uint32_t ring_size,
+			int socket_id)
+{
+	struct qdma_ring_arena *arena;
+
+	memset(mem, 0, sizeof(*mem));
+
+	arena = qdma_ring_arena_get(dev, socket_id);
+	if (arena != NULL && !qdma_ring_arena_carve(arena, mem, ring_size))
+		return mem->addr;
+
+	mem->mz = qdma_zone_reserve(dev, ring_name, queue_id, ring_size,
+					socket_id, 0);
+	if (mem->mz == NULL)
+		return NULL;
+	mem->addr = mem->mz->addr;
+	mem->iova = mem->mz->iova;
+
+	return mem->addr;
+}
+
+/* Returns a descriptor ring to the arena or frees its memzone */
+void qdma_ring_release(struct qdma_ring_mem *mem)
+{
+	struct qdma_ring_arena *arena = mem->arena;
+	uint32_t pg;
+
+	if (mem->mz != NULL) {
+		rte_memzone_free(mem->mz);
+	} else if (arena != NULL) {
+		pg = (uint32_t)(RTE_PTR_DIFF(mem->addr, arena->mz->addr) /
+				QDMA_ALIGN);
+		arena->nb_free += arena->run[pg];
+		arena->run[pg] = 0;
+	}
+	memset(mem, 0, sizeof(*mem));
+}
+
+/* Frees the ring arena once all queues of the port are released */
+void qdma_ring_arena_free(struct rte_eth_dev *dev)
+{
+	struct qdma_pci_dev *qdma_dev = dev->data->dev_private;
+	struct qdma_ring_arena *arena = qdma_dev->ring_arena;
+
+	if (arena == NULL)
+		return;
+
+	if (arena->nb_free != arena->nb_pages)
+		PMD_DRV_LOG(ERR, "Ring arena freed with %u pages in use\n",
+				arena->nb_pages - arena->nb_free);
+	rte_memzone_free(arena->mz);
+	rte_free(arena);
+	qdma_dev->ring_arena = NULL;
+}
+
 static int pfetch_check_handler(__rte_unused const char *key,
 					const char *value,  void *opaque)
 {
@@ -451,6 +629,125 @@ static int h2c_byp_mode_check_handler(__rte_unused const char *key,
 
 	return 0;
 }
+static int dma_queues_handler(__rte_unused const char *key,
+					const char *value,  void *opaque)
+{
+	struct qdma_pci_dev *qdma_dev = (struct qdma_pci_dev *)opaque;
+	char *end = NULL;
+	unsigned long num;
+
+	PMD_DRV_LOG(INFO, "QDMA devargs dma_queues is: %s\n", value);
+	num = strtoul(value, &end, 10);
+
+	if (num > qdma_dev->dev_cap.num_qs) {
+		PMD_DRV_LOG(INFO, "QDMA devargs incorrect"
+				" dma_queues =%lu specified\n", num);
+		return -1;
+	}
+	qdma_dev->dma_queues = (uint16_t)num;
+
+	return 0;
+}
+
+static int tx_db_profile_handler(__rte_unused const char *key,
+					const char *value,  void *opaque)
+{
+	struct qdma_pci_dev *qdma_dev = (struct qdma_pci_dev *)opaque;
+
+	PMD_DRV_LOG(INFO, "QDMA devargs tx_db_profile is: %s\n", value);
+	if (!strcmp(value, "latency")) {
+		qdma_dev->tx_db_thresh = QDMA_TX_DB_THRESH_LATENCY;
+		qdma_dev->tx_db_hold_us = QDMA_TX_DB_HOLD_US_LATENCY;
+	} else if (!strcmp(value, "throughput")) {
+		qdma_dev->tx_db_thresh = QDMA_TX_DB_THRESH_THROUGHPUT;
+		qdma_dev->tx_db_hold_us = QDMA_TX_DB_HOLD_US_THROUGHPUT;
+	} else {
+		PMD_DRV_LOG(INFO, "QDMA devargs incorrect"
+				" tx_db_profile =%s specified\n", value);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int tx_db_thresh_handler(__rte_unused const char *key,
+					const char *value,  void *opaque)
+{
+	struct qdma_pci_dev *qdma_dev = (struct qdma_pci_dev *)opaque;
+	char *end = NULL;
+	unsigned long num;
+
+	PMD_DRV_LOG(INFO, "QDMA devargs tx_db_thresh is: %s\n", value);
+	num = strtoul(value, &end, 10);
+
+	if (num == 0 || num > UINT16_MAX) {
+		PMD_DRV_LOG(INFO, "QDMA devargs incorrect"
+				" tx_db_thresh =%lu specified\n", num);
+		return -1;
+	}
+	qdma_dev->tx_db_thresh = (uint16_t)num;
+
+	return 0;
+}
+
+static int tx_db_hold_us_handler(__rte_unused const char *key,
+					const char *value,  void *opaque)
+{
+	struct qdma_pci_dev *qdma_dev = (struct qdma_pci_dev *)opaque;
+	char *end = NULL;
+	unsigned long num;
+
+	PMD_DRV_LOG(INFO, "QDMA devargs tx_db_hold_us is: %s\n", value);
+	num = strtoul(value, &end, 10);
+
+	if (num > QDMA_TX_DB_HOLD_US_MAX) {
+		PMD_DRV_LOG(INFO, "QDMA devargs incorrect"
+				" tx_db_hold_us =%lu specified\n", num);
+		return -1;
+	}
+	qdma_dev->tx_db_hold_us = (uint32_t)num;
+
+	return 0;
+}
+
+static int ring_arena_handler(__rte_unused const char *key,
+					const char *value,  void *opaque)
+{
+	struct qdma_pci_dev *qdma_dev = (struct qdma_pci_dev *)opaque;
+	char *end = NULL;
+	unsigned long num;
+
+	PMD_DRV_LOG(INFO, "QDMA devargs ring_arena is: %s\n", value);
+	num = strtoul(value, &end, 10);
+	if (num > QDMA_RING_ARENA_MB_MAX) {
+		PMD_DRV_LOG(ERR, "QDMA devargs incorrect"
+				" ring_arena =%lu specified\n", num);
+		return -1;
+	}
+	qdma_dev->ring_arena_mb = (uint32_t)num;
+
+	return 0;
+}
+
+static int qlat_handler(__rte_unused const char *key,
+					const char *value,  void *opaque)
+{
+	struct qdma_pci_dev *qdma_dev = (struct qdma_pci_dev *)opaque;
+	char *end = NULL;
+	unsigned long num;
+
+	PMD_DRV_LOG(INFO, "QDMA devargs qlat is: %s\n", value);
+	num = strtoul(value, &end, 10);
+	if (num > 1) {
+		PMD_DRV_LOG(ERR, "QDMA devargs incorrect"
+				" qlat =%lu specified\n", num);
+		return -1;
+	}
+	qdma_dev->qlat_en = (uint8_t)num;
+
+	return 0;
+}
+
 #ifdef TANDEM_BOOT_SUPPORTED
 static int en_st_mode_check_handler(__rte_unused const char *key,
 					const char *value,  void *opaque)
@@ -482,6 +779,12 @@ int qdma_check_kvargs(struct rte_devargs *devargs,
 	const char *config_bar_key    = "config_bar";
 	const char *c2h_byp_mode_key  = "c2h_byp_mode";
 	const char *h2c_byp_mode_key  = "h2c_byp_mode";
+	const char *dma_queues_key    = "dma_queues";
+	const char *tx_db_profile_key = "tx_db_profile";
+	const char *tx_db_thresh_key  = "tx_db_thresh";
+	const char *tx_db_hold_us_key = "tx_db_hold_us";
+	const char *qlat_key          = "qlat";
+	const char *ring_arena_key    = "ring_arena";
 #ifdef TANDEM_BOOT_SUPPORTED
 	const char *en_st_key         = "en_st";
 #endif
@@ -554,6 +857,66 @@ int qdma_check_kvargs(struct rte_devargs *devargs,
 		}
 	}
 
+	/* process dma_queues*/
+	if (rte_kvargs_count(kvlist, dma_queues_key)) {
+		ret = rte_kvargs_process(kvlist, dma_queues_key,
+					  dma_queues_handler, qdma_dev);
+		if (ret) {
+			rte_kvargs_free(kvlist);
+			return ret;
+		}
+	}
+
+	/* process tx_db_profile, before the values it may be refined with */
+	if (rte_kvargs_count(kvlist, tx_db_profile_key)) {
+		ret = rte_kvargs_process(kvlist, tx_db_profile_key,
+					  tx_db_profile_handler, qdma_dev);
+		if (ret) {
+			rte_kvargs_free(kvlist);
+			return ret;
+		}
+	}
+
+	/* process tx_db_thresh*/
+	if (rte_kvargs_count(kvlist, tx_db_thresh_key)) {
+		ret = rte_kvargs_process(kvlist, tx_db_thresh_key,
+					  tx_db_thresh_handler, qdma_dev);
+		if (ret) {
+			rte_kvargs_free(kvlist);
+			return ret;
+		}
+	}
+
+	/* process tx_db_hold_us*/
+	if (rte_kvargs_count(kvlist, tx_db_hold_us_key)) {
+		ret = rte_kvargs_process(kvlist, tx_db_hold_us_key,
+					  tx_db_hold_us_handler, qdma_dev);
+		if (ret) {
+			rte_kvargs_free(kvlist);
+			return ret;
+		}
+	}
+
+	/* process qlat*/
+	if (rte_kvargs_count(kvlist, qlat_key)) {
+		ret = rte_kvargs_process(kvlist, qlat_key,
+					  qlat_handler, qdma_dev);
+		if (ret) {
+			rte_kvargs_free(kvlist);
+			return ret;
+		}
+	}
+
+	/* process ring_arena*/
+	if (rte_kvargs_count(kvlist, ring_arena_key)) {
+		ret = rte_kvargs_process(kvlist, ring_arena_key,
+					  ring_arena_handler, qdma_dev);
+		if (ret) {
+			rte_kvargs_free(kvlist);
+			return ret;
+		}
+	}
+
 #ifdef TANDEM_BOOT_SUPPORTED
 	/* Enable ST */
 	if (rte_kvargs_count(kvlist, en_st_key)) {
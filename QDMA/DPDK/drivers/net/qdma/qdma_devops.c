@@ -562,29 +562,27 @@ int qdma_dev_rx_queue_setup(struct rte_eth_dev *dev, uint16_t rx_queue_id,
 			sz = (rxq->nb_rx_desc) *
 					sizeof(struct qdma_ul_st_c2h_desc);
 
-		rxq->rx_mz = qdma_zone_reserve(dev, "RxHwRn", rx_queue_id,
-						sz, socket_id);
-		if (!rxq->rx_mz) {
-			PMD_DRV_LOG(ERR, "Unable to allocate rxq->rx_mz "
+		rxq->rx_ring = qdma_ring_reserve(dev, &rxq->rx_mem, "RxHwRn",
+						rx_queue_id, sz, socket_id);
+		if (!rxq->rx_ring) {
+			PMD_DRV_LOG(ERR, "Unable to allocate rxq->rx_ring "
 					"of size %d\n", sz);
 			err = -ENOMEM;
 			goto rx_setup_err;
 		}
-		rxq->rx_ring = rxq->rx_mz->addr;
 		memset(rxq->rx_ring, 0, sz);
 
 		/* Allocate memory for Rx completion(CMPT) descriptor ring */
 		sz = (rxq->nb_rx_cmpt_desc) * rxq->cmpt_desc_len;
-		rxq->rx_cmpt_mz = qdma_zone_reserve(dev, "RxHwCmptRn",
-						    rx_queue_id, sz, socket_id);
-		if (!rxq->rx_cmpt_mz) {
-			PMD_DRV_LOG(ERR, "Unable to allocate rxq->rx_cmpt_mz "
+		rxq->cmpt_ring = (union qdma_ul_st_cmpt_ring *)
+			qdma_ring_reserve(dev, &rxq->rx_cmpt_mem, "RxHwCmptRn",
+					  rx_queue_id, sz, socket_id);
+		if (!rxq->cmpt_ring) {
+			PMD_DRV_LOG(ERR, "Unable to allocate rxq->cmpt_ring "
 					"of size %d\n", sz);
 			err = -ENOMEM;
 			goto rx_setup_err;
 		}
-		rxq->cmpt_ring =
-			(union qdma_ul_st_cmpt_ring *)rxq->rx_cmpt_mz->addr;
 
 		/* Write-back status structure */
 		rxq->wb_status = (struct wb_status *)((uint64_t)rxq->cmpt_ring +
@@ -604,19 +602,18 @@ int qdma_dev_rx_queue_setup(struct rte_eth_dev *dev, uint16_t rx_queue_id,
 			sz = (rxq->nb_rx_desc) * (rxq->bypass_desc_sz);
 		else
 			sz = (rxq->nb_rx_desc) * sizeof(struct qdma_ul_mm_desc);
-		rxq->rx_mz = qdma_zone_reserve(dev, "RxHwRn",
+		rxq->rx_ring = qdma_ring_reserve(dev, &rxq->rx_mem, "RxHwRn",
 						rx_queue_id, sz, socket_id);
-		if (!rxq->rx_mz) {
-			PMD_DRV_LOG(ERR, "Unable to allocate rxq->rx_mz "
+		if (!rxq->rx_ring) {
+			PMD_DRV_LOG(ERR, "Unable to allocate rxq->rx_ring "
 					"of size %d\n", sz);
 			err = -ENOMEM;
 			goto rx_setup_err;
 		}
-		rxq->rx_ring = rxq->rx_mz->addr;
-		rx_ring_mm = (struct qdma_ul_mm_desc *)rxq->rx_mz->addr;
+		rx_ring_mm = (struct qdma_ul_mm_desc *)rxq->rx_ring;
 		memset(rxq->rx_ring, 0, sz);
 
-		rx_ring_bypass = (uint8_t *)rxq->rx_mz->addr;
+		rx_ring_bypass = (uint8_t *)rxq->rx_ring;
 		if (rxq->en_bypass &&
 			(rxq->bypass_desc_sz != 0))
 			rxq->wb_status = (struct wb_status *)&
@@ -640,18 +637,9 @@ int qdma_dev_rx_queue_setup(struct rte_eth_dev *dev, uint16_t rx_queue_id,
 
 	qdma_rxq_default_mbuf_init(rxq);
 
+	rxq->qlat_en = qdma_dev->qlat_en;
 	dev->data->rx_queues[rx_queue_id] = rxq;
 
-#ifdef LATENCY_MEASUREMENT
-	err = qdma_rx_qstats_clear(dev, rx_queue_id);
-	if (err) {
-		PMD_DRV_LOG(ERR,
-			"Failed to clear QDMA Rx queue stats for qid: %d\n",
-			rx_queue_id);
-		return err;
-	}
-#endif
-
 	return 0;
 
 rx_setup_err:
@@ -677,8 +665,8 @@ rx_setup_err:
 	}
 
 	if (rxq) {
-		if (rxq->rx_mz)
-			rte_memzone_free(rxq->rx_mz);
+		qdma_ring_release(&rxq->rx_cmpt_mem);
+		qdma_ring_release(&rxq->rx_mem);
 		if (rxq->sw_ring)
 			rte_free(rxq->sw_ring);
 		rte_free(rxq);
@@ -772,6 +760,7 @@ int qdma_dev_tx_queue_setup(struct rte_eth_dev *dev, uint16_t tx_queue_id,
 	txq->func_id = qdma_dev->func_id;
 	txq->num_queues = dev->data->nb_tx_queues;
 	txq->tx_deferred_start = tx_conf->tx_deferred_start;
+	txq->offloads = tx_conf->offloads | dev->data->dev_conf.txmode.offloads;
 
 	txq->ringszidx = index_of_array(qdma_dev->g_ring_sz,
 					QDMA_NUM_RING_SIZES, txq->nb_tx_desc);
@@ -819,16 +808,15 @@ int qdma_dev_tx_queue_setup(struct rte_eth_dev *dev, uint16_t tx_queue_id,
 		else
 			sz = (txq->nb_tx_desc) *
 					sizeof(struct qdma_ul_st_h2c_desc);
-		txq->tx_mz = qdma_zone_reserve(dev, "TxHwRn", tx_queue_id, sz,
-						socket_id);
-		if (!txq->tx_mz) {
+		txq->tx_ring = qdma_ring_reserve(dev, &txq->tx_mem, "TxHwRn",
+						tx_queue_id, sz, socket_id);
+		if (!txq->tx_ring) {
 			PMD_DRV_LOG(ERR, "Couldn't reserve memory for "
 					"ST H2C ring of size %d\n", sz);
 			err = -ENOMEM;
 			goto tx_setup_err;
 		}
 
-		txq->tx_ring = txq->tx_mz->addr;
 		tx_ring_st = (struct qdma_ul_st_h2c_desc *)txq->tx_ring;
 
 		tx_ring_bypass = (uint8_t *)txq->tx_ring;
@@ -854,16 +842,15 @@ int qdma_dev_tx_queue_setup(struct rte_eth_dev *dev, uint16_t tx_queue_id,
 			sz = (txq->nb_tx_desc) * (txq->bypass_desc_sz);
 		else
 			sz = (txq->nb_tx_desc) * sizeof(struct qdma_ul_mm_desc);
-		txq->tx_mz = qdma_zone_reserve(dev, "TxHwRn", tx_queue_id,
-						sz, socket_id);
-		if (!txq->tx_mz) {
+		txq->tx_ring = qdma_ring_reserve(dev, &txq->tx_mem, "TxHwRn",
+						tx_queue_id, sz, socket_id);
+		if (!txq->tx_ring) {
 			PMD_DRV_LOG(ERR, "Couldn't reserve memory for "
 					"MM H2C ring of size %d\n", sz);
 			err = -ENOMEM;
 			goto tx_setup_err;
 		}
 
-		txq->tx_ring = txq->tx_mz->addr;
 		tx_ring_mm = (struct qdma_ul_mm_desc *)txq->tx_ring;
 
 		/* Write-back status structure */
@@ -880,7 +867,7 @@ int qdma_dev_tx_queue_setup(struct rte_eth_dev *dev, uint16_t tx_queue_id,
 	}
 
 	PMD_DRV_LOG(INFO, "Tx ring phys addr: 0x%lX, Tx Ring virt addr: 0x%lX",
-	    (uint64_t)txq->tx_mz->iova, (uint64_t)txq->tx_ring);
+	    (uint64_t)txq->tx_mem.iova, (uint64_t)txq->tx_ring);
 
 	/* Allocate memory for TX software ring */
 	sz = txq->nb_tx_desc * sizeof(struct rte_mbuf *);
@@ -893,19 +880,12 @@ int qdma_dev_tx_queue_setup(struct rte_eth_dev *dev, uint16_t tx_queue_id,
 		goto tx_setup_err;
 	}
 
-	rte_spinlock_init(&txq->pidx_update_lock);
+	txq->tx_db_thresh = qdma_dev->tx_db_thresh;
+	txq->tx_db_hold_cycles = (rte_get_timer_hz() *
+			qdma_dev->tx_db_hold_us) / US_PER_S;
+	txq->qlat_en = qdma_dev->qlat_en;
 	dev->data->tx_queues[tx_queue_id] = txq;
 
-#ifdef LATENCY_MEASUREMENT
-	err = qdma_tx_qstats_clear(dev, tx_queue_id);
-	if (err) {
-		PMD_DRV_LOG(ERR,
-			"Failed to clear QDMA Tx queue stats for qid: %d\n",
-			tx_queue_id);
-		return err;
-	}
-#endif
-
 	return 0;
 
 tx_setup_err:
@@ -918,8 +898,7 @@ tx_setup_err:
 		qdma_dev_notify_qdel(dev, tx_queue_id +
 				qdma_dev->queue_base, QDMA_DEV_Q_TYPE_H2C);
 	if (txq) {
-		if (txq->tx_mz)
-			rte_memzone_free(txq->tx_mz);
+		qdma_ring_release(&txq->tx_mem);
 		if (txq->sw_ring)
 			rte_free(txq->sw_ring);
 		rte_free(txq);
@@ -927,32 +906,136 @@ tx_setup_err:
 	return err;
 }
 
-#if (MIN_TX_PIDX_UPDATE_THRESHOLD > 1)
-void qdma_txq_pidx_update(void *arg)
+/**
+ * Bind one event fd per Rx queue to the MSI-X vectors following the
+ * mailbox/error vector. Rx queues share vectors round robin when the
+ * function has fewer vectors than Rx queues.
+ *
+ * @param dev
+ *   Pointer to Ethernet device structure.
+ *
+ * @return
+ *   0 on success, negative errno value on failure.
+ */
+int qdma_rx_intr_setup(struct rte_eth_dev *dev)
 {
-	struct rte_eth_dev *dev = (struct rte_eth_dev *)arg;
 	struct qdma_pci_dev *qdma_dev = dev->data->dev_private;
-	struct qdma_tx_queue *txq;
-	uint32_t qid;
+#ifndef QDMA_DPDK_20_11
+	struct rte_pci_device *pci_dev = RTE_ETH_DEV_TO_PCI(dev);
+	struct rte_intr_handle *intr_handle = pci_dev_intr_handle;
+	struct qdma_rx_queue *rxq;
+	uint32_t nb_efd, qid;
+	int err;
+#endif
 
-	for (qid = 0; qid < dev->data->nb_tx_queues; qid++) {
-		txq = (struct qdma_tx_queue *)dev->data->tx_queues[qid];
-		if (txq->tx_desc_pend) {
-			rte_spinlock_lock(&txq->pidx_update_lock);
-			if (txq->tx_desc_pend) {
-				qdma_dev->hw_access->qdma_queue_pidx_update(dev,
-					qdma_dev->is_vf,
-					qid, 0, &txq->q_pidx_info);
-
-				txq->tx_desc_pend = 0;
-			}
-			rte_spinlock_unlock(&txq->pidx_update_lock);
-		}
+	if (!dev->data->dev_conf.intr_conf.rxq)
+		return 0;
+
+#ifdef QDMA_DPDK_20_11
+	PMD_DRV_LOG(ERR, "%s-%d(DEVFN) Rx interrupts are not supported\n",
+		qdma_dev->is_vf ? "VF" : "PF", qdma_dev->func_id);
+	return -ENOTSUP;
+#else
+	/* CPM4 routes C2H interrupts through the qid2vec context, which is
+	 * not part of the queue contexts a VF passes to the PF
+	 */
+	if (qdma_dev->is_vf && qdma_dev->ip_type == QDMA_VERSAL_HARD_IP &&
+			qdma_dev->device_type == QDMA_DEVICE_VERSAL_CPM4) {
+		PMD_DRV_LOG(ERR, "VF-%d(DEVFN) Rx interrupts are not "
+			"supported on CPM4\n", qdma_dev->func_id);
+		return -ENOTSUP;
+	}
+
+	if (!rte_intr_cap_multiple(intr_handle)) {
+		PMD_DRV_LOG(ERR, "%s-%d(DEVFN) Rx interrupts need MSI-X "
+			"through vfio-pci\n",
+			qdma_dev->is_vf ? "VF" : "PF", qdma_dev->func_id);
+		return -ENOTSUP;
+	}
+
+	nb_efd = RTE_MIN(dev->data->nb_rx_queues,
+			(uint32_t)RTE_MAX_RXTX_INTR_VEC_ID);
+
+	/* The mailbox may already own vector 0, remap all vectors at once */
+	rte_intr_disable(intr_handle);
+
+	err = rte_intr_efd_enable(intr_handle, nb_efd);
+	if (err != 0)
+		goto err_enable;
+
+	err = rte_intr_vec_list_alloc(intr_handle, "qdma_intr_vec",
+			dev->data->nb_rx_queues);
+	if (err != 0)
+		goto err_efd;
+
+	for (qid = 0; qid < dev->data->nb_rx_queues; qid++) {
+		rxq = (struct qdma_rx_queue *)dev->data->rx_queues[qid];
+		rxq->intr_vec = RTE_INTR_VEC_RXTX_OFFSET + (qid % nb_efd);
+		rte_intr_vec_list_index_set(intr_handle, qid, rxq->intr_vec);
 	}
-	rte_eal_alarm_set(QDMA_TXQ_PIDX_UPDATE_INTERVAL,
-			qdma_txq_pidx_update, (void *)arg);
+
+	err = rte_intr_enable(intr_handle);
+	if (err != 0)
+		goto err_vec;
+
+	qdma_dev->rx_intr_en = 1;
+	PMD_DRV_LOG(INFO, "%s-%d(DEVFN) %u Rx queues on %u MSI-X vectors\n",
+		qdma_dev->is_vf ? "VF" : "PF", qdma_dev->func_id,
+		dev->data->nb_rx_queues, nb_efd);
+	return 0;
+
+err_vec:
+	for (qid = 0; qid < dev->data->nb_rx_queues; qid++) {
+		rxq = (struct qdma_rx_queue *)dev->data->rx_queues[qid];
+		rxq->intr_vec = 0;
+	}
+	rte_intr_vec_list_free(intr_handle);
+err_efd:
+	rte_intr_efd_disable(intr_handle);
+err_enable:
+	PMD_DRV_LOG(ERR, "%s-%d(DEVFN) Failed to set up Rx interrupts, "
+		"err = %d\n", qdma_dev->is_vf ? "VF" : "PF",
+		qdma_dev->func_id, err);
+	if (qdma_dev->dev_cap.mailbox_intr)
+		rte_intr_enable(intr_handle);
+	return -EIO;
+#endif
 }
+
+/**
+ * Undo qdma_rx_intr_setup(), leaving vector 0 to the mailbox.
+ *
+ * @param dev
+ *   Pointer to Ethernet device structure.
+ */
+void qdma_rx_intr_teardown(struct rte_eth_dev *dev)
+{
+	struct qdma_pci_dev *qdma_dev = dev->data->dev_private;
+#ifndef QDMA_DPDK_20_11
+	struct rte_pci_device *pci_dev = RTE_ETH_DEV_TO_PCI(dev);
+	struct rte_intr_handle *intr_handle = pci_dev_intr_handle;
+	struct qdma_rx_queue *rxq;
+	uint32_t qid;
+
+	if (!qdma_dev->rx_intr_en)
+		return;
+
+	rte_intr_disable(intr_handle);
+	rte_intr_efd_disable(intr_handle);
+	rte_intr_vec_list_free(intr_handle);
+	for (qid = 0; qid < dev->data->nb_rx_queues; qid++) {
+		rxq = (struct qdma_rx_queue *)dev->data->rx_queues[qid];
+		if (rxq)
+			rxq->intr_vec = 0;
+	}
+	qdma_dev->rx_intr_en = 0;
+
+	if (qdma_dev->dev_cap.mailbox_intr)
+		rte_intr_enable(intr_handle);
+#else
+	RTE_SET_USED(qdma_dev);
 #endif
+}
 
 /**
  * DPDK callback to start the device.
@@ -974,6 +1057,10 @@ int qdma_dev_start(struct rte_eth_dev *dev)
 
 	PMD_DRV_LOG(INFO, "qdma-dev-start: Starting\n");
 
+	err = qdma_rx_intr_setup(dev);
+	if (err != 0)
+		return err;
+
 	/* prepare descriptor rings for operation */
 	for (qid = 0; qid < dev->data->nb_tx_queues; qid++) {
 		txq = (struct qdma_tx_queue *)dev->data->tx_queues[qid];
@@ -982,7 +1069,7 @@ int qdma_dev_start(struct rte_eth_dev *dev)
 		if (!txq->tx_deferred_start) {
 			err = qdma_dev_tx_queue_start(dev, qid);
 			if (err != 0)
-				return err;
+				goto err_txq;
 		}
 	}
 
@@ -993,15 +1080,27 @@ int qdma_dev_start(struct rte_eth_dev *dev)
 		if (!rxq->rx_deferred_start) {
 			err = qdma_dev_rx_queue_start(dev, qid);
 			if (err != 0)
-				return err;
+				goto err_rxq;
 		}
 	}
 
-#if (MIN_TX_PIDX_UPDATE_THRESHOLD > 1)
-	rte_eal_alarm_set(QDMA_TXQ_PIDX_UPDATE_INTERVAL,
-			qdma_txq_pidx_update, (void *)dev);
-#endif
 	return 0;
+
+err_rxq:
+	while (qid--) {
+		rxq = (struct qdma_rx_queue *)dev->data->rx_queues[qid];
+		if (!rxq->rx_deferred_start)
+			qdma_dev_rx_queue_stop(dev, qid);
+	}
+	qid = dev->data->nb_tx_queues;
+err_txq:
+	while (qid--) {
+		txq = (struct qdma_tx_queue *)dev->data->tx_queues[qid];
+		if (!txq->tx_deferred_start)
+			qdma_dev_tx_queue_stop(dev, qid);
+	}
+	qdma_rx_intr_teardown(dev);
+	return err;
 }
 
 /**
@@ -1038,12 +1137,16 @@ int qdma_dev_infos_get(struct rte_eth_dev *dev,
 {
 	struct qdma_pci_dev *qdma_dev = dev->data->dev_private;
 
-	dev_info->max_rx_queues = qdma_dev->dev_cap.num_qs;
-	dev_info->max_tx_queues = qdma_dev->dev_cap.num_qs;
+	dev_info->max_rx_queues = qdma_dev->dev_cap.num_qs -
+					qdma_dev->dma_queues;
+	dev_info->max_tx_queues = qdma_dev->dev_cap.num_qs -
+					qdma_dev->dma_queues;
 
 	dev_info->min_rx_bufsize = QDMA_MIN_RXBUFF_SIZE;
 	dev_info->max_rx_pktlen = DMA_BRAM_SIZE;
 	dev_info->max_mac_addrs = 1;
+	dev_info->tx_queue_offload_capa = DEV_TX_OFFLOAD_MBUF_FAST_FREE;
+	dev_info->tx_offload_capa = dev_info->tx_queue_offload_capa;
 
 	return 0;
 }
@@ -1072,10 +1175,7 @@ int qdma_dev_stop(struct rte_eth_dev *dev)
 	for (qid = 0; qid < dev->data->nb_rx_queues; qid++)
 		qdma_dev_rx_queue_stop(dev, qid);
 
-#if (MIN_TX_PIDX_UPDATE_THRESHOLD > 1)
-	/* Cancel pending PIDX updates */
-	rte_eal_alarm_cancel(qdma_txq_pidx_update, (void *)dev);
-#endif
+	qdma_rx_intr_teardown(dev);
 
 	return 0;
 }
@@ -1103,6 +1203,8 @@ int qdma_dev_close(struct rte_eth_dev *dev)
 	if (dev->data->dev_started)
 		qdma_dev_stop(dev);
 
+	qdma_dmadev_stop(dev);
+
 	memset(&fmap_cfg, 0, sizeof(struct qdma_fmap_cfg));
 	qdma_dev->hw_access->qdma_fmap_conf(dev,
 		qdma_dev->func_id, &fmap_cfg, QDMA_HW_ACCESS_CLEAR);
@@ -1116,8 +1218,7 @@ int qdma_dev_close(struct rte_eth_dev *dev)
 			if (rxq->sw_ring)
 				rte_free(rxq->sw_ring);
 			if (rxq->st_mode) { /** if ST-mode **/
-				if (rxq->rx_cmpt_mz)
-					rte_memzone_free(rxq->rx_cmpt_mz);
+				qdma_ring_release(&rxq->rx_cmpt_mem);
 			}
 
 			qdma_dev_decrement_active_queue(
@@ -1131,8 +1232,7 @@ int qdma_dev_close(struct rte_eth_dev *dev)
 					qdma_dev->func_id,
 					QDMA_DEV_Q_TYPE_CMPT);
 
-			if (rxq->rx_mz)
-				rte_memzone_free(rxq->rx_mz);
+			qdma_ring_release(&rxq->rx_mem);
 			rte_free(rxq);
 			PMD_DRV_LOG(INFO, "C2H queue %d removed", qid);
 		}
@@ -1146,8 +1246,7 @@ int qdma_dev_close(struct rte_eth_dev *dev)
 
 			if (txq->sw_ring)
 				rte_free(txq->sw_ring);
-			if (txq->tx_mz)
-				rte_memzone_free(txq->tx_mz);
+			qdma_ring_release(&txq->tx_mem);
 			rte_free(txq);
 			PMD_DRV_LOG(INFO, "H2C queue %d removed", qid);
 
@@ -1164,8 +1263,7 @@ int qdma_dev_close(struct rte_eth_dev *dev)
 			if (cmptq != NULL) {
 				PMD_DRV_LOG(INFO, "PF-%d(DEVFN) Remove CMPT queue: %d",
 						qdma_dev->func_id, qid);
-				if (cmptq->cmpt_mz)
-					rte_memzone_free(cmptq->cmpt_mz);
+				qdma_ring_release(&cmptq->cmpt_mem);
 				rte_free(cmptq);
 				PMD_DRV_LOG(INFO, "PF-%d(DEVFN) CMPT queue %d removed",
 						qdma_dev->func_id, qid);
@@ -1181,6 +1279,7 @@ int qdma_dev_close(struct rte_eth_dev *dev)
 			qdma_dev->cmpt_queues = NULL;
 		}
 	}
+	qdma_ring_arena_free(dev);
 	qdma_dev->qsets_en = 0;
 	ret = qdma_dev_update(qdma_dev->dma_device_index, qdma_dev->func_id,
 			qdma_dev->qsets_en, (int *)&qdma_dev->queue_base);
@@ -1311,8 +1410,10 @@ int qdma_dev_configure(struct rte_eth_dev *dev)
 
 	PMD_DRV_LOG(INFO, "Configure the qdma engines\n");
 
+	/* dmadev vchans take the queues following the ethdev queues */
 	qdma_dev->qsets_en = RTE_MAX(dev->data->nb_rx_queues,
-					dev->data->nb_tx_queues);
+					dev->data->nb_tx_queues) +
+					qdma_dev->dma_queues;
 	if (qdma_dev->qsets_en > qdma_dev->dev_cap.num_qs) {
 		PMD_DRV_LOG(ERR, "PF-%d(DEVFN) Error: Number of Queues to be"
 				" configured are greater than the queues"
@@ -1446,7 +1547,7 @@ int qdma_dev_tx_queue_start(struct rte_eth_dev *dev, uint16_t qid)
 	q_sw_ctxt.rngsz_idx = txq->ringszidx;
 	q_sw_ctxt.bypass = txq->en_bypass;
 	q_sw_ctxt.wbk_en = 1;
-	q_sw_ctxt.ring_bs_addr = (uint64_t)txq->tx_mz->iova;
+	q_sw_ctxt.ring_bs_addr = (uint64_t)txq->tx_mem.iova;
 
 	if (txq->en_bypass &&
 		(txq->bypass_desc_sz != 0))
@@ -1532,7 +1633,7 @@ int qdma_dev_rx_queue_start(struct rte_eth_dev *dev, uint16_t qid)
 		q_cmpt_ctxt.lower_dword.bit.timer_idx = rxq->timeridx;
 		q_cmpt_ctxt.lower_dword.bit.color = CMPT_DEFAULT_COLOR_BIT;
 		q_cmpt_ctxt.lower_dword.bit.ringsz_idx = rxq->cmpt_ringszidx;
-		q_cmpt_ctxt.bs_addr = (uint64_t)rxq->rx_cmpt_mz->iova;
+		q_cmpt_ctxt.bs_addr = (uint64_t)rxq->rx_cmpt_mem.iova;
 		q_cmpt_ctxt.higher_dword.bit.desc_sz = cmpt_desc_fmt;
 		q_cmpt_ctxt.higher_dword.bit.valid = 1;
 		q_cmpt_ctxt.higher_dword.bit.dir_c2h = 1;
@@ -1540,6 +1641,12 @@ int qdma_dev_rx_queue_start(struct rte_eth_dev *dev, uint16_t qid)
 			q_cmpt_ctxt.higher_dword.bit.ovf_chk_dis =
 						rxq->dis_overflow_check;
 
+		/* Direct interrupt, armed by qdma_dev_rx_queue_intr_enable */
+		if (rxq->intr_vec) {
+			q_cmpt_ctxt.lower_dword.bit.en_int = 1;
+			q_cmpt_ctxt.higher_dword.bit.vec = rxq->intr_vec;
+			q_cmpt_ctxt.higher_dword.bit.int_aggr = 0;
+		}
 
 		q_sw_ctxt.desc_sz = SW_DESC_CNTXT_C2H_STREAM_DMA;
 		q_sw_ctxt.frcd_en = 1;
@@ -1555,7 +1662,7 @@ int qdma_dev_rx_queue_start(struct rte_eth_dev *dev, uint16_t qid)
 	q_sw_ctxt.rngsz_idx = rxq->ringszidx;
 	q_sw_ctxt.bypass = rxq->en_bypass;
 	q_sw_ctxt.wbk_en = 1;
-	q_sw_ctxt.ring_bs_addr = (uint64_t)rxq->rx_mz->iova;
+	q_sw_ctxt.ring_bs_addr = (uint64_t)rxq->rx_mem.iova;
 
 	if (rxq->en_bypass &&
 		(rxq->bypass_desc_sz != 0))
@@ -1580,6 +1687,20 @@ int qdma_dev_rx_queue_start(struct rte_eth_dev *dev, uint16_t qid)
 		if (err < 0)
 			return qdma_dev->hw_access->qdma_get_error_code(err);
 
+		/* CPM4 has no cmpt context vector, it maps qid2vec instead */
+		if (rxq->intr_vec && hw_access->qdma_qid2vec_conf) {
+			struct qdma_qid2vec q_qid2vec;
+
+			memset(&q_qid2vec, 0, sizeof(struct qdma_qid2vec));
+			q_qid2vec.c2h_vector = rxq->intr_vec;
+			q_qid2vec.c2h_en_coal = 0;
+			err = hw_access->qdma_qid2vec_conf(dev, 1,
+					(qid + queue_base), &q_qid2vec,
+					QDMA_HW_ACCESS_WRITE);
+			if (err < 0)
+				return hw_access->qdma_get_error_code(err);
+		}
+
 		rte_wmb();
 		/* enable status desc , loading the triggermode,
 		 * thresidx and timeridx passed from the user
@@ -1590,6 +1711,7 @@ int qdma_dev_rx_queue_start(struct rte_eth_dev *dev, uint16_t qid)
 		rxq->cmpt_cidx_info.trig_mode = rxq->triggermode;
 		rxq->cmpt_cidx_info.wrb_en = 1;
 		rxq->cmpt_cidx_info.wrb_cidx = 0;
+		rxq->cmpt_cidx_info.irq_en = 0;
 		hw_access->qdma_queue_cmpt_cidx_update(dev, qdma_dev->is_vf,
 			qid, &rxq->cmpt_cidx_info);
 
@@ -1664,6 +1786,61 @@ int qdma_dev_rx_queue_stop(struct rte_eth_dev *dev, uint16_t qid)
 	return 0;
 }
 
+/**
+ * DPDK callback to arm the interrupt of a ST Rx queue.
+ *
+ * The CIDX update carrying irq_en arms the queue, the hardware disarms
+ * it again when the interrupt fires. An interrupt is raised right away
+ * if completions are already pending.
+ *
+ * @param dev
+ *   Pointer to Ethernet device structure.
+ * @param qid
+ *   Rx queue index.
+ *
+ * @return
+ *   0 on success, negative errno value on failure.
+ */
+int qdma_dev_rx_queue_intr_enable(struct rte_eth_dev *dev, uint16_t qid)
+{
+	struct qdma_pci_dev *qdma_dev = dev->data->dev_private;
+	struct qdma_rx_queue *rxq;
+
+	rxq = (struct qdma_rx_queue *)dev->data->rx_queues[qid];
+	if (!rxq->st_mode || !rxq->intr_vec)
+		return -ENOTSUP;
+
+	rxq->cmpt_cidx_info.irq_en = 1;
+	return qdma_dev->hw_access->qdma_queue_cmpt_cidx_update(dev,
+			qdma_dev->is_vf, qid, &rxq->cmpt_cidx_info);
+}
+
+/**
+ * DPDK callback to stop re-arming the interrupt of a ST Rx queue.
+ *
+ * A fired interrupt leaves the queue disarmed, so clearing irq_en for the
+ * CIDX updates of the Rx burst is enough.
+ *
+ * @param dev
+ *   Pointer to Ethernet device structure.
+ * @param qid
+ *   Rx queue index.
+ *
+ * @return
+ *   0 on success, negative errno value on failure.
+ */
+int qdma_dev_rx_queue_intr_disable(struct rte_eth_dev *dev, uint16_t qid)
+{
+	struct qdma_rx_queue *rxq;
+
+	rxq = (struct qdma_rx_queue *)dev->data->rx_queues[qid];
+	if (!rxq->st_mode || !rxq->intr_vec)
+		return -ENOTSUP;
+
+	rxq->cmpt_cidx_info.irq_en = 0;
+	return 0;
+}
+
 int qdma_dev_tx_queue_stop(struct rte_eth_dev *dev, uint16_t qid)
 {
 	struct qdma_pci_dev *qdma_dev = dev->data->dev_private;
@@ -1674,6 +1851,8 @@ int qdma_dev_tx_queue_stop(struct rte_eth_dev *dev, uint16_t qid)
 
 	txq = (struct qdma_tx_queue *)dev->data->tx_queues[qid];
 
+	/* Push out the descriptors held back by doorbell batching */
+	qdma_txq_doorbell(txq, 0, true);
 	txq->status = RTE_ETH_QUEUE_STATE_STOPPED;
 	/* Wait for TXQ to send out all packets. */
 	while (txq->wb_status->cidx != txq->q_pidx_info.pidx) {
@@ -1970,6 +2149,11 @@ static struct eth_dev_ops qdma_eth_dev_ops = {
 	.stats_reset              = qdma_dev_stats_reset,
 	.rxq_info_get             = qdma_dev_rxq_info_get,
 	.txq_info_get             = qdma_dev_txq_info_get,
+	.rx_queue_intr_enable     = qdma_dev_rx_queue_intr_enable,
+	.rx_queue_intr_disable    = qdma_dev_rx_queue_intr_disable,
+#ifndef QDMA_DPDK_20_11
+	.get_monitor_addr         = qdma_dev_get_monitor_addr,
+#endif
 };
 
 void qdma_dev_ops_init(struct rte_eth_dev *dev)
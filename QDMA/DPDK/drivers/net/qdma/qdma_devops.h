@@ -342,6 +342,25 @@ int qdma_dev_queue_stats_mapping(struct rte_eth_dev *dev,
 int
 qdma_dev_rx_descriptor_status(void *rx_queue, uint16_t offset);
 
+#ifndef QDMA_DPDK_20_11
+struct rte_power_monitor_cond;
+
+/**
+ * DPDK callback to get the address to monitor for the next Rx completion
+ *
+ * @param rx_queue
+ *   Pointer to Rx queue specific data structure
+ * @param pmc
+ *   Monitor condition filled in with the CMPT status writeback PIDX
+ *
+ * @return
+ *   0 on success, -ENOTSUP for MM queues
+ * @ingroup dpdk_devops_func
+ */
+int
+qdma_dev_get_monitor_addr(void *rx_queue, struct rte_power_monitor_cond *pmc);
+#endif
+
 /**
  * DPDK callback to check the status of a Tx descriptor in the queue
  *
@@ -419,6 +438,34 @@ qdma_dev_get_regs(struct rte_eth_dev *dev,
  */
 int qdma_dev_rx_queue_stop(struct rte_eth_dev *dev, uint16_t qid);
 
+/**
+ * DPDK callback to arm the interrupt of a C2H queue
+ *
+ * Only ST queues of a port configured with intr_conf.rxq have an
+ * interrupt. The next CIDX update arms the queue, the hardware disarms
+ * it when the interrupt fires.
+ *
+ * @param dev Pointer to Ethernet device structure
+ * @param qid Rx queue index
+ *
+ * @return 0 on success, -ENOTSUP if the queue has no interrupt
+ * @ingroup dpdk_devops_func
+ *
+ */
+int qdma_dev_rx_queue_intr_enable(struct rte_eth_dev *dev, uint16_t qid);
+
+/**
+ * DPDK callback to stop arming the interrupt of a C2H queue
+ *
+ * @param dev Pointer to Ethernet device structure
+ * @param qid Rx queue index
+ *
+ * @return 0 on success, -ENOTSUP if the queue has no interrupt
+ * @ingroup dpdk_devops_func
+ *
+ */
+int qdma_dev_rx_queue_intr_disable(struct rte_eth_dev *dev, uint16_t qid);
+
 /**
  * qdma_dev_tx_queue_stop() - DPDK callback to stop a queue in H2C direction
  *
@@ -0,0 +1,824 @@
+/*-
+ * BSD LICENSE
+ *
+ * Copyright (c) 2022-2024, Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * dmadev front end for the QDMA memory mapped queues.
+ *
+ * The dmadev is created by the PF ethdev when the dma_queues devarg is
+ * given and shares its qdma_access handle and queue range: the last
+ * dma_queues queues of the range set up by qdma_dev_configure() are
+ * handed out as vchans, one MM H2C (RTE_DMA_DIR_MEM_TO_DEV) or MM C2H
+ * (RTE_DMA_DIR_DEV_TO_MEM) descriptor ring per vchan. The card side
+ * address of a copy is the AXI-MM address on the device.
+ *
+ * copy() and copy_sg() only fill descriptors, the PIDX doorbell is rung
+ * once per batch from submit() or on RTE_DMA_OP_FLAG_SUBMIT. completed()
+ * retires jobs from the write-back CIDX of the ring.
+ *
+ * The dmadev library comes with DPDK v21.11, a QDMA_DPDK_20_11 build only
+ * rejects the dma_queues devarg.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <rte_malloc.h>
+#include <rte_memzone.h>
+#include <rte_cycles.h>
+#ifndef QDMA_DPDK_20_11
+#include <rte_dmadev_pmd.h>
+#endif
+
+#include "qdma.h"
+#include "qdma_access_common.h"
+
+#ifndef QDMA_DPDK_20_11
+
+/* Longest transfer of a single MM descriptor, 4K aligned */
+#define QDMA_DMA_DESC_MAX_LEN	RTE_ALIGN_FLOOR((1U << 28) - 1, 4096)
+#define QDMA_DMA_NB_DESC(len)	((len) / QDMA_DMA_DESC_MAX_LEN + \
+				!!((len) % QDMA_DMA_DESC_MAX_LEN))
+#define QDMA_DMA_MAX_SGES	(16)
+#define QDMA_DMA_MIN_DESC	(64)
+#define QDMA_DMA_MAX_DESC	(16384)
+
+/* Second quad word of struct qdma_ul_mm_desc */
+#define QDMA_DMA_DESC_DV	(1ULL << 28)
+#define QDMA_DMA_DESC_SOP	(1ULL << 29)
+#define QDMA_DMA_DESC_EOP	(1ULL << 30)
+
+struct qdma_dma_vchan {
+	struct qdma_ul_mm_desc		*ring;
+	struct wb_status		*wb_status;
+	/* ring index following the last descriptor of each job */
+	uint16_t			*job_end;
+	struct qdma_q_pidx_reg_info	q_pidx_info;
+
+	uint16_t	nb_desc; /* usable ring entries, pidx wraps here */
+	uint16_t	cidx; /* first descriptor not yet retired */
+	uint16_t	job_head; /* oldest outstanding job in job_end */
+	uint16_t	job_tail; /* next free entry in job_end */
+	uint16_t	ring_idx; /* ring_idx of the next enqueued job */
+	uint16_t	cpl_idx; /* ring_idx of the next job to complete */
+	uint16_t	nb_pend; /* jobs enqueued since the last doorbell */
+	uint16_t	qid; /* queue index relative to the function */
+
+	uint8_t		is_c2h:1;
+	uint8_t		configured:1;
+	uint8_t		started:1;
+	int8_t		ringszidx;
+
+	struct rte_dma_stats		stats;
+	struct qdma_ring_mem		ring_mem;
+	struct rte_eth_dev		*dev;
+} __rte_cache_aligned;
+
+struct qdma_dma_dev {
+	struct rte_eth_dev	*eth_dev;
+	uint16_t		nb_vchans;
+	struct qdma_dma_vchan	vchans[];
+};
+
+static inline uint16_t qdma_dma_ring_dist(const struct qdma_dma_vchan *vq,
+		uint16_t from, uint16_t to)
+{
+	return (to >= from) ? (to - from) : (vq->nb_desc - from + to);
+}
+
+static inline uint16_t qdma_dma_free_desc(const struct qdma_dma_vchan *vq)
+{
+	/* One entry stays free so that a full ring never reads as empty */
+	return vq->nb_desc - 1 -
+		qdma_dma_ring_dist(vq, vq->cidx, vq->q_pidx_info.pidx);
+}
+
+static inline void qdma_dma_write_desc(struct qdma_dma_vchan *vq,
+		rte_iova_t src, rte_iova_t dst, uint32_t len)
+{
+	volatile uint64_t *desc =
+		(volatile uint64_t *)&vq->ring[vq->q_pidx_info.pidx];
+
+	desc[0] = src;
+	desc[1] = len | QDMA_DMA_DESC_DV | QDMA_DMA_DESC_SOP |
+			QDMA_DMA_DESC_EOP;
+	desc[2] = dst;
+	desc[3] = 0;
+
+	if (++vq->q_pidx_info.pidx == vq->nb_desc)
+		vq->q_pidx_info.pidx = 0;
+}
+
+static inline void qdma_dma_doorbell(struct qdma_dma_vchan *vq)
+{
+	struct qdma_pci_dev *qdma_dev = vq->dev->data->dev_private;
+
+	/* Make sure writes to the descriptors are synchronized before
+	 * updating PIDX
+	 */
+	rte_wmb();
+	qdma_dev->hw_access->qdma_queue_pidx_update(vq->dev, qdma_dev->is_vf,
+			vq->qid, vq->is_c2h, &vq->q_pidx_info);
+	vq->stats.submitted += vq->nb_pend;
+	vq->nb_pend = 0;
+}
+
+static inline int qdma_dma_job_done(struct qdma_dma_vchan *vq,
+		uint64_t flags)
+{
+	uint16_t idx = vq->ring_idx++;
+
+	vq->job_end[vq->job_tail] = vq->q_pidx_info.pidx;
+	if (++vq->job_tail == vq->nb_desc)
+		vq->job_tail = 0;
+	vq->nb_pend++;
+
+	if (flags & RTE_DMA_OP_FLAG_SUBMIT)
+		qdma_dma_doorbell(vq);
+
+	return idx;
+}
+
+static int qdma_dma_copy(void *dev_private, uint16_t vchan, rte_iova_t src,
+		rte_iova_t dst, uint32_t length, uint64_t flags)
+{
+	struct qdma_dma_dev *dmadev = dev_private;
+	struct qdma_dma_vchan *vq = &dmadev->vchans[vchan];
+	uint32_t nb_desc, len;
+
+	if (unlikely(length == 0))
+		return -EINVAL;
+
+	nb_desc = QDMA_DMA_NB_DESC(length);
+	if (unlikely(nb_desc > qdma_dma_free_desc(vq)))
+		return -ENOSPC;
+
+	while (length) {
+		len = RTE_MIN(length, QDMA_DMA_DESC_MAX_LEN);
+		qdma_dma_write_desc(vq, src, dst, len);
+		src += len;
+		dst += len;
+		length -= len;
+	}
+
+	return qdma_dma_job_done(vq, flags);
+}
+
+static int qdma_dma_copy_sg(void *dev_private, uint16_t vchan,
+		const struct rte_dma_sge *src, const struct rte_dma_sge *dst,
+		uint16_t nb_src, uint16_t nb_dst, uint64_t flags)
+{
+	struct qdma_dma_dev *dmadev = dev_private;
+	struct qdma_dma_vchan *vq = &dmadev->vchans[vchan];
+	uint64_t src_len = 0, dst_len = 0;
+	uint32_t nb_desc = 0, s_off = 0, d_off = 0, len;
+	uint16_t s = 0, d = 0;
+
+	/* Every descriptor ends at a source or destination segment boundary
+	 * or at QDMA_DMA_DESC_MAX_LEN, bound the count before writing any
+	 */
+	for (s = 0; s < nb_src; s++) {
+		src_len += src[s].length;
+		nb_desc += QDMA_DMA_NB_DESC(src[s].length);
+	}
+	for (d = 0; d < nb_dst; d++)
+		dst_len += dst[d].length;
+	if (unlikely(src_len != dst_len || src_len == 0))
+		return -EINVAL;
+	nb_desc += nb_dst - 1;
+	if (unlikely(nb_desc > qdma_dma_free_desc(vq)))
+		return -ENOSPC;
+
+	s = 0;
+	d = 0;
+	while (s < nb_src && d < nb_dst) {
+		len = RTE_MIN(src[s].length - s_off, dst[d].length - d_off);
+		len = RTE_MIN(len, QDMA_DMA_DESC_MAX_LEN);
+		if (len)
+			qdma_dma_write_desc(vq, src[s].addr + s_off,
+					dst[d].addr + d_off, len);
+		s_off += len;
+		d_off += len;
+		if (s_off == src[s].length) {
+			s++;
+			s_off = 0;
+		}
+		if (d_off == dst[d].length) {
+			d++;
+			d_off = 0;
+		}
+	}
+
+	return qdma_dma_job_done(vq, flags);
+}
+
+static int qdma_dma_submit(void *dev_private, uint16_t vchan)
+{
+	struct qdma_dma_dev *dmadev = dev_private;
+	struct qdma_dma_vchan *vq = &dmadev->vchans[vchan];
+
+	if (vq->nb_pend)
+		qdma_dma_doorbell(vq);
+
+	return 0;
+}
+
+static inline uint16_t qdma_dma_retire(struct qdma_dma_vchan *vq,
+		uint16_t nb_cpls)
+{
+	uint16_t hw_cidx = vq->wb_status->cidx;
+	uint16_t done = qdma_dma_ring_dist(vq, vq->cidx, hw_cidx);
+	uint16_t end, step, cnt = 0;
+
+	/* Read of the buffers must not pass the read of the CIDX */
+	rte_rmb();
+
+	while (cnt < nb_cpls && vq->job_head != vq->job_tail) {
+		end = vq->job_end[vq->job_head];
+		step = qdma_dma_ring_dist(vq, vq->cidx, end);
+		if (step > done)
+			break;
+		done -= step;
+		vq->cidx = end;
+		if (++vq->job_head == vq->nb_desc)
+			vq->job_head = 0;
+		cnt++;
+	}
+
+	vq->cpl_idx += cnt;
+	vq->stats.completed += cnt;
+
+	return cnt;
+}
+
+static uint16_t qdma_dma_completed(void *dev_private, uint16_t vchan,
+		const uint16_t nb_cpls, uint16_t *last_idx, bool *has_error)
+{
+	struct qdma_dma_dev *dmadev = dev_private;
+	struct qdma_dma_vchan *vq = &dmadev->vchans[vchan];
+	uint16_t cnt;
+
+	/* MM write-back status does not report per descriptor errors, a
+	 * failing transfer halts the queue and is reported by
+	 * qdma_check_errors()
+	 */
+	cnt = qdma_dma_retire(vq, nb_cpls);
+	*last_idx = vq->cpl_idx - 1;
+	*has_error = false;
+
+	return cnt;
+}
+
+static uint16_t qdma_dma_completed_status(void *dev_private, uint16_t vchan,
+		const uint16_t nb_cpls, uint16_t *last_idx,
+		enum rte_dma_status_code *status)
+{
+	struct qdma_dma_dev *dmadev = dev_private;
+	struct qdma_dma_vchan *vq = &dmadev->vchans[vchan];
+	uint16_t i, cnt;
+
+	cnt = qdma_dma_retire(vq, nb_cpls);
+	*last_idx = vq->cpl_idx - 1;
+	for (i = 0; i < cnt; i++)
+		status[i] = RTE_DMA_STATUS_SUCCESSFUL;
+
+	return cnt;
+}
+
+static uint16_t qdma_dma_burst_capacity(const void *dev_private,
+		uint16_t vchan)
+{
+	const struct qdma_dma_dev *dmadev = dev_private;
+
+	return qdma_dma_free_desc(&dmadev->vchans[vchan]);
+}
+
+static int qdma_dma_info_get(const struct rte_dma_dev *dev,
+		struct rte_dma_info *info, uint32_t info_sz)
+{
+	struct qdma_dma_dev *dmadev = dev->data->dev_private;
+
+	RTE_SET_USED(info_sz);
+
+	info->dev_capa = RTE_DMA_CAPA_MEM_TO_DEV | RTE_DMA_CAPA_DEV_TO_MEM |
+			RTE_DMA_CAPA_OPS_COPY | RTE_DMA_CAPA_OPS_COPY_SG;
+	info->max_vchans = dmadev->nb_vchans;
+	info->min_desc = QDMA_DMA_MIN_DESC;
+	info->max_desc = QDMA_DMA_MAX_DESC;
+	info->max_sges = QDMA_DMA_MAX_SGES;
+
+	return 0;
+}
+
+static void qdma_dma_vchan_release(struct qdma_dma_vchan *vq)
+{
+	rte_free(vq->job_end);
+	vq->job_end = NULL;
+	qdma_ring_release(&vq->ring_mem);
+	vq->ring = NULL;
+	vq->configured = 0;
+}
+
+static int qdma_dma_configure(struct rte_dma_dev *dev,
+		const struct rte_dma_conf *conf, uint32_t conf_sz)
+{
+	struct qdma_dma_dev *dmadev = dev->data->dev_private;
+	uint16_t i;
+
+	RTE_SET_USED(conf_sz);
+
+	for (i = conf->nb_vchans; i < dmadev->nb_vchans; i++)
+		qdma_dma_vchan_release(&dmadev->vchans[i]);
+
+	return 0;
+}
+
+static int qdma_dma_vchan_setup(struct rte_dma_dev *dev, uint16_t vchan,
+		const struct rte_dma_vchan_conf *conf, uint32_t conf_sz)
+{
+	struct qdma_dma_dev *dmadev = dev->data->dev_private;
+	struct rte_eth_dev *eth_dev = dmadev->eth_dev;
+	struct qdma_pci_dev *qdma_dev = eth_dev->data->dev_private;
+	struct qdma_dma_vchan *vq = &dmadev->vchans[vchan];
+	uint32_t sz;
+	int err;
+
+	RTE_SET_USED(conf_sz);
+
+	if (!qdma_dev->dev_cap.mm_en) {
+		PMD_DRV_LOG(ERR, "Memory mapped mode not "
+				"enabled in the hardware\n");
+		return -EINVAL;
+	}
+
+	if (!qdma_dev->init_q_range) {
+		err = qdma_pf_csr_read(eth_dev);
+		if (err < 0) {
+			PMD_DRV_LOG(ERR, "CSR read failed\n");
+			return err;
+		}
+		qdma_dev->init_q_range = 1;
+	}
+
+	qdma_dma_vchan_release(vq);
+	memset(vq, 0, sizeof(*vq));
+
+	vq->dev = eth_dev;
+	vq->is_c2h = (conf->direction == RTE_DMA_DIR_DEV_TO_MEM) ? 1 : 0;
+	vq->nb_desc = conf->nb_desc;
+	vq->ringszidx = index_of_array(qdma_dev->g_ring_sz,
+					QDMA_NUM_RING_SIZES, vq->nb_desc + 1);
+	if (vq->ringszidx < 0) {
+		PMD_DRV_LOG(ERR, "Expected Ring size %d not found\n",
+				vq->nb_desc + 1);
+		return -EINVAL;
+	}
+
+	/* Last ring entry holds the write-back status */
+	sz = (vq->nb_desc + 1) * sizeof(struct qdma_ul_mm_desc);
+	vq->ring = qdma_ring_reserve(eth_dev, &vq->ring_mem,
+				vq->is_c2h ? "DmaC2hRn" : "DmaH2cRn", vchan, sz,
+				dev->data->numa_node);
+	if (!vq->ring) {
+		PMD_DRV_LOG(ERR, "Couldn't reserve memory for "
+				"dmadev vchan %d ring of size %d\n",
+				vchan, sz);
+		return -ENOMEM;
+	}
+	vq->wb_status = (struct wb_status *)&vq->ring[vq->nb_desc];
+
+	vq->job_end = rte_zmalloc_socket("DmaJobRn",
+				vq->nb_desc * sizeof(vq->job_end[0]),
+				RTE_CACHE_LINE_SIZE, dev->data->numa_node);
+	if (!vq->job_end) {
+		PMD_DRV_LOG(ERR, "Memory allocation failed for "
+				"dmadev vchan %d job ring\n", vchan);
+		qdma_dma_vchan_release(vq);
+		return -ENOMEM;
+	}
+
+	vq->configured = 1;
+
+	return 0;
+}
+
+static int qdma_dma_vchan_start(struct qdma_dma_dev *dmadev,
+		uint16_t vchan)
+{
+	struct rte_eth_dev *eth_dev = dmadev->eth_dev;
+	struct qdma_pci_dev *qdma_dev = eth_dev->data->dev_private;
+	struct qdma_hw_access *hw_access = qdma_dev->hw_access;
+	struct qdma_dma_vchan *vq = &dmadev->vchans[vchan];
+	struct qdma_descq_sw_ctxt q_sw_ctxt;
+	uint32_t qid_hw;
+	int err;
+
+	err = qdma_dev_increment_active_queue(qdma_dev->dma_device_index,
+			qdma_dev->func_id, vq->is_c2h ?
+			QDMA_DEV_Q_TYPE_C2H : QDMA_DEV_Q_TYPE_H2C);
+	if (err != QDMA_SUCCESS)
+		return -EINVAL;
+
+	vq->qid = qdma_dev->qsets_en - dmadev->nb_vchans + vchan;
+	qid_hw = qdma_dev->queue_base + vq->qid;
+
+	memset(vq->ring, 0, (vq->nb_desc + 1) * sizeof(struct qdma_ul_mm_desc));
+	vq->cidx = 0;
+	vq->job_head = 0;
+	vq->job_tail = 0;
+	vq->ring_idx = 0;
+	vq->cpl_idx = 0;
+	vq->nb_pend = 0;
+
+	if (vq->is_c2h)
+		qdma_clr_rx_queue_ctxts(eth_dev, qid_hw, 0);
+	else
+		qdma_clr_tx_queue_ctxts(eth_dev, qid_hw, 0);
+
+	memset(&q_sw_ctxt, 0, sizeof(struct qdma_descq_sw_ctxt));
+	q_sw_ctxt.desc_sz = SW_DESC_CNTXT_MEMORY_MAP_DMA;
+	q_sw_ctxt.is_mm = 1;
+	q_sw_ctxt.wbi_chk = 1;
+	q_sw_ctxt.wbi_intvl_en = 1;
+	q_sw_ctxt.fnc_id = qdma_dev->func_id;
+	q_sw_ctxt.qen = 1;
+	q_sw_ctxt.rngsz_idx = vq->ringszidx;
+	q_sw_ctxt.wbk_en = 1;
+	q_sw_ctxt.ring_bs_addr = (uint64_t)vq->ring_mem.iova;
+
+	/* Set SW Context */
+	err = hw_access->qdma_sw_ctx_conf(eth_dev, vq->is_c2h, qid_hw,
+			&q_sw_ctxt, QDMA_HW_ACCESS_WRITE);
+	if (err < 0) {
+		qdma_dev_decrement_active_queue(qdma_dev->dma_device_index,
+				qdma_dev->func_id, vq->is_c2h ?
+				QDMA_DEV_Q_TYPE_C2H : QDMA_DEV_Q_TYPE_H2C);
+		return hw_access->qdma_get_error_code(err);
+	}
+
+	vq->q_pidx_info.pidx = 0;
+	vq->q_pidx_info.irq_en = 0;
+	hw_access->qdma_queue_pidx_update(eth_dev, qdma_dev->is_vf,
+			vq->qid, vq->is_c2h, &vq->q_pidx_info);
+
+	vq->started = 1;
+
+	return 0;
+}
+
+static void qdma_dma_vchan_stop(struct qdma_dma_dev *dmadev,
+		uint16_t vchan)
+{
+	struct rte_eth_dev *eth_dev = dmadev->eth_dev;
+	struct qdma_pci_dev *qdma_dev = eth_dev->data->dev_private;
+	struct qdma_dma_vchan *vq = &dmadev->vchans[vchan];
+	uint32_t qid_hw = qdma_dev->queue_base + vq->qid;
+	uint16_t lost;
+	int cnt = 0;
+
+	/* Jobs enqueued without a submit are pushed out and drained too */
+	if (vq->nb_pend)
+		qdma_dma_doorbell(vq);
+
+	/* Wait for the queue to finish the descriptors handed to it */
+	while (vq->wb_status->cidx != vq->q_pidx_info.pidx) {
+		rte_delay_us_block(10);
+		if (cnt++ > 10000)
+			break;
+	}
+
+	/* Jobs the queue did not finish are dropped with the ring */
+	qdma_dma_retire(vq, UINT16_MAX);
+	lost = qdma_dma_ring_dist(vq, vq->job_head, vq->job_tail);
+	if (lost) {
+		PMD_DRV_LOG(ERR, "dmadev vchan %d stopped with %d jobs "
+				"outstanding\n", vchan, lost);
+		vq->stats.errors += lost;
+	}
+
+	if (vq->is_c2h)
+		qdma_inv_rx_queue_ctxts(eth_dev, qid_hw, 0);
+	else
+		qdma_inv_tx_queue_ctxts(eth_dev, qid_hw, 0);
+
+	qdma_dev_decrement_active_queue(qdma_dev->dma_device_index,
+			qdma_dev->func_id, vq->is_c2h ?
+			QDMA_DEV_Q_TYPE_C2H : QDMA_DEV_Q_TYPE_H2C);
+	vq->started = 0;
+}
+
+static int qdma_dma_stop(struct rte_dma_dev *dev)
+{
+	struct qdma_dma_dev *dmadev = dev->data->dev_private;
+	uint16_t i;
+
+	for (i = 0; i < dmadev->nb_vchans; i++) {
+		if (dmadev->vchans[i].started)
+			qdma_dma_vchan_stop(dmadev, i);
+	}
+
+	return 0;
+}
+
+static int qdma_dma_start(struct rte_dma_dev *dev)
+{
+	struct qdma_dma_dev *dmadev = dev->data->dev_private;
+	struct qdma_pci_dev *qdma_dev = dmadev->eth_dev->data->dev_private;
+	uint16_t i;
+	int err;
+
+	/* The dmadev queues are part of the range the resource manager
+	 * hands to the ethdev in qdma_dev_configure()
+	 */
+	if (!qdma_dev->dev_configured) {
+		PMD_DRV_LOG(ERR, "PF-%d(DEVFN) ethdev port %d must be "
+				"configured before starting dmadev %d\n",
+				qdma_dev->func_id,
+				dmadev->eth_dev->data->port_id,
+				dev->data->dev_id);
+		return -EBUSY;
+	}
+
+	for (i = 0; i < dev->data->dev_conf.nb_vchans; i++) {
+		if (!dmadev->vchans[i].configured) {
+			PMD_DRV_LOG(ERR, "dmadev vchan %d not set up\n", i);
+			err = -EINVAL;
+			goto start_err;
+		}
+		err = qdma_dma_vchan_start(dmadev, i);
+		if (err < 0) {
+			PMD_DRV_LOG(ERR, "dmadev vchan %d start failed: %d\n",
+					i, err);
+			goto start_err;
+		}
+	}
+
+	return 0;
+
+start_err:
+	qdma_dma_stop(dev);
+	return err;
+}
+
+static int qdma_dma_close(struct rte_dma_dev *dev)
+{
+	struct qdma_dma_dev *dmadev = dev->data->dev_private;
+	uint16_t i;
+
+	for (i = 0; i < dmadev->nb_vchans; i++)
+		qdma_dma_vchan_release(&dmadev->vchans[i]);
+
+	return 0;
+}
+
+static int qdma_dma_stats_get(const struct rte_dma_dev *dev, uint16_t vchan,
+		struct rte_dma_stats *stats, uint32_t stats_sz)
+{
+	struct qdma_dma_dev *dmadev = dev->data->dev_private;
+	uint16_t i;
+
+	RTE_SET_USED(stats_sz);
+
+	if (vchan != RTE_DMA_ALL_VCHAN) {
+		*stats = dmadev->vchans[vchan].stats;
+		return 0;
+	}
+
+	memset(stats, 0, sizeof(*stats));
+	for (i = 0; i < dev->data->dev_conf.nb_vchans; i++) {
+		stats->submitted += dmadev->vchans[i].stats.submitted;
+		stats->completed += dmadev->vchans[i].stats.completed;
+		stats->errors += dmadev->vchans[i].stats.errors;
+	}
+
+	return 0;
+}
+
+static int qdma_dma_stats_reset(struct rte_dma_dev *dev, uint16_t vchan)
+{
+	struct qdma_dma_dev *dmadev = dev->data->dev_private;
+	uint16_t i;
+
+	for (i = 0; i < dmadev->nb_vchans; i++) {
+		if (vchan == RTE_DMA_ALL_VCHAN || vchan == i)
+			memset(&dmadev->vchans[i].stats, 0,
+				sizeof(struct rte_dma_stats));
+	}
+
+	return 0;
+}
+
+static int qdma_dma_vchan_status(const struct rte_dma_dev *dev,
+		uint16_t vchan, enum rte_dma_vchan_status *status)
+{
+	struct qdma_dma_dev *dmadev = dev->data->dev_private;
+	struct qdma_dma_vchan *vq = &dmadev->vchans[vchan];
+
+	if (vq->started && vq->wb_status->cidx != vq->q_pidx_info.pidx)
+		*status = RTE_DMA_VCHAN_ACTIVE;
+	else
+		*status = RTE_DMA_VCHAN_IDLE;
+
+	return 0;
+}
+
+static int qdma_dma_dump(const struct rte_dma_dev *dev, FILE *f)
+{
+	struct qdma_dma_dev *dmadev = dev->data->dev_private;
+	struct qdma_dma_vchan *vq;
+	uint16_t i;
+
+	fprintf(f, "  ethdev port: %d\n", dmadev->eth_dev->data->port_id);
+	for (i = 0; i < dev->data->dev_conf.nb_vchans; i++) {
+		vq = &dmadev->vchans[i];
+		if (!vq->configured)
+			continue;
+		fprintf(f, "  vchan %d: %s qid %d nb_desc %d pidx %d "
+			"cidx %d hw cidx %d pending jobs %d\n", i,
+			vq->is_c2h ? "C2H" : "H2C", vq->qid, vq->nb_desc,
+			vq->q_pidx_info.pidx, vq->cidx,
+			vq->started ? vq->wb_status->cidx : 0,
+			(uint16_t)(vq->ring_idx - vq->cpl_idx));
+	}
+
+	return 0;
+}
+
+static const struct rte_dma_dev_ops qdma_dmadev_ops = {
+	.dev_info_get     = qdma_dma_info_get,
+	.dev_configure    = qdma_dma_configure,
+	.dev_start        = qdma_dma_start,
+	.dev_stop         = qdma_dma_stop,
+	.dev_close        = qdma_dma_close,
+	.dev_dump         = qdma_dma_dump,
+	.vchan_setup      = qdma_dma_vchan_setup,
+	.vchan_status     = qdma_dma_vchan_status,
+	.stats_get        = qdma_dma_stats_get,
+	.stats_reset      = qdma_dma_stats_reset,
+};
+
+static void qdma_dmadev_name(struct rte_eth_dev *dev, char *name,
+		size_t len)
+{
+	snprintf(name, len, "%s_dma", dev->device->name);
+}
+
+/**
+ * Creates the dmadev for the dma_queues MM queues of a PF.
+ *
+ * @param dev
+ *   Pointer to Ethernet device structure.
+ *
+ * @return
+ *   0 on success, negative errno value on failure.
+ */
+int qdma_dmadev_create(struct rte_eth_dev *dev)
+{
+	struct qdma_pci_dev *qdma_dev = dev->data->dev_private;
+	char name[RTE_DEV_NAME_MAX_LEN];
+	struct rte_dma_dev *dmadev;
+	struct qdma_dma_dev *priv;
+
+	if (!qdma_dev->dma_queues)
+		return 0;
+
+	if (!qdma_dev->dev_cap.mm_en) {
+		PMD_DRV_LOG(ERR, "PF-%d(DEVFN) dma_queues needs memory "
+				"mapped mode enabled in the hardware\n",
+				qdma_dev->func_id);
+		return -EINVAL;
+	}
+
+	qdma_dmadev_name(dev, name, sizeof(name));
+	dmadev = rte_dma_pmd_allocate(name, dev->device->numa_node,
+			sizeof(struct qdma_dma_dev) + qdma_dev->dma_queues *
+			sizeof(struct qdma_dma_vchan));
+	if (!dmadev) {
+		PMD_DRV_LOG(ERR, "PF-%d(DEVFN) Unable to allocate dmadev %s\n",
+				qdma_dev->func_id, name);
+		return -ENOMEM;
+	}
+
+	priv = dmadev->data->dev_private;
+	priv->eth_dev = dev;
+	priv->nb_vchans = qdma_dev->dma_queues;
+
+	dmadev->device = dev->device;
+	dmadev->dev_ops = &qdma_dmadev_ops;
+	dmadev->fp_obj->dev_private = priv;
+	dmadev->fp_obj->copy = qdma_dma_copy;
+	dmadev->fp_obj->copy_sg = qdma_dma_copy_sg;
+	dmadev->fp_obj->submit = qdma_dma_submit;
+	dmadev->fp_obj->completed = qdma_dma_completed;
+	dmadev->fp_obj->completed_status = qdma_dma_completed_status;
+	dmadev->fp_obj->burst_capacity = qdma_dma_burst_capacity;
+	dmadev->state = RTE_DMA_DEV_READY;
+
+	qdma_dev->dmadev = dmadev;
+	PMD_DRV_LOG(INFO, "PF-%d(DEVFN) dmadev %s: %d MM vchans\n",
+			qdma_dev->func_id, name, priv->nb_vchans);
+
+	return 0;
+}
+
+/**
+ * Stops the dmadev queues and releases their rings, called before the
+ * ethdev gives its queue range back to the resource manager. The rings
+ * may be carved from the port ring arena, which is freed along with the
+ * queue range, so the vchans have to be set up again afterwards.
+ *
+ * @param dev
+ *   Pointer to Ethernet device structure.
+ */
+void qdma_dmadev_stop(struct rte_eth_dev *dev)
+{
+	struct qdma_pci_dev *qdma_dev = dev->data->dev_private;
+	struct rte_dma_dev *dmadev = qdma_dev->dmadev;
+	struct qdma_dma_dev *priv;
+	uint16_t i;
+
+	if (!dmadev)
+		return;
+
+	if (dmadev->data->dev_started) {
+		PMD_DRV_LOG(INFO, "PF-%d(DEVFN) Stopping dmadev %d\n",
+				qdma_dev->func_id, dmadev->data->dev_id);
+		rte_dma_stop(dmadev->data->dev_id);
+	}
+
+	priv = dmadev->data->dev_private;
+	for (i = 0; i < priv->nb_vchans; i++)
+		qdma_dma_vchan_release(&priv->vchans[i]);
+}
+
+/**
+ * Releases the dmadev created by qdma_dmadev_create().
+ *
+ * @param dev
+ *   Pointer to Ethernet device structure.
+ */
+void qdma_dmadev_destroy(struct rte_eth_dev *dev)
+{
+	struct qdma_pci_dev *qdma_dev = dev->data->dev_private;
+	char name[RTE_DEV_NAME_MAX_LEN];
+
+	if (!qdma_dev->dmadev)
+		return;
+
+	qdma_dmadev_stop(dev);
+	qdma_dmadev_name(dev, name, sizeof(name));
+	rte_dma_pmd_release(name);
+	qdma_dev->dmadev = NULL;
+}
+#else
+
+int qdma_dmadev_create(struct rte_eth_dev *dev)
+{
+	struct qdma_pci_dev *qdma_dev = dev->data->dev_private;
+
+	if (!qdma_dev->dma_queues)
+		return 0;
+
+	PMD_DRV_LOG(ERR, "PF-%d(DEVFN) dma_queues needs the dmadev library "
+			"of DPDK v21.11 or later\n", qdma_dev->func_id);
+	return -ENOTSUP;
+}
+
+void qdma_dmadev_stop(struct rte_eth_dev *dev)
+{
+	RTE_SET_USED(dev);
+}
+
+void qdma_dmadev_destroy(struct rte_eth_dev *dev)
+{
+	RTE_SET_USED(dev);
+}
+#endif /* QDMA_DPDK_20_11 */
@@ -81,8 +81,7 @@ void qdma_dev_tx_queue_release(struct rte_eth_dev *dev,
 						QDMA_DEV_Q_TYPE_H2C);
 		if (txq->sw_ring)
 			rte_free(txq->sw_ring);
-		if (txq->tx_mz)
-			rte_memzone_free(txq->tx_mz);
+		qdma_ring_release(&txq->tx_mem);
 		rte_free(txq);
 		PMD_DRV_LOG(INFO, "H2C queue %d removed", txq->queue_id);
 	}
@@ -124,11 +123,9 @@ void qdma_dev_rx_queue_release(struct rte_eth_dev *dev,
 		if (rxq->sw_ring)
 			rte_free(rxq->sw_ring);
 		if (rxq->st_mode) { /** if ST-mode **/
-			if (rxq->rx_cmpt_mz)
-				rte_memzone_free(rxq->rx_cmpt_mz);
+			qdma_ring_release(&rxq->rx_cmpt_mem);
 		}
-		if (rxq->rx_mz)
-			rte_memzone_free(rxq->rx_mz);
+		qdma_ring_release(&rxq->rx_mem);
 		rte_free(rxq);
 		PMD_DRV_LOG(INFO, "C2H queue %d removed", rxq->queue_id);
 	}
@@ -171,8 +168,7 @@ void qdma_dev_tx_queue_release(void *tqueue)
 						QDMA_DEV_Q_TYPE_H2C);
 		if (txq->sw_ring)
 			rte_free(txq->sw_ring);
-		if (txq->tx_mz)
-			rte_memzone_free(txq->tx_mz);
+		qdma_ring_release(&txq->tx_mem);
 		rte_free(txq);
 		PMD_DRV_LOG(INFO, "H2C queue %d removed", txq->queue_id);
 	}
@@ -207,11 +203,9 @@ void qdma_dev_rx_queue_release(void *rqueue)
 		if (rxq->sw_ring)
 			rte_free(rxq->sw_ring);
 		if (rxq->st_mode) { /** if ST-mode **/
-			if (rxq->rx_cmpt_mz)
-				rte_memzone_free(rxq->rx_cmpt_mz);
+			qdma_ring_release(&rxq->rx_cmpt_mem);
 		}
-		if (rxq->rx_mz)
-			rte_memzone_free(rxq->rx_mz);
+		qdma_ring_release(&rxq->rx_mem);
 		rte_free(rxq);
 		PMD_DRV_LOG(INFO, "C2H queue %d removed", rxq->queue_id);
 	}
@@ -42,6 +42,7 @@
 #define ETH_LINK_UP RTE_ETH_LINK_UP
 #define ETH_LINK_FULL_DUPLEX RTE_ETH_LINK_FULL_DUPLEX
 #define ETH_SPEED_NUM_200G RTE_ETH_SPEED_NUM_200G
+#define DEV_TX_OFFLOAD_MBUF_FAST_FREE RTE_ETH_TX_OFFLOAD_MBUF_FAST_FREE
 #define pci_dev_intr_handle pci_dev->intr_handle
 #define qdma_dev_rx_queue_count qdma_dev_rx_queue_count_v2122
 #define qdma_dev_rx_queue_release qdma_dev_rx_queue_release_v2122
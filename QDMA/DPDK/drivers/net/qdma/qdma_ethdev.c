@@ -63,13 +63,6 @@
 
 #define MAX_PCIE_CAPABILITY    (48)
 
-#ifdef LATENCY_MEASUREMENT
-const struct rte_memzone *txq_lat_buf_mz;
-const struct rte_memzone *rxq_lat_buf_mz;
-double (*h2c_pidx_to_hw_cidx_lat)[LATENCY_CNT] = NULL;
-double (*c2h_pidx_to_cmpt_pidx_lat)[LATENCY_CNT] = NULL;
-#endif
-
 static void qdma_device_attributes_get(struct rte_eth_dev *dev);
 
 /* Poll for any QDMA errors */
@@ -586,6 +579,8 @@ int qdma_eth_dev_init(struct rte_eth_dev *dev)
 	dma_priv->is_master = 0;
 	dma_priv->vf_online_count = 0;
 	dma_priv->timer_count = DEFAULT_TIMER_CNT_TRIG_MODE_TIMER;
+	dma_priv->tx_db_thresh = QDMA_TX_DB_THRESH_LATENCY;
+	dma_priv->tx_db_hold_us = QDMA_TX_DB_HOLD_US_LATENCY;
 
 	dma_priv->en_desc_prefetch = 0; //Keep prefetch default to 0
 	dma_priv->cmpt_desc_len = DEFAULT_QDMA_CMPT_DESC_LEN;
@@ -771,42 +766,14 @@ int qdma_eth_dev_init(struct rte_eth_dev *dev)
 		}
 	}
 
-#ifdef LATENCY_MEASUREMENT
-	/* Create txq and rxq latency measurement shared memory
-	 * if not already created by the VF
-	 */
-	if (!h2c_pidx_to_hw_cidx_lat) {
-		/* Create a shared memory zone for the txq latency buffer */
-		txq_lat_buf_mz = rte_memzone_reserve("TXQ_LAT_BUFFER_ZONE",
-			LATENCY_MAX_QUEUES * LATENCY_CNT * sizeof(double),
-			rte_socket_id(), 0);
-		if (txq_lat_buf_mz == NULL) {
-			PMD_DRV_LOG(ERR,
-				"Failed to allocate txq latency buffer memzone\n");
-			return -1;
-		}
-
-		/* Get the virtual address of the txq latency buffer */
-		h2c_pidx_to_hw_cidx_lat =
-			(double(*)[LATENCY_CNT])txq_lat_buf_mz->addr;
-	}
-
-	if (!c2h_pidx_to_cmpt_pidx_lat) {
-		/* Create a shared memory zone for the rxq latency buffer */
-		rxq_lat_buf_mz = rte_memzone_reserve("RXQ_LAT_BUFFER_ZONE",
-			LATENCY_MAX_QUEUES * LATENCY_CNT * sizeof(double),
-			rte_socket_id(), 0);
-		if (rxq_lat_buf_mz == NULL) {
-			PMD_DRV_LOG(ERR,
-				"Failed to allocate rxq latency buffer memzone\n");
-			return -1;
-		}
-
-		/* Get the virtual address of the rxq latency buffer */
-		c2h_pidx_to_cmpt_pidx_lat =
-			(double(*)[LATENCY_CNT])rxq_lat_buf_mz->addr;
+	ret = qdma_dmadev_create(dev);
+	if (ret < 0) {
+		PMD_DRV_LOG(ERR, "PF-%d(DEVFN) dmadev creation failed: %d\n",
+			    dma_priv->func_id, ret);
+		/* nothing is configured yet, uninit only undoes the probe */
+		qdma_eth_dev_uninit(dev);
+		return ret;
 	}
-#endif
 
 	dma_priv->reset_in_progress = 0;
 
@@ -882,6 +849,8 @@ int qdma_eth_dev_uninit(struct rte_eth_dev *dev)
 	if (qdma_dev->dev_configured)
 		qdma_dev_close(dev);
 
+	qdma_dmadev_destroy(dev);
+
 	if (qdma_dev->dev_cap.mailbox_en && pci_dev->max_vfs)
 		qdma_mbox_uninit(dev);
 
@@ -921,11 +890,6 @@ int qdma_eth_dev_uninit(struct rte_eth_dev *dev)
 		qdma_dev->hw_access = NULL;
 	}
 
-#ifdef LATENCY_MEASUREMENT
-	rte_memzone_free(txq_lat_buf_mz);
-	rte_memzone_free(rxq_lat_buf_mz);
-#endif
-
 	return 0;
 }
 
@@ -33,6 +33,11 @@
 
 #include <rte_mbuf.h>
 #include <rte_cycles.h>
+#include <rte_vect.h>
+#include <rte_cpuflags.h>
+#ifndef QDMA_DPDK_20_11
+#include <rte_power_intrinsics.h>
+#endif
 #include "qdma.h"
 #include "qdma_access_common.h"
 
@@ -138,12 +143,56 @@ static int qdma_extract_st_cmpt_info(void *ul_cmpt_entry, void *cmpt_info)
 	return 0;
 }
 
+/* Free cnt completed mbufs of the software ring starting at id.
+ * With MBUF_FAST_FREE the application guarantees refcnt 1 and a single
+ * mempool per queue, so single segment mbufs go straight back to the
+ * pool in bulk, skipping the per mbuf prefree checks.
+ */
+static inline void qdma_tx_free_bufs(struct qdma_tx_queue *txq,
+			uint16_t id, uint16_t cnt)
+{
+	struct rte_mbuf **sw_ring = &txq->sw_ring[id];
+	void *free[QDMA_MAX_BURST_SIZE];
+	struct rte_mempool *pool = NULL;
+	struct rte_mbuf *mb;
+	uint16_t nb_free = 0;
+	uint16_t count;
+
+	if (!(txq->offloads & DEV_TX_OFFLOAD_MBUF_FAST_FREE)) {
+		rte_pktmbuf_free_bulk(sw_ring, cnt);
+		memset(sw_ring, 0, cnt * sizeof(*sw_ring));
+		return;
+	}
+
+	for (count = 0; count < cnt; count++) {
+		mb = sw_ring[count];
+		/* Slots of the trailing segments are left empty */
+		if (mb == NULL)
+			continue;
+		sw_ring[count] = NULL;
+		if (unlikely(mb->nb_segs != 1)) {
+			rte_pktmbuf_free(mb);
+			continue;
+		}
+		if (unlikely(mb->pool != pool ||
+				nb_free == QDMA_MAX_BURST_SIZE)) {
+			if (nb_free)
+				rte_mempool_put_bulk(pool, free, nb_free);
+			pool = mb->pool;
+			nb_free = 0;
+		}
+		free[nb_free++] = mb;
+	}
+
+	if (nb_free)
+		rte_mempool_put_bulk(pool, free, nb_free);
+}
+
 int reclaim_tx_mbuf(struct qdma_tx_queue *txq,
 			uint16_t cidx, uint16_t free_cnt)
 {
 	int fl_desc = 0;
 	uint16_t fl_desc_cnt;
-	uint16_t count;
 	int id;
 
 	id = txq->tx_fl_tail;
@@ -160,11 +209,8 @@ int reclaim_tx_mbuf(struct qdma_tx_queue *txq,
 
 	if ((id + fl_desc) < (txq->nb_tx_desc - 1)) {
 		fl_desc_cnt = ((uint16_t)fl_desc & 0xFFFF);
-		rte_pktmbuf_free_bulk(&txq->sw_ring[id], fl_desc_cnt);
-		for (count = 0; count < fl_desc_cnt; count++)
-			txq->sw_ring[id++] = NULL;
-
-		txq->tx_fl_tail = id;
+		qdma_tx_free_bufs(txq, id, fl_desc_cnt);
+		txq->tx_fl_tail = id + fl_desc_cnt;
 
 		return fl_desc;
 	}
@@ -172,18 +218,11 @@ int reclaim_tx_mbuf(struct qdma_tx_queue *txq,
 	txq->qstats.ring_wrap_cnt++;
 
 	/* Handle Tx queue ring wrap case */
-	fl_desc -= (txq->nb_tx_desc - 1 - id);
-	rte_pktmbuf_free_bulk(&txq->sw_ring[id], (txq->nb_tx_desc - 1 - id));
-	for (; id < (txq->nb_tx_desc - 1); id++)
-		txq->sw_ring[id] = NULL;
-
-	id -= (txq->nb_tx_desc - 1);
-	fl_desc_cnt = ((uint16_t)fl_desc & 0xFFFF);
-	rte_pktmbuf_free_bulk(&txq->sw_ring[id], fl_desc_cnt);
-	for (count = 0; count < fl_desc_cnt; count++)
-		txq->sw_ring[id++] = NULL;
+	qdma_tx_free_bufs(txq, id, (txq->nb_tx_desc - 1 - id));
 
-	txq->tx_fl_tail = id;
+	fl_desc_cnt = (uint16_t)(fl_desc - (txq->nb_tx_desc - 1 - id));
+	qdma_tx_free_bufs(txq, 0, fl_desc_cnt);
+	txq->tx_fl_tail = fl_desc_cnt;
 
 	return fl_desc;
 }
@@ -656,6 +695,50 @@ qdma_dev_rx_descriptor_status(void *rx_queue, uint16_t offset)
 	return RTE_ETH_RX_DESC_AVAIL;
 }
 
+#ifndef QDMA_DPDK_20_11
+/* Abort the sleep once the hardware has moved the CMPT PIDX away from
+ * the CIDX sampled when the monitor was armed.
+ */
+static int
+qdma_monitor_callback(const uint64_t value,
+		const uint64_t opaque[RTE_POWER_MONITOR_OPAQUE_SZ])
+{
+	return ((uint16_t)value != (uint16_t)opaque[0]) ? -1 : 0;
+}
+
+/**
+ * DPDK callback to get the address to monitor for the next Rx completion.
+ *
+ * In ST mode the hardware writes the CMPT ring PIDX to the status
+ * writeback entry whenever it posts completions, so that word changes
+ * before rte_eth_rx_burst() can find anything new. MM mode receives only
+ * what the driver asked for in the burst call and has nothing to monitor.
+ *
+ * @param rx_queue
+ *   Pointer to Rx queue specific data structure.
+ * @param pmc
+ *   Monitor condition to fill in.
+ *
+ * @return
+ *   0 on success, -ENOTSUP for MM queues.
+ */
+int
+qdma_dev_get_monitor_addr(void *rx_queue, struct rte_power_monitor_cond *pmc)
+{
+	struct qdma_rx_queue *rxq = rx_queue;
+
+	if (!rxq->st_mode)
+		return -ENOTSUP;
+
+	pmc->addr = &rxq->wb_status->pidx;
+	pmc->fn = qdma_monitor_callback;
+	pmc->opaque[0] = rxq->cmpt_cidx_info.wrb_cidx;
+	pmc->size = sizeof(rxq->wb_status->pidx);
+
+	return 0;
+}
+#endif
+
 /* Update mbuf for a segmented packet */
 struct rte_mbuf *prepare_segmented_packet(struct qdma_rx_queue *rxq,
 		uint16_t pkt_length, uint16_t *tail)
@@ -868,6 +951,9 @@ static int rearm_c2h_ring(struct qdma_rx_queue *rxq, uint16_t num_desc)
 		qdma_dev->is_vf,
 		rxq->queue_id, 1, &rxq->q_pidx_info);
 
+	if (unlikely(rxq->qlat_en))
+		qdma_qlat_start(&rxq->qstats.lat, rxq->wb_status->pidx);
+
 	return 0;
 }
 
@@ -904,15 +990,7 @@ uint16_t qdma_recv_pkts_st(struct qdma_rx_queue *rxq,
 #endif
 	cmpt_pidx = wb_status->pidx;
 
-#ifdef LATENCY_MEASUREMENT
-	if (cmpt_pidx != rxq->qstats.wrb_pidx) {
-		/* stop the timer */
-		rxq->qstats.pkt_lat.curr = rte_get_timer_cycles();
-		c2h_pidx_to_cmpt_pidx_lat[rxq->queue_id][rxq->qstats.lat_cnt] =
-			rxq->qstats.pkt_lat.curr - rxq->qstats.pkt_lat.prev;
-		rxq->qstats.lat_cnt = ((rxq->qstats.lat_cnt + 1) % LATENCY_CNT);
-	}
-#endif
+	qdma_rxq_qlat_check(rxq, cmpt_pidx);
 
 	if (rx_cmpt_tail < cmpt_pidx)
 		nb_pkts_avail = cmpt_pidx - rx_cmpt_tail;
@@ -1138,6 +1216,10 @@ qdma_dev_tx_done_cleanup(void *tx_queue, uint32_t free_cnt)
 	if ((uint16_t)free_cnt >= (txq->nb_tx_desc - 1))
 		return -EINVAL;
 
+	/* Ring the doorbell of descriptors held past tx_db_hold_cycles */
+	if (txq->tx_desc_pend)
+		qdma_txq_doorbell(txq, 0, false);
+
 	/* Free transmitted mbufs back to pool */
 	return reclaim_tx_mbuf(txq, txq->wb_status->cidx, free_cnt);
 }
@@ -1189,6 +1271,44 @@ qdma_dev_tx_descriptor_status(void *tx_queue, uint16_t offset)
 	return RTE_ETH_TX_DESC_FULL;
 }
 
+/* Account count new H2C descriptors and write the PIDX doorbell once
+ * tx_db_thresh descriptors are pending, the oldest pending descriptor was
+ * queued tx_db_hold_cycles ago or force is set. The hold time is checked
+ * on every burst and in tx_done_cleanup, so a queue that goes idle must
+ * keep calling one of them, with zero packets if need be, to push out the
+ * tail. Called by the thread owning the queue only, or by queue stop.
+ */
+void qdma_txq_doorbell(struct qdma_tx_queue *txq, uint16_t count, bool force)
+{
+	struct qdma_pci_dev *qdma_dev = txq->dev->data->dev_private;
+
+	if (count) {
+		if (!txq->tx_desc_pend && txq->tx_db_thresh > 1)
+			txq->tx_db_pend_tsc = rte_get_timer_cycles();
+		txq->tx_desc_pend += count;
+	}
+
+	if (!txq->tx_desc_pend)
+		return;
+
+	if (!force && txq->tx_desc_pend < txq->tx_db_thresh) {
+		if ((rte_get_timer_cycles() - txq->tx_db_pend_tsc) <
+				txq->tx_db_hold_cycles)
+			return;
+		txq->qstats.db_hold_expired_cnt++;
+	}
+
+	qdma_dev->hw_access->qdma_queue_pidx_update(txq->dev,
+		qdma_dev->is_vf,
+		txq->queue_id, 0, &txq->q_pidx_info);
+
+	txq->qstats.db_cnt++;
+	txq->qstats.db_desc_cnt += txq->tx_desc_pend;
+	txq->tx_desc_pend = 0;
+	if (unlikely(txq->qlat_en))
+		qdma_qlat_start(&txq->qstats.lat, txq->q_pidx_info.pidx);
+}
+
 /* Transmit API for Streaming mode */
 uint16_t qdma_xmit_pkts_st(struct qdma_tx_queue *txq,
 		struct rte_mbuf **tx_pkts, uint16_t nb_pkts)
@@ -1198,7 +1318,6 @@ uint16_t qdma_xmit_pkts_st(struct qdma_tx_queue *txq,
 	int avail, in_use, ret, nsegs;
 	uint16_t cidx = 0;
 	uint16_t count = 0, id;
-	struct qdma_pci_dev *qdma_dev = txq->dev->data->dev_private;
 
 #ifdef TEST_64B_DESC_BYPASS
 	int bypass_desc_sz_idx = qmda_get_desc_sz_idx(txq->bypass_desc_sz);
@@ -1218,15 +1337,7 @@ uint16_t qdma_xmit_pkts_st(struct qdma_tx_queue *txq,
 
 	cidx = txq->wb_status->cidx;
 
-#ifdef LATENCY_MEASUREMENT
-	if (cidx != txq->qstats.wrb_cidx) {
-		/* stop the timer */
-		txq->qstats.pkt_lat.curr = rte_get_timer_cycles();
-		h2c_pidx_to_hw_cidx_lat[txq->queue_id][txq->qstats.lat_cnt] =
-			txq->qstats.pkt_lat.curr - txq->qstats.pkt_lat.prev;
-		txq->qstats.lat_cnt = ((txq->qstats.lat_cnt + 1) % LATENCY_CNT);
-	}
-#endif
+	qdma_txq_qlat_check(txq, cidx);
 
 	PMD_DRV_LOG(DEBUG, "Xmit start on tx queue-id:%d, tail index:%d\n",
 			txq->queue_id, id);
@@ -1248,6 +1359,7 @@ uint16_t qdma_xmit_pkts_st(struct qdma_tx_queue *txq,
 	if (unlikely(!avail)) {
 		txq->qstats.txq_full_cnt++;
 		PMD_DRV_LOG(DEBUG, "Tx queue full, in_use = %d", in_use);
+		qdma_txq_doorbell(txq, 0, true);
 		return 0;
 	}
 
@@ -1280,28 +1392,8 @@ uint16_t qdma_xmit_pkts_st(struct qdma_tx_queue *txq,
 	txq->qstats.in_use_desc = in_use;
 	txq->qstats.nb_pkts = nb_pkts;
 
-#if (MIN_TX_PIDX_UPDATE_THRESHOLD > 1)
-	rte_spinlock_lock(&txq->pidx_update_lock);
-#endif
-	txq->tx_desc_pend += count;
-
-	/* Send PIDX update only if pending desc is more than threshold
-	 * Saves frequent Hardware transactions
-	 */
-	if (txq->tx_desc_pend >= MIN_TX_PIDX_UPDATE_THRESHOLD) {
-		qdma_dev->hw_access->qdma_queue_pidx_update(txq->dev,
-			qdma_dev->is_vf,
-			txq->queue_id, 0, &txq->q_pidx_info);
-
-		txq->tx_desc_pend = 0;
-#ifdef LATENCY_MEASUREMENT
-		/* start the timer */
-		txq->qstats.pkt_lat.prev = rte_get_timer_cycles();
-#endif
-	}
-#if (MIN_TX_PIDX_UPDATE_THRESHOLD > 1)
-	rte_spinlock_unlock(&txq->pidx_update_lock);
-#endif
+	/* A burst that did not fit is not worth holding back */
+	qdma_txq_doorbell(txq, count, count < nb_pkts);
 	PMD_DRV_LOG(DEBUG, " xmit completed with count:%d\n", count);
 
 	return count;
@@ -1429,18 +1521,60 @@ uint16_t qdma_xmit_pkts(void *tx_queue, struct rte_mbuf **tx_pkts,
 	return count;
 }
 
+/* Widest vector path usable by the burst functions, limited by the EAL
+ * --force-max-simd-bitwidth setting, the CPU and the compiler
+ */
+static uint16_t __rte_cold qdma_get_max_simd_bitwidth(void)
+{
+	uint16_t max_simd = rte_vect_get_max_simd_bitwidth();
+
+#ifdef CC_AVX512_SUPPORT
+	if (max_simd >= RTE_VECT_SIMD_512 &&
+		rte_cpu_get_flag_enabled(RTE_CPUFLAG_AVX512F) == 1)
+		return RTE_VECT_SIMD_512;
+#endif
+#ifdef CC_AVX2_SUPPORT
+	if (max_simd >= RTE_VECT_SIMD_256 &&
+		rte_cpu_get_flag_enabled(RTE_CPUFLAG_AVX2) == 1)
+		return RTE_VECT_SIMD_256;
+#endif
+	if (max_simd >= RTE_VECT_SIMD_128)
+		return RTE_VECT_SIMD_128;
+
+	return RTE_VECT_SIMD_DISABLED;
+}
+
 void __rte_cold
 qdma_set_tx_function(struct rte_eth_dev *dev)
 {
 	struct qdma_pci_dev *qdma_dev = dev->data->dev_private;
+	uint16_t max_simd = qdma_get_max_simd_bitwidth();
 
-	if (rte_vect_get_max_simd_bitwidth() >= RTE_VECT_SIMD_128) {
+	if (max_simd >= RTE_VECT_SIMD_128)
+		qdma_dev->tx_vec_allowed = true;
+
+#ifdef CC_AVX512_SUPPORT
+	if (max_simd >= RTE_VECT_SIMD_512) {
+		PMD_DRV_LOG(DEBUG, "Using AVX-512 Vector Tx (port %d).",
+			dev->data->port_id);
+		dev->tx_pkt_burst = qdma_xmit_pkts_vec_avx512;
+		return;
+	}
+#endif
+#ifdef CC_AVX2_SUPPORT
+	if (max_simd >= RTE_VECT_SIMD_256) {
+		PMD_DRV_LOG(DEBUG, "Using AVX2 Vector Tx (port %d).",
+			dev->data->port_id);
+		dev->tx_pkt_burst = qdma_xmit_pkts_vec_avx2;
+		return;
+	}
+#endif
+	if (max_simd >= RTE_VECT_SIMD_128) {
 		PMD_DRV_LOG(DEBUG, "Using Vector Tx (port %d).",
 			dev->data->port_id);
-		qdma_dev->tx_vec_allowed = true;
 		dev->tx_pkt_burst = qdma_xmit_pkts_vec;
 	} else {
-		PMD_DRV_LOG(DEBUG, "Normal Rx will be used on port %d.",
+		PMD_DRV_LOG(DEBUG, "Normal Tx will be used on port %d.",
 				dev->data->port_id);
 		dev->tx_pkt_burst = qdma_xmit_pkts;
 	}
@@ -1450,11 +1584,30 @@ void __rte_cold
 qdma_set_rx_function(struct rte_eth_dev *dev)
 {
 	struct qdma_pci_dev *qdma_dev = dev->data->dev_private;
+	uint16_t max_simd = qdma_get_max_simd_bitwidth();
+
+	if (max_simd >= RTE_VECT_SIMD_128)
+		qdma_dev->rx_vec_allowed = true;
 
-	if (rte_vect_get_max_simd_bitwidth() >= RTE_VECT_SIMD_128) {
+#ifdef CC_AVX512_SUPPORT
+	if (max_simd >= RTE_VECT_SIMD_512) {
+		PMD_DRV_LOG(DEBUG, "Using AVX-512 Vector Rx (port %d).",
+			dev->data->port_id);
+		dev->rx_pkt_burst = qdma_recv_pkts_vec_avx512;
+		return;
+	}
+#endif
+#ifdef CC_AVX2_SUPPORT
+	if (max_simd >= RTE_VECT_SIMD_256) {
+		PMD_DRV_LOG(DEBUG, "Using AVX2 Vector Rx (port %d).",
+			dev->data->port_id);
+		dev->rx_pkt_burst = qdma_recv_pkts_vec_avx2;
+		return;
+	}
+#endif
+	if (max_simd >= RTE_VECT_SIMD_128) {
 		PMD_DRV_LOG(DEBUG, "Using Vector Rx (port %d).",
 			dev->data->port_id);
-		qdma_dev->rx_vec_allowed = true;
 		dev->rx_pkt_burst = qdma_recv_pkts_vec;
 	} else {
 		PMD_DRV_LOG(DEBUG, "Normal Rx will be used on port %d.",
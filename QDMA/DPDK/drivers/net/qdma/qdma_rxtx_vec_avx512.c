@@ -0,0 +1,420 @@
+/*-
+ * BSD LICENSE
+ *
+ * Copyright (c) 2017-2022 Xilinx, Inc. All rights reserved.
+ * Copyright (c) 2022-2024, Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <rte_mbuf.h>
+#include <rte_cycles.h>
+#include "qdma.h"
+#include "qdma_access_common.h"
+
+#include "qdma_rxtx.h"
+#include "qdma_rxtx_vec_common.h"
+
+#include <immintrin.h>
+
+#define QDMA_AVX512_DESCS_PER_LOOP	(8)
+
+/* Process completion ring, eight entries at a time.
+ * Entries are parsed as laid out by the example design, the same as
+ * qdma_ul_extract_st_cmpt_info() does. The loop stops at the first error,
+ * at the end of the ring and for immediate data, the remaining entries are
+ * handled one by one.
+ */
+static int process_cmpt_ring_avx512(struct qdma_rx_queue *rxq,
+		uint16_t num_cmpt_entries)
+{
+	uint16_t rx_cmpt_tail = rxq->cmpt_cidx_info.wrb_cidx;
+	uint16_t count = 0;
+
+	if (likely(!rxq->dump_immediate_data)) {
+		const int desc_len = rxq->cmpt_desc_len;
+		const __m256i stride = _mm256_mullo_epi32(
+				_mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0),
+				_mm256_set1_epi32(desc_len));
+		const __m512i err_msk = _mm512_set1_epi64(
+				QDMA_VEC_CMPT_F_DATA_FRMT |
+				QDMA_VEC_CMPT_F_ERR);
+		const __m512i used_msk =
+			_mm512_set1_epi64(QDMA_VEC_CMPT_F_DESC_USED);
+		const __m512i len_clr =
+			_mm512_set1_epi64(~QDMA_VEC_CMPT_LEN_MASK);
+		uint16_t n_cmpt = RTE_MIN(num_cmpt_entries,
+				rxq->nb_rx_cmpt_desc - 1 - rx_cmpt_tail) &
+				~(QDMA_AVX512_DESCS_PER_LOOP - 1);
+
+		for (; count < n_cmpt; count += QDMA_AVX512_DESCS_PER_LOOP,
+				rx_cmpt_tail += QDMA_AVX512_DESCS_PER_LOOP) {
+			const void *entry = (const void *)
+				((uint64_t)rxq->cmpt_ring +
+				((uint64_t)rx_cmpt_tail * desc_len));
+			__m512i cmpt;
+			__mmask8 used;
+
+			/* First 8 bytes of eight completion entries */
+			cmpt = _mm512_i32gather_epi64(stride, entry, 1);
+			if (unlikely(_mm512_test_epi64_mask(cmpt, err_msk)))
+				break;
+
+			/* Packets that did not use a descriptor have no
+			 * data, clear their length
+			 */
+			used = _mm512_test_epi64_mask(cmpt, used_msk);
+			cmpt = _mm512_mask_and_epi64(cmpt, (__mmask8)~used,
+					cmpt, len_clr);
+
+			_mm512_storeu_si512((void *)&rxq->cmpt_data[count],
+					cmpt);
+		}
+	}
+
+	return qdma_vec_process_cmpt_ring_tail(rxq, count, num_cmpt_entries,
+			rx_cmpt_tail);
+}
+
+/* Prepare mbufs for packets, eight at a time.
+ * Update this API if HW provides more information to be populated in mbuf.
+ */
+static uint16_t prepare_packets_avx512(struct qdma_rx_queue *rxq,
+			struct rte_mbuf **rx_pkts, uint16_t nb_pkts)
+{
+	struct rte_mbuf **sw_ring = rxq->sw_ring;
+	uint16_t n_pkts = nb_pkts & ~(QDMA_AVX512_DESCS_PER_LOOP - 1);
+	uint16_t last_id = rxq->nb_rx_desc - 1;
+	uint16_t id = rxq->rx_tail;
+	uint16_t count, count_pkts = 0;
+	uint64_t seg_bytes = 0;
+	const __m512i len_msk = _mm512_set1_epi64(0xFFFF);
+	const __m512i buff_size = _mm512_set1_epi64(rxq->rx_buff_size);
+	const __m256i mbuf_init = _mm256_set_epi64x(0, 0, 0,
+			rxq->mbuf_initializer);
+	const __m512i zero = _mm512_setzero_si512();
+	__m512i bytes = zero;
+
+	for (count = 0; count < n_pkts; count += QDMA_AVX512_DESCS_PER_LOOP) {
+		__m512i len;
+		__m256i len_lo, len_hi;
+		__mmask8 good;
+		uint16_t i;
+
+		len = _mm512_loadu_si512((const void *)&rxq->cmpt_data[count]);
+		len = _mm512_and_si512(
+				_mm512_srli_epi64(len, QDMA_VEC_CMPT_LEN_SHIFT),
+				len_msk);
+
+		/* Empty packets and packets spanning more than one
+		 * buffer take the slow path
+		 */
+		good = _mm512_test_epi64_mask(len, len) &
+			_mm512_cmple_epu64_mask(len, buff_size);
+
+		if (likely(good == 0xFF &&
+			((id + QDMA_AVX512_DESCS_PER_LOOP) < last_id))) {
+			struct rte_mbuf **mb = &rx_pkts[count_pkts];
+			__m512i mbp;
+
+			/* Move eight mbuf pointers from sw_ring to rx_pkts */
+			mbp = _mm512_loadu_si512((const void *)&sw_ring[id]);
+			_mm512_storeu_si512((void *)mb, mbp);
+			_mm512_storeu_si512((void *)&sw_ring[id], zero);
+
+			len_lo = _mm512_castsi512_si256(len);
+			len_hi = _mm512_extracti64x4_epi64(len, 1);
+
+			qdma_avx2_rx_mbuf_init(mb[0],
+				_mm256_permute4x64_epi64(len_lo, 0x00),
+				mbuf_init);
+			qdma_avx2_rx_mbuf_init(mb[1],
+				_mm256_permute4x64_epi64(len_lo, 0x55),
+				mbuf_init);
+			qdma_avx2_rx_mbuf_init(mb[2],
+				_mm256_permute4x64_epi64(len_lo, 0xAA),
+				mbuf_init);
+			qdma_avx2_rx_mbuf_init(mb[3],
+				_mm256_permute4x64_epi64(len_lo, 0xFF),
+				mbuf_init);
+			qdma_avx2_rx_mbuf_init(mb[4],
+				_mm256_permute4x64_epi64(len_hi, 0x00),
+				mbuf_init);
+			qdma_avx2_rx_mbuf_init(mb[5],
+				_mm256_permute4x64_epi64(len_hi, 0x55),
+				mbuf_init);
+			qdma_avx2_rx_mbuf_init(mb[6],
+				_mm256_permute4x64_epi64(len_hi, 0xAA),
+				mbuf_init);
+			qdma_avx2_rx_mbuf_init(mb[7],
+				_mm256_permute4x64_epi64(len_hi, 0xFF),
+				mbuf_init);
+
+			bytes = _mm512_add_epi64(bytes, len);
+			count_pkts += QDMA_AVX512_DESCS_PER_LOOP;
+			id += QDMA_AVX512_DESCS_PER_LOOP;
+			continue;
+		}
+
+		/* Handle packets segmented across multiple descriptors
+		 * or ring wrap
+		 */
+		for (i = 0; i < QDMA_AVX512_DESCS_PER_LOOP; i++) {
+			uint16_t pkt_length = qdma_ul_get_cmpt_pkt_len(
+					&rxq->cmpt_data[count + i]);
+
+			if (!pkt_length)
+				continue;
+			rx_pkts[count_pkts++] = prepare_segmented_packet(rxq,
+					pkt_length, &id);
+			seg_bytes += pkt_length;
+		}
+	}
+
+	rxq->stats.pkts += count_pkts;
+	rxq->stats.bytes += seg_bytes + _mm512_reduce_add_epi64(bytes);
+	rxq->rx_tail = id;
+
+	/* Handle remaining packets, if any pending */
+	for (; count < nb_pkts; count++) {
+		struct rte_mbuf *mb = prepare_single_packet(rxq, count);
+
+		if (mb)
+			rx_pkts[count_pkts++] = mb;
+	}
+
+	return count_pkts;
+}
+
+/* Populate C2H ring with new buffers, eight at a time */
+static int rearm_c2h_ring_avx512(struct qdma_rx_queue *rxq,
+		uint16_t num_desc)
+{
+	struct rte_mbuf **sw_ring = rxq->sw_ring;
+	struct qdma_ul_st_c2h_desc *rx_ring_st =
+			(struct qdma_ul_st_c2h_desc *)rxq->rx_ring;
+	const __m512i head_room = _mm512_set1_epi64(RTE_PKTMBUF_HEADROOM);
+	uint16_t mbuf_index;
+	uint16_t rearm_descs;
+	uint16_t id;
+
+	id = rxq->q_pidx_info.pidx;
+
+	/* Split the C2H ring updation in two parts.
+	 * First handle till end of ring and then
+	 * handle from beginning of ring, if ring wraps
+	 */
+	if ((id + num_desc) < (rxq->nb_rx_desc - 1))
+		rearm_descs = num_desc;
+	else {
+		rearm_descs = (rxq->nb_rx_desc - 1) - id;
+		rxq->qstats.ring_wrap_cnt++;
+	}
+
+	/* allocate new buffer */
+	if (qdma_vec_rx_mbufs_get(rxq, id, rearm_descs) != 0)
+		return -1;
+
+	/* load buf_addr(lo 64bit) and buf_iova(hi 64bit) */
+	RTE_BUILD_BUG_ON(offsetof(struct rte_mbuf, buf_iova) !=
+			offsetof(struct rte_mbuf, buf_addr) + 8);
+
+	for (mbuf_index = 0;
+		(mbuf_index + QDMA_AVX512_DESCS_PER_LOOP) <= rearm_descs;
+		mbuf_index += QDMA_AVX512_DESCS_PER_LOOP,
+		id += QDMA_AVX512_DESCS_PER_LOOP) {
+		__m128i vaddr[QDMA_AVX512_DESCS_PER_LOOP];
+		__m512i vaddr_even, vaddr_odd, dma_addr;
+		int i;
+
+		for (i = 0; i < QDMA_AVX512_DESCS_PER_LOOP; i++)
+			vaddr[i] = _mm_loadu_si128(
+				(__m128i *)&sw_ring[id + i]->buf_addr);
+
+		/* mbufs 0, 2, 4, 6 and 1, 3, 5, 7 */
+		vaddr_even = _mm512_inserti64x4(
+			_mm512_castsi256_si512(_mm256_inserti128_si256(
+				_mm256_castsi128_si256(vaddr[0]), vaddr[2], 1)),
+			_mm256_inserti128_si256(
+				_mm256_castsi128_si256(vaddr[4]), vaddr[6], 1),
+			1);
+		vaddr_odd = _mm512_inserti64x4(
+			_mm512_castsi256_si512(_mm256_inserti128_si256(
+				_mm256_castsi128_si256(vaddr[1]), vaddr[3], 1)),
+			_mm256_inserti128_si256(
+				_mm256_castsi128_si256(vaddr[5]), vaddr[7], 1),
+			1);
+
+		/* Extract physical addresses of eight mbufs, in order */
+		dma_addr = _mm512_unpackhi_epi64(vaddr_even, vaddr_odd);
+
+		/* Add headroom to dma_addr */
+		dma_addr = _mm512_add_epi64(dma_addr, head_room);
+
+		/* Write C2H desc with physical dma_addr */
+		_mm512_storeu_si512((void *)&rx_ring_st[id], dma_addr);
+	}
+
+	for (; mbuf_index < rearm_descs; mbuf_index++, id++) {
+		/* rearm descriptor */
+		rx_ring_st[id].dst_addr =
+				(uint64_t)sw_ring[id]->buf_iova +
+					RTE_PKTMBUF_HEADROOM;
+	}
+
+	return qdma_vec_rx_rearm_wrap(rxq, id, num_desc - rearm_descs);
+}
+
+/* Receive API for Streaming mode */
+static uint16_t qdma_recv_pkts_st_vec_avx512(struct qdma_rx_queue *rxq,
+		struct rte_mbuf **rx_pkts, uint16_t nb_pkts)
+{
+	return qdma_recv_pkts_st_vec_common(rxq, rx_pkts, nb_pkts,
+			process_cmpt_ring_avx512, prepare_packets_avx512,
+			rearm_c2h_ring_avx512);
+}
+
+/**
+ * DPDK callback for receiving packets in burst, AVX-512 version.
+ *
+ * @param rx_queue
+ *   Generic pointer to Rx queue structure.
+ * @param[out] rx_pkts
+ *   Array to store received packets.
+ * @param nb_pkts
+ *   Maximum number of packets in array.
+ *
+ * @return
+ *   Number of packets successfully received (<= nb_pkts).
+ */
+uint16_t qdma_recv_pkts_vec_avx512(void *rx_queue, struct rte_mbuf **rx_pkts,
+			uint16_t nb_pkts)
+{
+	return qdma_recv_pkts_vec_common(rx_queue, rx_pkts, nb_pkts,
+			qdma_recv_pkts_st_vec_avx512);
+}
+
+/* Write the H2C descriptors of four single segment packets */
+static __rte_always_inline void
+qdma_avx512_h2c_desc4(struct qdma_ul_st_h2c_desc *desc,
+		struct rte_mbuf **pkts)
+{
+	const uint64_t flags =
+		(uint64_t)(S_H2C_DESC_F_SOP | S_H2C_DESC_F_EOP) << 48;
+	uint64_t len0 = pkts[0]->data_len;
+	uint64_t len1 = pkts[1]->data_len;
+	uint64_t len2 = pkts[2]->data_len;
+	uint64_t len3 = pkts[3]->data_len;
+	__m512i descs;
+
+	descs = _mm512_set_epi64(pkts[3]->buf_iova + pkts[3]->data_off,
+			flags | len3 << 32 | len3 << 16,
+			pkts[2]->buf_iova + pkts[2]->data_off,
+			flags | len2 << 32 | len2 << 16,
+			pkts[1]->buf_iova + pkts[1]->data_off,
+			flags | len1 << 32 | len1 << 16,
+			pkts[0]->buf_iova + pkts[0]->data_off,
+			flags | len0 << 32 | len0 << 16);
+	_mm512_storeu_si512((void *)desc, descs);
+}
+
+/* Fill H2C descriptors, eight single segment packets at a time */
+static uint16_t fill_h2c_ring_avx512(struct qdma_tx_queue *txq,
+		struct rte_mbuf **tx_pkts, uint16_t nb_pkts,
+		int avail, uint64_t *pkt_len)
+{
+	struct qdma_ul_st_h2c_desc *tx_ring_st =
+			(struct qdma_ul_st_h2c_desc *)txq->tx_ring;
+	uint16_t last_id = txq->nb_tx_desc - 1;
+	uint16_t count = 0;
+	uint16_t id, i;
+
+	while (count < nb_pkts) {
+		struct rte_mbuf **pkts = &tx_pkts[count];
+
+		id = txq->q_pidx_info.pidx;
+		if (likely((count + QDMA_AVX512_DESCS_PER_LOOP) <= nb_pkts &&
+			avail >= QDMA_AVX512_DESCS_PER_LOOP &&
+			(id + QDMA_AVX512_DESCS_PER_LOOP) <= last_id &&
+			(pkts[0]->nb_segs | pkts[1]->nb_segs |
+			 pkts[2]->nb_segs | pkts[3]->nb_segs |
+			 pkts[4]->nb_segs | pkts[5]->nb_segs |
+			 pkts[6]->nb_segs | pkts[7]->nb_segs) == 1)) {
+			_mm512_storeu_si512((void *)&txq->sw_ring[id],
+				_mm512_loadu_si512((const void *)pkts));
+
+			qdma_avx512_h2c_desc4(&tx_ring_st[id], pkts);
+			qdma_avx512_h2c_desc4(&tx_ring_st[id + 4], pkts + 4);
+
+			for (i = 0; i < QDMA_AVX512_DESCS_PER_LOOP; i++)
+				*pkt_len += rte_pktmbuf_pkt_len(pkts[i]);
+
+			id += QDMA_AVX512_DESCS_PER_LOOP;
+			if (unlikely(id >= last_id))
+				id -= last_id;
+			txq->q_pidx_info.pidx = id;
+			avail -= QDMA_AVX512_DESCS_PER_LOOP;
+			count += QDMA_AVX512_DESCS_PER_LOOP;
+			continue;
+		}
+
+		/* Segmented packet, ring wrap or end of the burst */
+		if (!qdma_vec_tx_one(txq, pkts[0], &avail, pkt_len))
+			break;
+		count++;
+	}
+
+	return count;
+}
+
+/* Transmit API for Streaming mode */
+static uint16_t qdma_xmit_pkts_st_vec_avx512(struct qdma_tx_queue *txq,
+		struct rte_mbuf **tx_pkts, uint16_t nb_pkts)
+{
+	return qdma_xmit_pkts_st_vec_common(txq, tx_pkts, nb_pkts,
+			fill_h2c_ring_avx512);
+}
+
+/**
+ * DPDK callback for transmitting packets in burst, AVX-512 version.
+ *
+ * @param tx_queue
+ *   Generic pointer to TX queue structure.
+ * @param[in] tx_pkts
+ *   Packets to transmit.
+ * @param nb_pkts
+ *   Number of packets in array.
+ *
+ * @return
+ *   Number of packets successfully transmitted (<= nb_pkts).
+ */
+uint16_t qdma_xmit_pkts_vec_avx512(void *tx_queue, struct rte_mbuf **tx_pkts,
+			uint16_t nb_pkts)
+{
+	return qdma_xmit_pkts_vec_common(tx_queue, tx_pkts, nb_pkts,
+			qdma_xmit_pkts_st_vec_avx512);
+}
@@ -0,0 +1,584 @@
+/*-
+ * BSD LICENSE
+ *
+ * Copyright (c) 2017-2022 Xilinx, Inc. All rights reserved.
+ * Copyright (c) 2022-2024, Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __QDMA_RXTX_VEC_COMMON_H__
+#define __QDMA_RXTX_VEC_COMMON_H__
+
+/*
+ * Burst function skeletons and slow path helpers shared by the SSE, AVX2
+ * and AVX-512 Rx/Tx implementations. Every vector source file provides its
+ * own completion parsing, mbuf preparation, C2H rearm and H2C descriptor
+ * fill routines and plugs them into the skeletons below.
+ */
+
+#include <rte_mbuf.h>
+#include <rte_cycles.h>
+#include "qdma.h"
+#include "qdma_access_common.h"
+#include "qdma_rxtx.h"
+
+#include <immintrin.h>
+
+/* Example design completion entry layout, see union qdma_ul_st_cmpt_ring */
+#define QDMA_VEC_CMPT_F_DATA_FRMT	(1ULL << 0)
+#define QDMA_VEC_CMPT_F_ERR		(1ULL << 2)
+#define QDMA_VEC_CMPT_F_DESC_USED	(1ULL << 3)
+#define QDMA_VEC_CMPT_LEN_SHIFT		(4)
+#define QDMA_VEC_CMPT_LEN_MASK		(0xFFFFULL << QDMA_VEC_CMPT_LEN_SHIFT)
+
+/* Vector implementation to update H2C descriptor */
+static inline int qdma_ul_update_st_h2c_desc_vec(void *qhndl,
+				uint64_t q_offloads, struct rte_mbuf *mb)
+{
+	(void)q_offloads;
+	int nsegs = mb->nb_segs;
+	uint16_t flags = S_H2C_DESC_F_SOP | S_H2C_DESC_F_EOP;
+	uint16_t id;
+	struct qdma_ul_st_h2c_desc *tx_ring_st;
+	struct qdma_tx_queue *txq = (struct qdma_tx_queue *)qhndl;
+
+	tx_ring_st = (struct qdma_ul_st_h2c_desc *)txq->tx_ring;
+	id = txq->q_pidx_info.pidx;
+
+	if (nsegs == 1) {
+		__m128i descriptor;
+		uint16_t datalen = mb->data_len;
+
+		descriptor = _mm_set_epi64x(mb->buf_iova + mb->data_off,
+				(uint64_t)datalen << 16 |
+				(uint64_t)datalen << 32 |
+				(uint64_t)flags << 48);
+		_mm_store_si128((__m128i *)&tx_ring_st[id], descriptor);
+
+		id++;
+		if (unlikely(id >= (txq->nb_tx_desc - 1)))
+			id -= (txq->nb_tx_desc - 1);
+	} else {
+		int pkt_segs = nsegs;
+		while (nsegs && mb) {
+			__m128i descriptor;
+			uint16_t datalen = mb->data_len;
+
+			flags = 0;
+			if (nsegs == pkt_segs)
+				flags |= S_H2C_DESC_F_SOP;
+			if (nsegs == 1)
+				flags |= S_H2C_DESC_F_EOP;
+
+			descriptor = _mm_set_epi64x(mb->buf_iova + mb->data_off,
+					(uint64_t)datalen << 16 |
+					(uint64_t)datalen << 32 |
+					(uint64_t)flags << 48);
+			_mm_store_si128((__m128i *)&tx_ring_st[id], descriptor);
+
+			nsegs--;
+			mb = mb->next;
+			id++;
+			if (unlikely(id >= (txq->nb_tx_desc - 1)))
+				id -= (txq->nb_tx_desc - 1);
+		}
+	}
+
+	txq->q_pidx_info.pidx = id;
+
+	return 0;
+}
+
+/* Process completion entries starting from cmpt_data index count, one by
+ * one, and update the CMPT CIDX. Vector implementations parse what they
+ * can and leave the ring wrap, errors and immediate data to this function.
+ */
+static inline int qdma_vec_process_cmpt_ring_tail(struct qdma_rx_queue *rxq,
+		uint16_t count, uint16_t num_cmpt_entries,
+		uint16_t rx_cmpt_tail)
+{
+	struct qdma_pci_dev *qdma_dev = rxq->dev->data->dev_private;
+	union qdma_ul_st_cmpt_ring *user_cmpt_entry;
+	int ret;
+
+	if (unlikely(rx_cmpt_tail >= (rxq->nb_rx_cmpt_desc - 1)))
+		rx_cmpt_tail -= (rxq->nb_rx_cmpt_desc - 1);
+
+	while (count < num_cmpt_entries) {
+		user_cmpt_entry =
+		(union qdma_ul_st_cmpt_ring *)
+		((uint64_t)rxq->cmpt_ring +
+		((uint64_t)rx_cmpt_tail * rxq->cmpt_desc_len));
+
+		ret = qdma_ul_extract_st_cmpt_info(
+				user_cmpt_entry,
+				&rxq->cmpt_data[count]);
+		if (ret != 0) {
+			PMD_DRV_LOG(ERR, "Error detected on CMPT ring "
+				"at index %d, queue_id = %d\n",
+				rx_cmpt_tail, rxq->queue_id);
+			rxq->err = 1;
+			return -1;
+		}
+
+		if (unlikely(rxq->dump_immediate_data)) {
+			ret = qdma_ul_process_immediate_data_st((void *)rxq,
+					user_cmpt_entry, rxq->cmpt_desc_len);
+			if (ret < 0) {
+				PMD_DRV_LOG(ERR, "Error processing immediate "
+					"data at CMPT index = %d, "
+					"queue_id = %d\n",
+					rx_cmpt_tail, rxq->queue_id);
+				return -1;
+			}
+		}
+
+		rx_cmpt_tail++;
+		if (unlikely(rx_cmpt_tail >=
+			(rxq->nb_rx_cmpt_desc - 1)))
+			rx_cmpt_tail -= (rxq->nb_rx_cmpt_desc - 1);
+		count++;
+	}
+
+	// Update the CPMT CIDX
+	rxq->cmpt_cidx_info.wrb_cidx = rx_cmpt_tail;
+	qdma_dev->hw_access->qdma_queue_cmpt_cidx_update(rxq->dev,
+		qdma_dev->is_vf,
+		rxq->queue_id, &rxq->cmpt_cidx_info);
+
+	return 0;
+}
+
+/* Prepare mbuf for one packet */
+static inline
+struct rte_mbuf *prepare_single_packet(struct qdma_rx_queue *rxq,
+		uint16_t cmpt_idx)
+{
+	struct rte_mbuf *mb = NULL;
+	uint16_t id = rxq->rx_tail;
+	uint16_t pkt_length;
+
+	pkt_length = qdma_ul_get_cmpt_pkt_len(&rxq->cmpt_data[cmpt_idx]);
+
+	if (pkt_length) {
+		rxq->stats.pkts++;
+		rxq->stats.bytes += pkt_length;
+
+		if (likely(pkt_length <= rxq->rx_buff_size)) {
+			mb = rxq->sw_ring[id];
+			rxq->sw_ring[id++] = NULL;
+
+			if (unlikely(id >= (rxq->nb_rx_desc - 1)))
+				id -= (rxq->nb_rx_desc - 1);
+
+			rte_mbuf_refcnt_set(mb, 1);
+			mb->nb_segs = 1;
+			mb->port = rxq->port_id;
+			mb->ol_flags = 0;
+			mb->packet_type = 0;
+			mb->pkt_len = pkt_length;
+			mb->data_len = pkt_length;
+		} else {
+			mb = prepare_segmented_packet(rxq, pkt_length, &id);
+		}
+
+		rxq->rx_tail = id;
+	}
+	return mb;
+}
+
+/* Get num_desc mbufs from the Rx pool into the software ring at id */
+static inline int qdma_vec_rx_mbufs_get(struct qdma_rx_queue *rxq,
+		uint16_t id, uint16_t num_desc)
+{
+	if (unlikely(rte_mempool_get_bulk(rxq->mb_pool,
+			(void *)&rxq->sw_ring[id], num_desc) != 0)) {
+		PMD_DRV_LOG(ERR, "%s(): %d: No MBUFS, queue id = %d,"
+		"mbuf_avail_count = %d,"
+		" mbuf_in_use_count = %d, num_desc_req = %d\n",
+		__func__, __LINE__, rxq->queue_id,
+		rte_mempool_avail_count(rxq->mb_pool),
+		rte_mempool_in_use_count(rxq->mb_pool), num_desc);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Update the C2H PIDX once the descriptors up to id are written */
+static inline void qdma_vec_rx_pidx_update(struct qdma_rx_queue *rxq,
+		uint16_t id)
+{
+	struct qdma_pci_dev *qdma_dev = rxq->dev->data->dev_private;
+
+	/* Make sure writes to the C2H descriptors are
+	 * synchronized before updating PIDX
+	 */
+	rte_wmb();
+
+	rxq->q_pidx_info.pidx = id;
+	qdma_dev->hw_access->qdma_queue_pidx_update(rxq->dev,
+		qdma_dev->is_vf,
+		rxq->queue_id, 1, &rxq->q_pidx_info);
+
+	if (unlikely(rxq->qlat_en))
+		qdma_qlat_start(&rxq->qstats.lat, rxq->wb_status->pidx);
+}
+
+/* Rearm num_desc C2H descriptors from the beginning of the ring after the
+ * vector rearm reached its end, then update the PIDX
+ */
+static inline int qdma_vec_rx_rearm_wrap(struct qdma_rx_queue *rxq,
+		uint16_t id, uint16_t num_desc)
+{
+	struct qdma_ul_st_c2h_desc *rx_ring_st =
+			(struct qdma_ul_st_c2h_desc *)rxq->rx_ring;
+	struct rte_mbuf *mb;
+	uint16_t mbuf_index;
+
+	if (unlikely(id >= (rxq->nb_rx_desc - 1)))
+		id -= (rxq->nb_rx_desc - 1);
+
+	/* Handle from beginning of ring, if ring wrapped */
+	if (unlikely(num_desc)) {
+		if (qdma_vec_rx_mbufs_get(rxq, id, num_desc) != 0) {
+			qdma_vec_rx_pidx_update(rxq, id);
+			return -1;
+		}
+
+		for (mbuf_index = 0; mbuf_index < num_desc;
+				mbuf_index++, id++) {
+			mb = rxq->sw_ring[id];
+			mb->data_off = RTE_PKTMBUF_HEADROOM;
+
+			/* rearm descriptor */
+			rx_ring_st[id].dst_addr =
+					(uint64_t)mb->buf_iova +
+						RTE_PKTMBUF_HEADROOM;
+		}
+	}
+
+	PMD_DRV_LOG(DEBUG, "%s(): %d: PIDX Update: queue id = %d, "
+				"PIDX = %d",
+				__func__, __LINE__, rxq->queue_id, id);
+
+	qdma_vec_rx_pidx_update(rxq, id);
+
+	return 0;
+}
+
+/* Receive API for Streaming mode, common to all vector implementations */
+static __rte_always_inline uint16_t
+qdma_recv_pkts_st_vec_common(struct qdma_rx_queue *rxq,
+		struct rte_mbuf **rx_pkts, uint16_t nb_pkts,
+		int (*process_cmpt_ring)(struct qdma_rx_queue *rxq,
+			uint16_t num_cmpt_entries),
+		uint16_t (*prepare_packets)(struct qdma_rx_queue *rxq,
+			struct rte_mbuf **rx_pkts, uint16_t nb_pkts),
+		int (*rearm_c2h_ring)(struct qdma_rx_queue *rxq,
+			uint16_t num_desc))
+{
+	uint16_t count_pkts;
+	struct wb_status *wb_status;
+	uint16_t nb_pkts_avail = 0;
+	uint16_t rx_cmpt_tail = 0;
+	uint16_t cmpt_pidx, c2h_pidx;
+	uint16_t pending_desc;
+#ifdef TEST_64B_DESC_BYPASS
+	int bypass_desc_sz_idx = qmda_get_desc_sz_idx(rxq->bypass_desc_sz);
+#endif
+
+	if (unlikely(rxq->err))
+		return 0;
+
+	PMD_DRV_LOG(DEBUG, "recv start on rx queue-id :%d, on "
+			"tail index:%d number of pkts %d",
+			rxq->queue_id, rxq->rx_tail, nb_pkts);
+	wb_status = rxq->wb_status;
+	rx_cmpt_tail = rxq->cmpt_cidx_info.wrb_cidx;
+
+#ifdef TEST_64B_DESC_BYPASS
+	if (unlikely(rxq->en_bypass &&
+			bypass_desc_sz_idx == SW_DESC_CNTXT_64B_BYPASS_DMA)) {
+		PMD_DRV_LOG(DEBUG, "For  RX ST-mode, example"
+				" design doesn't support 64byte descriptor\n");
+		return 0;
+	}
+#endif
+	cmpt_pidx = wb_status->pidx;
+
+	qdma_rxq_qlat_check(rxq, cmpt_pidx);
+
+	if (rx_cmpt_tail < cmpt_pidx)
+		nb_pkts_avail = cmpt_pidx - rx_cmpt_tail;
+	else if (rx_cmpt_tail > cmpt_pidx)
+		nb_pkts_avail = rxq->nb_rx_cmpt_desc - 1 - rx_cmpt_tail +
+				cmpt_pidx;
+
+	if (nb_pkts_avail == 0) {
+		PMD_DRV_LOG(DEBUG, "%s(): %d: nb_pkts_avail = 0\n",
+				__func__, __LINE__);
+		return 0;
+	}
+
+	nb_pkts = RTE_MIN(nb_pkts, RTE_MIN(nb_pkts_avail, QDMA_MAX_BURST_SIZE));
+
+#ifdef DUMP_MEMPOOL_USAGE_STATS
+	PMD_DRV_LOG(DEBUG, "%s(): %d: queue id = %d, mbuf_avail_count = %d, "
+			"mbuf_in_use_count = %d",
+		__func__, __LINE__, rxq->queue_id,
+		rte_mempool_avail_count(rxq->mb_pool),
+		rte_mempool_in_use_count(rxq->mb_pool));
+#endif //DUMP_MEMPOOL_USAGE_STATS
+	/* Make sure reads to CMPT ring are synchronized before
+	 * accessing the ring
+	 */
+	rte_rmb();
+#ifdef QDMA_LATENCY_OPTIMIZED
+	adapt_update_counter(rxq, nb_pkts_avail);
+#endif //QDMA_LATENCY_OPTIMIZED
+
+	int ret = process_cmpt_ring(rxq, nb_pkts);
+	if (unlikely(ret))
+		return 0;
+
+	if (rxq->status != RTE_ETH_QUEUE_STATE_STARTED) {
+		PMD_DRV_LOG(DEBUG, "%s(): %d: rxq->status = %d\n",
+				__func__, __LINE__, rxq->status);
+		return 0;
+	}
+
+	count_pkts = prepare_packets(rxq, rx_pkts, nb_pkts);
+
+	c2h_pidx = rxq->q_pidx_info.pidx;
+	pending_desc = rxq->rx_tail - c2h_pidx - 1;
+	if (rxq->rx_tail < (c2h_pidx + 1))
+		pending_desc = rxq->nb_rx_desc - 2 + rxq->rx_tail -
+				c2h_pidx;
+
+	rxq->qstats.pidx = rxq->q_pidx_info.pidx;
+	rxq->qstats.wrb_pidx = rxq->wb_status->pidx;
+	rxq->qstats.wrb_cidx = rxq->wb_status->cidx;
+	rxq->qstats.rxq_cmpt_tail = rx_cmpt_tail;
+	rxq->qstats.pending_desc = pending_desc;
+	rxq->qstats.mbuf_avail_cnt = rte_mempool_avail_count(rxq->mb_pool);
+	rxq->qstats.mbuf_in_use_cnt = rte_mempool_in_use_count(rxq->mb_pool);
+
+	/* Batch the PIDX updates, this minimizes overhead on
+	 * descriptor engine
+	 */
+	if (pending_desc >= MIN_RX_PIDX_UPDATE_THRESHOLD)
+		rearm_c2h_ring(rxq, pending_desc);
+
+#ifdef DUMP_MEMPOOL_USAGE_STATS
+	PMD_DRV_LOG(DEBUG, "%s(): %d: queue id = %d, mbuf_avail_count = %d,"
+			" mbuf_in_use_count = %d, count_pkts = %d",
+		__func__, __LINE__, rxq->queue_id,
+		rte_mempool_avail_count(rxq->mb_pool),
+		rte_mempool_in_use_count(rxq->mb_pool), count_pkts);
+#endif //DUMP_MEMPOOL_USAGE_STATS
+
+	PMD_DRV_LOG(DEBUG, " Recv complete with hw cidx :%d",
+				rxq->wb_status->cidx);
+	PMD_DRV_LOG(DEBUG, " Recv complete with hw pidx :%d\n",
+				rxq->wb_status->pidx);
+
+	return count_pkts;
+}
+
+/* Transmit API for Streaming mode, common to all vector implementations.
+ * fill_h2c_ring() writes the descriptors of as many packets as fit in
+ * avail descriptors, advances the PIDX in txq->q_pidx_info and returns
+ * the number of packets and their total length.
+ */
+static __rte_always_inline uint16_t
+qdma_xmit_pkts_st_vec_common(struct qdma_tx_queue *txq,
+		struct rte_mbuf **tx_pkts, uint16_t nb_pkts,
+		uint16_t (*fill_h2c_ring)(struct qdma_tx_queue *txq,
+			struct rte_mbuf **tx_pkts, uint16_t nb_pkts,
+			int avail, uint64_t *pkt_len))
+{
+	uint64_t pkt_len = 0;
+	int avail, in_use;
+	uint16_t cidx = 0;
+	uint16_t count = 0, id;
+
+#ifdef TEST_64B_DESC_BYPASS
+	int bypass_desc_sz_idx = qmda_get_desc_sz_idx(txq->bypass_desc_sz);
+
+	if (unlikely(txq->en_bypass &&
+			bypass_desc_sz_idx == SW_DESC_CNTXT_64B_BYPASS_DMA)) {
+		return qdma_xmit_64B_desc_bypass(txq, tx_pkts, nb_pkts);
+	}
+#endif
+
+	id = txq->q_pidx_info.pidx;
+
+	/* Make sure reads to Tx ring are synchronized before
+	 * accessing the status descriptor.
+	 */
+	rte_rmb();
+
+	cidx = txq->wb_status->cidx;
+
+	qdma_txq_qlat_check(txq, cidx);
+
+	PMD_DRV_LOG(DEBUG, "Xmit start on tx queue-id:%d, tail index:%d\n",
+			txq->queue_id, id);
+
+	/* Free transmitted mbufs back to pool */
+	reclaim_tx_mbuf(txq, cidx, 0);
+
+	in_use = (int)id - cidx;
+	if (in_use < 0)
+		in_use += (txq->nb_tx_desc - 1);
+
+	/* Make 1 less available, otherwise if we allow all descriptors
+	 * to be filled, when nb_pkts = nb_tx_desc - 1, pidx will be same
+	 * as old pidx and HW will treat this as no new descriptors were added.
+	 * Hence, DMA won't happen with new descriptors.
+	 */
+	avail = txq->nb_tx_desc - 2 - in_use;
+
+	if (unlikely(!avail)) {
+		txq->qstats.txq_full_cnt++;
+		PMD_DRV_LOG(DEBUG, "Tx queue full, in_use = %d", in_use);
+		qdma_txq_doorbell(txq, 0, true);
+		return 0;
+	}
+
+	count = fill_h2c_ring(txq, tx_pkts, nb_pkts, avail, &pkt_len);
+
+	txq->stats.pkts += count;
+	txq->stats.bytes += pkt_len;
+
+	txq->qstats.pidx = txq->q_pidx_info.pidx;
+	txq->qstats.wrb_cidx = cidx;
+	txq->qstats.txq_tail = txq->tx_fl_tail;
+	txq->qstats.in_use_desc = in_use;
+	txq->qstats.nb_pkts = nb_pkts;
+
+	/* A burst that did not fit is not worth holding back */
+	qdma_txq_doorbell(txq, count, count < nb_pkts);
+	PMD_DRV_LOG(DEBUG, " xmit completed with count:%d\n", count);
+
+	return count;
+}
+
+/* Write the H2C descriptors of a single packet, segmented or not, for the
+ * vector fill routines. Returns false if the packet does not fit in avail.
+ */
+static __rte_always_inline bool
+qdma_vec_tx_one(struct qdma_tx_queue *txq, struct rte_mbuf *mb,
+		int *avail, uint64_t *pkt_len)
+{
+	int nsegs = mb->nb_segs;
+
+	if (nsegs > *avail) {
+		/* Number of segments in current mbuf are greater
+		 * than number of descriptors available,
+		 * hence update PIDX and return
+		 */
+		return false;
+	}
+	*avail -= nsegs;
+	txq->sw_ring[txq->q_pidx_info.pidx] = mb;
+	*pkt_len += rte_pktmbuf_pkt_len(mb);
+
+	return qdma_ul_update_st_h2c_desc_vec(txq, txq->offloads, mb) == 0;
+}
+
+/* Dispatch an Rx burst to the given Streaming mode implementation */
+static __rte_always_inline uint16_t
+qdma_recv_pkts_vec_common(void *rx_queue, struct rte_mbuf **rx_pkts,
+		uint16_t nb_pkts,
+		uint16_t (*recv_pkts_st)(struct qdma_rx_queue *rxq,
+			struct rte_mbuf **rx_pkts, uint16_t nb_pkts))
+{
+	struct qdma_rx_queue *rxq = rx_queue;
+	uint32_t count;
+
+	if (rxq->st_mode)
+		count = recv_pkts_st(rxq, rx_pkts, nb_pkts);
+	else
+		count = qdma_recv_pkts_mm(rxq, rx_pkts, nb_pkts);
+
+	return count;
+}
+
+/* Dispatch a Tx burst to the given Streaming mode implementation */
+static __rte_always_inline uint16_t
+qdma_xmit_pkts_vec_common(void *tx_queue, struct rte_mbuf **tx_pkts,
+		uint16_t nb_pkts,
+		uint16_t (*xmit_pkts_st)(struct qdma_tx_queue *txq,
+			struct rte_mbuf **tx_pkts, uint16_t nb_pkts))
+{
+	struct qdma_tx_queue *txq = tx_queue;
+	uint16_t count;
+
+	if (txq->status != RTE_ETH_QUEUE_STATE_STARTED)
+		return 0;
+
+	if (txq->st_mode)
+		count =	xmit_pkts_st(txq, tx_pkts, nb_pkts);
+	else
+		count =	qdma_xmit_pkts_mm(txq, tx_pkts, nb_pkts);
+
+	return count;
+}
+
+#ifdef __AVX2__
+/* Write rearm_data, ol_flags, packet_type, pkt_len and data_len of a
+ * received mbuf with a single 32 byte store. len holds the packet length
+ * in all four 64 bit lanes, mbuf_init holds mbuf_initializer in lane 0.
+ */
+static __rte_always_inline void
+qdma_avx2_rx_mbuf_init(struct rte_mbuf *mb, __m256i len, __m256i mbuf_init)
+{
+	/* pkt_len is the upper half of lane 2, data_len the low bits of
+	 * lane 3, everything else but the rearm data is zero
+	 */
+	const __m256i len_shift = _mm256_set_epi64x(0, 32, 0, 0);
+	__m256i rearm;
+
+	RTE_BUILD_BUG_ON(offsetof(struct rte_mbuf, ol_flags) !=
+			offsetof(struct rte_mbuf, rearm_data) + 8);
+	RTE_BUILD_BUG_ON(offsetof(struct rte_mbuf, rx_descriptor_fields1) !=
+			offsetof(struct rte_mbuf, rearm_data) + 16);
+	RTE_BUILD_BUG_ON(offsetof(struct rte_mbuf, pkt_len) !=
+			offsetof(struct rte_mbuf, rx_descriptor_fields1) + 4);
+	RTE_BUILD_BUG_ON(offsetof(struct rte_mbuf, data_len) !=
+			offsetof(struct rte_mbuf, rx_descriptor_fields1) + 8);
+
+	rearm = _mm256_sllv_epi64(len, len_shift);
+	rearm = _mm256_blend_epi32(rearm, mbuf_init, 0x0F);
+	_mm256_storeu_si256((__m256i *)&mb->rearm_data, rearm);
+}
+#endif
+
+#endif /* ifndef __QDMA_RXTX_VEC_COMMON_H__ */
@@ -39,6 +39,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include "qdma_rxtx.h"
+#include "qdma_rxtx_vec_common.h"
 #include "qdma_devops.h"
 
 #if defined RTE_ARCH_X86_64
@@ -72,201 +73,12 @@ static void qdma_ul_get_cmpt_pkt_len_vec(void *ul_cmpt_entry, __m128i *data)
 	data[0] = _mm_srl_epi32(data[0], pkt_len_shift);
 }
 
-/* Vector implementation to update H2C descriptor */
-static int qdma_ul_update_st_h2c_desc_vec(void *qhndl, uint64_t q_offloads,
-				struct rte_mbuf *mb)
-{
-	(void)q_offloads;
-	int nsegs = mb->nb_segs;
-	uint16_t flags = S_H2C_DESC_F_SOP | S_H2C_DESC_F_EOP;
-	uint16_t id;
-	struct qdma_ul_st_h2c_desc *tx_ring_st;
-	struct qdma_tx_queue *txq = (struct qdma_tx_queue *)qhndl;
-
-	tx_ring_st = (struct qdma_ul_st_h2c_desc *)txq->tx_ring;
-	id = txq->q_pidx_info.pidx;
-
-	if (nsegs == 1) {
-		__m128i descriptor;
-		uint16_t datalen = mb->data_len;
-
-		descriptor = _mm_set_epi64x(mb->buf_iova + mb->data_off,
-				(uint64_t)datalen << 16 |
-				(uint64_t)datalen << 32 |
-				(uint64_t)flags << 48);
-		_mm_store_si128((__m128i *)&tx_ring_st[id], descriptor);
-
-		id++;
-		if (unlikely(id >= (txq->nb_tx_desc - 1)))
-			id -= (txq->nb_tx_desc - 1);
-	} else {
-		int pkt_segs = nsegs;
-		while (nsegs && mb) {
-			__m128i descriptor;
-			uint16_t datalen = mb->data_len;
-
-			flags = 0;
-			if (nsegs == pkt_segs)
-				flags |= S_H2C_DESC_F_SOP;
-			if (nsegs == 1)
-				flags |= S_H2C_DESC_F_EOP;
-
-			descriptor = _mm_set_epi64x(mb->buf_iova + mb->data_off,
-					(uint64_t)datalen << 16 |
-					(uint64_t)datalen << 32 |
-					(uint64_t)flags << 48);
-			_mm_store_si128((__m128i *)&tx_ring_st[id], descriptor);
-
-			nsegs--;
-			mb = mb->next;
-			id++;
-			if (unlikely(id >= (txq->nb_tx_desc - 1)))
-				id -= (txq->nb_tx_desc - 1);
-		}
-	}
-
-	txq->q_pidx_info.pidx = id;
-
-	return 0;
-}
-
 /* Process completion ring */
 static int process_cmpt_ring_vec(struct qdma_rx_queue *rxq,
 		uint16_t num_cmpt_entries)
 {
-	struct qdma_pci_dev *qdma_dev = rxq->dev->data->dev_private;
-	union qdma_ul_st_cmpt_ring *user_cmpt_entry;
-	uint32_t count = 0;
-	int ret = 0;
-	uint16_t rx_cmpt_tail = rxq->cmpt_cidx_info.wrb_cidx;
-
-	if (likely(!rxq->dump_immediate_data)) {
-		if ((rx_cmpt_tail + num_cmpt_entries) <
-			(rxq->nb_rx_cmpt_desc - 1)) {
-			for (count = 0; count < num_cmpt_entries; count++) {
-				user_cmpt_entry =
-				(union qdma_ul_st_cmpt_ring *)
-				((uint64_t)rxq->cmpt_ring +
-				((uint64_t)rx_cmpt_tail * rxq->cmpt_desc_len));
-
-				ret = qdma_ul_extract_st_cmpt_info(
-						user_cmpt_entry,
-						&rxq->cmpt_data[count]);
-				if (ret != 0) {
-					PMD_DRV_LOG(ERR, "Error detected on CMPT ring "
-						"at index %d, queue_id = %d\n",
-						rx_cmpt_tail, rxq->queue_id);
-					rxq->err = 1;
-					return -1;
-				}
-				rx_cmpt_tail++;
-			}
-		} else {
-			while (count < num_cmpt_entries) {
-				user_cmpt_entry =
-				(union qdma_ul_st_cmpt_ring *)
-				((uint64_t)rxq->cmpt_ring +
-				((uint64_t)rx_cmpt_tail * rxq->cmpt_desc_len));
-
-				ret = qdma_ul_extract_st_cmpt_info(
-						user_cmpt_entry,
-						&rxq->cmpt_data[count]);
-				if (ret != 0) {
-					PMD_DRV_LOG(ERR, "Error detected on CMPT ring "
-						"at index %d, queue_id = %d\n",
-						rx_cmpt_tail, rxq->queue_id);
-					rxq->err = 1;
-					return -1;
-				}
-
-				rx_cmpt_tail++;
-				if (unlikely(rx_cmpt_tail >=
-					(rxq->nb_rx_cmpt_desc - 1)))
-					rx_cmpt_tail -=
-						(rxq->nb_rx_cmpt_desc - 1);
-				count++;
-			}
-		}
-	} else {
-		while (count < num_cmpt_entries) {
-			user_cmpt_entry =
-			(union qdma_ul_st_cmpt_ring *)
-			((uint64_t)rxq->cmpt_ring +
-			((uint64_t)rx_cmpt_tail * rxq->cmpt_desc_len));
-
-			ret = qdma_ul_extract_st_cmpt_info(
-					user_cmpt_entry,
-					&rxq->cmpt_data[count]);
-			if (ret != 0) {
-				PMD_DRV_LOG(ERR, "Error detected on CMPT ring "
-					"at CMPT index %d, queue_id = %d\n",
-					rx_cmpt_tail, rxq->queue_id);
-				rxq->err = 1;
-				return -1;
-			}
-
-			ret = qdma_ul_process_immediate_data_st((void *)rxq,
-					user_cmpt_entry, rxq->cmpt_desc_len);
-			if (ret < 0) {
-				PMD_DRV_LOG(ERR, "Error processing immediate data "
-					"at CMPT index = %d, queue_id = %d\n",
-					rx_cmpt_tail, rxq->queue_id);
-				return -1;
-			}
-
-			rx_cmpt_tail++;
-			if (unlikely(rx_cmpt_tail >=
-				(rxq->nb_rx_cmpt_desc - 1)))
-				rx_cmpt_tail -= (rxq->nb_rx_cmpt_desc - 1);
-			count++;
-		}
-	}
-
-	// Update the CPMT CIDX
-	rxq->cmpt_cidx_info.wrb_cidx = rx_cmpt_tail;
-	qdma_dev->hw_access->qdma_queue_cmpt_cidx_update(rxq->dev,
-		qdma_dev->is_vf,
-		rxq->queue_id, &rxq->cmpt_cidx_info);
-
-	return 0;
-}
-
-/* Prepare mbuf for one packet */
-static inline
-struct rte_mbuf *prepare_single_packet(struct qdma_rx_queue *rxq,
-		uint16_t cmpt_idx)
-{
-	struct rte_mbuf *mb = NULL;
-	uint16_t id = rxq->rx_tail;
-	uint16_t pkt_length;
-
-	pkt_length = qdma_ul_get_cmpt_pkt_len(&rxq->cmpt_data[cmpt_idx]);
-
-	if (pkt_length) {
-		rxq->stats.pkts++;
-		rxq->stats.bytes += pkt_length;
-
-		if (likely(pkt_length <= rxq->rx_buff_size)) {
-			mb = rxq->sw_ring[id];
-			rxq->sw_ring[id++] = NULL;
-
-			if (unlikely(id >= (rxq->nb_rx_desc - 1)))
-				id -= (rxq->nb_rx_desc - 1);
-
-			rte_mbuf_refcnt_set(mb, 1);
-			mb->nb_segs = 1;
-			mb->port = rxq->port_id;
-			mb->ol_flags = 0;
-			mb->packet_type = 0;
-			mb->pkt_len = pkt_length;
-			mb->data_len = pkt_length;
-		} else {
-			mb = prepare_segmented_packet(rxq, pkt_length, &id);
-		}
-
-		rxq->rx_tail = id;
-	}
-	return mb;
+	return qdma_vec_process_cmpt_ring_tail(rxq, 0, num_cmpt_entries,
+			rxq->cmpt_cidx_info.wrb_cidx);
 }
 
 /* Vector implementation to prepare mbufs for packets.
@@ -402,7 +214,6 @@ static uint16_t prepare_packets_vec(struct qdma_rx_queue *rxq,
 /* Populate C2H ring with new buffers */
 static int rearm_c2h_ring_vec(struct qdma_rx_queue *rxq, uint16_t num_desc)
 {
-	struct qdma_pci_dev *qdma_dev = rxq->dev->data->dev_private;
 	struct rte_mbuf *mb;
 	struct qdma_ul_st_c2h_desc *rx_ring_st =
 			(struct qdma_ul_st_c2h_desc *)rxq->rx_ring;
@@ -424,16 +235,8 @@ static int rearm_c2h_ring_vec(struct qdma_rx_queue *rxq, uint16_t num_desc)
 	}
 
 	/* allocate new buffer */
-	if (rte_mempool_get_bulk(rxq->mb_pool, (void *)&rxq->sw_ring[id],
-					rearm_descs) != 0){
-		PMD_DRV_LOG(ERR, "%s(): %d: No MBUFS, queue id = %d,"
-		"mbuf_avail_count = %d,"
-		" mbuf_in_use_count = %d, num_desc_req = %d\n",
-		__func__, __LINE__, rxq->queue_id,
-		rte_mempool_avail_count(rxq->mb_pool),
-		rte_mempool_in_use_count(rxq->mb_pool), rearm_descs);
+	if (qdma_vec_rx_mbufs_get(rxq, id, rearm_descs) != 0)
 		return -1;
-	}
 
 	int rearm_cnt = rearm_descs & -2;
 	__m128i head_room = _mm_set_epi64x(RTE_PKTMBUF_HEADROOM,
@@ -475,186 +278,16 @@ static int rearm_c2h_ring_vec(struct qdma_rx_queue *rxq, uint16_t num_desc)
 		id++;
 	}
 
-	if (unlikely(id >= (rxq->nb_rx_desc - 1)))
-		id -= (rxq->nb_rx_desc - 1);
-
-	/* Handle from beginning of ring, if ring wrapped */
-	rearm_descs = num_desc - rearm_descs;
-	if (unlikely(rearm_descs)) {
-		/* allocate new buffer */
-		if (rte_mempool_get_bulk(rxq->mb_pool,
-			(void *)&rxq->sw_ring[id], rearm_descs) != 0) {
-			PMD_DRV_LOG(ERR, "%s(): %d: No MBUFS, queue id = %d,"
-			"mbuf_avail_count = %d,"
-			" mbuf_in_use_count = %d, num_desc_req = %d\n",
-			__func__, __LINE__, rxq->queue_id,
-			rte_mempool_avail_count(rxq->mb_pool),
-			rte_mempool_in_use_count(rxq->mb_pool), rearm_descs);
-
-			rxq->q_pidx_info.pidx = id;
-			qdma_dev->hw_access->qdma_queue_pidx_update(rxq->dev,
-				qdma_dev->is_vf,
-				rxq->queue_id, 1, &rxq->q_pidx_info);
-#ifdef LATENCY_MEASUREMENT
-			/* start the timer */
-			rxq->qstats.pkt_lat.prev = rte_get_timer_cycles();
-#endif
-			return -1;
-		}
-
-		for (mbuf_index = 0;
-				mbuf_index < ((uint16_t)rearm_descs & 0xFFFF);
-				mbuf_index++, id++) {
-			mb = rxq->sw_ring[id];
-			mb->data_off = RTE_PKTMBUF_HEADROOM;
-
-			/* rearm descriptor */
-			rx_ring_st[id].dst_addr =
-					(uint64_t)mb->buf_iova +
-						RTE_PKTMBUF_HEADROOM;
-		}
-	}
-
-	PMD_DRV_LOG(DEBUG, "%s(): %d: PIDX Update: queue id = %d, "
-				"num_desc = %d",
-				__func__, __LINE__, rxq->queue_id,
-				num_desc);
-
-	/* Make sure writes to the C2H descriptors are
-	 * synchronized before updating PIDX
-	 */
-	rte_wmb();
-
-	rxq->q_pidx_info.pidx = id;
-	qdma_dev->hw_access->qdma_queue_pidx_update(rxq->dev,
-		qdma_dev->is_vf,
-		rxq->queue_id, 1, &rxq->q_pidx_info);
-
-#ifdef LATENCY_MEASUREMENT
-	/* start the timer */
-	rxq->qstats.pkt_lat.prev = rte_get_timer_cycles();
-#endif
-	return 0;
+	return qdma_vec_rx_rearm_wrap(rxq, id, num_desc - rearm_descs);
 }
 
 /* Receive API for Streaming mode */
 uint16_t qdma_recv_pkts_st_vec(struct qdma_rx_queue *rxq,
 		struct rte_mbuf **rx_pkts, uint16_t nb_pkts)
 {
-	uint16_t count_pkts;
-	struct wb_status *wb_status;
-	uint16_t nb_pkts_avail = 0;
-	uint16_t rx_cmpt_tail = 0;
-	uint16_t cmpt_pidx, c2h_pidx;
-	uint16_t pending_desc;
-#ifdef TEST_64B_DESC_BYPASS
-	int bypass_desc_sz_idx = qmda_get_desc_sz_idx(rxq->bypass_desc_sz);
-#endif
-
-	if (unlikely(rxq->err))
-		return 0;
-
-	PMD_DRV_LOG(DEBUG, "recv start on rx queue-id :%d, on "
-			"tail index:%d number of pkts %d",
-			rxq->queue_id, rxq->rx_tail, nb_pkts);
-	wb_status = rxq->wb_status;
-	rx_cmpt_tail = rxq->cmpt_cidx_info.wrb_cidx;
-
-#ifdef TEST_64B_DESC_BYPASS
-	if (unlikely(rxq->en_bypass &&
-			bypass_desc_sz_idx == SW_DESC_CNTXT_64B_BYPASS_DMA)) {
-		PMD_DRV_LOG(DEBUG, "For  RX ST-mode, example"
-				" design doesn't support 64byte descriptor\n");
-		return 0;
-	}
-#endif
-	cmpt_pidx = wb_status->pidx;
-
-#ifdef LATENCY_MEASUREMENT
-	if (cmpt_pidx != rxq->qstats.wrb_pidx) {
-		/* stop the timer */
-		rxq->qstats.pkt_lat.curr = rte_get_timer_cycles();
-		c2h_pidx_to_cmpt_pidx_lat[rxq->queue_id][rxq->qstats.lat_cnt] =
-			rxq->qstats.pkt_lat.curr - rxq->qstats.pkt_lat.prev;
-		rxq->qstats.lat_cnt = ((rxq->qstats.lat_cnt + 1) % LATENCY_CNT);
-	}
-#endif
-
-	if (rx_cmpt_tail < cmpt_pidx)
-		nb_pkts_avail = cmpt_pidx - rx_cmpt_tail;
-	else if (rx_cmpt_tail > cmpt_pidx)
-		nb_pkts_avail = rxq->nb_rx_cmpt_desc - 1 - rx_cmpt_tail +
-				cmpt_pidx;
-
-	if (nb_pkts_avail == 0) {
-		PMD_DRV_LOG(DEBUG, "%s(): %d: nb_pkts_avail = 0\n",
-				__func__, __LINE__);
-		return 0;
-	}
-
-	nb_pkts = RTE_MIN(nb_pkts, RTE_MIN(nb_pkts_avail, QDMA_MAX_BURST_SIZE));
-
-#ifdef DUMP_MEMPOOL_USAGE_STATS
-	PMD_DRV_LOG(DEBUG, "%s(): %d: queue id = %d, mbuf_avail_count = %d, "
-			"mbuf_in_use_count = %d",
-		__func__, __LINE__, rxq->queue_id,
-		rte_mempool_avail_count(rxq->mb_pool),
-		rte_mempool_in_use_count(rxq->mb_pool));
-#endif //DUMP_MEMPOOL_USAGE_STATS
-	/* Make sure reads to CMPT ring are synchronized before
-	 * accessing the ring
-	 */
-	rte_rmb();
-#ifdef QDMA_LATENCY_OPTIMIZED
-	adapt_update_counter(rxq, nb_pkts_avail);
-#endif //QDMA_LATENCY_OPTIMIZED
-
-	int ret = process_cmpt_ring_vec(rxq, nb_pkts);
-	if (unlikely(ret))
-		return 0;
-
-	if (rxq->status != RTE_ETH_QUEUE_STATE_STARTED) {
-		PMD_DRV_LOG(DEBUG, "%s(): %d: rxq->status = %d\n",
-				__func__, __LINE__, rxq->status);
-		return 0;
-	}
-
-	count_pkts = prepare_packets_vec(rxq, rx_pkts, nb_pkts);
-
-	c2h_pidx = rxq->q_pidx_info.pidx;
-	pending_desc = rxq->rx_tail - c2h_pidx - 1;
-	if (rxq->rx_tail < (c2h_pidx + 1))
-		pending_desc = rxq->nb_rx_desc - 2 + rxq->rx_tail -
-				c2h_pidx;
-
-	rxq->qstats.pidx = rxq->q_pidx_info.pidx;
-	rxq->qstats.wrb_pidx = rxq->wb_status->pidx;
-	rxq->qstats.wrb_cidx = rxq->wb_status->cidx;
-	rxq->qstats.rxq_cmpt_tail = rx_cmpt_tail;
-	rxq->qstats.pending_desc = pending_desc;
-	rxq->qstats.mbuf_avail_cnt = rte_mempool_avail_count(rxq->mb_pool);
-	rxq->qstats.mbuf_in_use_cnt = rte_mempool_in_use_count(rxq->mb_pool);
-
-	/* Batch the PIDX updates, this minimizes overhead on
-	 * descriptor engine
-	 */
-	if (pending_desc >= MIN_RX_PIDX_UPDATE_THRESHOLD)
-		rearm_c2h_ring_vec(rxq, pending_desc);
-
-#ifdef DUMP_MEMPOOL_USAGE_STATS
-	PMD_DRV_LOG(DEBUG, "%s(): %d: queue id = %d, mbuf_avail_count = %d,"
-			" mbuf_in_use_count = %d, count_pkts = %d",
-		__func__, __LINE__, rxq->queue_id,
-		rte_mempool_avail_count(rxq->mb_pool),
-		rte_mempool_in_use_count(rxq->mb_pool), count_pkts);
-#endif //DUMP_MEMPOOL_USAGE_STATS
-
-	PMD_DRV_LOG(DEBUG, " Recv complete with hw cidx :%d",
-				rxq->wb_status->cidx);
-	PMD_DRV_LOG(DEBUG, " Recv complete with hw pidx :%d\n",
-				rxq->wb_status->pidx);
-
-	return count_pkts;
+	return qdma_recv_pkts_st_vec_common(rxq, rx_pkts, nb_pkts,
+			process_cmpt_ring_vec, prepare_packets_vec,
+			rearm_c2h_ring_vec);
 }
 
 /**
@@ -673,153 +306,33 @@ uint16_t qdma_recv_pkts_st_vec(struct qdma_rx_queue *rxq,
 uint16_t qdma_recv_pkts_vec(void *rx_queue, struct rte_mbuf **rx_pkts,
 			uint16_t nb_pkts)
 {
-	struct qdma_rx_queue *rxq = rx_queue;
-	uint32_t count;
-
-	if (rxq->st_mode)
-		count = qdma_recv_pkts_st_vec(rxq, rx_pkts, nb_pkts);
-	else
-		count = qdma_recv_pkts_mm(rxq, rx_pkts, nb_pkts);
-
-	return count;
+	return qdma_recv_pkts_vec_common(rx_queue, rx_pkts, nb_pkts,
+			qdma_recv_pkts_st_vec);
 }
 
-/* Transmit API for Streaming mode */
-uint16_t qdma_xmit_pkts_st_vec(struct qdma_tx_queue *txq,
-		struct rte_mbuf **tx_pkts, uint16_t nb_pkts)
+/* Fill H2C descriptors, one packet at a time */
+static uint16_t fill_h2c_ring_vec(struct qdma_tx_queue *txq,
+		struct rte_mbuf **tx_pkts, uint16_t nb_pkts,
+		int avail, uint64_t *pkt_len)
 {
-	struct rte_mbuf *mb;
-	uint64_t pkt_len = 0;
-	int avail, in_use, ret, nsegs;
-	uint16_t cidx = 0;
-	uint16_t count = 0, id;
-	struct qdma_pci_dev *qdma_dev = txq->dev->data->dev_private;
-
-#ifdef TEST_64B_DESC_BYPASS
-	int bypass_desc_sz_idx = qmda_get_desc_sz_idx(txq->bypass_desc_sz);
-
-	if (unlikely(txq->en_bypass &&
-			bypass_desc_sz_idx == SW_DESC_CNTXT_64B_BYPASS_DMA)) {
-		return qdma_xmit_64B_desc_bypass(txq, tx_pkts, nb_pkts);
-	}
-#endif
-
-	id = txq->q_pidx_info.pidx;
-
-	/* Make sure reads to Tx ring are synchronized before
-	 * accessing the status descriptor.
-	 */
-	rte_rmb();
-
-	cidx = txq->wb_status->cidx;
-
-#ifdef LATENCY_MEASUREMENT
-	uint32_t cidx_cnt = 0;
-	if (cidx != txq->qstats.wrb_cidx) {
-		if ((cidx - txq->qstats.wrb_cidx) > 0) {
-			cidx_cnt = cidx - txq->qstats.wrb_cidx;
-
-			if (cidx_cnt <= 8)
-				txq->qstats.wrb_cidx_cnt_lt_8++;
-			else if (cidx_cnt > 8 && cidx_cnt <= 32)
-				txq->qstats.wrb_cidx_cnt_8_to_32++;
-			else if (cidx_cnt > 32 && cidx_cnt <= 64)
-				txq->qstats.wrb_cidx_cnt_32_to_64++;
-			else
-				txq->qstats.wrb_cidx_cnt_gt_64++;
-		}
-
-		/* stop the timer */
-		txq->qstats.pkt_lat.curr = rte_get_timer_cycles();
-		h2c_pidx_to_hw_cidx_lat[txq->queue_id][txq->qstats.lat_cnt] =
-			txq->qstats.pkt_lat.curr - txq->qstats.pkt_lat.prev;
-		txq->qstats.lat_cnt = ((txq->qstats.lat_cnt + 1) % LATENCY_CNT);
-	} else {
-		txq->qstats.wrb_cidx_cnt_no_change++;
-	}
-#endif
-
-	PMD_DRV_LOG(DEBUG, "Xmit start on tx queue-id:%d, tail index:%d\n",
-			txq->queue_id, id);
-
-	/* Free transmitted mbufs back to pool */
-	reclaim_tx_mbuf(txq, cidx, 0);
-
-	in_use = (int)id - cidx;
-	if (in_use < 0)
-		in_use += (txq->nb_tx_desc - 1);
-
-	/* Make 1 less available, otherwise if we allow all descriptors
-	 * to be filled, when nb_pkts = nb_tx_desc - 1, pidx will be same
-	 * as old pidx and HW will treat this as no new descriptors were added.
-	 * Hence, DMA won't happen with new descriptors.
-	 */
-	avail = txq->nb_tx_desc - 2 - in_use;
-
-	if (unlikely(!avail)) {
-		txq->qstats.txq_full_cnt++;
-		PMD_DRV_LOG(DEBUG, "Tx queue full, in_use = %d", in_use);
-		return 0;
-	}
+	uint16_t count;
 
 	for (count = 0; count < nb_pkts; count++) {
-		mb = tx_pkts[count];
-		nsegs = mb->nb_segs;
-		if (nsegs > avail) {
-			/* Number of segments in current mbuf are greater
-			 * than number of descriptors available,
-			 * hence update PIDX and return
-			 */
-			break;
-		}
-		avail -= nsegs;
-		id = txq->q_pidx_info.pidx;
-		txq->sw_ring[id] = mb;
-		pkt_len += rte_pktmbuf_pkt_len(mb);
-
-		ret = qdma_ul_update_st_h2c_desc_vec(txq, txq->offloads, mb);
-
-		if (unlikely(ret < 0))
+		if (!qdma_vec_tx_one(txq, tx_pkts[count], &avail, pkt_len))
 			break;
 	}
 
-	txq->stats.pkts += count;
-	txq->stats.bytes += pkt_len;
-
-	txq->qstats.pidx = id;
-	txq->qstats.wrb_cidx = cidx;
-	txq->qstats.txq_tail = txq->tx_fl_tail;
-	txq->qstats.in_use_desc = in_use;
-	txq->qstats.nb_pkts = nb_pkts;
-
-#if (MIN_TX_PIDX_UPDATE_THRESHOLD > 1)
-	rte_spinlock_lock(&txq->pidx_update_lock);
-#endif
-	txq->tx_desc_pend += count;
-
-	/* Send PIDX update only if pending desc is more than threshold
-	 * Saves frequent Hardware transactions
-	 */
-	if (txq->tx_desc_pend >= MIN_TX_PIDX_UPDATE_THRESHOLD) {
-		qdma_dev->hw_access->qdma_queue_pidx_update(txq->dev,
-			qdma_dev->is_vf,
-			txq->queue_id, 0, &txq->q_pidx_info);
-
-		txq->tx_desc_pend = 0;
-
-#ifdef LATENCY_MEASUREMENT
-		/* start the timer */
-		txq->qstats.pkt_lat.prev = rte_get_timer_cycles();
-#endif
-	}
-#if (MIN_TX_PIDX_UPDATE_THRESHOLD > 1)
-	rte_spinlock_unlock(&txq->pidx_update_lock);
-#endif
-	PMD_DRV_LOG(DEBUG, " xmit completed with count:%d\n", count);
-
 	return count;
 }
 
+/* Transmit API for Streaming mode */
+uint16_t qdma_xmit_pkts_st_vec(struct qdma_tx_queue *txq,
+		struct rte_mbuf **tx_pkts, uint16_t nb_pkts)
+{
+	return qdma_xmit_pkts_st_vec_common(txq, tx_pkts, nb_pkts,
+			fill_h2c_ring_vec);
+}
+
 /**
  * DPDK callback for transmitting packets in burst.
  *
@@ -836,16 +349,6 @@ uint16_t qdma_xmit_pkts_st_vec(struct qdma_tx_queue *txq,
 uint16_t qdma_xmit_pkts_vec(void *tx_queue, struct rte_mbuf **tx_pkts,
 			uint16_t nb_pkts)
 {
-	struct qdma_tx_queue *txq = tx_queue;
-	uint16_t count;
-
-	if (txq->status != RTE_ETH_QUEUE_STATE_STARTED)
-		return 0;
-
-	if (txq->st_mode)
-		count =	qdma_xmit_pkts_st_vec(txq, tx_pkts, nb_pkts);
-	else
-		count =	qdma_xmit_pkts_mm(txq, tx_pkts, nb_pkts);
-
-	return count;
+	return qdma_xmit_pkts_vec_common(tx_queue, tx_pkts, nb_pkts,
+			qdma_xmit_pkts_st_vec);
 }
@@ -386,7 +386,7 @@ static int qdma_rxq_context_setup(struct rte_eth_dev *dev, uint16_t qid)
 		cmpt_desc_fmt = CMPT_CNTXT_DESC_SIZE_8B;
 		break;
 	}
-	descq_conf.ring_bs_addr = rxq->rx_mz->iova;
+	descq_conf.ring_bs_addr = rxq->rx_mem.iova;
 	descq_conf.en_bypass = rxq->en_bypass;
 	descq_conf.irq_arm = 0;
 	descq_conf.at = 0;
@@ -402,7 +402,7 @@ static int qdma_rxq_context_setup(struct rte_eth_dev *dev, uint16_t qid)
 	} else {/* st c2h*/
 		descq_conf.desc_sz = SW_DESC_CNTXT_C2H_STREAM_DMA;
 		descq_conf.forced_en = 1;
-		descq_conf.cmpt_ring_bs_addr = rxq->rx_cmpt_mz->iova;
+		descq_conf.cmpt_ring_bs_addr = rxq->rx_cmpt_mem.iova;
 		descq_conf.cmpt_desc_sz = cmpt_desc_fmt;
 		descq_conf.triggermode = rxq->triggermode;
 
@@ -415,7 +415,10 @@ static int qdma_rxq_context_setup(struct rte_eth_dev *dev, uint16_t qid)
 		descq_conf.cmpt_ringsz =
 				qdma_dev->g_ring_sz[rxq->cmpt_ringszidx] - 1;
 		descq_conf.bufsz = qdma_dev->g_c2h_buf_sz[rxq->buffszidx];
-		descq_conf.cmpt_int_en = 0;
+		/* Direct interrupt, armed by qdma_dev_rx_queue_intr_enable */
+		descq_conf.cmpt_int_en = rxq->intr_vec ? 1 : 0;
+		descq_conf.intr_id = rxq->intr_vec;
+		descq_conf.intr_aggr = 0;
 		descq_conf.cmpl_stat_en = rxq->st_mode;
 		descq_conf.pfch_en = rxq->en_prefetch;
 		descq_conf.en_bypass_prefetch = rxq->en_bypass_prefetch;
@@ -464,7 +467,7 @@ static int qdma_txq_context_setup(struct rte_eth_dev *dev, uint16_t qid)
 	memset(&descq_conf, 0, sizeof(struct mbox_descq_conf));
 	txq = (struct qdma_tx_queue *)dev->data->tx_queues[qid];
 	qid_hw =  qdma_dev->queue_base + txq->queue_id;
-	descq_conf.ring_bs_addr = txq->tx_mz->iova;
+	descq_conf.ring_bs_addr = txq->tx_mem.iova;
 	descq_conf.en_bypass = txq->en_bypass;
 	descq_conf.wbi_intvl_en = 1;
 	descq_conf.wbi_chk = 1;
@@ -542,6 +545,11 @@ static int qdma_vf_dev_start(struct rte_eth_dev *dev)
 	int err;
 
 	PMD_DRV_LOG(INFO, "qdma_dev_start: Starting\n");
+
+	err = qdma_rx_intr_setup(dev);
+	if (err != 0)
+		return err;
+
 	/* prepare descriptor rings for operation */
 	for (qid = 0; qid < dev->data->nb_tx_queues; qid++) {
 		txq = (struct qdma_tx_queue *)dev->data->tx_queues[qid];
@@ -550,7 +558,7 @@ static int qdma_vf_dev_start(struct rte_eth_dev *dev)
 		if (!txq->tx_deferred_start) {
 			err = qdma_vf_dev_tx_queue_start(dev, qid);
 			if (err != 0)
-				return err;
+				goto err_txq;
 		}
 	}
 
@@ -561,10 +569,26 @@ static int qdma_vf_dev_start(struct rte_eth_dev *dev)
 		if (!rxq->rx_deferred_start) {
 			err = qdma_vf_dev_rx_queue_start(dev, qid);
 			if (err != 0)
-				return err;
+				goto err_rxq;
 		}
 	}
 	return 0;
+
+err_rxq:
+	while (qid--) {
+		rxq = (struct qdma_rx_queue *)dev->data->rx_queues[qid];
+		if (!rxq->rx_deferred_start)
+			qdma_vf_dev_rx_queue_stop(dev, qid);
+	}
+	qid = dev->data->nb_tx_queues;
+err_txq:
+	while (qid--) {
+		txq = (struct qdma_tx_queue *)dev->data->tx_queues[qid];
+		if (!txq->tx_deferred_start)
+			qdma_vf_dev_tx_queue_stop(dev, qid);
+	}
+	qdma_rx_intr_teardown(dev);
+	return err;
 }
 
 static int qdma_vf_dev_link_update(struct rte_eth_dev *dev,
@@ -592,6 +616,8 @@ static int qdma_vf_dev_infos_get(__rte_unused struct rte_eth_dev *dev,
 	dev_info->min_rx_bufsize = QDMA_MIN_RXBUFF_SIZE;
 	dev_info->max_rx_pktlen = DMA_BRAM_SIZE;
 	dev_info->max_mac_addrs = 1;
+	dev_info->tx_queue_offload_capa = DEV_TX_OFFLOAD_MBUF_FAST_FREE;
+	dev_info->tx_offload_capa = dev_info->tx_queue_offload_capa;
 
 	return 0;
 }
@@ -611,6 +637,8 @@ static int qdma_vf_dev_stop(struct rte_eth_dev *dev)
 	for (qid = 0; qid < dev->data->nb_rx_queues; qid++)
 		qdma_vf_dev_rx_queue_stop(dev, qid);
 
+	qdma_rx_intr_teardown(dev);
+
 	return 0;
 }
 
@@ -647,12 +675,10 @@ int qdma_vf_dev_close(struct rte_eth_dev *dev)
 				rte_free(rxq->sw_ring);
 
 			if (rxq->st_mode) { /** if ST-mode **/
-				if (rxq->rx_cmpt_mz)
-					rte_memzone_free(rxq->rx_cmpt_mz);
+				qdma_ring_release(&rxq->rx_cmpt_mem);
 			}
 
-			if (rxq->rx_mz)
-				rte_memzone_free(rxq->rx_mz);
+			qdma_ring_release(&rxq->rx_mem);
 			rte_free(rxq);
 			PMD_DRV_LOG(INFO, "VF-%d(DEVFN) C2H queue %d removed",
 							qdma_dev->func_id, qid);
@@ -671,8 +697,7 @@ int qdma_vf_dev_close(struct rte_eth_dev *dev)
 						QDMA_DEV_Q_TYPE_H2C);
 			if (txq->sw_ring)
 				rte_free(txq->sw_ring);
-			if (txq->tx_mz)
-				rte_memzone_free(txq->tx_mz);
+			qdma_ring_release(&txq->tx_mem);
 			rte_free(txq);
 			PMD_DRV_LOG(INFO, "VF-%d(DEVFN) H2C queue %d removed",
 							qdma_dev->func_id, qid);
@@ -689,8 +714,7 @@ int qdma_vf_dev_close(struct rte_eth_dev *dev)
 						cmptq->queue_id +
 						qdma_dev->queue_base,
 						QDMA_DEV_Q_TYPE_CMPT);
-				if (cmptq->cmpt_mz)
-					rte_memzone_free(cmptq->cmpt_mz);
+				qdma_ring_release(&cmptq->cmpt_mem);
 				rte_free(cmptq);
 				PMD_DRV_LOG(INFO, "VF-%d(DEVFN) CMPT queue %d removed",
 						qdma_dev->func_id, qid);
@@ -703,6 +727,8 @@ int qdma_vf_dev_close(struct rte_eth_dev *dev)
 		}
 	}
 
+	qdma_ring_arena_free(dev);
+
 	qdma_dev->qsets_en = 0;
 	qdma_set_qmax(dev, (int *)&qdma_dev->qsets_en,
 		      (int *)&qdma_dev->queue_base);
@@ -890,6 +916,7 @@ int qdma_vf_dev_rx_queue_start(struct rte_eth_dev *dev, uint16_t qid)
 		rxq->cmpt_cidx_info.timer_idx = rxq->timeridx;
 		rxq->cmpt_cidx_info.trig_mode = rxq->triggermode;
 		rxq->cmpt_cidx_info.wrb_en = 1;
+		rxq->cmpt_cidx_info.irq_en = 0;
 		qdma_dev->hw_access->qdma_queue_cmpt_cidx_update(dev, 1,
 				qid, &rxq->cmpt_cidx_info);
 
@@ -964,6 +991,8 @@ int qdma_vf_dev_tx_queue_stop(struct rte_eth_dev *dev, uint16_t qid)
 
 	txq = (struct qdma_tx_queue *)dev->data->tx_queues[qid];
 
+	/* Push out the descriptors held back by doorbell batching */
+	qdma_txq_doorbell(txq, 0, true);
 	txq->status = RTE_ETH_QUEUE_STATE_STOPPED;
 	/* Wait for TXQ to send out all packets. */
 	while (txq->wb_status->cidx != txq->q_pidx_info.pidx) {
@@ -1001,6 +1030,11 @@ static struct eth_dev_ops qdma_vf_eth_dev_ops = {
 	.tx_queue_start       = qdma_vf_dev_tx_queue_start,
 	.tx_queue_stop        = qdma_vf_dev_tx_queue_stop,
 	.stats_get            = qdma_dev_stats_get,
+	.rx_queue_intr_enable = qdma_dev_rx_queue_intr_enable,
+	.rx_queue_intr_disable = qdma_dev_rx_queue_intr_disable,
+#ifndef QDMA_DPDK_20_11
+	.get_monitor_addr     = qdma_dev_get_monitor_addr,
+#endif
 };
 
 /**
@@ -1065,6 +1099,8 @@ static int eth_qdma_vf_dev_init(struct rte_eth_dev *dev)
 	dma_priv->func_id = 0;
 	dma_priv->is_vf = 1;
 	dma_priv->timer_count = DEFAULT_TIMER_CNT_TRIG_MODE_TIMER;
+	dma_priv->tx_db_thresh = QDMA_TX_DB_THRESH_LATENCY;
+	dma_priv->tx_db_hold_us = QDMA_TX_DB_HOLD_US_LATENCY;
 
 	dma_priv->en_desc_prefetch = 0;
 	dma_priv->cmpt_desc_len = DEFAULT_QDMA_CMPT_DESC_LEN;
@@ -1141,48 +1177,18 @@ static int eth_qdma_vf_dev_init(struct rte_eth_dev *dev)
 		return -EINVAL;
 	}
 
+	/* dmadev queues need the PF context programming path */
+	if (dma_priv->dma_queues) {
+		PMD_DRV_LOG(INFO, "VF-%d(DEVFN) dma_queues not supported "
+				"on VF, ignored\n", dma_priv->func_id);
+		dma_priv->dma_queues = 0;
+	}
+
 	/* Setting default Mode to RTE_PMD_QDMA_TRIG_MODE_USER_TIMER */
 	dma_priv->trigger_mode = RTE_PMD_QDMA_TRIG_MODE_USER_TIMER;
 
 	dma_priv->reset_state = RESET_STATE_IDLE;
 
-#ifdef LATENCY_MEASUREMENT
-	/* Create txq and rxq latency measurement shared memory
-	 * if not already created by the PF
-	 */
-	if (!h2c_pidx_to_hw_cidx_lat) {
-		/* Create a shared memory zone for the txq latency buffer */
-		txq_lat_buf_mz = rte_memzone_reserve("TXQ_LAT_BUFFER_ZONE",
-			LATENCY_MAX_QUEUES * LATENCY_CNT * sizeof(double),
-			rte_socket_id(), 0);
-		if (txq_lat_buf_mz == NULL) {
-			PMD_DRV_LOG(ERR,
-				"Failed to allocate txq latency buffer memzone\n");
-			return -1;
-		}
-
-		/* Get the virtual address of the txq latency buffer */
-		h2c_pidx_to_hw_cidx_lat =
-			(double(*)[LATENCY_CNT])txq_lat_buf_mz->addr;
-	}
-
-	if (!c2h_pidx_to_cmpt_pidx_lat) {
-		/* Create a shared memory zone for the rxq latency buffer */
-		rxq_lat_buf_mz = rte_memzone_reserve("RXQ_LAT_BUFFER_ZONE",
-			LATENCY_MAX_QUEUES * LATENCY_CNT * sizeof(double),
-			rte_socket_id(), 0);
-		if (rxq_lat_buf_mz == NULL) {
-			PMD_DRV_LOG(ERR,
-				"Failed to allocate rxq latency buffer memzone\n");
-			return -1;
-		}
-
-		/* Get the virtual address of the rxq latency buffer */
-		c2h_pidx_to_cmpt_pidx_lat =
-			(double(*)[LATENCY_CNT])rxq_lat_buf_mz->addr;
-	}
-#endif
-
 	PMD_DRV_LOG(INFO, "VF-%d(DEVFN) QDMA device driver probe:",
 				dma_priv->func_id);
 
@@ -106,6 +106,8 @@ static int qdma_h2c_struct_dump(uint8_t port_id, uint16_t queue)
 				tx_q->tx_fl_tail);
 		xdebug_info("\t\t tx_desc_pend        :%x\n",
 				tx_q->tx_desc_pend);
+		xdebug_info("\t\t tx_db_thresh        :%x\n",
+				tx_q->tx_db_thresh);
 		xdebug_info("\t\t nb_tx_desc          :%x\n",
 				tx_q->nb_tx_desc);
 		xdebug_info("\t\t st_mode             :%x\n",
@@ -443,6 +445,29 @@ static int qdma_device_dump(uint8_t port_id)
 	return 0;
 }
 
+static void qdma_qlat_dump(const char *name, const struct qdma_qlat *lat)
+{
+	double us = 1000000.0 / rte_get_timer_hz();
+	uint64_t lo;
+	int i;
+
+	xdebug_info("\n\t***** %s latency *****\n", name);
+	xdebug_info("\t\t samples              :%" PRIu64 "\n", lat->samples);
+	if (!lat->samples)
+		return;
+
+	xdebug_info("\t\t min/avg/max          :%.3f/%.3f/%.3f us\n",
+			lat->min * us, (lat->sum * us) / lat->samples,
+			lat->max * us);
+	for (i = 0; i < RTE_PMD_QDMA_QLAT_BUCKETS; i++) {
+		if (!lat->bucket[i])
+			continue;
+		lo = i ? (1ULL << (i - 1)) : 0;
+		xdebug_info("\t\t >= %12.3f us      :%" PRIu64 "\n",
+				lo * us, lat->bucket[i]);
+	}
+}
+
 static int qdma_tx_qstats_dump(struct qdma_tx_queue *txq)
 {
 	if (txq == NULL) {
@@ -467,20 +492,12 @@ static int qdma_tx_qstats_dump(struct qdma_tx_queue *txq)
 			txq->qstats.ring_wrap_cnt);
 	xdebug_info("\t\t txq_full_cnt         :%u\n",
 			txq->qstats.txq_full_cnt);
-
-#ifdef LATENCY_MEASUREMENT
-	xdebug_info("\n\t***** wrb cidx counts *****\n");
-	xdebug_info("\t\t wrb_cidx_cnt_no_change     :%u\n",
-			txq->qstats.wrb_cidx_cnt_no_change);
-	xdebug_info("\t\t wrb_cidx_cnt_lt_8          :%u\n",
-			txq->qstats.wrb_cidx_cnt_lt_8);
-	xdebug_info("\t\t wrb_cidx_cnt_8_to_32       :%u\n",
-			txq->qstats.wrb_cidx_cnt_8_to_32);
-	xdebug_info("\t\t wrb_cidx_cnt_32_to_64      :%u\n",
-			txq->qstats.wrb_cidx_cnt_32_to_64);
-	xdebug_info("\t\t wrb_cidx_cnt_gt_64         :%u\n",
-			txq->qstats.wrb_cidx_cnt_gt_64);
-#endif
+	xdebug_info("\t\t db_cnt               :%" PRIu64 "\n",
+			txq->qstats.db_cnt);
+	xdebug_info("\t\t db_desc_cnt          :%" PRIu64 "\n",
+			txq->qstats.db_desc_cnt);
+	xdebug_info("\t\t db_hold_expired_cnt  :%" PRIu64 "\n",
+			txq->qstats.db_hold_expired_cnt);
 
 	return 0;
 }
@@ -489,14 +506,6 @@ static int qdma_tx_qstats_latency_dump(struct rte_eth_dev *dev, uint16_t queue)
 {
 	struct qdma_tx_queue *txq;
 	int ret;
-#ifdef LATENCY_MEASUREMENT
-	double pkt_lat_val_ms = 0;
-	double txq_avg_lat_ms = 0;
-	const struct rte_memzone *memzone;
-	double (*lat_data)[LATENCY_CNT] = NULL;
-	uint64_t hz;
-	int i;
-#endif
 
 	if (dev == NULL) {
 		xdebug_error("Caught NULL pointer for dev\n");
@@ -526,32 +535,7 @@ static int qdma_tx_qstats_latency_dump(struct rte_eth_dev *dev, uint16_t queue)
 		return -1;
 	}
 
-#ifdef LATENCY_MEASUREMENT
-	/* Find the memzone created by the primary application */
-	memzone = rte_memzone_lookup("TXQ_LAT_BUFFER_ZONE");
-	if (memzone == NULL) {
-		/* Handle memzone lookup failure */
-		return -1;
-	}
-
-	/* Get the virtual address of the shared rxq latency buffer memory */
-	lat_data = memzone->addr;
-
-	xdebug_info("\n\t**** TxQ SW PIDX to HW CIDX Latency for qid: %d ****\n",
-			queue);
-	hz = rte_get_timer_hz();
-	for (i = 0; i < LATENCY_CNT; i++) {
-		pkt_lat_val_ms =
-			((double)lat_data[queue][i]*1000000/hz);
-		txq_avg_lat_ms += pkt_lat_val_ms;
-		xdebug_info("\t\t h2c_sw_pidx_to_hw_cidx_latency[%d][%d] : %f ms\n",
-			queue, i, pkt_lat_val_ms);
-	}
-
-	xdebug_info(
-			"\n\t Avg h2c_sw_pidx_to_hw_cidx_latency for qid:%d is %f ms\n",
-			queue, (txq_avg_lat_ms/LATENCY_CNT));
-#endif
+	qdma_qlat_dump("H2C PIDX to CIDX writeback", &txq->qstats.lat);
 
 	return 0;
 }
@@ -591,14 +575,6 @@ static int qdma_rx_qstats_latency_dump(struct rte_eth_dev *dev, uint16_t queue)
 {
 	struct qdma_rx_queue *rxq;
 	int ret;
-#ifdef LATENCY_MEASUREMENT
-	double pkt_lat_val_ms = 0;
-	double rxq_avg_lat_ms = 0;
-	const struct rte_memzone *memzone;
-	double (*lat_data)[LATENCY_CNT] = NULL;
-	uint64_t hz;
-	int i;
-#endif
 
 	if (dev == NULL) {
 		xdebug_error("Caught NULL pointer for dev\n");
@@ -628,32 +604,7 @@ static int qdma_rx_qstats_latency_dump(struct rte_eth_dev *dev, uint16_t queue)
 		return -1;
 	}
 
-#ifdef LATENCY_MEASUREMENT
-	/* Find the memzone created by the primary application */
-	memzone = rte_memzone_lookup("RXQ_LAT_BUFFER_ZONE");
-	if (memzone == NULL) {
-		/* Handle memzone lookup failure */
-		return -1;
-	}
-
-	/* Get the virtual address of the shared txq latency buffer memory */
-	lat_data = memzone->addr;
-
-	xdebug_info("\n\t*** RxQ SW PIDX to CMPT PIDX Latency for qid: %d ***\n",
-		queue);
-	hz = rte_get_timer_hz();
-	for (i = 0; i < LATENCY_CNT; i++) {
-		pkt_lat_val_ms =
-			((double)lat_data[queue][i]*1000000/hz);
-		rxq_avg_lat_ms += pkt_lat_val_ms;
-		xdebug_info("\t\t c2h_sw_pidx_to_cmpt_pidx_latency[%d][%d] : %f ms\n",
-			queue, i, pkt_lat_val_ms);
-	}
-
-	xdebug_info(
-			"\n\t Avg c2h_sw_pidx_to_cmpt_pidx_latency for qid:%d is %f ms\n",
-			queue, (rxq_avg_lat_ms/LATENCY_CNT));
-#endif
+	qdma_qlat_dump("C2H PIDX to CMPT writeback", &rxq->qstats.lat);
 
 	return 0;
 }
@@ -1281,9 +1232,6 @@ int qdma_tx_qstats_clear(struct rte_eth_dev *dev, uint16_t queue)
 {
 	struct qdma_tx_queue *txq;
 	int ret;
-#ifdef LATENCY_MEASUREMENT
-	int i;
-#endif
 
 	if (queue >= dev->data->nb_tx_queues) {
 		xdebug_info("TX queue_id=%d not configured\n", queue);
@@ -1298,11 +1246,6 @@ int qdma_tx_qstats_clear(struct rte_eth_dev *dev, uint16_t queue)
 
 	memset(&txq->qstats, 0, sizeof(struct qdma_txq_stats));
 
-#ifdef LATENCY_MEASUREMENT
-	for (i = 0; i < LATENCY_CNT; i++)
-		h2c_pidx_to_hw_cidx_lat[queue][i] = 0;
-#endif
-
 	xdebug_info("\nCleared Tx queue stats for  qid: %d\n",
 		queue);
 
@@ -1320,9 +1263,6 @@ int qdma_rx_qstats_clear(struct rte_eth_dev *dev, uint16_t queue)
 {
 	struct qdma_rx_queue *rxq;
 	int ret;
-#ifdef LATENCY_MEASUREMENT
-	int i;
-#endif
 
 	if (queue >= dev->data->nb_rx_queues) {
 		xdebug_info("RX queue_id=%d not configured\n", queue);
@@ -1337,11 +1277,6 @@ int qdma_rx_qstats_clear(struct rte_eth_dev *dev, uint16_t queue)
 
 	memset(&rxq->qstats, 0, sizeof(struct qdma_rxq_stats));
 
-#ifdef LATENCY_MEASUREMENT
-	for (i = 0; i < LATENCY_CNT; i++)
-		c2h_pidx_to_cmpt_pidx_lat[queue][i] = 0;
-#endif
-
 	xdebug_info("\nCleared Rx queue stats for  qid: %d\n",
 		queue);
 
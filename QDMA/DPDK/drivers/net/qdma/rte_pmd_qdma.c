@@ -44,7 +44,9 @@
 #include <rte_ethdev.h>
 #include <rte_alarm.h>
 #include <rte_cycles.h>
+#include <rte_telemetry.h>
 #include <unistd.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "qdma.h"
@@ -1350,15 +1352,15 @@ int rte_pmd_qdma_dev_cmptq_setup(int port_id, uint32_t cmpt_queue_id,
 
 	/* Allocate memory for completion(CMPT) descriptor ring */
 	sz = (cmptq->nb_cmpt_desc) * cmptq->cmpt_desc_len;
-	cmptq->cmpt_mz = qdma_zone_reserve(dev, "RxHwCmptRn",
-			cmpt_queue_id, sz, socket_id);
-	if (!cmptq->cmpt_mz) {
-		PMD_DRV_LOG(ERR, "Unable to allocate cmptq->cmpt_mz "
+	cmptq->cmpt_ring = (struct qdma_ul_cmpt_ring *)
+		qdma_ring_reserve(dev, &cmptq->cmpt_mem, "RxHwCmptRn",
+				  cmpt_queue_id, sz, socket_id);
+	if (!cmptq->cmpt_ring) {
+		PMD_DRV_LOG(ERR, "Unable to allocate cmptq->cmpt_ring "
 				"of size %d\n", sz);
 		err = -ENOMEM;
 		goto cmptq_setup_err;
 	}
-	cmptq->cmpt_ring = (struct qdma_ul_cmpt_ring *)cmptq->cmpt_mz->addr;
 
 	/* Write-back status structure */
 	cmptq->wb_status = (struct wb_status *)((uint64_t)cmptq->cmpt_ring +
@@ -1377,8 +1379,7 @@ cmptq_setup_err:
 				qdma_dev->queue_base, QDMA_DEV_Q_TYPE_CMPT);
 
 	if (cmptq) {
-		if (cmptq->cmpt_mz)
-			rte_memzone_free(cmptq->cmpt_mz);
+		qdma_ring_release(&cmptq->cmpt_mem);
 		rte_free(cmptq);
 	}
 	return err;
@@ -1424,7 +1425,7 @@ static int qdma_vf_cmptq_context_write(struct rte_eth_dev *dev, uint16_t qid)
 	descq_conf.irq_en = 0;
 	descq_conf.desc_sz = SW_DESC_CNTXT_MEMORY_MAP_DMA;
 	descq_conf.forced_en = 1;
-	descq_conf.cmpt_ring_bs_addr = cmptq->cmpt_mz->iova;
+	descq_conf.cmpt_ring_bs_addr = cmptq->cmpt_mem.iova;
 	descq_conf.cmpt_desc_sz = cmpt_desc_fmt;
 	descq_conf.triggermode = cmptq->triggermode;
 
@@ -1508,7 +1509,7 @@ static int qdma_pf_cmptq_context_write(struct rte_eth_dev *dev, uint32_t qid)
 	q_cmpt_ctxt.lower_dword.bit.timer_idx = cmptq->timeridx;
 	q_cmpt_ctxt.lower_dword.bit.color = CMPT_DEFAULT_COLOR_BIT;
 	q_cmpt_ctxt.lower_dword.bit.ringsz_idx = cmptq->ringszidx;
-	q_cmpt_ctxt.bs_addr = (uint64_t)cmptq->cmpt_mz->iova;
+	q_cmpt_ctxt.bs_addr = (uint64_t)cmptq->cmpt_mem.iova;
 	q_cmpt_ctxt.higher_dword.bit.desc_sz = cmpt_desc_fmt;
 	q_cmpt_ctxt.higher_dword.bit.valid = 1;
 	if (cmptq->st_mode)
@@ -1781,6 +1782,297 @@ uint16_t rte_pmd_qdma_mm_cmpt_process(int port_id, uint32_t qid,
 	return count;
 }
 
+/******************************************************************************/
+/**
+ * Function Name:	rte_pmd_qdma_set_tx_doorbell
+ * Description:		Configures the doorbell batching of a Tx queue.
+ *
+ * @param	port_id : Port ID.
+ * @param	qid : Queue ID.
+ * @param	threshold : Pending descriptors that trigger a doorbell.
+ * @param	hold_us : Maximum time a descriptor is held back.
+ *
+ * @return	'0' on success and '<0' on failure.
+ *
+ * @note	Application can call this API after successful call to
+ *		rte_eth_tx_queue_setup(), also while the queue is running.
+ ******************************************************************************/
+int rte_pmd_qdma_set_tx_doorbell(int port_id, uint32_t qid,
+		uint16_t threshold, uint32_t hold_us)
+{
+	struct rte_eth_dev *dev;
+	struct qdma_tx_queue *txq;
+	int ret = 0;
+
+	ret = validate_qdma_dev_info(port_id, qid);
+	if (ret != QDMA_SUCCESS) {
+		PMD_DRV_LOG(ERR,
+			"QDMA device validation failed for port id %d\n",
+			port_id);
+		return ret;
+	}
+	dev = &rte_eth_devices[port_id];
+	if (qid >= dev->data->nb_tx_queues) {
+		PMD_DRV_LOG(ERR, "Invalid Tx queue id passed for %s, "
+				"Queue ID = %d\n", __func__, qid);
+		return -EINVAL;
+	}
+
+	txq = (struct qdma_tx_queue *)dev->data->tx_queues[qid];
+	if (txq == NULL) {
+		PMD_DRV_LOG(ERR, "Tx queue %d is not setup\n", qid);
+		return -EINVAL;
+	}
+
+	if (threshold == 0 || hold_us > QDMA_TX_DB_HOLD_US_MAX) {
+		PMD_DRV_LOG(ERR, "Invalid Tx doorbell threshold %u or "
+				"hold time %u us\n", threshold, hold_us);
+		return -EINVAL;
+	}
+
+	/* Picked up by the next burst, a torn update only delays one
+	 * doorbell
+	 */
+	txq->tx_db_hold_cycles = (rte_get_timer_hz() * hold_us) / US_PER_S;
+	txq->tx_db_thresh = threshold;
+
+	return 0;
+}
+
+/******************************************************************************/
+/**
+ * Function Name:	rte_pmd_qdma_get_tx_db_stats
+ * Description:		Reads the doorbell counters of a Tx queue.
+ *
+ * @param	port_id : Port ID.
+ * @param	qid : Queue ID.
+ * @param	stats : Doorbell counters of the queue.
+ *
+ * @return	'0' on success and '<0' on failure.
+ ******************************************************************************/
+int rte_pmd_qdma_get_tx_db_stats(int port_id, uint32_t qid,
+		struct rte_pmd_qdma_tx_db_stats *stats)
+{
+	struct rte_eth_dev *dev;
+	struct qdma_tx_queue *txq;
+	int ret = 0;
+
+	if (stats == NULL)
+		return -EINVAL;
+
+	ret = validate_qdma_dev_info(port_id, qid);
+	if (ret != QDMA_SUCCESS) {
+		PMD_DRV_LOG(ERR,
+			"QDMA device validation failed for port id %d\n",
+			port_id);
+		return ret;
+	}
+	dev = &rte_eth_devices[port_id];
+	if (qid >= dev->data->nb_tx_queues ||
+			dev->data->tx_queues[qid] == NULL) {
+		PMD_DRV_LOG(ERR, "Tx queue %d is not setup\n", qid);
+		return -EINVAL;
+	}
+
+	txq = (struct qdma_tx_queue *)dev->data->tx_queues[qid];
+	stats->doorbells = txq->qstats.db_cnt;
+	stats->descs = txq->qstats.db_desc_cnt;
+	stats->hold_expired = txq->qstats.db_hold_expired_cnt;
+
+	return 0;
+}
+
+/******************************************************************************/
+/**
+ * Function Name:	rte_pmd_qdma_qlat_enable
+ * Description:		Enables or disables the latency histograms of all
+ *			queues of a port. Enabling clears the histograms.
+ *
+ * @param	port_id : Port ID.
+ * @param	enable : '1' to enable and '0' to disable.
+ *
+ * @return	'0' on success and '<0' on failure.
+ *
+ * @note	Application can call this API also while the queues are
+ *		running, queues set up later inherit the setting.
+ ******************************************************************************/
+int rte_pmd_qdma_qlat_enable(int port_id, uint8_t enable)
+{
+	struct rte_eth_dev *dev;
+	struct qdma_pci_dev *qdma_dev;
+	struct qdma_tx_queue *txq;
+	struct qdma_rx_queue *rxq;
+	uint16_t qid;
+
+	if (port_id < 0 || port_id >= rte_eth_dev_count_avail()) {
+		PMD_DRV_LOG(ERR, "Wrong port id %d\n", port_id);
+		return -ENOTSUP;
+	}
+	dev = &rte_eth_devices[port_id];
+	if (!is_qdma_supported(dev)) {
+		PMD_DRV_LOG(ERR, "Device is not supported\n");
+		return -ENOTSUP;
+	}
+	if (enable > 1) {
+		PMD_DRV_LOG(ERR, "Invalid value %u passed for %s\n",
+				enable, __func__);
+		return -EINVAL;
+	}
+
+	qdma_dev = dev->data->dev_private;
+	qdma_dev->qlat_en = enable;
+
+	for (qid = 0; qid < dev->data->nb_tx_queues; qid++) {
+		txq = (struct qdma_tx_queue *)dev->data->tx_queues[qid];
+		if (txq == NULL)
+			continue;
+		if (enable)
+			memset(&txq->qstats.lat, 0, sizeof(txq->qstats.lat));
+		txq->qlat_en = enable;
+	}
+
+	for (qid = 0; qid < dev->data->nb_rx_queues; qid++) {
+		rxq = (struct qdma_rx_queue *)dev->data->rx_queues[qid];
+		if (rxq == NULL)
+			continue;
+		if (enable)
+			memset(&rxq->qstats.lat, 0, sizeof(rxq->qstats.lat));
+		rxq->qlat_en = enable;
+	}
+
+	return 0;
+}
+
+/******************************************************************************/
+/**
+ * Function Name:	rte_pmd_qdma_qlat_get
+ * Description:		Reads the latency histogram of a queue.
+ *
+ * @param	port_id : Port ID.
+ * @param	qid : Queue ID.
+ * @param	dir : Queue direction.
+ * @param	qlat : Latency histogram of the queue.
+ *
+ * @return	'0' on success and '<0' on failure.
+ ******************************************************************************/
+int rte_pmd_qdma_qlat_get(int port_id, uint32_t qid,
+		enum rte_pmd_qdma_dir_type dir, struct rte_pmd_qdma_qlat *qlat)
+{
+	struct rte_eth_dev *dev;
+	const struct qdma_qlat *lat;
+	int ret = 0;
+
+	if (qlat == NULL)
+		return -EINVAL;
+
+	ret = validate_qdma_dev_info(port_id, qid);
+	if (ret != QDMA_SUCCESS) {
+		PMD_DRV_LOG(ERR,
+			"QDMA device validation failed for port id %d\n",
+			port_id);
+		return ret;
+	}
+	dev = &rte_eth_devices[port_id];
+
+	if (dir == RTE_PMD_QDMA_TX) {
+		if (qid >= dev->data->nb_tx_queues ||
+				dev->data->tx_queues[qid] == NULL) {
+			PMD_DRV_LOG(ERR, "Tx queue %d is not setup\n", qid);
+			return -EINVAL;
+		}
+		lat = &((struct qdma_tx_queue *)
+				dev->data->tx_queues[qid])->qstats.lat;
+	} else if (dir == RTE_PMD_QDMA_RX) {
+		if (qid >= dev->data->nb_rx_queues ||
+				dev->data->rx_queues[qid] == NULL) {
+			PMD_DRV_LOG(ERR, "Rx queue %d is not setup\n", qid);
+			return -EINVAL;
+		}
+		lat = &((struct qdma_rx_queue *)
+				dev->data->rx_queues[qid])->qstats.lat;
+	} else {
+		PMD_DRV_LOG(ERR, "Invalid direction specified,"
+				"Direction is %d\n", dir);
+		return -EINVAL;
+	}
+
+	qlat->hz = rte_get_timer_hz();
+	qlat->samples = lat->samples;
+	qlat->sum = lat->sum;
+	qlat->min = lat->min;
+	qlat->max = lat->max;
+	memcpy(qlat->bucket, lat->bucket, sizeof(qlat->bucket));
+
+	return 0;
+}
+
+#ifdef QDMA_DPDK_23_11
+#define qdma_tel_add_dict(d, name, val)	rte_tel_data_add_dict_uint(d, name, val)
+#define qdma_tel_add_array(d, val)	rte_tel_data_add_array_uint(d, val)
+#define QDMA_TEL_VAL			RTE_TEL_UINT_VAL
+#else
+#define qdma_tel_add_dict(d, name, val)	rte_tel_data_add_dict_u64(d, name, val)
+#define qdma_tel_add_array(d, val)	rte_tel_data_add_array_u64(d, val)
+#define QDMA_TEL_VAL			RTE_TEL_U64_VAL
+#endif
+
+/* Telemetry command /qdma/qlat,<port_id>,<queue_id>,<tx|rx> */
+static int qdma_tel_qlat(const char *cmd __rte_unused, const char *params,
+		struct rte_tel_data *d)
+{
+	struct rte_pmd_qdma_qlat qlat;
+	struct rte_tel_data *buckets;
+	enum rte_pmd_qdma_dir_type dir;
+	unsigned long port_id, qid;
+	char *end = NULL;
+	int i, ret;
+
+	if (params == NULL)
+		return -EINVAL;
+
+	port_id = strtoul(params, &end, 10);
+	if (*end != ',')
+		return -EINVAL;
+	qid = strtoul(end + 1, &end, 10);
+	if (*end != ',')
+		return -EINVAL;
+	end++;
+	if (!strcmp(end, "tx"))
+		dir = RTE_PMD_QDMA_TX;
+	else if (!strcmp(end, "rx"))
+		dir = RTE_PMD_QDMA_RX;
+	else
+		return -EINVAL;
+
+	ret = rte_pmd_qdma_qlat_get((int)port_id, (uint32_t)qid, dir, &qlat);
+	if (ret < 0)
+		return ret;
+
+	buckets = rte_tel_data_alloc();
+	if (buckets == NULL)
+		return -ENOMEM;
+	rte_tel_data_start_array(buckets, QDMA_TEL_VAL);
+	for (i = 0; i < RTE_PMD_QDMA_QLAT_BUCKETS; i++)
+		qdma_tel_add_array(buckets, qlat.bucket[i]);
+
+	rte_tel_data_start_dict(d);
+	qdma_tel_add_dict(d, "hz", qlat.hz);
+	qdma_tel_add_dict(d, "samples", qlat.samples);
+	qdma_tel_add_dict(d, "sum", qlat.sum);
+	qdma_tel_add_dict(d, "min", qlat.min);
+	qdma_tel_add_dict(d, "max", qlat.max);
+	rte_tel_data_add_dict_container(d, "bucket", buckets, 0);
+
+	return 0;
+}
+
+RTE_INIT(qdma_init_telemetry)
+{
+	rte_telemetry_register_cmd("/qdma/qlat", qdma_tel_qlat,
+		"Returns the latency histogram of a queue in timer cycles, "
+		"log2 buckets. Parameters: port_id,queue_id,tx|rx");
+}
+
 /*****************************************************************************/
 /**
  * Function Name:   rte_pmd_qdma_dev_close
@@ -53,6 +53,9 @@ extern "C" {
 /** @defgroup rte_pmd_qdma_func Functions
  */
 
+/** Number of log2 buckets of the queue latency histograms */
+#define RTE_PMD_QDMA_QLAT_BUCKETS	(40)
+
 /**
  * Bypass modes in C2H direction
  * @ingroup rte_pmd_qdma_enums
@@ -293,6 +296,48 @@ struct rte_pmd_qdma_dev_attributes {
 	enum rte_pmd_qdma_ip_type ip_type;
 };
 
+/**
+ * Structure to hold the Tx doorbell counters of a queue
+ *
+ * @ingroup rte_pmd_qdma_struct
+ */
+struct rte_pmd_qdma_tx_db_stats {
+	/** PIDX doorbells written */
+	uint64_t doorbells;
+	/** Descriptors announced by the doorbells */
+	uint64_t descs;
+	/** Doorbells written because the hold time expired */
+	uint64_t hold_expired;
+};
+
+/**
+ * Structure to hold the latency histogram of a queue
+ *
+ * Tx queues measure from the H2C PIDX doorbell until the Tx burst sees
+ * the CIDX writeback covering it. Rx queues measure from the C2H PIDX
+ * doorbell until the Rx burst sees the next CMPT writeback. Only one
+ * measurement per queue is in flight, doorbells rung meanwhile are not
+ * sampled.
+ *
+ * @ingroup rte_pmd_qdma_struct
+ */
+struct rte_pmd_qdma_qlat {
+	/** Timer frequency, rte_get_timer_hz(), to convert the cycles */
+	uint64_t hz;
+	/** Number of measurements */
+	uint64_t samples;
+	/** Sum of all measurements in timer cycles */
+	uint64_t sum;
+	/** Shortest measurement in timer cycles */
+	uint64_t min;
+	/** Longest measurement in timer cycles */
+	uint64_t max;
+	/** bucket[0] counts measurements of 0 cycles, bucket[i] those of
+	 * [2^(i-1), 2^i) cycles, the last bucket everything longer
+	 */
+	uint64_t bucket[RTE_PMD_QDMA_QLAT_BUCKETS];
+};
+
 
 /******************************************************************************/
 /**
@@ -752,6 +797,87 @@ int rte_pmd_qdma_dev_cmptq_stop(int port_id, uint32_t qid);
 uint16_t rte_pmd_qdma_mm_cmpt_process(int port_id, uint32_t qid,
 		void *cmpt_buff, uint16_t nb_entries);
 
+/******************************************************************************/
+/**
+ * Configures the doorbell batching of a Tx queue
+ *
+ * The PIDX doorbell is written once threshold descriptors are pending or
+ * the oldest pending descriptor was queued hold_us microseconds ago. The
+ * hold time is checked in rte_eth_tx_burst() and
+ * rte_eth_tx_done_cleanup(), an idle queue must keep calling one of them,
+ * with zero packets if need be, to flush the tail. Queue stop flushes it.
+ * Threshold 1 writes the doorbell on every burst, hold_us 0 never holds
+ * descriptors back across bursts.
+ *
+ * @param	port_id Port ID
+ * @param	qid  Queue ID
+ * @param	threshold Pending descriptors that trigger a doorbell
+ * @param	hold_us Maximum time a descriptor is held back
+ *
+ * @return	'0' on success and '< 0' on failure
+ *
+ * @note	Application can call this API after successful call to
+ *		rte_eth_tx_queue_setup(), also while the queue is running.
+ *		The tx_db_profile, tx_db_thresh and tx_db_hold_us devargs
+ *		set the initial values of all Tx queues of the port.
+ * @ingroup rte_pmd_qdma_func
+ ******************************************************************************/
+int rte_pmd_qdma_set_tx_doorbell(int port_id, uint32_t qid,
+		uint16_t threshold, uint32_t hold_us);
+
+/******************************************************************************/
+/**
+ * Reads the doorbell counters of a Tx queue
+ *
+ * @param	port_id Port ID
+ * @param	qid  Queue ID
+ * @param	stats Doorbell counters of the queue
+ *
+ * @return	'0' on success and '< 0' on failure
+ *
+ * @note	The counters are cleared by rte_pmd_qdma_qstats_clear().
+ * @ingroup rte_pmd_qdma_func
+ ******************************************************************************/
+int rte_pmd_qdma_get_tx_db_stats(int port_id, uint32_t qid,
+		struct rte_pmd_qdma_tx_db_stats *stats);
+
+/******************************************************************************/
+/**
+ * Enables or disables the latency histograms of all queues of a port
+ *
+ * Enabling clears the histograms. The qlat=1 devarg enables them from
+ * the start. The histograms are also available through the telemetry
+ * command /qdma/qlat,<port_id>,<queue_id>,<tx|rx>.
+ *
+ * @param	port_id Port ID
+ * @param	enable  '1' to enable and '0' to disable
+ *
+ * @return	'0' on success and '< 0' on failure
+ *
+ * @note	Application can call this API after successful call to
+ *		rte_eth_dev_configure(), also while the port is running.
+ *		Queues set up later inherit the setting.
+ * @ingroup rte_pmd_qdma_func
+ ******************************************************************************/
+int rte_pmd_qdma_qlat_enable(int port_id, uint8_t enable);
+
+/******************************************************************************/
+/**
+ * Reads the latency histogram of a queue
+ *
+ * @param	port_id Port ID
+ * @param	qid  Queue ID
+ * @param	dir  Queue direction, RTE_PMD_QDMA_TX or RTE_PMD_QDMA_RX
+ * @param	qlat Latency histogram of the queue
+ *
+ * @return	'0' on success and '< 0' on failure
+ *
+ * @note	The histograms are cleared by rte_pmd_qdma_qstats_clear().
+ * @ingroup rte_pmd_qdma_func
+ ******************************************************************************/
+int rte_pmd_qdma_qlat_get(int port_id, uint32_t qid,
+		enum rte_pmd_qdma_dir_type dir, struct rte_pmd_qdma_qlat *qlat);
+
 /*****************************************************************************/
 /**
  * DPDK PMD function to close the device.
@@ -220,12 +220,14 @@ static void __attribute__((noreturn)) usage(FILE *fp)
 		   "                                    [idx_cntr <0:15>] [trigmode <every|usr_cnt|usr|usr_tmr|dis>] [cmptsz <0|1|2|3>] [sw_desc_sz <3>]\n"
 	        "                                    [mm_chn <0|1>] [desc_bypass_en] [pfetch_en] [pfetch_bypass_en] [dis_cmpl_status]\n"
 	        "                                    [dis_cmpl_status_acc] [dis_cmpl_status_pend_chk] [c2h_udd_en]\n"
-			"                                    [cmpl_ovf_dis] [fetch_credit  <h2c|c2h|bi|none>] [dis_cmpl_status] [c2h_cmpl_intr_en] [aperture_sz <aperture size power of 2>]- start a single queue\n"
+			"                                    [cmpl_ovf_dis] [fetch_credit  <h2c|c2h|bi|none>] [dis_cmpl_status] [c2h_cmpl_intr_en] [aperture_sz <aperture size power of 2>]\n"
+			"                                    [pidx_acc <0:255>] [pidx_acc_us <usecs>] [numa_node <N>] - start a single queue\n"
 	        "\t\tq start list <start_idx> <num_Qs> [dir <h2c|c2h|bi|cmpt>] [idx_bufsz <0:15>] [idx_tmr <0:15>]\n"
 			"                                    [idx_cntr <0:15>] [trigmode <every|usr_cnt|usr|usr_tmr|dis>] [cmptsz <0|1|2|3>] [sw_desc_sz <3>]\n"
 	        "                                    [mm_chn <0|1>] [desc_bypass_en] [pfetch_en] [pfetch_bypass_en] [dis_cmpl_status]\n"
 	        "                                    [dis_cmpl_status_acc] [dis_cmpl_status_pend_chk] [cmpl_ovf_dis]\n"
-			"                                    [fetch_credit <h2c|c2h|bi|none>] [dis_cmpl_status] [c2h_cmpl_intr_en] [aperture_sz <aperture size power of 2>]- start multiple queues at once\n"
+			"                                    [fetch_credit <h2c|c2h|bi|none>] [dis_cmpl_status] [c2h_cmpl_intr_en] [aperture_sz <aperture size power of 2>]\n"
+			"                                    [pidx_acc <0:255>] [pidx_acc_us <usecs>] [numa_node <N>] - start multiple queues at once\n"
 	        "\t\tq stop idx <N> dir [<h2c|c2h|bi|cmpt>] - stop a single queue\n"
 	        "\t\tq stop list <start_idx> <num_Qs> dir [<h2c|c2h|bi|cmpt>] - stop list of queues at once\n"
 	        "\t\tq del idx <N> dir [<h2c|c2h|bi|cmpt>] - delete a queue\n"
@@ -904,6 +906,45 @@ static int read_qparm(int argc, char *argv[], int i, struct xcmd_q_parm *qparm,
 			f_arg_set |= 1 << QPARM_KEYHOLE_EN;
 			qparm->aperture_sz = v1;
 			i++;
+		} else if (!strcmp(argv[i], "pidx_acc")) {
+			rv = next_arg_read_int(argc, argv, &i, &v1);
+			if (rv < 0)
+				return rv;
+
+			if (v1 > 255) {
+				warnx("Error: pidx_acc should be 0 - 255\n");
+				return -EINVAL;
+			}
+
+			f_arg_set |= 1 << QPARM_PIDX_ACC;
+			qparm->pidx_acc = v1;
+			i++;
+		} else if (!strcmp(argv[i], "pidx_acc_us")) {
+			rv = next_arg_read_int(argc, argv, &i, &v1);
+			if (rv < 0)
+				return rv;
+
+			if (v1 > 65535) {
+				warnx("Error: pidx_acc_us should be 0 - 65535\n");
+				return -EINVAL;
+			}
+
+			f_arg_set |= 1 << QPARM_PIDX_ACC_USECS;
+			qparm->pidx_acc_usecs = v1;
+			i++;
+		} else if (!strcmp(argv[i], "numa_node")) {
+			rv = next_arg_read_int(argc, argv, &i, &v1);
+			if (rv < 0)
+				return rv;
+
+			if (v1 > 1023) {
+				warnx("Error: numa_node should be 0 - 1023\n");
+				return -EINVAL;
+			}
+
+			f_arg_set |= 1 << QPARM_NUMA_NODE;
+			qparm->numa_node = v1;
+			i++;
 		} else if (!strcmp(argv[i], "pfetch_bypass_en")) {
 			qparm->flags |= XNL_F_PFETCH_BYPASS_EN;
 			i++;
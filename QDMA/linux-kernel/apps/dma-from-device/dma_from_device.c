@@ -21,6 +21,7 @@
 #include <unistd.h>
 #include <time.h>
 
+#include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -28,6 +29,7 @@
 #include <unistd.h>
 
 #include "dma_xfer_utils.c"
+#include "qdma_cdev_ioctl.h"
 
 #define DEVICE_NAME_DEFAULT "/dev/qdma01000-MM-0"
 #define SIZE_DEFAULT (32)
@@ -45,12 +47,16 @@ static struct option const long_opts[] = {
 	{"file", required_argument, NULL, 'f'},
 	{"help", no_argument, NULL, 'h'},
 	{"verbose", no_argument, NULL, 'v'},
+	{"zero-copy", no_argument, NULL, 'z'},
 	{0, 0, 0, 0}
 };
 
 static int test_dma(char *devname, uint64_t addr, uint64_t size,
 		    uint64_t offset, uint64_t count, char *ofname);
+static int test_dma_zc(char *devname, uint64_t size, uint64_t count,
+		       char *ofname);
 static int no_write = 0;
+static int zero_copy = 0;
 
 static void usage(const char *name)
 {
@@ -84,6 +90,10 @@ static void usage(const char *name)
 	i++;
 	fprintf(stdout, "  -%c (--%s) verbose output\n",
 		long_opts[i].val, long_opts[i].name);
+	i++;
+	fprintf(stdout,
+		"  -%c (--%s) ST only, receive in place from the mmap'd ring\n",
+		long_opts[i].val, long_opts[i].name);
 }
 
 int main(int argc, char *argv[])
@@ -96,7 +106,7 @@ int main(int argc, char *argv[])
 	uint64_t count = COUNT_DEFAULT;
 	char *ofname = NULL;
 
-	while ((cmd_opt = getopt_long(argc, argv, "vhxc:f:d:a:s:o:", long_opts,
+	while ((cmd_opt = getopt_long(argc, argv, "vhxzc:f:d:a:s:o:", long_opts,
 			    NULL)) != -1) {
 		switch (cmd_opt) {
 		case 0:
@@ -132,6 +142,9 @@ int main(int argc, char *argv[])
 		case 'v':
 			verbose = 1;
 			break;
+		case 'z':
+			zero_copy = 1;
+			break;
 		case 'h':
 		default:
 			usage(argv[0]);
@@ -144,9 +157,110 @@ int main(int argc, char *argv[])
 		"dev %s, addr 0x%lx, size 0x%lx, offset 0x%lx, count %lu\n",
 		device, address, size, offset, count);
 
+	if (zero_copy)
+		return test_dma_zc(device, size, count, ofname);
+
 	return test_dma(device, address, size, offset, count, ofname);
 }
 
+static int test_dma_zc(char *devname, uint64_t size, uint64_t count,
+		       char *ofname)
+{
+	struct qdma_cdev_zc_info info;
+	struct qdma_zc_rx_ring *ring;
+	struct timespec ts_start, ts_end;
+	char *base = MAP_FAILED;
+	unsigned int cons, prod, n;
+	uint64_t i, got;
+	double total_time = 0;
+	double result;
+	double avg_time = 0;
+	int out_fd = -1;
+	int rc = -EINVAL;
+	int fpga_fd = open(devname, O_RDWR);
+
+	if (fpga_fd < 0) {
+		fprintf(stderr, "unable to open device %s, %d.\n",
+			devname, fpga_fd);
+		perror("open device");
+		return -EINVAL;
+	}
+
+	if (ofname) {
+		out_fd = open(ofname, O_RDWR | O_CREAT | O_TRUNC | O_SYNC,
+				0666);
+		if (out_fd < 0) {
+			fprintf(stderr, "unable to open output file %s, %d.\n",
+				ofname, out_fd);
+			perror("open output file");
+			goto out;
+		}
+	}
+
+	if (ioctl(fpga_fd, QDMA_CDEV_IOCTL_ZC_ENABLE, &info) < 0) {
+		perror("zero copy enable");
+		goto out;
+	}
+
+	base = mmap(NULL, info.mmap_len, PROT_READ, MAP_SHARED, fpga_fd, 0);
+	if (base == MAP_FAILED) {
+		perror("mmap");
+		goto out;
+	}
+	ring = (struct qdma_zc_rx_ring *)base;
+	cons = ring->cons;
+	if (verbose)
+		fprintf(stdout, "zero copy ring %u x %u bytes, mapped 0x%llx\n",
+			info.size, info.buf_sz, info.mmap_len);
+
+	for (i = 0; i < count; i++) {
+		clock_gettime(CLOCK_MONOTONIC, &ts_start);
+		for (got = 0, n = 0; got < size; ) {
+			prod = __atomic_load_n(&ring->prod, __ATOMIC_ACQUIRE);
+			for (; cons != prod && got < size; n++) {
+				struct qdma_zc_rx_entry *ent = &ring->ent[cons];
+
+				if ((out_fd >= 0) && (no_write == 0)) {
+					rc = write_from_buffer(ofname, out_fd,
+						base + ent->off, ent->len,
+						i * size + got);
+					if (rc < 0)
+						goto out;
+				}
+				got += ent->len;
+				cons = (cons + 1) % info.size;
+			}
+		}
+		if (ioctl(fpga_fd, QDMA_CDEV_IOCTL_ZC_RELEASE, &n) < 0) {
+			perror("zero copy release");
+			rc = -EIO;
+			goto out;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &ts_end);
+
+		timespec_sub(&ts_end, &ts_start);
+		total_time += (ts_end.tv_sec + ((double)ts_end.tv_nsec/NSEC_DIV));
+		if (verbose)
+		fprintf(stdout,
+			"#%lu: CLOCK_MONOTONIC %ld.%09ld sec. received %lu bytes in %u buffers\n",
+			i, ts_end.tv_sec, ts_end.tv_nsec, got, n);
+	}
+	avg_time = (double)total_time/(double)count;
+	result = ((double)size)/avg_time;
+	dump_throughput_result(size, result);
+
+	rc = 0;
+
+out:
+	if (base != MAP_FAILED)
+		munmap(base, info.mmap_len);
+	close(fpga_fd);
+	if (out_fd >= 0)
+		close(out_fd);
+
+	return rc;
+}
+
 static int test_dma(char *devname, uint64_t addr, uint64_t size,
 		    uint64_t offset, uint64_t count, char *ofname)
 {
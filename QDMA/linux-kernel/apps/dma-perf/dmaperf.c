@@ -35,8 +35,11 @@
 #include </usr/include/pthread.h>
 #include <libaio.h>
 #include <sys/sysinfo.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
 #include "dmautils.h"
 #include "qdma_nl.h"
+#include "qdma_cdev_ioctl.h"
 
 #define SEC2NSEC           1000000000
 #define SEC2USEC           1000000
@@ -152,6 +155,11 @@ enum mm_channel_ctrl {
 	MM_CHANNEL_INTERLEAVE /*Odd queues are assigned to ch 1 and even Qs are assigned to channel 0*/
 };
 
+enum io_engine {
+	IO_ENGINE_AIO,		/* libaio, one iocb per burst */
+	IO_ENGINE_URING		/* io_uring passthrough, one sqe per buffer */
+};
+
 #define THREADS_SET_CPU_AFFINITY 0
 
 struct io_info {
@@ -263,6 +271,7 @@ char trigmode[10];
 char pci_dump[PCI_DUMP_CMD_LEN];
 unsigned int dump_en = 0;
 unsigned int marker_en = 1;
+enum io_engine io_engine = IO_ENGINE_AIO;
 static struct timespec g_ts_start;
 static unsigned char *q_lst_stop = NULL;
 int q_lst_stop_mid;
@@ -1056,6 +1065,15 @@ static void parse_config_file(const char *cfg_fname)
 				printf("Error: bad parameter \"%s\", integer expected", value);
 				goto prase_cleanup;
 			}
+		} else if (!strncmp(config, "io_engine", 9)) {
+			if (!strncmp(value, "io_uring", 8))
+				io_engine = IO_ENGINE_URING;
+			else if (!strncmp(value, "aio", 3))
+				io_engine = IO_ENGINE_AIO;
+			else {
+				printf("Error: unknown io_engine \"%s\", aio or io_uring expected", value);
+				goto prase_cleanup;
+			}
 		} else if (!strncmp(config, "vf_perf", 7)) {
 			char *p;
 
@@ -1752,7 +1770,8 @@ static void io_proc_cleanup(struct io_info *_info)
 	int reg_value = 0;
 
 	*io_exit = 1;
-	pthread_join(_info->evt_id, NULL);
+	if (io_engine == IO_ENGINE_AIO)
+		pthread_join(_info->evt_id, NULL);
 
 	q_offset = (_info->dir == Q_DIR_H2C) ? 0 : num_q;
 	if (dir != Q_DIR_BI)
@@ -1854,6 +1873,232 @@ static void io_proc_cleanup(struct io_info *_info)
 	mempool_free(&datahandle);
 }
 
+/*
+ * io_uring engine: every buffer is an IORING_OP_URING_CMD on the queue
+ * character device, a burst of them is handed to the kernel with one
+ * io_uring_enter() so the driver rings the doorbell once for the burst.
+ * Completions are reaped from the same thread, no event thread needed.
+ */
+#define URING_ENTRIES	256
+
+struct uring {
+	int fd;
+	unsigned int *sq_head;
+	unsigned int *sq_tail;
+	unsigned int *sq_mask;
+	unsigned int *sq_array;
+	unsigned int *cq_head;
+	unsigned int *cq_tail;
+	unsigned int *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sq_ptr;
+	void *cq_ptr;
+	size_t sq_sz;
+	size_t cq_sz;
+	size_t sqes_sz;
+	unsigned int sq_entries;
+	unsigned int to_submit;
+	int fixed;
+};
+
+static int uring_init(struct uring *r, unsigned int entries)
+{
+	struct io_uring_params p;
+
+	memset(r, 0, sizeof(*r));
+	memset(&p, 0, sizeof(p));
+	/* the qdma_cdev_uring_cmd payload needs the big sqes */
+	p.flags = IORING_SETUP_SQE128;
+	r->fd = syscall(__NR_io_uring_setup, entries, &p);
+	if (r->fd < 0)
+		return -errno;
+
+	r->sq_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	r->cq_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	r->sqes_sz = p.sq_entries * 2 * sizeof(struct io_uring_sqe);
+	r->sq_ptr = mmap(NULL, r->sq_sz, PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	r->cq_ptr = mmap(NULL, r->cq_sz, PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+	r->sqes = mmap(NULL, r->sqes_sz, PROT_READ | PROT_WRITE,
+		       MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if (r->sq_ptr == MAP_FAILED || r->cq_ptr == MAP_FAILED ||
+	    r->sqes == MAP_FAILED) {
+		close(r->fd);
+		return -ENOMEM;
+	}
+
+	r->sq_head = r->sq_ptr + p.sq_off.head;
+	r->sq_tail = r->sq_ptr + p.sq_off.tail;
+	r->sq_mask = r->sq_ptr + p.sq_off.ring_mask;
+	r->sq_array = r->sq_ptr + p.sq_off.array;
+	r->cq_head = r->cq_ptr + p.cq_off.head;
+	r->cq_tail = r->cq_ptr + p.cq_off.tail;
+	r->cq_mask = r->cq_ptr + p.cq_off.ring_mask;
+	r->cqes = r->cq_ptr + p.cq_off.cqes;
+	r->sq_entries = p.sq_entries;
+
+	return 0;
+}
+
+static void uring_exit(struct uring *r)
+{
+	munmap(r->sqes, r->sqes_sz);
+	munmap(r->cq_ptr, r->cq_sz);
+	munmap(r->sq_ptr, r->sq_sz);
+	close(r->fd);
+}
+
+/* register the data mempool, requests on it then skip the page pinning */
+static void uring_register_mempool(struct uring *r, struct mempool_handle *mpool)
+{
+	struct iovec iov;
+
+	iov.iov_base = mpool->mempool;
+	iov.iov_len = (size_t)mpool->total_memblks * mpool->mempool_blksz;
+	if (syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_BUFFERS,
+		    &iov, 1) == 0)
+		r->fixed = 1;
+	else
+		printf("io_uring: buffer registration failed %d, using unregistered buffers\n",
+		       errno);
+}
+
+static int uring_queue_cmd(struct uring *r, struct io_info *_info, void *buf,
+			   unsigned int len)
+{
+	unsigned int tail = *r->sq_tail + r->to_submit;
+	unsigned int idx = tail & *r->sq_mask;
+	struct io_uring_sqe *sqe = &r->sqes[idx * 2];
+	struct qdma_cdev_uring_cmd *cmd = (struct qdma_cdev_uring_cmd *)sqe->cmd;
+
+	if (tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) >= r->sq_entries)
+		return -EBUSY;
+
+	memset(sqe, 0, 2 * sizeof(*sqe));
+	sqe->opcode = IORING_OP_URING_CMD;
+	sqe->fd = _info->fd;
+	sqe->cmd_op = (_info->dir == Q_DIR_H2C) ? QDMA_CDEV_URING_CMD_WRITE :
+						   QDMA_CDEV_URING_CMD_READ;
+	sqe->user_data = (unsigned long)buf;
+	if (r->fixed) {
+		sqe->uring_cmd_flags = IORING_URING_CMD_FIXED;
+		sqe->buf_index = 0;
+	}
+	cmd->addr = (unsigned long)buf;
+	cmd->ep_addr = _info->offset;
+	cmd->len = len;
+	r->sq_array[idx] = idx;
+	r->to_submit++;
+
+	return 0;
+}
+
+static int uring_submit(struct uring *r, unsigned int wait_nr)
+{
+	unsigned int to_submit = r->to_submit;
+	int ret;
+
+	__atomic_store_n(r->sq_tail, *r->sq_tail + to_submit, __ATOMIC_RELEASE);
+	r->to_submit = 0;
+	ret = syscall(__NR_io_uring_enter, r->fd, to_submit, wait_nr,
+		      wait_nr ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+	if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+		return -errno;
+
+	return 0;
+}
+
+static unsigned int uring_reap(struct uring *r, struct io_info *_info)
+{
+	unsigned int head = *r->cq_head;
+	unsigned int tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+	unsigned int cnt = 0;
+
+	for (; head != tail; head++, cnt++) {
+		struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+
+		if (cqe->res >= 0)
+			_info->num_req_completed++;
+		else
+			printf("Error: io_uring cmd failed %d on %s\n", cqe->res,
+			       _info->q_name);
+		dma_free(&datahandle, (void *)(unsigned long)cqe->user_data);
+	}
+	__atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+
+	return cnt;
+}
+
+static void io_uring_run(struct io_info *_info, unsigned int io_sz,
+			 unsigned int burst_cnt, unsigned int num_desc,
+			 unsigned int max_reqs)
+{
+	struct uring r;
+	unsigned int inflight = 0;
+	unsigned int retry;
+	int ret;
+
+	ret = uring_init(&r, URING_ENTRIES);
+	if (ret < 0) {
+		printf("Error: io_uring setup error %d on %u\n", ret, _info->thread_id);
+		return;
+	}
+	uring_register_mempool(&r, &datahandle);
+
+	do {
+		struct timespec ts_cur;
+		unsigned int i;
+
+		if (tsecs) {
+			if (clock_gettime(CLOCK_MONOTONIC, &ts_cur) != 0)
+				break;
+			timespec_sub(&ts_cur, &g_ts_start);
+			if (ts_cur.tv_sec >= tsecs)
+				break;
+		}
+
+		for (i = 0; i < burst_cnt; i++) {
+			void *buf;
+
+			if (((inflight + 1) * num_desc) > max_reqs)
+				break;
+			buf = dma_memalloc(&datahandle, 1);
+			if (!buf)
+				break;
+			if (uring_queue_cmd(&r, _info, buf, io_sz) < 0) {
+				dma_free(&datahandle, buf);
+				break;
+			}
+			inflight++;
+			_info->num_req_submitted++;
+		}
+
+		/* whole burst in one syscall, wait only if nothing was queued */
+		ret = uring_submit(&r, i ? 0 : 1);
+		if (ret < 0) {
+			printf("Error: io_uring_enter error:%d on %s\n", ret, _info->q_name);
+			break;
+		}
+		inflight -= uring_reap(&r, _info);
+	} while (tsecs && !force_exit);
+
+	/* drain what is still in flight, bounded like thread_exit_check() */
+	for (retry = 0; inflight && retry < 10000; retry++) {
+		unsigned int cnt = uring_reap(&r, _info);
+
+		inflight -= cnt;
+		if (!cnt)
+			usleep(100);
+	}
+	if (inflight)
+		printf("Exit Check: tid =%u, %u io_uring cmds still in flight\n",
+		       _info->thread_id, inflight);
+
+	uring_exit(&r);
+}
+
 static void *io_thread(void *argp)
 {
 	struct io_info *_info = (struct io_info *)argp;
@@ -1882,6 +2127,12 @@ static void *io_thread(void *argp)
 	datahandle.id = 0;
 	iocbhandle.id = 2;
 #endif
+	if (io_engine == IO_ENGINE_URING) {
+		io_uring_run(_info, io_sz, burst_cnt, num_desc, max_reqs);
+		io_proc_cleanup(_info);
+		return NULL;
+	}
+
 	s = pthread_attr_init(&attr);
 	if (s != 0)
 		printf("pthread_attr_init failed\n");
@@ -0,0 +1,1129 @@
+/*
+ * This file is part of the QDMA userspace application
+ * to enable the user to execute the QDMA functionality
+ *
+ * Copyright (c) 2018-2022, Xilinx, Inc. All rights reserved.
+ * Copyright (c) 2022-2024, Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * This source code is licensed under BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <getopt.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+#include <stdbool.h>
+#include "qdma_platform.h"
+#include "qdma_sim.h"
+#include "version.h"
+
+/* kernel primitives used by the libqdma submission ring */
+#define READ_ONCE(x)		__atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define smp_load_acquire(p)	__atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define smp_store_release(p, v)	__atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define cmpxchg(p, o, n) \
+	({ __typeof__(*(p)) __o = (o); \
+	   __atomic_compare_exchange_n(p, &__o, n, 0, __ATOMIC_SEQ_CST, \
+			__ATOMIC_SEQ_CST); \
+	   __o; })
+#define ____cacheline_aligned_in_smp	__attribute__((aligned(64)))
+#include "qdma_req_ring.h"
+
+#define SEC2NSEC		1000000000ULL
+#define DEFAULT_PAGE_SIZE	4096
+
+#define MM_DESC_SZ		32
+#define ST_H2C_DESC_SZ		16
+#define ST_C2H_DESC_SZ		8
+#define CMPT_DESC_SZ		8
+
+/* sw/cmpt context desc_sz encoding */
+#define CTXT_DESC_SZ_8B		0
+#define CTXT_DESC_SZ_16B	1
+#define CTXT_DESC_SZ_32B	2
+
+#define MM_DESC_F_DV		(1U << 28)
+#define MM_DESC_F_SOP		(1U << 29)
+#define MM_DESC_F_EOP		(1U << 30)
+
+#define CMPT_F_COLOR		(1U << 1)
+#define CMPT_LEN_SHIFT		4
+#define CMPT_LEN_MASK		0xFFFFU
+
+enum sim_mode {
+	SIM_MODE_MM,
+	SIM_MODE_ST,
+};
+
+enum sim_dir {
+	SIM_DIR_H2C,
+	SIM_DIR_C2H,
+	SIM_DIR_BI,
+};
+
+struct desc_wb {
+	uint16_t pidx;
+	uint16_t cidx;
+	uint32_t rsvd;
+};
+
+struct mm_desc {
+	uint64_t src_addr;
+	uint32_t flag_len;
+	uint32_t rsvd0;
+	uint64_t dst_addr;
+	uint64_t rsvd1;
+};
+
+struct h2c_desc {
+	uint16_t cdh_flags;
+	uint16_t pld_len;
+	uint16_t len;
+	uint16_t flags;
+	uint64_t src_addr;
+};
+
+struct c2h_desc {
+	uint64_t dst_addr;
+};
+
+/* driver side view of one queue pair */
+struct sim_q {
+	uint16_t qid;
+	/* usable ring entries, the last HW entry holds the status */
+	uint32_t rngsz;
+	uint8_t *ring[2];
+	uint32_t pidx[2];
+	struct desc_wb *wb[2];
+	/* ST C2H */
+	uint32_t bufsz;
+	uint8_t *fl_buf;
+	uint32_t fl_cidx;
+	uint8_t *cmpt_ring;
+	uint32_t cmpt_rngsz;
+	uint32_t cmpt_cidx;
+	uint8_t color;
+	uint64_t rx_pkts;
+	/* payload */
+	uint8_t *buf;
+	uint8_t *rbuf;
+};
+
+struct sim_ctx {
+	struct qdma_sim_dev *sim;
+	struct qdma_hw_access *hw;
+	struct sim_q *q;
+	enum sim_mode mode;
+	enum sim_dir dir;
+	unsigned int num_q;
+	unsigned int rng_idx;
+	unsigned int bufsz_idx;
+	unsigned int size;
+	unsigned int chunk;
+	unsigned int iter;
+	unsigned int threaded;
+	unsigned int batch;
+	unsigned int producers;
+	unsigned int verify;
+	uint64_t ops;
+	uint64_t bytes;
+	uint64_t fails;
+};
+
+static struct option const long_opts[] = {
+	{"mode", required_argument, NULL, 'm'},
+	{"dir", required_argument, NULL, 'd'},
+	{"queues", required_argument, NULL, 'q'},
+	{"ring", required_argument, NULL, 'r'},
+	{"size", required_argument, NULL, 's'},
+	{"chunk", required_argument, NULL, 'c'},
+	{"iter", required_argument, NULL, 'n'},
+	{"ip", required_argument, NULL, 'i'},
+	{"threaded", no_argument, NULL, 't'},
+	{"batch", no_argument, NULL, 'b'},
+	{"producers", required_argument, NULL, 'p'},
+	{"no-verify", no_argument, NULL, 'x'},
+	{"verbose", no_argument, NULL, 'v'},
+	{"help", no_argument, NULL, 'h'},
+	{0, 0, 0, 0}
+};
+
+static void usage(const char *name)
+{
+	fprintf(stdout, "%s v%s\n%s\n\n", PROGNAME, VERSION, COPYRIGHT);
+	fprintf(stdout, "usage: %s [OPTIONS]\n\n", name);
+	fprintf(stdout, "Run QDMA queues against the software device model.\n\n");
+	fprintf(stdout, "  -m (--mode) mm|st, default mm\n");
+	fprintf(stdout, "  -d (--dir) h2c|c2h|bi, default bi\n");
+	fprintf(stdout,
+		"     mm bi writes the card memory and reads it back,\n"
+		"     st bi loops ST H2C packets back to ST C2H and\n"
+		"     st c2h uses the device traffic generator\n");
+	fprintf(stdout, "  -q (--queues) number of queues, default 1\n");
+	fprintf(stdout, "  -r (--ring) ring size index, default 0 (2048)\n");
+	fprintf(stdout, "  -s (--size) transfer/packet size, default 4096\n");
+	fprintf(stdout, "  -c (--chunk) MM bytes per descriptor, default 4096\n");
+	fprintf(stdout, "  -n (--iter) iterations per queue, default 1000\n");
+	fprintf(stdout, "  -i (--ip) qdma|eqdma, default qdma\n");
+	fprintf(stdout, "  -t (--threaded) run the device engine in a thread\n");
+	fprintf(stdout,
+		"  -b (--batch) program all queue contexts in one batch\n");
+	fprintf(stdout,
+		"  -p (--producers) submission benchmark, MM H2C requests\n"
+		"     from 1..N threads sharing queue 0, lock vs ring\n");
+	fprintf(stdout, "  -x (--no-verify) skip data verification\n");
+	fprintf(stdout, "  -v (--verbose) enable qdma_access logs\n");
+	fprintf(stdout, "  -h (--help) print usage help and exit\n");
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * SEC2NSEC + ts.tv_nsec;
+}
+
+static void *zalloc_aligned(size_t size)
+{
+	void *p = NULL;
+
+	if (posix_memalign(&p, DEFAULT_PAGE_SIZE, size))
+		return NULL;
+	memset(p, 0, size);
+	return p;
+}
+
+static inline uint32_t ring_next(uint32_t idx, uint32_t rngsz)
+{
+	return (++idx == rngsz) ? 0 : idx;
+}
+
+static inline uint32_t ring_avail(uint32_t pidx, uint32_t cidx,
+		uint32_t rngsz)
+{
+	/* one slot is kept empty to tell full from empty */
+	return (cidx > pidx) ? cidx - pidx - 1 : rngsz - pidx + cidx - 1;
+}
+
+static void dev_wait(struct sim_ctx *ctx)
+{
+	if (ctx->threaded)
+		sched_yield();
+	else
+		qdma_sim_poll(ctx->sim);
+}
+
+static void q_pidx_update(struct sim_ctx *ctx, struct sim_q *q, int c2h)
+{
+	struct qdma_q_pidx_reg_info reg_info;
+
+	memset(&reg_info, 0, sizeof(reg_info));
+	reg_info.pidx = q->pidx[c2h];
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	ctx->hw->qdma_queue_pidx_update(ctx->sim, 0, q->qid, c2h, &reg_info);
+}
+
+static void q_cmpt_cidx_update(struct sim_ctx *ctx, struct sim_q *q)
+{
+	struct qdma_q_cmpt_cidx_reg_info reg_info;
+
+	memset(&reg_info, 0, sizeof(reg_info));
+	reg_info.wrb_cidx = q->cmpt_cidx;
+	reg_info.trig_mode = QDMA_CMPT_UPDATE_TRIG_MODE_EVERY;
+	reg_info.wrb_en = 1;
+	ctx->hw->qdma_queue_cmpt_cidx_update(ctx->sim, 0, q->qid, &reg_info);
+}
+
+static uint32_t q_hw_cidx(struct sim_q *q, int c2h)
+{
+	return __atomic_load_n(&q->wb[c2h]->cidx, __ATOMIC_ACQUIRE);
+}
+
+static void q_context_fill(struct sim_ctx *ctx, struct sim_q *q, int c2h,
+		struct qdma_descq_context *c)
+{
+	int st = (ctx->mode == SIM_MODE_ST);
+	struct qdma_descq_sw_ctxt *sw = &c->sw_ctxt;
+	struct qdma_descq_prefetch_ctxt *pfetch = &c->pfetch_ctxt;
+	struct qdma_descq_cmpt_ctxt *cmpt = &c->cmpt_ctxt;
+
+	memset(c, 0, sizeof(*c));
+	sw->ring_bs_addr = (uintptr_t)q->ring[c2h];
+	sw->rngsz_idx = ctx->rng_idx;
+	sw->wbk_en = 1;
+	sw->is_mm = !st;
+	sw->qen = 1;
+	sw->fetch_max = 0;
+	if (!st) {
+		sw->desc_sz = CTXT_DESC_SZ_32B;
+		sw->mrkr_dis = 1;
+	} else if (c2h) {
+		sw->desc_sz = CTXT_DESC_SZ_8B;
+		sw->wbk_en = 0;
+	} else {
+		sw->desc_sz = CTXT_DESC_SZ_16B;
+		sw->mrkr_dis = 1;
+	}
+
+	if (!(st && c2h))
+		return;
+
+	pfetch->valid = 1;
+	pfetch->bufsz_idx = ctx->bufsz_idx;
+
+	cmpt->lower_dword.bit.en_stat_desc = 1;
+	cmpt->lower_dword.bit.trig_mode = QDMA_CMPT_UPDATE_TRIG_MODE_EVERY;
+	cmpt->lower_dword.bit.color = 1;
+	cmpt->lower_dword.bit.ringsz_idx = ctx->rng_idx;
+	cmpt->bs_addr = (uintptr_t)q->cmpt_ring;
+	cmpt->higher_dword.bit.desc_sz = CTXT_DESC_SZ_8B;
+	cmpt->higher_dword.bit.valid = 1;
+	cmpt->higher_dword.bit.dir_c2h = 1;
+}
+
+static int q_context_program(struct sim_ctx *ctx, struct sim_q *q, int c2h)
+{
+	struct qdma_hw_access *hw = ctx->hw;
+	int st = (ctx->mode == SIM_MODE_ST);
+	struct qdma_descq_context c;
+	int rv;
+
+	/* always clear first */
+	hw->qdma_sw_ctx_conf(ctx->sim, c2h, q->qid, NULL,
+			QDMA_HW_ACCESS_CLEAR);
+	hw->qdma_hw_ctx_conf(ctx->sim, c2h, q->qid, NULL,
+			QDMA_HW_ACCESS_CLEAR);
+	hw->qdma_credit_ctx_conf(ctx->sim, c2h, q->qid, NULL,
+			QDMA_HW_ACCESS_CLEAR);
+	if (st && c2h) {
+		hw->qdma_pfetch_ctx_conf(ctx->sim, q->qid, NULL,
+				QDMA_HW_ACCESS_CLEAR);
+		hw->qdma_cmpt_ctx_conf(ctx->sim, q->qid, NULL,
+				QDMA_HW_ACCESS_CLEAR);
+	}
+
+	q_context_fill(ctx, q, c2h, &c);
+	rv = hw->qdma_sw_ctx_conf(ctx->sim, c2h, q->qid, &c.sw_ctxt,
+			QDMA_HW_ACCESS_WRITE);
+	if (rv < 0)
+		return rv;
+
+	if (!(st && c2h))
+		return 0;
+
+	rv = hw->qdma_pfetch_ctx_conf(ctx->sim, q->qid, &c.pfetch_ctxt,
+			QDMA_HW_ACCESS_WRITE);
+	if (rv < 0)
+		return rv;
+
+	return hw->qdma_cmpt_ctx_conf(ctx->sim, q->qid, &c.cmpt_ctxt,
+			QDMA_HW_ACCESS_WRITE);
+}
+
+/* program the contexts of all queues with one batch */
+static int q_context_program_batch(struct sim_ctx *ctx)
+{
+	struct qdma_descq_ctxt_prog *list;
+	struct qdma_descq_context *c;
+	unsigned int i, n = ctx->num_q * 2;
+	int rv;
+
+	list = calloc(n, sizeof(*list));
+	c = calloc(n, sizeof(*c));
+	if (!list || !c) {
+		rv = -ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < n; i++) {
+		struct sim_q *q = &ctx->q[i / 2];
+		int c2h = i & 1;
+
+		q_context_fill(ctx, q, c2h, &c[i]);
+		list[i].hw_qid = q->qid;
+		list[i].st = (ctx->mode == SIM_MODE_ST);
+		list[i].q_type = c2h ? QDMA_DEV_Q_TYPE_C2H :
+				QDMA_DEV_Q_TYPE_H2C;
+		list[i].ctxt = &c[i];
+	}
+
+	rv = ctx->hw->qdma_queue_ctxt_prog_batch(ctx->sim, list, n);
+
+out:
+	free(c);
+	free(list);
+	return rv;
+}
+
+static void q_start(struct sim_ctx *ctx, struct sim_q *q)
+{
+	if (ctx->mode != SIM_MODE_ST)
+		return;
+
+	/* hand the whole free list to the device */
+	q->pidx[1] = q->rngsz - 1;
+	q_pidx_update(ctx, q, 1);
+	q_cmpt_cidx_update(ctx, q);
+}
+
+static int q_setup(struct sim_ctx *ctx, struct sim_q *q, uint16_t qid)
+{
+	uint32_t csr_rngsz[QDMA_NUM_RING_SIZES];
+	uint32_t csr_bufsz[QDMA_NUM_C2H_BUFFER_SIZES];
+	int st = (ctx->mode == SIM_MODE_ST);
+	uint32_t i;
+	int rv;
+
+	ctx->hw->qdma_global_csr_conf(ctx->sim, 0, QDMA_NUM_RING_SIZES,
+			csr_rngsz, QDMA_CSR_RING_SZ, QDMA_HW_ACCESS_READ);
+	ctx->hw->qdma_global_csr_conf(ctx->sim, 0, QDMA_NUM_C2H_BUFFER_SIZES,
+			csr_bufsz, QDMA_CSR_BUF_SZ, QDMA_HW_ACCESS_READ);
+
+	q->qid = qid;
+	q->rngsz = csr_rngsz[ctx->rng_idx] - 1;
+	q->ring[0] = zalloc_aligned((size_t)csr_rngsz[ctx->rng_idx] *
+			(st ? ST_H2C_DESC_SZ : MM_DESC_SZ));
+	q->ring[1] = zalloc_aligned((size_t)csr_rngsz[ctx->rng_idx] *
+			(st ? ST_C2H_DESC_SZ : MM_DESC_SZ));
+	q->buf = zalloc_aligned(ctx->size);
+	q->rbuf = zalloc_aligned(ctx->size);
+	if (!q->ring[0] || !q->ring[1] || !q->buf || !q->rbuf)
+		return -ENOMEM;
+	q->wb[0] = (struct desc_wb *)(q->ring[0] + (size_t)q->rngsz *
+			(st ? ST_H2C_DESC_SZ : MM_DESC_SZ));
+	q->wb[1] = (struct desc_wb *)(q->ring[1] + (size_t)q->rngsz *
+			(st ? ST_C2H_DESC_SZ : MM_DESC_SZ));
+
+	for (i = 0; i < ctx->size; i++)
+		q->buf[i] = (uint8_t)(qid + i);
+
+	if (st) {
+		q->bufsz = csr_bufsz[ctx->bufsz_idx];
+		q->cmpt_rngsz = q->rngsz;
+		q->cmpt_ring = zalloc_aligned((size_t)(q->cmpt_rngsz + 1) *
+				CMPT_DESC_SZ);
+		q->fl_buf = zalloc_aligned((size_t)q->rngsz * q->bufsz);
+		if (!q->cmpt_ring || !q->fl_buf)
+			return -ENOMEM;
+		q->color = 1;
+		for (i = 0; i < q->rngsz; i++) {
+			struct c2h_desc *d = (struct c2h_desc *)q->ring[1] + i;
+
+			d->dst_addr = (uintptr_t)(q->fl_buf +
+					(size_t)i * q->bufsz);
+		}
+	}
+
+	if (ctx->batch)
+		return 0;
+
+	rv = q_context_program(ctx, q, 0);
+	if (rv < 0)
+		return rv;
+	rv = q_context_program(ctx, q, 1);
+	if (rv < 0)
+		return rv;
+
+	q_start(ctx, q);
+
+	return 0;
+}
+
+static void q_cleanup(struct sim_q *q)
+{
+	free(q->ring[0]);
+	free(q->ring[1]);
+	free(q->cmpt_ring);
+	free(q->fl_buf);
+	free(q->buf);
+	free(q->rbuf);
+}
+
+static void mm_xfer(struct sim_ctx *ctx, struct sim_q *q, int c2h,
+		uint8_t *host, uint64_t card, uint32_t len)
+{
+	uint32_t off = 0;
+
+	while (off < len) {
+		uint32_t cidx = q_hw_cidx(q, c2h);
+		uint32_t avail = ring_avail(q->pidx[c2h], cidx, q->rngsz);
+
+		if (!avail) {
+			dev_wait(ctx);
+			continue;
+		}
+
+		while (avail-- && off < len) {
+			struct mm_desc *d = (struct mm_desc *)q->ring[c2h] +
+					q->pidx[c2h];
+			uint32_t n = len - off;
+
+			if (n > ctx->chunk)
+				n = ctx->chunk;
+			if (c2h) {
+				d->src_addr = card + off;
+				d->dst_addr = (uintptr_t)(host + off);
+			} else {
+				d->src_addr = (uintptr_t)(host + off);
+				d->dst_addr = card + off;
+			}
+			d->flag_len = n | MM_DESC_F_DV;
+			if (!off)
+				d->flag_len |= MM_DESC_F_SOP;
+			off += n;
+			if (off == len)
+				d->flag_len |= MM_DESC_F_EOP;
+			q->pidx[c2h] = ring_next(q->pidx[c2h], q->rngsz);
+		}
+		q_pidx_update(ctx, q, c2h);
+	}
+
+	while (q_hw_cidx(q, c2h) != q->pidx[c2h])
+		dev_wait(ctx);
+}
+
+static int st_c2h_drain(struct sim_ctx *ctx, struct sim_q *q)
+{
+	uint32_t nbufs = 0;
+	int pkts = 0;
+
+	while (1) {
+		uint32_t *ent = (uint32_t *)(q->cmpt_ring +
+				(size_t)q->cmpt_cidx * CMPT_DESC_SZ);
+		uint32_t dw0 = __atomic_load_n(&ent[0], __ATOMIC_ACQUIRE);
+		uint32_t len, off = 0;
+
+		if (!!(dw0 & CMPT_F_COLOR) != q->color)
+			break;
+
+		len = (dw0 >> CMPT_LEN_SHIFT) & CMPT_LEN_MASK;
+		do {
+			uint8_t *b = q->fl_buf + (size_t)q->fl_cidx * q->bufsz;
+			uint32_t n = len - off;
+
+			if (n > q->bufsz)
+				n = q->bufsz;
+			if (ctx->verify && off + n <= ctx->size)
+				memcpy(q->rbuf + off, b, n);
+			off += n;
+			nbufs++;
+			q->fl_cidx = ring_next(q->fl_cidx, q->rngsz);
+		} while (off < len);
+
+		if (ctx->verify) {
+			int bad = (len != ctx->size);
+			uint32_t i;
+
+			if (!bad && ctx->dir == SIM_DIR_BI)
+				bad = memcmp(q->rbuf, q->buf, len);
+			for (i = 0; !bad && ctx->dir != SIM_DIR_BI && i < len;
+					i++)
+				bad = q->rbuf[i] != (uint8_t)(ent[1] + i);
+			if (bad)
+				ctx->fails++;
+		}
+
+		q->cmpt_cidx = ring_next(q->cmpt_cidx, q->cmpt_rngsz);
+		if (!q->cmpt_cidx)
+			q->color ^= 1;
+		q->rx_pkts++;
+		pkts++;
+	}
+
+	if (pkts) {
+		/* recycle the consumed buffers and release the entries */
+		q->pidx[1] = (q->pidx[1] + nbufs) % q->rngsz;
+		q_pidx_update(ctx, q, 1);
+		q_cmpt_cidx_update(ctx, q);
+	}
+
+	return pkts;
+}
+
+static void st_h2c_send(struct sim_ctx *ctx, struct sim_q *q,
+		unsigned int npkts)
+{
+	while (npkts) {
+		uint32_t cidx = q_hw_cidx(q, 0);
+		uint32_t avail = ring_avail(q->pidx[0], cidx, q->rngsz);
+
+		if (ctx->dir == SIM_DIR_BI)
+			st_c2h_drain(ctx, q);
+		if (!avail) {
+			dev_wait(ctx);
+			continue;
+		}
+
+		while (avail-- && npkts) {
+			struct h2c_desc *d = (struct h2c_desc *)q->ring[0] +
+					q->pidx[0];
+
+			d->src_addr = (uintptr_t)q->buf;
+			d->len = ctx->size;
+			d->pld_len = ctx->size;
+			d->flags = 0;
+			q->pidx[0] = ring_next(q->pidx[0], q->rngsz);
+			npkts--;
+		}
+		q_pidx_update(ctx, q, 0);
+	}
+
+	while (q_hw_cidx(q, 0) != q->pidx[0]) {
+		if (ctx->dir == SIM_DIR_BI)
+			st_c2h_drain(ctx, q);
+		dev_wait(ctx);
+	}
+}
+
+static void run_mm(struct sim_ctx *ctx)
+{
+	unsigned int i, k;
+
+	for (k = 0; k < ctx->iter; k++) {
+		for (i = 0; i < ctx->num_q; i++) {
+			struct sim_q *q = &ctx->q[i];
+			uint64_t card = (uint64_t)i * ctx->size;
+
+			if (ctx->dir != SIM_DIR_C2H) {
+				mm_xfer(ctx, q, 0, q->buf, card, ctx->size);
+				ctx->ops++;
+				ctx->bytes += ctx->size;
+			}
+			if (ctx->dir != SIM_DIR_H2C) {
+				mm_xfer(ctx, q, 1, q->rbuf, card, ctx->size);
+				ctx->ops++;
+				ctx->bytes += ctx->size;
+				if (ctx->verify && ctx->dir == SIM_DIR_BI &&
+						memcmp(q->buf, q->rbuf,
+							ctx->size))
+					ctx->fails++;
+			}
+		}
+	}
+}
+
+static void run_st(struct sim_ctx *ctx)
+{
+	unsigned int i;
+	int pending = 1;
+
+	for (i = 0; i < ctx->num_q; i++) {
+		struct sim_q *q = &ctx->q[i];
+
+		if (ctx->dir == SIM_DIR_C2H)
+			qdma_sim_c2h_gen(ctx->sim, q->qid, ctx->size,
+					ctx->iter);
+		else
+			st_h2c_send(ctx, q, ctx->iter);
+	}
+
+	while (pending && ctx->dir != SIM_DIR_H2C) {
+		pending = 0;
+		for (i = 0; i < ctx->num_q; i++) {
+			struct sim_q *q = &ctx->q[i];
+
+			st_c2h_drain(ctx, q);
+			if (q->rx_pkts < ctx->iter)
+				pending = 1;
+		}
+		if (pending)
+			dev_wait(ctx);
+	}
+
+	ctx->ops = (uint64_t)ctx->num_q * ctx->iter;
+	if (ctx->dir == SIM_DIR_BI)
+		ctx->ops *= 2;
+	ctx->bytes = ctx->ops * ctx->size;
+}
+
+/*
+ * submission benchmark: producer threads share one MM H2C queue the way
+ * libqdma submitters share a descq. The "lock" scheme adds to the work
+ * list under the queue lock and processes it, like qdma_request_submit()
+ * used to. The "ring" scheme publishes on the libqdma submission ring and
+ * only one submitter at a time processes it. A completion thread reaps
+ * the queue concurrently, like the libqdma completion thread.
+ */
+#define SUBQ_WINDOW		32
+
+struct subq_req {
+	struct subq_req *next;
+	uint64_t card;
+	uint8_t *buf;
+	uint32_t len;
+	uint32_t ndesc;
+	unsigned int *done;
+};
+
+struct subq {
+	struct sim_ctx *ctx;
+	struct sim_q *q;
+	int use_ring;
+	/* descq lock, protects everything below up to the ring */
+	pthread_spinlock_t lock;
+	struct subq_req *work;
+	struct subq_req **work_tail;
+	struct subq_req *pend;
+	struct subq_req **pend_tail;
+	uint32_t cidx;
+	uint32_t credit;
+	struct qdma_req_ring ring;
+	int proc_busy;
+	int stop;
+	uint64_t lock_procs;
+};
+
+struct subq_producer {
+	pthread_t thread;
+	struct subq *sq;
+	struct subq_req req[SUBQ_WINDOW];
+	unsigned int submitted;
+	unsigned int done;
+};
+
+static void subq_list_add(struct subq_req ***tail, struct subq_req *req)
+{
+	req->next = NULL;
+	**tail = req;
+	*tail = &req->next;
+}
+
+/* descq_mm_proc_request() counterpart, called with the lock held */
+static void subq_proc(struct subq *sq)
+{
+	struct sim_ctx *ctx = sq->ctx;
+	struct sim_q *q = sq->q;
+	uint32_t cidx = q_hw_cidx(q, 0);
+	uint32_t avail, written = 0;
+	struct subq_req *req;
+
+	sq->lock_procs++;
+
+	/* complete requests */
+	sq->credit += (cidx >= sq->cidx) ? cidx - sq->cidx :
+			q->rngsz - sq->cidx + cidx;
+	sq->cidx = cidx;
+	while ((req = sq->pend) && sq->credit >= req->ndesc) {
+		sq->credit -= req->ndesc;
+		sq->pend = req->next;
+		if (!sq->pend)
+			sq->pend_tail = &sq->pend;
+		__atomic_add_fetch(req->done, 1, __ATOMIC_RELEASE);
+	}
+
+	while ((req = qdma_req_ring_dequeue(&sq->ring)))
+		subq_list_add(&sq->work_tail, req);
+
+	avail = ring_avail(q->pidx[0], cidx, q->rngsz);
+	while ((req = sq->work) && avail >= req->ndesc) {
+		uint32_t off = 0;
+
+		while (off < req->len) {
+			struct mm_desc *d = (struct mm_desc *)q->ring[0] +
+					q->pidx[0];
+			uint32_t n = req->len - off;
+
+			if (n > ctx->chunk)
+				n = ctx->chunk;
+			d->src_addr = (uintptr_t)(req->buf + off);
+			d->dst_addr = req->card + off;
+			d->flag_len = n | MM_DESC_F_DV;
+			if (!off)
+				d->flag_len |= MM_DESC_F_SOP;
+			off += n;
+			if (off == req->len)
+				d->flag_len |= MM_DESC_F_EOP;
+			q->pidx[0] = ring_next(q->pidx[0], q->rngsz);
+		}
+		avail -= req->ndesc;
+		written += req->ndesc;
+		sq->work = req->next;
+		if (!sq->work)
+			sq->work_tail = &sq->work;
+		subq_list_add(&sq->pend_tail, req);
+	}
+
+	if (written)
+		q_pidx_update(ctx, q, 0);
+}
+
+static void subq_proc_locked(struct subq *sq)
+{
+	pthread_spin_lock(&sq->lock);
+	subq_proc(sq);
+	pthread_spin_unlock(&sq->lock);
+}
+
+/* qdma_descq_submit_request() + qdma_descq_proc_submitted() */
+static void subq_submit_ring(struct subq *sq, struct subq_req *req)
+{
+	struct subq_req *r;
+
+	while (qdma_req_ring_enqueue(&sq->ring, req)) {
+		int rv;
+
+		/* ring full, flush it so that the request order is kept */
+		pthread_spin_lock(&sq->lock);
+		while ((r = qdma_req_ring_dequeue(&sq->ring)))
+			subq_list_add(&sq->work_tail, r);
+		/* a claimed slot not published yet has to stay ahead */
+		if (READ_ONCE(sq->ring.prod) == sq->ring.cons) {
+			subq_list_add(&sq->work_tail, req);
+			pthread_spin_unlock(&sq->lock);
+			break;
+		}
+		rv = qdma_req_ring_enqueue(&sq->ring, req);
+		pthread_spin_unlock(&sq->lock);
+		if (!rv)
+			break;
+	}
+
+	while (!__atomic_exchange_n(&sq->proc_busy, 1, __ATOMIC_SEQ_CST)) {
+		subq_proc_locked(sq);
+		__atomic_store_n(&sq->proc_busy, 0, __ATOMIC_SEQ_CST);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if (qdma_req_ring_empty(&sq->ring))
+			break;
+	}
+}
+
+static void subq_submit_lock(struct subq *sq, struct subq_req *req)
+{
+	pthread_spin_lock(&sq->lock);
+	subq_list_add(&sq->work_tail, req);
+	pthread_spin_unlock(&sq->lock);
+
+	subq_proc_locked(sq);
+}
+
+static void *subq_producer_run(void *arg)
+{
+	struct subq_producer *p = arg;
+	struct subq *sq = p->sq;
+	unsigned int iter = sq->ctx->iter;
+	struct subq_req *req;
+
+	while (p->submitted < iter) {
+		if (p->submitted - __atomic_load_n(&p->done,
+				__ATOMIC_ACQUIRE) >= SUBQ_WINDOW) {
+			sched_yield();
+			continue;
+		}
+		req = &p->req[p->submitted % SUBQ_WINDOW];
+		if (sq->use_ring)
+			subq_submit_ring(sq, req);
+		else
+			subq_submit_lock(sq, req);
+		p->submitted++;
+	}
+
+	while (__atomic_load_n(&p->done, __ATOMIC_ACQUIRE) < iter)
+		sched_yield();
+
+	return NULL;
+}
+
+/* libqdma completion thread counterpart */
+static void *subq_cmpl_run(void *arg)
+{
+	struct subq *sq = arg;
+
+	while (!__atomic_load_n(&sq->stop, __ATOMIC_ACQUIRE)) {
+		subq_proc_locked(sq);
+		sched_yield();
+	}
+
+	return NULL;
+}
+
+static int run_subq_one(struct sim_ctx *ctx, unsigned int num_prod,
+		int use_ring)
+{
+	struct qdma_req_ring_slot slot[QDMA_REQ_RING_SZ];
+	uint32_t ndesc = (ctx->size + ctx->chunk - 1) / ctx->chunk;
+	uint64_t card_sz = QDMA_SIM_CARD_MEM_SZ_DFLT / ctx->size;
+	struct subq_producer *prod;
+	pthread_t cmpl_thread;
+	struct subq sq;
+	uint64_t t0, t1, reqs;
+	unsigned int i, k;
+
+	prod = calloc(num_prod, sizeof(*prod));
+	if (!prod)
+		return -ENOMEM;
+
+	memset(&sq, 0, sizeof(sq));
+	sq.ctx = ctx;
+	sq.q = &ctx->q[0];
+	sq.use_ring = use_ring;
+	sq.work_tail = &sq.work;
+	sq.pend_tail = &sq.pend;
+	sq.cidx = q_hw_cidx(sq.q, 0);
+	pthread_spin_init(&sq.lock, PTHREAD_PROCESS_PRIVATE);
+	qdma_req_ring_init(&sq.ring, slot, QDMA_REQ_RING_SZ);
+
+	for (i = 0; i < num_prod; i++) {
+		prod[i].sq = &sq;
+		for (k = 0; k < SUBQ_WINDOW; k++) {
+			struct subq_req *req = &prod[i].req[k];
+
+			req->buf = sq.q->buf;
+			req->len = ctx->size;
+			req->ndesc = ndesc;
+			req->card = ((i * SUBQ_WINDOW + k) % card_sz) *
+					ctx->size;
+			req->done = &prod[i].done;
+		}
+	}
+
+	t0 = now_ns();
+	pthread_create(&cmpl_thread, NULL, subq_cmpl_run, &sq);
+	for (i = 0; i < num_prod; i++)
+		pthread_create(&prod[i].thread, NULL, subq_producer_run,
+				&prod[i]);
+	for (i = 0; i < num_prod; i++)
+		pthread_join(prod[i].thread, NULL);
+	t1 = now_ns();
+	__atomic_store_n(&sq.stop, 1, __ATOMIC_RELEASE);
+	pthread_join(cmpl_thread, NULL);
+
+	reqs = (uint64_t)num_prod * ctx->iter;
+	printf("subq %s: %u producer(s), %llu reqs in %llu ns, %.3f Mreqs/s, %.2f lock holds/req\n",
+		use_ring ? "ring" : "lock", num_prod,
+		(unsigned long long)reqs, (unsigned long long)(t1 - t0),
+		(double)reqs * 1000 / (t1 - t0),
+		(double)sq.lock_procs / reqs);
+
+	ctx->ops += reqs;
+	ctx->bytes += reqs * ctx->size;
+	pthread_spin_destroy(&sq.lock);
+	free(prod);
+	return 0;
+}
+
+static void run_subq(struct sim_ctx *ctx)
+{
+	unsigned int n;
+
+	for (n = 1; n <= ctx->producers; n++) {
+		run_subq_one(ctx, n, 0);
+		run_subq_one(ctx, n, 1);
+	}
+}
+
+static void print_stats(const char *what, struct qdma_sim_stats *st,
+		uint64_t ops)
+{
+	printf("%s: reg_rd %llu reg_wr %llu ctxt_cmd %llu pidx_db %llu cidx_db %llu\n",
+		what, (unsigned long long)st->reg_rd,
+		(unsigned long long)st->reg_wr,
+		(unsigned long long)st->ctxt_cmd,
+		(unsigned long long)st->pidx_db,
+		(unsigned long long)st->cidx_db);
+	if (!ops)
+		return;
+	printf("%s: per op reg_rd %.3f reg_wr %.3f doorbells %.3f\n",
+		what, (double)st->reg_rd / ops, (double)st->reg_wr / ops,
+		(double)(st->pidx_db + st->cidx_db) / ops);
+}
+
+int main(int argc, char *argv[])
+{
+	struct qdma_sim_conf conf;
+	struct qdma_sim_stats st;
+	struct qdma_fmap_cfg fmap;
+	struct sim_ctx ctx;
+	uint64_t t0, t1;
+	unsigned int i;
+	int cmd_opt;
+	int rv = 0;
+
+	memset(&conf, 0, sizeof(conf));
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.mode = SIM_MODE_MM;
+	ctx.dir = SIM_DIR_BI;
+	ctx.num_q = 1;
+	ctx.size = 4096;
+	ctx.chunk = 4096;
+	ctx.iter = 1000;
+	ctx.verify = 1;
+	conf.ip = QDMA_SIM_IP_QDMA_SOFT;
+
+	while ((cmd_opt = getopt_long(argc, argv, "m:d:q:r:s:c:n:i:tbp:xvh",
+			long_opts, NULL)) != -1) {
+		switch (cmd_opt) {
+		case 'm':
+			ctx.mode = strcmp(optarg, "st") ? SIM_MODE_MM :
+					SIM_MODE_ST;
+			break;
+		case 'd':
+			if (!strcmp(optarg, "h2c"))
+				ctx.dir = SIM_DIR_H2C;
+			else if (!strcmp(optarg, "c2h"))
+				ctx.dir = SIM_DIR_C2H;
+			else
+				ctx.dir = SIM_DIR_BI;
+			break;
+		case 'q':
+			ctx.num_q = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			ctx.rng_idx = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			ctx.size = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			ctx.chunk = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			ctx.iter = strtoul(optarg, NULL, 0);
+			break;
+		case 'i':
+			conf.ip = strcmp(optarg, "eqdma") ?
+				QDMA_SIM_IP_QDMA_SOFT : QDMA_SIM_IP_EQDMA_SOFT;
+			break;
+		case 't':
+			ctx.threaded = 1;
+			break;
+		case 'b':
+			ctx.batch = 1;
+			break;
+		case 'p':
+			ctx.producers = strtoul(optarg, NULL, 0);
+			break;
+		case 'x':
+			ctx.verify = 0;
+			break;
+		case 'v':
+			qdma_sim_log_level = 3;
+			break;
+		default:
+			usage(argv[0]);
+			exit(0);
+			break;
+		}
+	}
+
+	if (ctx.producers) {
+		/* submission benchmark needs the device running on its own */
+		ctx.mode = SIM_MODE_MM;
+		ctx.dir = SIM_DIR_H2C;
+		ctx.threaded = 1;
+		ctx.verify = 0;
+	}
+
+	if (!ctx.num_q || ctx.num_q > QDMA_SIM_MAX_QUEUES ||
+			ctx.rng_idx >= QDMA_NUM_RING_SIZES || !ctx.size ||
+			!ctx.chunk || !ctx.iter) {
+		usage(argv[0]);
+		return -EINVAL;
+	}
+	if (ctx.mode == SIM_MODE_ST && ctx.size > CMPT_LEN_MASK) {
+		fprintf(stderr, "ST packet size must be < 64K\n");
+		return -EINVAL;
+	}
+	if (ctx.mode == SIM_MODE_MM &&
+			(uint64_t)ctx.num_q * ctx.size >
+			QDMA_SIM_CARD_MEM_SZ_DFLT) {
+		fprintf(stderr, "queues * size exceeds the card memory\n");
+		return -EINVAL;
+	}
+
+	conf.num_qs = ctx.num_q;
+	conf.st_loopback = (ctx.mode == SIM_MODE_ST &&
+			ctx.dir == SIM_DIR_BI);
+	ctx.sim = qdma_sim_create(&conf);
+	if (!ctx.sim) {
+		fprintf(stderr, "failed to create the device model\n");
+		return -ENOMEM;
+	}
+	qdma_get_hw_access(ctx.sim, &ctx.hw);
+
+	ctx.q = calloc(ctx.num_q, sizeof(struct sim_q));
+	if (!ctx.q) {
+		rv = -ENOMEM;
+		goto destroy;
+	}
+
+	qdma_sim_stats_clear(ctx.sim);
+	rv = ctx.hw->qdma_set_default_global_csr(ctx.sim);
+	if (rv < 0)
+		goto free_q;
+
+	memset(&fmap, 0, sizeof(fmap));
+	fmap.qmax = ctx.num_q;
+	rv = ctx.hw->qdma_fmap_conf(ctx.sim, 0, &fmap, QDMA_HW_ACCESS_WRITE);
+	if (rv < 0)
+		goto free_q;
+
+	for (i = 0; i < ctx.num_q; i++) {
+		rv = q_setup(&ctx, &ctx.q[i], i);
+		if (rv < 0) {
+			fprintf(stderr, "queue %u setup failed %d\n", i, rv);
+			goto free_q;
+		}
+	}
+	if (ctx.batch) {
+		rv = q_context_program_batch(&ctx);
+		if (rv < 0) {
+			fprintf(stderr, "batch context setup failed %d\n", rv);
+			goto free_q;
+		}
+		for (i = 0; i < ctx.num_q; i++)
+			q_start(&ctx, &ctx.q[i]);
+	}
+	qdma_sim_stats_get(ctx.sim, &st);
+	print_stats("setup", &st, 0);
+
+	if (ctx.threaded) {
+		rv = qdma_sim_start(ctx.sim);
+		if (rv < 0)
+			goto free_q;
+	}
+
+	qdma_sim_stats_clear(ctx.sim);
+	t0 = now_ns();
+	if (ctx.producers)
+		run_subq(&ctx);
+	else if (ctx.mode == SIM_MODE_MM)
+		run_mm(&ctx);
+	else
+		run_st(&ctx);
+	t1 = now_ns();
+	qdma_sim_stop(ctx.sim);
+
+	qdma_sim_stats_get(ctx.sim, &st);
+	printf("%s %s: %u queue(s), %llu ops, %llu bytes in %llu ns, %.2f MB/s, %.2f Mops/s\n",
+		ctx.mode == SIM_MODE_MM ? "mm" : "st",
+		ctx.dir == SIM_DIR_H2C ? "h2c" :
+		ctx.dir == SIM_DIR_C2H ? "c2h" : "bi",
+		ctx.num_q, (unsigned long long)ctx.ops,
+		(unsigned long long)ctx.bytes, (unsigned long long)(t1 - t0),
+		(double)ctx.bytes * 1000 / (t1 - t0),
+		(double)ctx.ops * 1000 / (t1 - t0));
+	print_stats("run", &st, ctx.ops);
+	printf("device: desc %llu pkts %llu cmpt %llu status_wb %llu errors %llu\n",
+		(unsigned long long)st.desc, (unsigned long long)st.pkts,
+		(unsigned long long)st.cmpt, (unsigned long long)st.status_wb,
+		(unsigned long long)st.errors);
+	if (ctx.verify)
+		printf("verify: %llu mismatch(es)\n",
+			(unsigned long long)ctx.fails);
+	if (ctx.fails || st.errors)
+		rv = -EIO;
+
+free_q:
+	for (i = 0; i < ctx.num_q; i++)
+		q_cleanup(&ctx.q[i]);
+	free(ctx.q);
+destroy:
+	qdma_sim_destroy(ctx.sim);
+	return rv;
+}
@@ -0,0 +1,36 @@
+/*
+ * This file is part of the QDMA userspace application
+ * to enable the user to execute the QDMA functionality
+ *
+ * Copyright (c) 2018-2022, Xilinx, Inc. All rights reserved.
+ * Copyright (c) 2022-2024, Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * This source code is licensed under BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree)
+ */
+
+#ifndef __DMA_SIM_QDMA_PLATFORM_ENV_H__
+#define __DMA_SIM_QDMA_PLATFORM_ENV_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define QDMA_SNPRINTF_S(arg1, arg2, arg3, ...) \
+		snprintf(arg1, arg3, ##__VA_ARGS__)
+
+extern int qdma_sim_log_level;
+
+#define QDMA_SIM_LOG(lvl_, x_, ...) \
+	do { \
+		if ((lvl_) <= qdma_sim_log_level) \
+			fprintf(stderr, x_, ##__VA_ARGS__); \
+	} while (0)
+
+#define qdma_log_error(x_, ...) QDMA_SIM_LOG(0, x_, ##__VA_ARGS__)
+#define qdma_log_warning(x_, ...) QDMA_SIM_LOG(1, x_, ##__VA_ARGS__)
+#define qdma_log_info(x_, ...) QDMA_SIM_LOG(2, x_, ##__VA_ARGS__)
+#define qdma_log_debug(x_, ...) QDMA_SIM_LOG(3, x_, ##__VA_ARGS__)
+
+#endif /* __DMA_SIM_QDMA_PLATFORM_ENV_H__ */
@@ -0,0 +1,824 @@
+/*
+ * This file is part of the QDMA userspace application
+ * to enable the user to execute the QDMA functionality
+ *
+ * Copyright (c) 2018-2022, Xilinx, Inc. All rights reserved.
+ * Copyright (c) 2022-2024, Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * This source code is licensed under BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "qdma_sim.h"
+#include "qdma_soft_reg.h"
+
+/* descriptor formats, see libqdma/qdma_regs.h */
+#define SIM_MM_DESC_LEN_MASK		0x0FFFFFFFU
+#define SIM_MM_DESC_F_DV		(1U << 28)
+#define SIM_H2C_DESC_F_SOP		(1U << 1)
+#define SIM_H2C_DESC_F_EOP		(1U << 2)
+
+#define SIM_CMPT_F_COLOR		(1U << 1)
+#define SIM_CMPT_F_DESC_USED		(1U << 3)
+#define SIM_CMPT_LEN_SHIFT		4
+#define SIM_CMPT_LEN_MASK		0xFFFFU
+
+#define SIM_MISC_CAP_VIVADO_SHIFT	24
+#define SIM_MISC_CAP_IP_SHIFT		20
+
+#define SIM_Q_H2C			0
+#define SIM_Q_C2H			1
+
+#define SIM_CTXT_QID_MAX(sim) \
+	((sim)->conf.num_qs > 256 ? (sim)->conf.num_qs : 256)
+
+struct sim_mm_desc {
+	uint64_t src_addr;
+	uint32_t flag_len;
+	uint32_t rsvd0;
+	uint64_t dst_addr;
+	uint64_t rsvd1;
+};
+
+struct sim_h2c_desc {
+	uint16_t cdh_flags;
+	uint16_t pld_len;
+	uint16_t len;
+	uint16_t flags;
+	uint64_t src_addr;
+};
+
+struct sim_c2h_desc {
+	uint64_t dst_addr;
+};
+
+struct sim_cmpl_status {
+	uint16_t pidx;
+	uint16_t cidx;
+	uint32_t color_isr_status;
+};
+
+/* set while the model itself drives qdma_access, keeps stats driver-only */
+static __thread int sim_internal;
+
+#define SIM_STAT_ADD(sim, field, n) \
+	__atomic_fetch_add(&(sim)->stats.field, (n), __ATOMIC_RELAXED)
+
+static inline uint32_t *sim_ctxt_words(struct qdma_sim_dev *sim,
+		uint32_t sel, uint32_t qid)
+{
+	return sim->ctxt + ((sel * SIM_CTXT_QID_MAX(sim)) + qid) *
+			QDMA_IND_CTXT_DATA_NUM_REGS;
+}
+
+static inline uint32_t sim_ring_used(uint32_t pidx, uint32_t cidx,
+		uint32_t size)
+{
+	/* the last ring entry holds the status, indices wrap at size - 1 */
+	return (pidx >= cidx) ? pidx - cidx : (size - 1) - cidx + pidx;
+}
+
+static inline uint32_t sim_ring_next(uint32_t idx, uint32_t size)
+{
+	return (++idx == size - 1) ? 0 : idx;
+}
+
+static void sim_pend_set(struct qdma_sim_dev *sim, uint32_t qid)
+{
+	__atomic_fetch_or(&sim->pend[qid / 64], 1ULL << (qid % 64),
+			__ATOMIC_SEQ_CST);
+
+	if (__atomic_load_n(&sim->eng_sleeping, __ATOMIC_SEQ_CST)) {
+		pthread_mutex_lock(&sim->db_lock);
+		pthread_cond_signal(&sim->db_cond);
+		pthread_mutex_unlock(&sim->db_lock);
+	}
+}
+
+static int sim_pend_any(struct qdma_sim_dev *sim)
+{
+	uint32_t i;
+
+	for (i = 0; i < (sim->conf.num_qs + 63u) / 64; i++)
+		if (__atomic_load_n(&sim->pend[i], __ATOMIC_SEQ_CST))
+			return 1;
+	return 0;
+}
+
+static void sim_ctxt_cmd(struct qdma_sim_dev *sim, uint32_t val)
+{
+	union qdma_ind_ctxt_cmd cmd;
+	uint32_t *words;
+	uint32_t i;
+
+	cmd.word = val;
+	if (cmd.bits.sel >= QDMA_SIM_CTXT_SEL_MAX ||
+			cmd.bits.qid >= SIM_CTXT_QID_MAX(sim)) {
+		SIM_STAT_ADD(sim, errors, 1);
+		goto done;
+	}
+
+	words = sim_ctxt_words(sim, cmd.bits.sel, cmd.bits.qid);
+	switch (cmd.bits.op) {
+	case QDMA_CTXT_CMD_WR:
+		for (i = 0; i < QDMA_IND_CTXT_DATA_NUM_REGS; i++) {
+			uint32_t mask = sim->bar[(QDMA_OFFSET_IND_CTXT_MASK >> 2)
+						 + i];
+			uint32_t data = sim->bar[(QDMA_OFFSET_IND_CTXT_DATA >> 2)
+						 + i];
+
+			words[i] = (words[i] & ~mask) | (data & mask);
+		}
+		break;
+	case QDMA_CTXT_CMD_RD:
+		for (i = 0; i < QDMA_IND_CTXT_DATA_NUM_REGS; i++)
+			sim->bar[(QDMA_OFFSET_IND_CTXT_DATA >> 2) + i] =
+				words[i];
+		break;
+	case QDMA_CTXT_CMD_CLR:
+	case QDMA_CTXT_CMD_INV:
+		/* invalidation is modelled as clear, the queue stops either way */
+		memset(words, 0, QDMA_IND_CTXT_DATA_NUM_REGS * sizeof(uint32_t));
+		break;
+	}
+
+	if (cmd.bits.op != QDMA_CTXT_CMD_RD &&
+			cmd.bits.qid < sim->conf.num_qs)
+		__atomic_fetch_or(&sim->q[cmd.bits.qid].ctxt_stale,
+				1U << cmd.bits.sel, __ATOMIC_RELEASE);
+
+	if (!sim_internal)
+		SIM_STAT_ADD(sim, ctxt_cmd, 1);
+done:
+	/* the command completes immediately, never report busy */
+	cmd.bits.busy = 0;
+	sim->bar[QDMA_OFFSET_IND_CTXT_CMD >> 2] = cmd.word;
+}
+
+static void sim_doorbell(struct qdma_sim_dev *sim, uint32_t off, uint32_t val)
+{
+	uint32_t qid = (off - QDMA_SIM_DMAP_BASE) / QDMA_SIM_DMAP_STEP;
+	struct qdma_sim_queue *q = &sim->q[qid];
+
+	switch (off & (QDMA_SIM_DMAP_STEP - 1)) {
+	case 0x4:
+		__atomic_store_n(&q->db_pidx[SIM_Q_H2C],
+				FIELD_GET(QDMA_DMA_SEL_DESC_PIDX_MASK, val),
+				__ATOMIC_RELEASE);
+		SIM_STAT_ADD(sim, pidx_db, 1);
+		sim_pend_set(sim, qid);
+		break;
+	case 0x8:
+		__atomic_store_n(&q->db_pidx[SIM_Q_C2H],
+				FIELD_GET(QDMA_DMA_SEL_DESC_PIDX_MASK, val),
+				__ATOMIC_RELEASE);
+		SIM_STAT_ADD(sim, pidx_db, 1);
+		sim_pend_set(sim, qid);
+		break;
+	case 0xC:
+		__atomic_store_n(&q->db_cmpt_cidx,
+				FIELD_GET(QDMA_DMAP_SEL_CMPT_WRB_CIDX_MASK, val),
+				__ATOMIC_RELEASE);
+		SIM_STAT_ADD(sim, cidx_db, 1);
+		sim_pend_set(sim, qid);
+		break;
+	default:
+		/* interrupt ring CIDX, no interrupt model */
+		SIM_STAT_ADD(sim, cidx_db, 1);
+		break;
+	}
+}
+
+uint32_t qdma_sim_reg_read(struct qdma_sim_dev *sim, uint32_t off)
+{
+	if (off >= QDMA_SIM_BAR_SIZE || (off & 0x3)) {
+		SIM_STAT_ADD(sim, errors, 1);
+		return 0xFFFFFFFF;
+	}
+
+	if (!sim_internal)
+		SIM_STAT_ADD(sim, reg_rd, 1);
+
+	return __atomic_load_n(&sim->bar[off >> 2], __ATOMIC_ACQUIRE);
+}
+
+void qdma_sim_reg_write(struct qdma_sim_dev *sim, uint32_t off, uint32_t val)
+{
+	if (off >= QDMA_SIM_BAR_SIZE || (off & 0x3)) {
+		SIM_STAT_ADD(sim, errors, 1);
+		return;
+	}
+
+	if (!sim_internal)
+		SIM_STAT_ADD(sim, reg_wr, 1);
+
+	if (off == QDMA_OFFSET_IND_CTXT_CMD) {
+		sim_ctxt_cmd(sim, val);
+		return;
+	}
+
+	__atomic_store_n(&sim->bar[off >> 2], val, __ATOMIC_RELEASE);
+
+	if (off >= QDMA_SIM_DMAP_BASE && off < QDMA_SIM_DMAP_BASE +
+			(uint32_t)sim->conf.num_qs * QDMA_SIM_DMAP_STEP)
+		sim_doorbell(sim, off, val);
+}
+
+static uint32_t sim_csr_ring_size(struct qdma_sim_dev *sim, uint8_t idx)
+{
+	return sim->bar[(QDMA_OFFSET_GLBL_RNG_SZ >> 2) +
+			(idx % QDMA_NUM_RING_SIZES)];
+}
+
+static void sim_q_load_dir(struct qdma_sim_dev *sim, uint16_t qid, int c2h)
+{
+	struct qdma_sim_queue *q = &sim->q[qid];
+	struct qdma_sim_ring *ring = &q->ring[c2h];
+	struct qdma_descq_sw_ctxt sw;
+	uint32_t *hw_words;
+
+	memset(&sw, 0, sizeof(sw));
+	if (sim->hw.qdma_sw_ctx_conf(sim, c2h, qid, &sw,
+			QDMA_HW_ACCESS_READ) < 0)
+		sw.qen = 0;
+
+	hw_words = sim_ctxt_words(sim, c2h ? QDMA_CTXT_SEL_HW_C2H :
+			QDMA_CTXT_SEL_HW_H2C, qid);
+
+	q->en[c2h] = sw.qen;
+	q->st[c2h] = !sw.is_mm;
+	q->wbk_en[c2h] = sw.wbk_en;
+	ring->base = (uint8_t *)(uintptr_t)sw.ring_bs_addr;
+	ring->size = sim_csr_ring_size(sim, sw.rngsz_idx);
+	ring->desc_sz = 8U << sw.desc_sz;
+	ring->cidx = FIELD_GET(QDMA_HW_CTXT_W0_CIDX_MASK, hw_words[0]);
+	if (ring->size < 2)
+		q->en[c2h] = 0;
+}
+
+static void sim_q_load(struct qdma_sim_dev *sim, uint16_t qid)
+{
+	struct qdma_sim_queue *q = &sim->q[qid];
+	uint32_t stale = __atomic_exchange_n(&q->ctxt_stale, 0,
+			__ATOMIC_ACQ_REL);
+
+	sim_internal = 1;
+
+	if (stale & ((1U << QDMA_CTXT_SEL_SW_H2C) |
+			(1U << QDMA_CTXT_SEL_HW_H2C)))
+		sim_q_load_dir(sim, qid, SIM_Q_H2C);
+
+	if (stale & ((1U << QDMA_CTXT_SEL_SW_C2H) |
+			(1U << QDMA_CTXT_SEL_HW_C2H)))
+		sim_q_load_dir(sim, qid, SIM_Q_C2H);
+
+	if (stale & (1U << QDMA_CTXT_SEL_PFTCH)) {
+		struct qdma_descq_prefetch_ctxt pf;
+
+		memset(&pf, 0, sizeof(pf));
+		sim->hw.qdma_pfetch_ctx_conf(sim, qid, &pf,
+				QDMA_HW_ACCESS_READ);
+		q->c2h_bufsz = sim->bar[(QDMA_OFFSET_C2H_BUF_SZ >> 2) +
+				(pf.bufsz_idx % QDMA_NUM_C2H_BUFFER_SIZES)];
+	}
+
+	if (stale & (1U << QDMA_CTXT_SEL_CMPT)) {
+		struct qdma_descq_cmpt_ctxt cmpt;
+
+		memset(&cmpt, 0, sizeof(cmpt));
+		sim->hw.qdma_cmpt_ctx_conf(sim, qid, &cmpt,
+				QDMA_HW_ACCESS_READ);
+		q->cmpt_en = cmpt.higher_dword.bit.valid;
+		q->cmpt_color = cmpt.lower_dword.bit.color;
+		q->cmpt_stat_en = cmpt.lower_dword.bit.en_stat_desc;
+		q->cmpt.base = (uint8_t *)(uintptr_t)cmpt.bs_addr;
+		q->cmpt.size = sim_csr_ring_size(sim,
+				cmpt.lower_dword.bit.ringsz_idx);
+		q->cmpt.desc_sz = 8U << cmpt.higher_dword.bit.desc_sz;
+		q->cmpt.pidx = cmpt.pidx;
+		q->cmpt.cidx = cmpt.cidx;
+		if (q->cmpt.size < 2)
+			q->cmpt_en = 0;
+	}
+
+	sim_internal = 0;
+}
+
+static void sim_ring_status_wb(struct qdma_sim_dev *sim,
+		struct qdma_sim_queue *q, int c2h)
+{
+	struct qdma_sim_ring *ring = &q->ring[c2h];
+	struct sim_cmpl_status *cs = (struct sim_cmpl_status *)
+			(ring->base + (size_t)(ring->size - 1) * ring->desc_sz);
+
+	__atomic_store_n(&cs->pidx, (uint16_t)ring->pidx, __ATOMIC_RELAXED);
+	__atomic_store_n(&cs->cidx, (uint16_t)ring->cidx, __ATOMIC_RELEASE);
+	SIM_STAT_ADD(sim, status_wb, 1);
+}
+
+static void sim_hw_ctxt_cidx_set(struct qdma_sim_dev *sim, uint16_t qid,
+		int c2h, uint32_t cidx)
+{
+	uint32_t *w = sim_ctxt_words(sim, c2h ? QDMA_CTXT_SEL_HW_C2H :
+			QDMA_CTXT_SEL_HW_H2C, qid);
+
+	w[0] = (w[0] & ~QDMA_HW_CTXT_W0_CIDX_MASK) |
+		FIELD_SET(QDMA_HW_CTXT_W0_CIDX_MASK, cidx);
+}
+
+static int sim_mm_service(struct qdma_sim_dev *sim, uint16_t qid, int c2h)
+{
+	struct qdma_sim_queue *q = &sim->q[qid];
+	struct qdma_sim_ring *ring = &q->ring[c2h];
+	uint32_t pidx = __atomic_load_n(&q->db_pidx[c2h], __ATOMIC_ACQUIRE);
+	int cnt = 0;
+
+	ring->pidx = pidx % (ring->size - 1);
+	while (ring->cidx != ring->pidx) {
+		struct sim_mm_desc *d = (struct sim_mm_desc *)
+			(ring->base + (size_t)ring->cidx * ring->desc_sz);
+		uint32_t len = d->flag_len & SIM_MM_DESC_LEN_MASK;
+		uint64_t card = c2h ? d->src_addr : d->dst_addr;
+
+		if (!(d->flag_len & SIM_MM_DESC_F_DV) ||
+				card + len > sim->conf.card_mem_sz) {
+			SIM_STAT_ADD(sim, errors, 1);
+			break;
+		}
+
+		if (c2h)
+			memcpy((void *)(uintptr_t)d->dst_addr,
+					sim->card_mem + card, len);
+		else
+			memcpy(sim->card_mem + card,
+					(void *)(uintptr_t)d->src_addr, len);
+
+		ring->cidx = sim_ring_next(ring->cidx, ring->size);
+		SIM_STAT_ADD(sim, bytes, len);
+		cnt++;
+	}
+
+	if (cnt) {
+		SIM_STAT_ADD(sim, desc, cnt);
+		sim_hw_ctxt_cidx_set(sim, qid, c2h, ring->cidx);
+		if (q->wbk_en[c2h])
+			sim_ring_status_wb(sim, q, c2h);
+	}
+
+	return cnt;
+}
+
+/* one ST packet to be delivered on the C2H side */
+struct sim_pkt {
+	/* H2C descriptors carrying the payload, NULL for generated data */
+	struct qdma_sim_ring *src;
+	uint32_t src_cidx;
+	uint32_t src_cnt;
+	uint32_t len;
+	uint32_t seq;
+};
+
+static int sim_c2h_can_accept(struct qdma_sim_dev *sim,
+		struct qdma_sim_queue *q, uint32_t len)
+{
+	struct qdma_sim_ring *ring = &q->ring[SIM_Q_C2H];
+	uint32_t bufs = q->c2h_bufsz ? (len + q->c2h_bufsz - 1) / q->c2h_bufsz
+				     : 0;
+	uint32_t cmpt_pidx;
+
+	if (!q->en[SIM_Q_C2H] || !q->st[SIM_Q_C2H] || !q->cmpt_en ||
+			!q->c2h_bufsz)
+		return 0;
+
+	if (!bufs)
+		bufs = 1;
+
+	ring->pidx = __atomic_load_n(&q->db_pidx[SIM_Q_C2H],
+			__ATOMIC_ACQUIRE) % (ring->size - 1);
+	if (sim_ring_used(ring->pidx, ring->cidx, ring->size) < bufs)
+		return 0;
+
+	/* completion ring full? */
+	q->cmpt.cidx = __atomic_load_n(&q->db_cmpt_cidx, __ATOMIC_ACQUIRE) %
+			(q->cmpt.size - 1);
+	cmpt_pidx = sim_ring_next(q->cmpt.pidx, q->cmpt.size);
+	if (cmpt_pidx == q->cmpt.cidx)
+		return 0;
+
+	return 1;
+}
+
+static void sim_c2h_put(struct qdma_sim_dev *sim, uint16_t qid,
+		const struct sim_pkt *pkt)
+{
+	struct qdma_sim_queue *q = &sim->q[qid];
+	struct qdma_sim_ring *ring = &q->ring[SIM_Q_C2H];
+	uint32_t rem = pkt->len, bufs = 0, src_off = 0, gen_off = 0;
+	uint32_t src_cidx = pkt->src_cidx;
+	uint32_t *ent;
+	uint8_t *dst = NULL;
+	uint32_t dst_room = 0;
+
+	do {
+		struct sim_c2h_desc *d = (struct sim_c2h_desc *)
+			(ring->base + (size_t)ring->cidx * ring->desc_sz);
+		uint32_t chunk;
+
+		dst = (uint8_t *)(uintptr_t)d->dst_addr;
+		dst_room = q->c2h_bufsz;
+		ring->cidx = sim_ring_next(ring->cidx, ring->size);
+		bufs++;
+
+		while (rem && dst_room) {
+			if (pkt->src) {
+				struct sim_h2c_desc *s = (struct sim_h2c_desc *)
+					(pkt->src->base + (size_t)src_cidx *
+					 pkt->src->desc_sz);
+
+				chunk = s->len - src_off;
+				if (chunk > dst_room)
+					chunk = dst_room;
+				memcpy(dst, (uint8_t *)(uintptr_t)s->src_addr +
+						src_off, chunk);
+				src_off += chunk;
+				if (src_off == s->len) {
+					src_off = 0;
+					src_cidx = sim_ring_next(src_cidx,
+							pkt->src->size);
+				}
+			} else {
+				uint32_t i;
+
+				chunk = rem < dst_room ? rem : dst_room;
+				for (i = 0; i < chunk; i++)
+					dst[i] = (uint8_t)(pkt->seq + gen_off +
+							i);
+				gen_off += chunk;
+			}
+			dst += chunk;
+			dst_room -= chunk;
+			rem -= chunk;
+		}
+	} while (rem);
+
+	/* completion entry: format 0, color, desc_used, length, udd = seq */
+	ent = (uint32_t *)(q->cmpt.base +
+			(size_t)q->cmpt.pidx * q->cmpt.desc_sz);
+	ent[1] = pkt->seq;
+	__atomic_store_n(&ent[0], (q->cmpt_color ? SIM_CMPT_F_COLOR : 0) |
+			SIM_CMPT_F_DESC_USED |
+			((pkt->len & SIM_CMPT_LEN_MASK) << SIM_CMPT_LEN_SHIFT),
+			__ATOMIC_RELEASE);
+
+	q->cmpt.pidx = sim_ring_next(q->cmpt.pidx, q->cmpt.size);
+	if (!q->cmpt.pidx)
+		q->cmpt_color ^= 1;
+
+	SIM_STAT_ADD(sim, desc, bufs);
+	SIM_STAT_ADD(sim, bytes, pkt->len);
+	SIM_STAT_ADD(sim, pkts, 1);
+	SIM_STAT_ADD(sim, cmpt, 1);
+}
+
+static void sim_cmpt_status_wb(struct qdma_sim_dev *sim,
+		struct qdma_sim_queue *q, uint16_t qid)
+{
+	struct sim_cmpl_status *cs;
+
+	sim_hw_ctxt_cidx_set(sim, qid, SIM_Q_C2H, q->ring[SIM_Q_C2H].cidx);
+	if (!q->cmpt_stat_en)
+		return;
+
+	cs = (struct sim_cmpl_status *)(q->cmpt.base +
+			(size_t)(q->cmpt.size - 1) * q->cmpt.desc_sz);
+	__atomic_store_n(&cs->cidx, (uint16_t)q->cmpt.cidx, __ATOMIC_RELAXED);
+	__atomic_store_n(&cs->color_isr_status, q->cmpt_color,
+			__ATOMIC_RELAXED);
+	__atomic_store_n(&cs->pidx, (uint16_t)q->cmpt.pidx, __ATOMIC_RELEASE);
+	SIM_STAT_ADD(sim, status_wb, 1);
+}
+
+static int sim_st_h2c_service(struct qdma_sim_dev *sim, uint16_t qid)
+{
+	struct qdma_sim_queue *q = &sim->q[qid];
+	struct qdma_sim_ring *ring = &q->ring[SIM_Q_H2C];
+	uint32_t pidx = __atomic_load_n(&q->db_pidx[SIM_Q_H2C],
+			__ATOMIC_ACQUIRE);
+	int cnt = 0, pkts = 0;
+
+	ring->pidx = pidx % (ring->size - 1);
+	while (ring->cidx != ring->pidx) {
+		struct sim_pkt pkt;
+		uint32_t idx = ring->cidx;
+		int eop = 0;
+
+		memset(&pkt, 0, sizeof(pkt));
+		pkt.src = ring;
+		pkt.src_cidx = idx;
+
+		/* gather SOP..EOP, a descriptor without flags is a packet */
+		while (idx != ring->pidx) {
+			struct sim_h2c_desc *d = (struct sim_h2c_desc *)
+				(ring->base + (size_t)idx * ring->desc_sz);
+
+			pkt.len += d->len;
+			pkt.src_cnt++;
+			idx = sim_ring_next(idx, ring->size);
+			if (!(d->flags & (SIM_H2C_DESC_F_SOP |
+					SIM_H2C_DESC_F_EOP)) ||
+					(d->flags & SIM_H2C_DESC_F_EOP)) {
+				eop = 1;
+				break;
+			}
+		}
+		if (!eop)
+			break;
+
+		if (sim->conf.st_loopback) {
+			if (!sim_c2h_can_accept(sim, q, pkt.len))
+				break;
+			pkt.seq = q->gen_seq++;
+			sim_c2h_put(sim, qid, &pkt);
+			pkts++;
+		} else {
+			SIM_STAT_ADD(sim, bytes, pkt.len);
+			SIM_STAT_ADD(sim, pkts, 1);
+		}
+
+		ring->cidx = idx;
+		cnt += pkt.src_cnt;
+	}
+
+	if (cnt) {
+		SIM_STAT_ADD(sim, desc, cnt);
+		sim_hw_ctxt_cidx_set(sim, qid, SIM_Q_H2C, ring->cidx);
+		if (q->wbk_en[SIM_Q_H2C])
+			sim_ring_status_wb(sim, q, SIM_Q_H2C);
+	}
+	if (pkts)
+		sim_cmpt_status_wb(sim, q, qid);
+
+	return cnt;
+}
+
+static int sim_st_c2h_service(struct qdma_sim_dev *sim, uint16_t qid)
+{
+	struct qdma_sim_queue *q = &sim->q[qid];
+	int cnt = 0;
+
+	while (__atomic_load_n(&q->gen_pkts, __ATOMIC_ACQUIRE)) {
+		struct sim_pkt pkt;
+
+		memset(&pkt, 0, sizeof(pkt));
+		pkt.len = q->gen_len;
+		if (!sim_c2h_can_accept(sim, q, pkt.len))
+			break;
+		pkt.seq = q->gen_seq++;
+		sim_c2h_put(sim, qid, &pkt);
+		__atomic_fetch_sub(&q->gen_pkts, 1, __ATOMIC_RELEASE);
+		cnt++;
+	}
+
+	if (cnt)
+		sim_cmpt_status_wb(sim, q, qid);
+
+	return cnt;
+}
+
+static int sim_q_service(struct qdma_sim_dev *sim, uint16_t qid)
+{
+	struct qdma_sim_queue *q = &sim->q[qid];
+	int cnt = 0;
+
+	if (__atomic_load_n(&q->ctxt_stale, __ATOMIC_ACQUIRE))
+		sim_q_load(sim, qid);
+
+	if (q->en[SIM_Q_H2C]) {
+		if (q->st[SIM_Q_H2C])
+			cnt += sim_st_h2c_service(sim, qid);
+		else
+			cnt += sim_mm_service(sim, qid, SIM_Q_H2C);
+	}
+
+	if (q->en[SIM_Q_C2H]) {
+		if (q->st[SIM_Q_C2H])
+			cnt += sim_st_c2h_service(sim, qid);
+		else
+			cnt += sim_mm_service(sim, qid, SIM_Q_C2H);
+	}
+
+	return cnt;
+}
+
+int qdma_sim_poll(struct qdma_sim_dev *sim)
+{
+	uint32_t i;
+	int cnt = 0;
+
+	pthread_mutex_lock(&sim->eng_lock);
+	for (i = 0; i < (sim->conf.num_qs + 63u) / 64; i++) {
+		uint64_t bits = __atomic_exchange_n(&sim->pend[i], 0,
+				__ATOMIC_SEQ_CST);
+
+		while (bits) {
+			uint32_t bit = __builtin_ctzll(bits);
+
+			bits &= bits - 1;
+			cnt += sim_q_service(sim, (uint16_t)(i * 64 + bit));
+		}
+	}
+	pthread_mutex_unlock(&sim->eng_lock);
+
+	return cnt;
+}
+
+static void *sim_engine_thread(void *arg)
+{
+	struct qdma_sim_dev *sim = arg;
+
+	while (__atomic_load_n(&sim->eng_running, __ATOMIC_ACQUIRE)) {
+		if (qdma_sim_poll(sim))
+			continue;
+
+		pthread_mutex_lock(&sim->db_lock);
+		__atomic_store_n(&sim->eng_sleeping, 1, __ATOMIC_SEQ_CST);
+		if (!sim_pend_any(sim) &&
+				__atomic_load_n(&sim->eng_running,
+					__ATOMIC_ACQUIRE))
+			pthread_cond_wait(&sim->db_cond, &sim->db_lock);
+		__atomic_store_n(&sim->eng_sleeping, 0, __ATOMIC_SEQ_CST);
+		pthread_mutex_unlock(&sim->db_lock);
+	}
+
+	return NULL;
+}
+
+int qdma_sim_start(struct qdma_sim_dev *sim)
+{
+	int rv;
+
+	if (sim->eng_running)
+		return 0;
+
+	sim->eng_running = 1;
+	rv = pthread_create(&sim->eng_thread, NULL, sim_engine_thread, sim);
+	if (rv) {
+		sim->eng_running = 0;
+		return -rv;
+	}
+
+	return 0;
+}
+
+void qdma_sim_stop(struct qdma_sim_dev *sim)
+{
+	if (!sim->eng_running)
+		return;
+
+	pthread_mutex_lock(&sim->db_lock);
+	__atomic_store_n(&sim->eng_running, 0, __ATOMIC_RELEASE);
+	pthread_cond_signal(&sim->db_cond);
+	pthread_mutex_unlock(&sim->db_lock);
+	pthread_join(sim->eng_thread, NULL);
+}
+
+int qdma_sim_c2h_gen(struct qdma_sim_dev *sim, uint16_t qid_hw,
+		uint32_t pkt_len, uint32_t num_pkts)
+{
+	struct qdma_sim_queue *q;
+
+	if (qid_hw >= sim->conf.num_qs || pkt_len > SIM_CMPT_LEN_MASK)
+		return -EINVAL;
+
+	q = &sim->q[qid_hw];
+	q->gen_len = pkt_len;
+	__atomic_fetch_add(&q->gen_pkts, num_pkts, __ATOMIC_RELEASE);
+	sim_pend_set(sim, qid_hw);
+
+	return 0;
+}
+
+void qdma_sim_stats_get(struct qdma_sim_dev *sim,
+		struct qdma_sim_stats *stats)
+{
+	uint64_t *dst = (uint64_t *)stats;
+	uint64_t *src = (uint64_t *)&sim->stats;
+	size_t i;
+
+	for (i = 0; i < sizeof(*stats) / sizeof(uint64_t); i++)
+		dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+}
+
+void qdma_sim_stats_clear(struct qdma_sim_dev *sim)
+{
+	uint64_t *p = (uint64_t *)&sim->stats;
+	size_t i;
+
+	for (i = 0; i < sizeof(sim->stats) / sizeof(uint64_t); i++)
+		__atomic_store_n(&p[i], 0, __ATOMIC_RELAXED);
+}
+
+static void sim_reset_regs(struct qdma_sim_dev *sim)
+{
+	uint32_t misc_cap;
+
+	sim->bar[QDMA_OFFSET_CONFIG_BLOCK_ID >> 2] =
+			FIELD_SET(QDMA_CONFIG_BLOCK_ID_MASK, QDMA_MAGIC_NUMBER);
+
+	/* soft device, mailbox and FLR present, MM completion capable */
+	misc_cap = QDMA_GLBL2_MAILBOX_EN_MASK | QDMA_GLBL2_FLR_PRESENT_MASK |
+			QDMA_GLBL2_MM_CMPT_EN_MASK;
+	if (sim->conf.ip == QDMA_SIM_IP_EQDMA_SOFT)
+		/* EQDMA 4.0, 2020.2 */
+		misc_cap |= (1U << SIM_MISC_CAP_IP_SHIFT) |
+				(1U << SIM_MISC_CAP_VIVADO_SHIFT);
+	else
+		/* QDMA 3.x, 2019.2 */
+		misc_cap |= (2U << SIM_MISC_CAP_VIVADO_SHIFT);
+	sim->bar[QDMA_OFFSET_GLBL2_MISC_CAP >> 2] = misc_cap;
+
+	sim->bar[QDMA_OFFSET_GLBL2_PF_BARLITE_INT >> 2] =
+			FIELD_SET(QDMA_GLBL2_PF0_BAR_MAP_MASK, 0x1);
+	sim->bar[QDMA_OFFSET_GLBL2_CHANNEL_QDMA_CAP >> 2] =
+			FIELD_SET(QDMA_GLBL2_MULTQ_MAX_MASK, sim->conf.num_qs);
+	sim->bar[QDMA_OFFSET_GLBL2_CHANNEL_MDMA >> 2] =
+			QDMA_GLBL2_ST_C2H_MASK | QDMA_GLBL2_ST_H2C_MASK |
+			QDMA_GLBL2_MM_C2H_MASK | QDMA_GLBL2_MM_H2C_MASK;
+	sim->bar[QDMA_OFFSET_C2H_PFETCH_CACHE_DEPTH >> 2] = 64;
+	sim->bar[QDMA_OFFSET_C2H_CMPT_COAL_BUF_DEPTH >> 2] = 32;
+}
+
+struct qdma_sim_dev *qdma_sim_create(const struct qdma_sim_conf *conf)
+{
+	struct qdma_sim_dev *sim;
+	uint32_t qmax;
+
+	if (!conf || !conf->num_qs || conf->num_qs > QDMA_SIM_MAX_QUEUES)
+		return NULL;
+
+	sim = calloc(1, sizeof(*sim));
+	if (!sim)
+		return NULL;
+
+	sim->conf = *conf;
+	if (!sim->conf.card_mem_sz)
+		sim->conf.card_mem_sz = QDMA_SIM_CARD_MEM_SZ_DFLT;
+	qmax = SIM_CTXT_QID_MAX(sim);
+
+	sim->bar = calloc(1, QDMA_SIM_BAR_SIZE);
+	sim->ctxt = calloc((size_t)QDMA_SIM_CTXT_SEL_MAX * qmax,
+			QDMA_IND_CTXT_DATA_NUM_REGS * sizeof(uint32_t));
+	sim->card_mem = calloc(1, sim->conf.card_mem_sz);
+	sim->q = calloc(sim->conf.num_qs, sizeof(struct qdma_sim_queue));
+	sim->pend = calloc((sim->conf.num_qs + 63) / 64, sizeof(uint64_t));
+	if (!sim->bar || !sim->ctxt || !sim->card_mem || !sim->q ||
+			!sim->pend)
+		goto free_sim;
+
+	pthread_mutex_init(&sim->reg_lock, NULL);
+	pthread_mutex_init(&sim->eng_lock, NULL);
+	pthread_mutex_init(&sim->db_lock, NULL);
+	pthread_cond_init(&sim->db_cond, NULL);
+
+	sim_reset_regs(sim);
+
+	sim_internal = 1;
+	if (qdma_hw_access_init(sim, 0, &sim->hw) < 0) {
+		sim_internal = 0;
+		goto free_sim;
+	}
+	sim_internal = 0;
+
+	return sim;
+
+free_sim:
+	free(sim->pend);
+	free(sim->q);
+	free(sim->card_mem);
+	free(sim->ctxt);
+	free(sim->bar);
+	free(sim);
+	return NULL;
+}
+
+void qdma_sim_destroy(struct qdma_sim_dev *sim)
+{
+	if (!sim)
+		return;
+
+	qdma_sim_stop(sim);
+	pthread_cond_destroy(&sim->db_cond);
+	pthread_mutex_destroy(&sim->db_lock);
+	pthread_mutex_destroy(&sim->eng_lock);
+	pthread_mutex_destroy(&sim->reg_lock);
+	free(sim->pend);
+	free(sim->q);
+	free(sim->card_mem);
+	free(sim->ctxt);
+	free(sim->bar);
+	free(sim);
+}
@@ -0,0 +1,287 @@
+/*
+ * This file is part of the QDMA userspace application
+ * to enable the user to execute the QDMA functionality
+ *
+ * Copyright (c) 2018-2022, Xilinx, Inc. All rights reserved.
+ * Copyright (c) 2022-2024, Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * This source code is licensed under BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree)
+ */
+
+#ifndef __QDMA_SIM_H__
+#define __QDMA_SIM_H__
+
+#include <stdint.h>
+#include <pthread.h>
+#include "qdma_access_common.h"
+
+/**
+ * DOC: QDMA software device model
+ *
+ * The model backs a QDMA PF config BAR with a memory register file so that
+ * the unmodified qdma_access layer can be exercised without a card. It
+ * implements the indirect context command interface, the PIDX/CIDX doorbell
+ * space, descriptor fetch from host rings, MM transfers to a card memory
+ * buffer, ST H2C/C2H data movement and completion/status writeback.
+ *
+ * Host "DMA addresses" are plain process virtual addresses (identity IOMMU).
+ */
+
+/** size of the modelled config BAR */
+#define QDMA_SIM_BAR_SIZE		(256 * 1024)
+/** maximum number of queues the model exposes */
+#define QDMA_SIM_MAX_QUEUES		2048
+/** number of indirect context selectors tracked per queue */
+#define QDMA_SIM_CTXT_SEL_MAX		16
+/** PF queue DMAP space base and per queue stride */
+#define QDMA_SIM_DMAP_BASE		0x18000
+#define QDMA_SIM_DMAP_STEP		0x10
+/** default card memory size for MM queues */
+#define QDMA_SIM_CARD_MEM_SZ_DFLT	(64 * 1024 * 1024)
+
+/**
+ * enum qdma_sim_ip - IP flavour reported through the version registers
+ */
+enum qdma_sim_ip {
+	/** @QDMA_SIM_IP_QDMA_SOFT: QDMA 3.x soft IP */
+	QDMA_SIM_IP_QDMA_SOFT,
+	/** @QDMA_SIM_IP_EQDMA_SOFT: EQDMA 4.0 soft IP */
+	QDMA_SIM_IP_EQDMA_SOFT,
+};
+
+/**
+ * struct qdma_sim_conf - device model configuration
+ */
+struct qdma_sim_conf {
+	/** @ip: IP flavour to model */
+	enum qdma_sim_ip ip;
+	/** @num_qs: number of queues exposed by the device */
+	uint16_t num_qs;
+	/** @card_mem_sz: size of the card memory behind MM queues */
+	uint32_t card_mem_sz;
+	/** @st_loopback: route ST H2C packets to the C2H queue of same qid */
+	uint8_t st_loopback;
+};
+
+/**
+ * struct qdma_sim_stats - device model statistics
+ *
+ * Register accesses issued by the model itself (context loads) are not
+ * accounted, so the counters reflect the cost seen by the driver.
+ */
+struct qdma_sim_stats {
+	/** @reg_rd: BAR register reads */
+	uint64_t reg_rd;
+	/** @reg_wr: BAR register writes */
+	uint64_t reg_wr;
+	/** @ctxt_cmd: indirect context commands */
+	uint64_t ctxt_cmd;
+	/** @pidx_db: H2C/C2H PIDX doorbells */
+	uint64_t pidx_db;
+	/** @cidx_db: CMPT and interrupt CIDX doorbells */
+	uint64_t cidx_db;
+	/** @desc: descriptors fetched */
+	uint64_t desc;
+	/** @bytes: payload bytes moved */
+	uint64_t bytes;
+	/** @pkts: ST packets moved */
+	uint64_t pkts;
+	/** @cmpt: completion entries written */
+	uint64_t cmpt;
+	/** @status_wb: descriptor ring status writebacks */
+	uint64_t status_wb;
+	/** @drops: ST C2H packets dropped for lack of buffers */
+	uint64_t drops;
+	/** @errors: descriptors rejected by the model */
+	uint64_t errors;
+};
+
+/**
+ * struct qdma_sim_ring - cached view of a descriptor or completion ring
+ */
+struct qdma_sim_ring {
+	/** @base: ring base address */
+	uint8_t *base;
+	/** @size: ring size including the status entry */
+	uint32_t size;
+	/** @desc_sz: descriptor/entry size in bytes */
+	uint32_t desc_sz;
+	/** @pidx: producer index */
+	uint32_t pidx;
+	/** @cidx: consumer index */
+	uint32_t cidx;
+};
+
+/**
+ * struct qdma_sim_queue - per queue state of the device model
+ */
+struct qdma_sim_queue {
+	/** @ctxt_stale: bitmap of context selectors written since last load */
+	uint32_t ctxt_stale;
+	/** @en: h2c/c2h queue enabled */
+	uint8_t en[2];
+	/** @st: h2c/c2h queue is streaming */
+	uint8_t st[2];
+	/** @wbk_en: h2c/c2h status writeback enabled */
+	uint8_t wbk_en[2];
+	/** @ring: h2c/c2h descriptor ring */
+	struct qdma_sim_ring ring[2];
+	/** @db_pidx: last PIDX doorbell value for h2c/c2h */
+	uint32_t db_pidx[2];
+	/** @c2h_bufsz: ST C2H buffer size */
+	uint32_t c2h_bufsz;
+	/** @cmpt_en: completion ring valid */
+	uint8_t cmpt_en;
+	/** @cmpt_color: current completion color */
+	uint8_t cmpt_color;
+	/** @cmpt_stat_en: completion status writeback enabled */
+	uint8_t cmpt_stat_en;
+	/** @cmpt: completion ring */
+	struct qdma_sim_ring cmpt;
+	/** @db_cmpt_cidx: last CMPT CIDX doorbell value */
+	uint32_t db_cmpt_cidx;
+	/** @gen_pkts: ST C2H packets still to be generated */
+	uint32_t gen_pkts;
+	/** @gen_len: length of generated ST C2H packets */
+	uint32_t gen_len;
+	/** @gen_seq: generated packet sequence number */
+	uint32_t gen_seq;
+};
+
+/**
+ * struct qdma_sim_dev - software QDMA device
+ */
+struct qdma_sim_dev {
+	/** @conf: device configuration */
+	struct qdma_sim_conf conf;
+	/** @bar: config BAR register file */
+	uint32_t *bar;
+	/** @ctxt: indirect context RAM, [sel][qid][word] */
+	uint32_t *ctxt;
+	/** @card_mem: card memory behind MM queues */
+	uint8_t *card_mem;
+	/** @q: per queue state */
+	struct qdma_sim_queue *q;
+	/** @pend: bitmap of queues with outstanding doorbells */
+	uint64_t *pend;
+	/** @hw: qdma_access function table used by driver and model */
+	struct qdma_hw_access hw;
+	/** @reg_lock: register access lock for qdma_reg_access_lock() */
+	pthread_mutex_t reg_lock;
+	/** @eng_lock: serializes the engine against itself */
+	pthread_mutex_t eng_lock;
+	/** @db_lock: protects @db_cond */
+	pthread_mutex_t db_lock;
+	/** @db_cond: signalled on doorbell writes */
+	pthread_cond_t db_cond;
+	/** @eng_thread: engine thread */
+	pthread_t eng_thread;
+	/** @eng_running: engine thread is running */
+	int eng_running;
+	/** @eng_sleeping: engine thread waits on @db_cond */
+	int eng_sleeping;
+	/** @stats: device statistics */
+	struct qdma_sim_stats stats;
+};
+
+/*****************************************************************************/
+/**
+ * qdma_sim_create() - create a software QDMA device
+ *
+ * @conf: device configuration
+ *
+ * Return: device on success and NULL on failure
+ *****************************************************************************/
+struct qdma_sim_dev *qdma_sim_create(const struct qdma_sim_conf *conf);
+
+/*****************************************************************************/
+/**
+ * qdma_sim_destroy() - stop the engine and free a software QDMA device
+ *
+ * @sim: device
+ *****************************************************************************/
+void qdma_sim_destroy(struct qdma_sim_dev *sim);
+
+/*****************************************************************************/
+/**
+ * qdma_sim_reg_read() - config BAR read
+ *
+ * @sim: device
+ * @off: register offset
+ *
+ * Return: register value
+ *****************************************************************************/
+uint32_t qdma_sim_reg_read(struct qdma_sim_dev *sim, uint32_t off);
+
+/*****************************************************************************/
+/**
+ * qdma_sim_reg_write() - config BAR write
+ *
+ * @sim: device
+ * @off: register offset
+ * @val: value to be written
+ *****************************************************************************/
+void qdma_sim_reg_write(struct qdma_sim_dev *sim, uint32_t off, uint32_t val);
+
+/*****************************************************************************/
+/**
+ * qdma_sim_poll() - run the engine once over all queues with pending work
+ *
+ * @sim: device
+ *
+ * Return: number of descriptors processed
+ *****************************************************************************/
+int qdma_sim_poll(struct qdma_sim_dev *sim);
+
+/*****************************************************************************/
+/**
+ * qdma_sim_start() - run the engine in its own thread
+ *
+ * @sim: device
+ *
+ * Return: 0 on success and < 0 on failure
+ *****************************************************************************/
+int qdma_sim_start(struct qdma_sim_dev *sim);
+
+/*****************************************************************************/
+/**
+ * qdma_sim_stop() - stop the engine thread
+ *
+ * @sim: device
+ *****************************************************************************/
+void qdma_sim_stop(struct qdma_sim_dev *sim);
+
+/*****************************************************************************/
+/**
+ * qdma_sim_c2h_gen() - request ST C2H packets from the traffic generator
+ *
+ * @sim: device
+ * @qid_hw: hardware queue id
+ * @pkt_len: packet length in bytes
+ * @num_pkts: number of packets
+ *
+ * Return: 0 on success and < 0 on failure
+ *****************************************************************************/
+int qdma_sim_c2h_gen(struct qdma_sim_dev *sim, uint16_t qid_hw,
+		uint32_t pkt_len, uint32_t num_pkts);
+
+/*****************************************************************************/
+/**
+ * qdma_sim_stats_get() - snapshot of the device statistics
+ *
+ * @sim: device
+ * @stats: statistics to be filled
+ *****************************************************************************/
+void qdma_sim_stats_get(struct qdma_sim_dev *sim,
+		struct qdma_sim_stats *stats);
+
+/*****************************************************************************/
+/**
+ * qdma_sim_stats_clear() - reset the device statistics
+ *
+ * @sim: device
+ *****************************************************************************/
+void qdma_sim_stats_clear(struct qdma_sim_dev *sim);
+
+#endif /* __QDMA_SIM_H__ */
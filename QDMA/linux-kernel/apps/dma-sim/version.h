@@ -0,0 +1,19 @@
+/*
+ * This file is part of the QDMA userspace application
+ * to enable the user to execute the QDMA functionality
+ *
+ * Copyright (c) 2018-2022, Xilinx, Inc. All rights reserved.
+ * Copyright (c) 2022-2024, Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * This source code is licensed under BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree)
+ */
+
+#ifndef __DMA_SIM_VERSION_H
+#define __DMA_SIM_VERSION_H
+
+#define PROGNAME "dma-sim"
+#define VERSION "2024.1.0"
+#define COPYRIGHT "Copyright (c) 2022-2024 Advanced Micro Devices Inc."
+
+#endif
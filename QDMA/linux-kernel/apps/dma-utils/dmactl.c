@@ -376,6 +376,15 @@ static void xnl_msg_add_extra_config_attrs(struct xnl_hdr *hdr,
 		xnl_msg_add_int_attr(hdr,  XNL_ATTR_APERTURE_SZ,
 							 xcmd->req.qparm.aperture_sz);
 	}
+	if (xcmd->req.qparm.sflags & (1 << QPARM_PIDX_ACC))
+		xnl_msg_add_int_attr(hdr,  XNL_ATTR_PIDX_ACC,
+				     xcmd->req.qparm.pidx_acc);
+	if (xcmd->req.qparm.sflags & (1 << QPARM_PIDX_ACC_USECS))
+		xnl_msg_add_int_attr(hdr,  XNL_ATTR_PIDX_ACC_USECS,
+				     xcmd->req.qparm.pidx_acc_usecs);
+	if (xcmd->req.qparm.sflags & (1 << QPARM_NUMA_NODE))
+		xnl_msg_add_int_attr(hdr,  XNL_ATTR_NUMA_NODE,
+				     xcmd->req.qparm.numa_node);
 }
 
 static int xnl_parse_response(struct xnl_cb *cb, struct xnl_hdr *hdr,
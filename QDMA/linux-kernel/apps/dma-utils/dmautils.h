@@ -100,6 +100,12 @@ enum qdma_q_parm_type {
 	QPARM_KEYHOLE_EN,
 	/** @QPARM_MM_CHANNEL: q mm channel enable param */
 	QPARM_MM_CHANNEL,
+	/** @QPARM_PIDX_ACC: q pidx update accumulation count param */
+	QPARM_PIDX_ACC,
+	/** @QPARM_PIDX_ACC_USECS: q pidx update max delay param */
+	QPARM_PIDX_ACC_USECS,
+	/** @QPARM_NUMA_NODE: q rings numa node param */
+	QPARM_NUMA_NODE,
 	/** @QPARM_MAX: max q param */
 	QPARM_MAX,
 };
@@ -145,6 +151,12 @@ struct xcmd_q_parm {
 	unsigned char ping_pong_en;
 	/** @aperture_sz: aperture_size for keyhole transfers*/
 	unsigned int aperture_sz;
+	/** @pidx_acc: descriptors to accumulate per pidx update */
+	unsigned int pidx_acc;
+	/** @pidx_acc_usecs: max usecs a pidx update may be held back */
+	unsigned int pidx_acc_usecs;
+	/** @numa_node: numa node of the queue rings and free list */
+	unsigned int numa_node;
 };
 
 /**
@@ -0,0 +1,151 @@
+/*
+ * This file is part of the Xilinx DMA IP Core driver for Linux
+ *
+ * Copyright (c) 2018-2022, Xilinx, Inc. All rights reserved.
+ * Copyright (c) 2022-2024, Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * This source code is licensed under both the BSD-style license (found in the
+ * LICENSE file in the root directory of this source tree) and the GPLv2 (found
+ * in the COPYING file in the root directory of this source tree).
+ * You may select, at your option, one of the above-listed licenses.
+ */
+
+#ifndef __QDMA_CDEV_IOCTL_H__
+#define __QDMA_CDEV_IOCTL_H__
+/**
+ * @file
+ * @brief This file contains the ioctl interface of the qdma queue character
+ *        devices, shared between the driver and the applications
+ */
+
+/**
+ * qdma queue character device ioctl commands
+ */
+enum qdma_cdev_ioctl_cmd {
+	/** arg: unsigned char *, non-zero to skip the ST C2H memcpy */
+	QDMA_CDEV_IOCTL_NO_MEMCPY,
+	/**
+	 * arg: struct qdma_cdev_buf_reg *, pin and dma map a user buffer
+	 * once. Reads and writes on the same file that fall inside a
+	 * registered buffer reuse its mapping. The pages count against
+	 * RLIMIT_MEMLOCK, at most 1GB can be registered per file.
+	 */
+	QDMA_CDEV_IOCTL_BUF_REG,
+	/** arg: struct qdma_cdev_buf_reg *, release a registered buffer */
+	QDMA_CDEV_IOCTL_BUF_UNREG,
+	/**
+	 * arg: struct qdma_cdev_zc_info *, ST C2H only. Switch the queue to
+	 * zero copy receive: packets are no longer copied out by read(),
+	 * they are left in the free list buffers, which are mmap'able
+	 * read-only together with a struct qdma_zc_rx_ring describing them.
+	 * Fails with -EBUSY if received data is still waiting to be read.
+	 */
+	QDMA_CDEV_IOCTL_ZC_ENABLE,
+	/** arg: none, leave zero copy receive, unreleased data is dropped */
+	QDMA_CDEV_IOCTL_ZC_DISABLE,
+	/**
+	 * arg: unsigned int *, hand the next n consumed entries of the zero
+	 * copy ring back to the free list
+	 */
+	QDMA_CDEV_IOCTL_ZC_RELEASE,
+	QDMA_CDEV_IOCTL_CMDS
+};
+
+/**
+ * @struct - qdma_cdev_buf_reg
+ * @brief	user buffer passed to QDMA_CDEV_IOCTL_BUF_REG/_UNREG
+ */
+struct qdma_cdev_buf_reg {
+	/** user virtual address of the buffer */
+	unsigned long long addr;
+	/** length of the buffer in bytes, ignored by _UNREG */
+	unsigned long long len;
+};
+
+/**
+ * qdma queue character device io_uring passthrough commands, passed in
+ * sqe->cmd_op of an IORING_OP_URING_CMD. The ring has to be set up with
+ * IORING_SETUP_SQE128, the sqe command area carries a
+ * struct qdma_cdev_uring_cmd.
+ */
+enum qdma_cdev_uring_cmd_op {
+	/** c2h transfer into addr */
+	QDMA_CDEV_URING_CMD_READ,
+	/** h2c transfer from addr */
+	QDMA_CDEV_URING_CMD_WRITE,
+	QDMA_CDEV_URING_CMDS
+};
+
+/**
+ * @struct - qdma_cdev_uring_cmd
+ * @brief	io_uring passthrough command payload. With
+ *		IORING_URING_CMD_FIXED set in sqe->uring_cmd_flags, addr/len
+ *		has to lie within the buffer sqe->buf_index was registered as
+ *		with io_uring_register_buffers().
+ */
+struct qdma_cdev_uring_cmd {
+	/** user virtual address of the data */
+	unsigned long long addr;
+	/** card address for MM queues, as the file offset in read/write */
+	unsigned long long ep_addr;
+	/** length of the transfer in bytes */
+	unsigned int len;
+	/** reserved, must be 0 */
+	unsigned int rsvd;
+};
+
+/**
+ * @struct - qdma_cdev_zc_info
+ * @brief	zero copy receive area returned by QDMA_CDEV_IOCTL_ZC_ENABLE
+ */
+struct qdma_cdev_zc_info {
+	/** length to mmap(), at offset 0, read-only and MAP_SHARED */
+	unsigned long long mmap_len;
+	/** offset of the first buffer from the start of the mapping */
+	unsigned long long data_off;
+	/** number of entries of the ring */
+	unsigned int size;
+	/** size of a free list buffer */
+	unsigned int buf_sz;
+};
+
+/** zero copy ring entry is the first buffer of a packet */
+#define QDMA_ZC_RX_F_SOP	0x1
+/** zero copy ring entry is the last buffer of a packet */
+#define QDMA_ZC_RX_F_EOP	0x2
+
+/**
+ * @struct - qdma_zc_rx_entry
+ * @brief	zero copy ring entry, one per free list buffer
+ */
+struct qdma_zc_rx_entry {
+	/** offset of the buffer from the start of the mapping */
+	unsigned long long off;
+	/** bytes of packet data in the buffer */
+	unsigned int len;
+	/** QDMA_ZC_RX_F_* */
+	unsigned int flags;
+};
+
+/**
+ * @struct - qdma_zc_rx_ring
+ * @brief	start of the zero copy receive mapping. Entries [cons, prod)
+ *		hold received data, both indices wrap at size. The
+ *		application reads prod with acquire semantics, consumes the
+ *		entries in order and returns them with
+ *		QDMA_CDEV_IOCTL_ZC_RELEASE, which advances cons.
+ */
+struct qdma_zc_rx_ring {
+	/** index of the next entry the driver fills */
+	unsigned int prod;
+	/** reserved, keeps prod and cons on separate cache lines */
+	unsigned int rsvd0[15];
+	/** index of the next entry to be released */
+	unsigned int cons;
+	/** reserved */
+	unsigned int rsvd1[15];
+	/** ring entries */
+	struct qdma_zc_rx_entry ent[];
+};
+
+#endif /* ifndef __QDMA_CDEV_IOCTL_H__ */
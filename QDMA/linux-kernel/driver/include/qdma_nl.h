@@ -171,6 +171,9 @@ enum xnl_attr_t {
 	XNL_ATTR_DEV,
 	XNL_ATTR_DEBUG_EN,	/** Debug Regs Capability*/
 	XNL_ATTR_DESC_ENGINE_MODE, /** Descriptor Engine Capability */
+	XNL_ATTR_PIDX_ACC,		/**< pidx update accumulation count */
+	XNL_ATTR_PIDX_ACC_USECS,	/**< pidx update max delay in usecs */
+	XNL_ATTR_NUMA_NODE,		/**< numa node of the queue memory */
 #ifdef ERR_DEBUG
 	XNL_ATTR_QPARAM_ERR_INFO,	/**< queue param info */
 #endif
@@ -274,6 +277,9 @@ static const char *xnl_attr_str[XNL_ATTR_MAX + 1] = {
 	"DEV_ATTR",			/**< XNL_ATTR_DEV */
 	"XNL_ATTR_DEBUG_EN",	/** XNL_ATTR_DEBUG_EN */
 	"XNL_ATTR_DESC_ENGINE_MODE",	/** XNL_ATTR_DESC_ENGINE_MODE */
+	"PIDX_ACC",			/**< XNL_ATTR_PIDX_ACC */
+	"PIDX_ACC_USECS",		/**< XNL_ATTR_PIDX_ACC_USECS */
+	"NUMA_NODE",			/**< XNL_ATTR_NUMA_NODE */
 #ifdef ERR_DEBUG
 	"QPARAM_ERR_INFO",		/**< queue param info */
 #endif
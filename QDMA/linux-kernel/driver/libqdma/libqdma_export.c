@@ -24,6 +24,8 @@
  */
 #define pr_fmt(fmt)	KBUILD_MODNAME ":%s: " fmt, __func__
 
+#include <linux/delay.h>
+
 #include "libqdma_export.h"
 
 #include "qdma_descq.h"
@@ -49,13 +51,15 @@ static bool qdma_debufs_cleanup = true;
 
 
 #define QDMA_Q_PEND_LIST_COMPLETION_TIMEOUT 1000 /* msec */
+#define QDMA_Q_SUB_USERS_TIMEOUT 1000 /* msec */
 
 struct drv_mode_name mode_name_list[] = {
 	{ AUTO_MODE,			"auto"},
 	{ POLL_MODE,			"poll"},
 	{ DIRECT_INTR_MODE,		"direct interrupt"},
 	{ INDIRECT_INTR_MODE,	"indirect interrupt"},
-	{ LEGACY_INTR_MODE,		"legacy interrupt"}
+	{ LEGACY_INTR_MODE,		"legacy interrupt"},
+	{ HYBRID_INTR_MODE,		"hybrid interrupt"}
 };
 
 
@@ -343,6 +347,11 @@ static ssize_t qdma_request_submit_st_c2h(struct xlnx_dma_dev *xdev,
 		unlock_descq(descq);
 		return 0;
 	}
+	/** received data is consumed through the zero copy ring */
+	if (descq->zc_ring) {
+		unlock_descq(descq);
+		return -EBUSY;
+	}
 	if ((descq->q_state == Q_STATE_ONLINE) &&
 			!descq->q_stop_wait) {
 		/* add to pend list even before cidx/pidx update as it could
@@ -1700,44 +1709,17 @@ int qdma_queue_add(unsigned long dev_hndl, struct qdma_queue_conf *qconf,
 	return 0;
 }
 
-/*****************************************************************************/
-/**
- * qdma_queue_start() - start a queue (i.e, online, ready for dma)
- *
- * @param[in]	dev_hndl:	dev_hndl returned from qdma_device_open()
- * @param[in]	id:		queue index
- * @param[in]	buflen:		length of the input buffer
- * @param[out]	buf:		message buffer
- *
- * @return	0: success
- * @return	<0: error
- *****************************************************************************/
-int qdma_queue_start(unsigned long dev_hndl, unsigned long id,
-		     char *buf, int buflen)
+/*
+ * qdma_queue_start_prepare() - validate a queue for start, complete its
+ *	configuration and allocate its resources, the contexts are not touched
+ */
+static int qdma_queue_start_prepare(struct xlnx_dma_dev *xdev,
+		unsigned long id, char *buf, int buflen,
+		struct qdma_descq **descq_out)
 {
 	struct qdma_descq *descq;
-	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
 	int rv;
 
-	/** make sure that input buffer is not empty, else return error */
-	if (!buf || !buflen) {
-		pr_err("invalid argument: buf=%p, buflen=%d", buf, buflen);
-		return -EINVAL;
-	}
-
-	/** make sure that the dev_hndl passed is Valid */
-	if (!xdev) {
-		pr_err("dev_hndl is NULL");
-		snprintf(buf, buflen, "dev_hndl is NULL");
-		return -EINVAL;
-	}
-
-	if (xdev_check_hndl(__func__, xdev->conf.pdev, dev_hndl) < 0) {
-		pr_err("Invalid dev_hndl passed");
-		snprintf(buf, buflen, "Invalid dev_hndl passed");
-		return -EINVAL;
-	}
-
 	descq = qdma_device_get_descq_by_id(xdev, id, buf, buflen, 1);
 	/** make sure that descq is not NULL, else return error*/
 	if (!descq) {
@@ -1821,17 +1803,17 @@ int qdma_queue_start(unsigned long dev_hndl, unsigned long id,
 		return rv;
 	}
 
-	/** program the hw contexts*/
-	rv = qdma_descq_prog_hw(descq);
-	if (rv < 0) {
-		pr_err("%s 0x%x setup failed.\n",
-			descq->conf.name, descq->qidx_hw);
-		snprintf(buf, buflen,
-			"%s prog. context failed.\n",
-			descq->conf.name);
-		goto clear_context;
-	}
+	*descq_out = descq;
 
+	return 0;
+}
+
+/*
+ * qdma_queue_start_finish() - hook a queue with programmed contexts up to
+ *	its interrupt vector and completion thread and bring it online
+ */
+static void qdma_queue_start_finish(struct qdma_descq *descq)
+{
 	/** Interrupt mode */
 	if (descq->xdev->num_vecs) {
 		unsigned long flags;
@@ -1847,13 +1829,69 @@ int qdma_queue_start(unsigned long dev_hndl, unsigned long id,
 
 	qdma_thread_add_work(descq);
 
-	snprintf(buf, buflen, "queue %s, idx %u started\n",
-			descq->conf.name, descq->conf.qidx);
-
 	/** set the descq to online state*/
 	lock_descq(descq);
 	descq->q_state = Q_STATE_ONLINE;
 	unlock_descq(descq);
+}
+
+/*****************************************************************************/
+/**
+ * qdma_queue_start() - start a queue (i.e, online, ready for dma)
+ *
+ * @param[in]	dev_hndl:	dev_hndl returned from qdma_device_open()
+ * @param[in]	id:		queue index
+ * @param[in]	buflen:		length of the input buffer
+ * @param[out]	buf:		message buffer
+ *
+ * @return	0: success
+ * @return	<0: error
+ *****************************************************************************/
+int qdma_queue_start(unsigned long dev_hndl, unsigned long id,
+		     char *buf, int buflen)
+{
+	struct qdma_descq *descq;
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	int rv;
+
+	/** make sure that input buffer is not empty, else return error */
+	if (!buf || !buflen) {
+		pr_err("invalid argument: buf=%p, buflen=%d", buf, buflen);
+		return -EINVAL;
+	}
+
+	/** make sure that the dev_hndl passed is Valid */
+	if (!xdev) {
+		pr_err("dev_hndl is NULL");
+		snprintf(buf, buflen, "dev_hndl is NULL");
+		return -EINVAL;
+	}
+
+	if (xdev_check_hndl(__func__, xdev->conf.pdev, dev_hndl) < 0) {
+		pr_err("Invalid dev_hndl passed");
+		snprintf(buf, buflen, "Invalid dev_hndl passed");
+		return -EINVAL;
+	}
+
+	rv = qdma_queue_start_prepare(xdev, id, buf, buflen, &descq);
+	if (rv < 0)
+		return rv;
+
+	/** program the hw contexts*/
+	rv = qdma_descq_prog_hw(descq);
+	if (rv < 0) {
+		pr_err("%s 0x%x setup failed.\n",
+			descq->conf.name, descq->qidx_hw);
+		snprintf(buf, buflen,
+			"%s prog. context failed.\n",
+			descq->conf.name);
+		goto clear_context;
+	}
+
+	qdma_queue_start_finish(descq);
+
+	snprintf(buf, buflen, "queue %s, idx %u started\n",
+			descq->conf.name, descq->conf.qidx);
 
 	return 0;
 
@@ -1865,6 +1903,98 @@ clear_context:
 	return rv;
 }
 
+/*****************************************************************************/
+/**
+ * qdma_queue_start_list() - start a list of queues, their hw contexts are
+ *	programmed as one batch
+ *
+ * @param[in]	dev_hndl:	dev_hndl returned from qdma_device_open()
+ * @param[in]	id_list:	queue handles
+ * @param[in]	num_q:		number of entries in id_list
+ * @param[in]	buflen:		length of the input buffer
+ * @param[out]	buf:		message buffer
+ *
+ * @return	0: success
+ * @return	<0: error, none of the queues is started
+ *****************************************************************************/
+int qdma_queue_start_list(unsigned long dev_hndl, const unsigned long *id_list,
+		unsigned int num_q, char *buf, int buflen)
+{
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	struct qdma_descq **descq_list;
+	unsigned int i;
+	int rv;
+
+	/** make sure that input buffer is not empty, else return error */
+	if (!buf || !buflen) {
+		pr_err("invalid argument: buf=%p, buflen=%d", buf, buflen);
+		return -EINVAL;
+	}
+
+	/** make sure that the dev_hndl passed is Valid */
+	if (!xdev) {
+		pr_err("dev_hndl is NULL");
+		snprintf(buf, buflen, "dev_hndl is NULL");
+		return -EINVAL;
+	}
+
+	if (xdev_check_hndl(__func__, xdev->conf.pdev, dev_hndl) < 0) {
+		pr_err("Invalid dev_hndl passed");
+		snprintf(buf, buflen, "Invalid dev_hndl passed");
+		return -EINVAL;
+	}
+
+	if (!id_list || !num_q) {
+		pr_err("invalid argument: id_list=%p, num_q=%u",
+			id_list, num_q);
+		snprintf(buf, buflen, "Invalid queue list");
+		return -EINVAL;
+	}
+
+	descq_list = kcalloc(num_q, sizeof(*descq_list), GFP_KERNEL);
+	if (!descq_list) {
+		snprintf(buf, buflen, "OOM, %u queues", num_q);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < num_q; i++) {
+		rv = qdma_queue_start_prepare(xdev, id_list[i], buf, buflen,
+				&descq_list[i]);
+		if (rv < 0)
+			goto free_resource;
+	}
+
+	/** program the hw contexts of all queues*/
+	rv = qdma_descq_prog_hw_list(descq_list, num_q);
+	if (rv < 0) {
+		pr_err("%s, %u queues setup failed.\n",
+			xdev->conf.name, num_q);
+		snprintf(buf, buflen, "%u queues prog. context failed.\n",
+			num_q);
+		goto clear_context;
+	}
+
+	for (i = 0; i < num_q; i++)
+		qdma_queue_start_finish(descq_list[i]);
+
+	snprintf(buf, buflen, "%u queues started\n", num_q);
+	kfree(descq_list);
+
+	return 0;
+
+clear_context:
+	for (i = 0; i < num_q; i++)
+		qdma_descq_context_clear(xdev, descq_list[i]->qidx_hw,
+				descq_list[i]->conf.st,
+				descq_list[i]->conf.q_type, 1);
+free_resource:
+	while (i--)
+		qdma_descq_free_resource(descq_list[i]);
+	kfree(descq_list);
+
+	return rv;
+}
+
 int qdma_get_queue_state(unsigned long dev_hndl, unsigned long id,
 		struct qdma_q_state *q_state, char *buf, int buflen)
 {
@@ -1947,6 +2077,7 @@ int qdma_queue_stop(unsigned long dev_hndl, unsigned long id, char *buf,
 	struct qdma_sgt_req_cb *cb, *tmp;
 	struct qdma_request *req;
 	unsigned int pend_list_empty = 0;
+	unsigned long sub_timeout;
 
 	/** make sure that input buffer is not empty, else return error */
 	if (!buf || !buflen) {
@@ -1987,6 +2118,8 @@ int qdma_queue_stop(unsigned long dev_hndl, unsigned long id, char *buf,
 	}
 	pend_list_empty = descq->pend_list_empty;
 
+	/** descriptors held back by pidx_acc have to reach the hw to drain */
+	qdma_descq_pidx_flush(descq);
 	descq->q_stop_wait = 1;
 	unlock_descq(descq);
 	if (!pend_list_empty) {
@@ -2008,6 +2141,28 @@ int qdma_queue_stop(unsigned long dev_hndl, unsigned long id, char *buf,
 		} else
 			qdma_waitq_wakeup(&cb->wq);
 	}
+	unlock_descq(descq);
+
+	/** submitters that saw the queue online may still be publishing on
+	 *  the submission ring, it is drained only once they are done.
+	 *  Pairs with the barrier in qdma_descq_submit_get().
+	 */
+	smp_mb();
+	sub_timeout = jiffies + msecs_to_jiffies(QDMA_Q_SUB_USERS_TIMEOUT);
+	while (atomic_read(&descq->sub_users)) {
+		if (time_after(jiffies, sub_timeout)) {
+			pr_err("%s: %d submitters still active after %u ms, giving up.\n",
+				descq->conf.name,
+				atomic_read(&descq->sub_users),
+				QDMA_Q_SUB_USERS_TIMEOUT);
+			break;
+		}
+		usleep_range(10, 50);
+	}
+
+	lock_descq(descq);
+	/** requests still on the submission ring are cancelled as well */
+	qdma_work_queue_drain(descq);
 	list_for_each_entry_safe(cb, tmp, &descq->work_list, list) {
 		req = (struct qdma_request *)cb;
 		cb->done = 1;
@@ -2020,6 +2175,8 @@ int qdma_queue_stop(unsigned long dev_hndl, unsigned long id, char *buf,
 	}
 	unlock_descq(descq);
 
+	hrtimer_cancel(&descq->pidx_timer);
+
 	/** remove the work thread associated with the current queue */
 	qdma_thread_remove_work(descq);
 
@@ -2469,22 +2626,25 @@ ssize_t qdma_request_submit(unsigned long dev_hndl, unsigned long id,
 		cb->unmap_needed = 1;
 	}
 
-	lock_descq(descq);
 	/**  if the descq is already in online state*/
-	if (descq->q_state != Q_STATE_ONLINE) {
-		unlock_descq(descq);
+	if (!qdma_descq_submit_get(descq)) {
 		pr_err("%s descq %s NOT online.\n",
 			xdev->conf.name, descq->conf.name);
 		rv = -EINVAL;
 		goto unmap_sgl;
 	}
-	qdma_work_queue_add(descq, cb);
-	unlock_descq(descq);
+	rv = qdma_descq_submit_request(descq, cb);
+	if (!rv)
+		qdma_descq_proc_submitted(descq);
+	qdma_descq_submit_put(descq);
+	if (rv < 0) {
+		pr_err("%s descq %s NOT online.\n",
+			xdev->conf.name, descq->conf.name);
+		goto unmap_sgl;
+	}
 
 	pr_debug("%s: cb 0x%p submitted.\n", descq->conf.name, cb);
 
-	qdma_descq_proc_sgt_request(descq);
-
 	if (!wait)
 		return 0;
 
@@ -2613,10 +2773,8 @@ ssize_t qdma_batch_request_submit(unsigned long dev_hndl, unsigned long id,
 		}
 	}
 
-	lock_descq(descq);
 	/**  if the descq is already in online state*/
-	if (unlikely(descq->q_state != Q_STATE_ONLINE)) {
-		unlock_descq(descq);
+	if (unlikely(!qdma_descq_submit_get(descq))) {
 		pr_err("%s descq %s NOT online.\n", xdev->conf.name,
 				descq->conf.name);
 		return -EINVAL;
@@ -2626,11 +2784,29 @@ ssize_t qdma_batch_request_submit(unsigned long dev_hndl, unsigned long id,
 		req = reqv[i];
 		cb = qdma_req_cb_get(req);
 
-		list_add_tail(&cb->list, &descq->work_list);
+		rv = qdma_descq_submit_request(descq, cb);
+		if (unlikely(rv < 0))
+			break;
+	}
+
+	/** the queue went offline, the requests queued so far are
+	 *  cancelled by qdma_queue_stop(), fail the rest
+	 */
+	for (; i < count; i++) {
+		req = reqv[i];
+		cb = qdma_req_cb_get(req);
+
+		if (cb->unmap_needed) {
+			sgl_unmap(xdev->conf.pdev, req->sgl, req->sgcnt, dir);
+			cb->unmap_needed = 0;
+		}
+		cb->done = 1;
+		cb->status = -ENXIO;
+		req->fp_done(req, 0, -ENXIO);
 	}
-	unlock_descq(descq);
 
-	qdma_descq_proc_sgt_request(descq);
+	qdma_descq_proc_submitted(descq);
+	qdma_descq_submit_put(descq);
 
 	return 0;
 }
@@ -82,6 +82,12 @@
  */
 #define QDMA_QUEUE_VEC_INVALID	0xFF
 
+/**
+ * QDMA_PIDX_ACC_USECS_DEFAULT - Default max delay of a PIDX update held
+ * back by pidx_acc
+ */
+#define QDMA_PIDX_ACC_USECS_DEFAULT	20
+
 /**
  * QDMA_REQ_OPAQUE_SIZE - Maximum request length.
  * QDMA_REQ_OPAQUE_SIZE varies according to kernel params.
@@ -161,7 +167,15 @@ enum qdma_drv_mode {
 	 *  @param LEGACY_INTR_MODE Driver is inserted in legacy interrupt mode
 	 *  Software serves status updates upon receiving the legacy interrupt
 	 */
-	LEGACY_INTR_MODE
+	LEGACY_INTR_MODE,
+	/**
+	 *  @param HYBRID_INTR_MODE Interrupts are set up as in
+	 *  INDIRECT_INTR_MODE, or as in DIRECT_INTR_MODE when there is a data
+	 *  vector per queue at device open. On an interrupt the queue is left disarmed and serviced
+	 *  in budgeted poll rounds, its interrupt is re-armed only once the
+	 *  ring has been drained
+	 */
+	HYBRID_INTR_MODE
 };
 
 /**
@@ -664,11 +678,20 @@ struct qdma_queue_conf {
 
 	/**  MM Channel */
 	u8 mm_channel:1;
+	/**  place the free list and queue state on numa_node, not the device node */
+	u8 numa_node_en:1;
+	/**  NUMA node used when numa_node_en is set */
+	u16 numa_node;
 
 	/**  user provided per-Q irq handler */
 	unsigned long quld;		/* set by user for per Q data */
 	/**  acummulate PIDX to batch packets */
 	u32 pidx_acc:8;
+	/**
+	 *  max usecs a PIDX update may be held back by pidx_acc,
+	 *  0 selects QDMA_PIDX_ACC_USECS_DEFAULT
+	 */
+	u32 pidx_acc_usecs:16;
 	/**
 	 *  @brief  Q interrupt top, per-queue additional handling
 	 *  code for example, network rx napi_schedule(&Q->napi)
@@ -1277,6 +1300,23 @@ int qdma_queue_config(unsigned long dev_hndl, unsigned long qid,
 int qdma_queue_start(unsigned long dev_hndl, unsigned long id,
 						char *buf, int buflen);
 
+/*****************************************************************************/
+/**
+ * start a list of queues, their contexts are programmed as one batch
+ *
+ * @param dev_hndl	dev_hndl returned from qdma_device_open()
+ * @param id_list	the opaque qhndls
+ * @param num_q		number of entries in id_list
+ * @param buflen	length of the input buffer
+ * @param buf		message buffer
+ *
+ * @returns		0 for success and <0 for error, no queue is started
+ *			on error
+ *
+ *****************************************************************************/
+int qdma_queue_start_list(unsigned long dev_hndl, const unsigned long *id_list,
+			unsigned int num_q, char *buf, int buflen);
+
 /*****************************************************************************/
 /**
  * Stop a queue (i.e., offline, NOT ready for dma)
@@ -1555,6 +1595,116 @@ int qdma_queue_packet_read(unsigned long dev_hndl, unsigned long id,
 int qdma_queue_packet_write(unsigned long dev_hndl, unsigned long id,
 			struct qdma_request *req);
 
+struct qdma_cdev_zc_info;
+struct vm_area_struct;
+
+/*****************************************************************************/
+/**
+ * Switch a ST C2H queue to zero copy receive. Received packets are left in
+ * the free list buffers and described in a struct qdma_zc_rx_ring, both
+ * can be mapped with qdma_queue_c2h_zc_mmap(). Regular reads fail with
+ * -EBUSY until qdma_queue_c2h_zc_disable() is called.
+ *
+ * @param dev_hndl	hndl returned from qdma_device_open()
+ * @param id		queue hndl returned from qdma_queue_add()
+ * @param info		filled in with the layout of the receive area
+ *
+ * @returns		0 for success or <0 for error
+ *
+ *****************************************************************************/
+int qdma_queue_c2h_zc_enable(unsigned long dev_hndl, unsigned long id,
+			struct qdma_cdev_zc_info *info);
+
+/*****************************************************************************/
+/**
+ * Leave zero copy receive, entries not released yet are recycled
+ *
+ * @param dev_hndl	hndl returned from qdma_device_open()
+ * @param id		queue hndl returned from qdma_queue_add()
+ *
+ * @returns		0 for success or <0 for error
+ *
+ *****************************************************************************/
+int qdma_queue_c2h_zc_disable(unsigned long dev_hndl, unsigned long id);
+
+/*****************************************************************************/
+/**
+ * Map the zero copy receive area read-only into @vma
+ *
+ * @param dev_hndl	hndl returned from qdma_device_open()
+ * @param id		queue hndl returned from qdma_queue_add()
+ * @param vma		user mapping, offset 0 and the length reported by
+ *			qdma_queue_c2h_zc_enable()
+ *
+ * @returns		0 for success or <0 for error
+ *
+ *****************************************************************************/
+int qdma_queue_c2h_zc_mmap(unsigned long dev_hndl, unsigned long id,
+			struct vm_area_struct *vma);
+
+/*****************************************************************************/
+/**
+ * Hand consumed zero copy ring entries back to the free list
+ *
+ * @param dev_hndl	hndl returned from qdma_device_open()
+ * @param id		queue hndl returned from qdma_queue_add()
+ * @param cnt		number of entries, starting at the ring's cons index
+ *
+ * @returns		0 for success or <0 for error
+ *
+ *****************************************************************************/
+int qdma_queue_c2h_zc_release(unsigned long dev_hndl, unsigned long id,
+			unsigned int cnt);
+
+/**
+ * QDMA_DMAENG_WIN_SZ_DEFAULT - default size of the card window used to
+ * stage the memcpy chunks of a dmaengine channel
+ */
+#define QDMA_DMAENG_WIN_SZ_DEFAULT	(64 * 1024)
+
+/*****************************************************************************/
+/**
+ * Register MM queue pairs as dmaengine channels. Each channel takes the
+ * highest free queue index, slave and interleaved transfers use the card
+ * address given by the client, memcpy is staged through @win_sz bytes of
+ * card memory at @win_base + channel * @win_sz.
+ *
+ * @param dev_hndl	dev_hndl returned from qdma_device_open()
+ * @param num_chans	number of channels
+ * @param win_base	card address of the first memcpy staging window
+ * @param win_sz	size of a memcpy staging window
+ *
+ * @returns		0 for success or <0 for error
+ *
+ *****************************************************************************/
+int qdma_dmaengine_register(unsigned long dev_hndl, unsigned int num_chans,
+			u64 win_base, unsigned int win_sz);
+
+/*****************************************************************************/
+/**
+ * Unregister the dmaengine channels and remove their queues
+ *
+ * @param dev_hndl	dev_hndl returned from qdma_device_open()
+ * @param wait		wait for the clients to release their channels
+ *			instead of failing, no new client gets a channel
+ *			in the meantime
+ *
+ * @returns		0 for success, -EBUSY if a channel is in use
+ *
+ *****************************************************************************/
+int qdma_dmaengine_unregister(unsigned long dev_hndl, int wait);
+
+/*****************************************************************************/
+/**
+ * Number of dmaengine channels registered
+ *
+ * @param dev_hndl	dev_hndl returned from qdma_device_open()
+ *
+ * @returns		number of channels, 0 if none
+ *
+ *****************************************************************************/
+unsigned int qdma_dmaengine_chan_count(unsigned long dev_hndl);
+
 /*****************************************************************************/
 /**
  * Service the queue in the case of irq handler is registered by the user,
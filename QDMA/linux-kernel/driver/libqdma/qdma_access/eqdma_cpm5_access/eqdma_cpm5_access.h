@@ -272,6 +272,10 @@ int eqdma_cpm5_indirect_intr_ctx_conf(void *dev_hndl, uint16_t ring_index,
 			struct qdma_indirect_intr_ctxt *ctxt,
 			enum qdma_hw_access_type access_type);
 
+int eqdma_cpm5_queue_ctxt_prog_batch(void *dev_hndl,
+			struct qdma_descq_ctxt_prog *q_list,
+			uint16_t num_q);
+
 int eqdma_cpm5_dump_config_regs(void *dev_hndl, uint8_t is_vf,
 		char *buf, uint32_t buflen);
 
@@ -501,6 +501,26 @@ struct qdma_descq_context {
 	struct qdma_descq_cmpt_ctxt cmpt_ctxt;
 };
 
+/**
+ * struct qdma_descq_ctxt_prog - queue contexts to be programmed as part
+ *	of a batch, see qdma_hw_access.qdma_queue_ctxt_prog_batch
+ *
+ * The contexts selected by @st and @q_type are cleared first and then, if
+ * @ctxt is given, the sw, prefetch and completion contexts are written
+ * in the same order as for individual programming. qid2vec is not part
+ * of the batch.
+ */
+struct qdma_descq_ctxt_prog {
+	/** @hw_qid - hardware qid of the queue */
+	uint16_t hw_qid;
+	/** @st - streaming queue */
+	uint8_t st;
+	/** @q_type - queue type */
+	enum qdma_dev_q_type q_type;
+	/** @ctxt - contexts to be written, NULL to only clear */
+	struct qdma_descq_context *ctxt;
+};
+
 /**
  * struct qdma_q_pidx_reg_info - Software PIDX register fields
  */
@@ -642,6 +662,47 @@ int hw_monitor_reg(void *dev_hndl, uint32_t reg, uint32_t mask,
 		uint32_t val, uint32_t interval_us,
 		uint32_t timeout_us);
 
+/**
+ * struct qdma_ind_ctxt_batch - state of a batched indirect context
+ *	programming sequence
+ *
+ * The register access lock is held from qdma_ind_ctxt_batch_start() to
+ * qdma_ind_ctxt_batch_end(). Mask registers are written once, data
+ * registers only when their value changes, and the busy bit is only
+ * polled before the data registers are rewritten.
+ */
+struct qdma_ind_ctxt_batch {
+	/** @dev_hndl - device handle */
+	void *dev_hndl;
+	/** @data_addr - address of the first context data register */
+	uint32_t data_addr;
+	/** @mask_addr - address of the first context mask register */
+	uint32_t mask_addr;
+	/** @cmd_addr - address of the context command register */
+	uint32_t cmd_addr;
+	/** @busy_mask - busy bit of the context command register */
+	uint32_t busy_mask;
+	/** @num_regs - number of context data/mask registers */
+	uint16_t num_regs;
+	/** @mask_valid - mask registers are programmed */
+	uint8_t mask_valid;
+	/** @cmd_pend - commands issued since the last busy poll */
+	uint8_t cmd_pend;
+	/** @data_valid - bitmap of data registers holding @data */
+	uint32_t data_valid;
+	/** @data - last values written to the data registers */
+	uint32_t data[QDMA_IND_CTXT_DATA_NUM_REGS];
+};
+
+void qdma_ind_ctxt_batch_start(struct qdma_ind_ctxt_batch *batch,
+		void *dev_hndl, uint32_t data_addr, uint32_t mask_addr,
+		uint32_t cmd_addr, uint32_t busy_mask, uint16_t num_regs);
+
+int qdma_ind_ctxt_batch_cmd(struct qdma_ind_ctxt_batch *batch,
+		uint32_t cmd, const uint32_t *data, uint16_t cnt);
+
+int qdma_ind_ctxt_batch_end(struct qdma_ind_ctxt_batch *batch);
+
 void qdma_memset(void *to, uint8_t val, uint32_t size);
 
 int qdma_acc_reg_dump_buf_len(void *dev_hndl, enum qdma_ip_type ip_type,
@@ -695,6 +756,9 @@ struct qdma_hw_access {
 	int (*qdma_indirect_intr_ctx_conf)(void *dev_hndl, uint16_t ring_index,
 					struct qdma_indirect_intr_ctxt *ctxt,
 					enum qdma_hw_access_type access_type);
+	int (*qdma_queue_ctxt_prog_batch)(void *dev_hndl,
+					struct qdma_descq_ctxt_prog *q_list,
+					uint16_t num_q);
 	int (*qdma_queue_pidx_update)(void *dev_hndl, uint8_t is_vf,
 				uint16_t qid,
 				uint8_t is_c2h,
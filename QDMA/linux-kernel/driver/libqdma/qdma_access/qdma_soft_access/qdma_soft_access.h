@@ -203,6 +203,10 @@ int qdma_indirect_intr_ctx_conf(void *dev_hndl, uint16_t ring_index,
 				struct qdma_indirect_intr_ctxt *ctxt,
 				enum qdma_hw_access_type access_type);
 
+int qdma_queue_ctxt_prog_batch(void *dev_hndl,
+				struct qdma_descq_ctxt_prog *q_list,
+				uint16_t num_q);
+
 int qdma_queue_pidx_update(void *dev_hndl, uint8_t is_vf, uint16_t qid,
 		uint8_t is_c2h, const struct qdma_q_pidx_reg_info *reg_info);
 
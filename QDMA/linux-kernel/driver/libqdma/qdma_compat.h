@@ -103,5 +103,22 @@
 
 #endif /* timer */
 
+/**
+ * kcalloc_node() was added in 4.14
+ */
+#if KERNEL_VERSION(4, 14, 0) > LINUX_VERSION_CODE
+#include <linux/kernel.h>
+#include <linux/slab.h>
+
+static inline void *qdma_kcalloc_node(size_t n, size_t size, gfp_t flags,
+				int node)
+{
+	if (size != 0 && n > SIZE_MAX / size)
+		return NULL;
+	return kzalloc_node(n * size, flags, node);
+}
+#define kcalloc_node	qdma_kcalloc_node
+#endif
+
 
 #endif /* #ifndef __QDMA_COMPAT_H */
@@ -494,6 +494,22 @@ err_out:
 	return rv;
 }
 
+int qdma_descq_context_setup_list(struct qdma_descq **descq_list,
+			unsigned int num_q)
+{
+	unsigned int i;
+	int rv;
+
+	/* the contexts of a vf are programmed by the pf, one message each */
+	for (i = 0; i < num_q; i++) {
+		rv = qdma_descq_context_setup(descq_list[i]);
+		if (rv < 0)
+			return rv;
+	}
+
+	return 0;
+}
+
 int qdma_descq_context_dump(struct qdma_descq *descq, char *buf, int buflen)
 {
 	int rv = 0;
@@ -736,33 +752,102 @@ int qdma_descq_context_clear(struct xlnx_dma_dev *xdev, unsigned int qid_hw,
 	return 0;
 }
 
-int qdma_descq_context_setup(struct qdma_descq *descq)
+static void make_descq_context(struct qdma_descq *descq,
+			struct qdma_descq_context *context)
 {
-	struct qdma_descq_context context;
-
-	memset(&context, 0, sizeof(context));
+	memset(context, 0, sizeof(*context));
 
 	if (descq->conf.q_type != Q_CMPT) {
 
-		make_sw_context(descq, &context.sw_ctxt);
+		make_sw_context(descq, &context->sw_ctxt);
 
 		if (descq->xdev->dev_cap.qid2vec_ctx) {
 			if (descq->xdev->conf.qdma_drv_mode != POLL_MODE)
-				make_qid2vec_context(descq, &context.qid2vec);
+				make_qid2vec_context(descq, &context->qid2vec);
 		}
 
 		if (descq->conf.st && (descq->conf.q_type == Q_C2H))
-			make_prefetch_context(descq, &context.pfetch_ctxt);
+			make_prefetch_context(descq, &context->pfetch_ctxt);
 	}
 
 	if ((descq->conf.st && (descq->conf.q_type == Q_C2H)) ||
 		(!descq->conf.st && (descq->conf.q_type == Q_CMPT)))
-		make_cmpt_context(descq, &context.cmpt_ctxt);
+		make_cmpt_context(descq, &context->cmpt_ctxt);
+}
+
+/*
+ * qid2vec is not part of the batch and has to be written between the sw and
+ * prefetch contexts, such queues are programmed one context at a time
+ */
+static bool descq_context_batchable(struct xlnx_dma_dev *xdev, u8 type)
+{
+	return xdev->hw.qdma_queue_ctxt_prog_batch &&
+		!((type != Q_CMPT) && xdev->dev_cap.qid2vec_ctx &&
+		  (xdev->conf.qdma_drv_mode != POLL_MODE));
+}
+
+int qdma_descq_context_setup(struct qdma_descq *descq)
+{
+	struct qdma_descq_context context;
+
+	make_descq_context(descq, &context);
 
 	return qdma_descq_context_program(descq->xdev, descq->qidx_hw,
 				descq->conf.st, descq->conf.q_type, &context);
 }
 
+int qdma_descq_context_setup_list(struct qdma_descq **descq_list,
+			unsigned int num_q)
+{
+	struct xlnx_dma_dev *xdev = descq_list[0]->xdev;
+	struct qdma_descq_context *context;
+	struct qdma_descq_ctxt_prog *prog;
+	struct qdma_descq *descq;
+	unsigned int i, n = 0;
+	int rv = 0;
+
+	prog = kcalloc(num_q, sizeof(*prog), GFP_KERNEL);
+	context = kcalloc(num_q, sizeof(*context), GFP_KERNEL);
+	if (!prog || !context) {
+		rv = -ENOMEM;
+		goto free_list;
+	}
+
+	for (i = 0; i < num_q; i++) {
+		descq = descq_list[i];
+		if (!descq_context_batchable(xdev, descq->conf.q_type)) {
+			rv = qdma_descq_context_setup(descq);
+			if (rv < 0)
+				goto free_list;
+			continue;
+		}
+
+		make_descq_context(descq, &context[n]);
+		prog[n].hw_qid = descq->qidx_hw;
+		prog[n].st = descq->conf.st;
+		prog[n].q_type = (enum qdma_dev_q_type)descq->conf.q_type;
+		prog[n].ctxt = &context[n];
+		n++;
+	}
+
+	/* clear and program the contexts of all queues under one lock hold */
+	for (i = 0; i < n; i += U16_MAX) {
+		rv = xdev->hw.qdma_queue_ctxt_prog_batch(xdev, prog + i,
+				min_t(unsigned int, n - i, U16_MAX));
+		if (rv < 0) {
+			pr_err("failed to program %u contexts, rv= %d",
+				n, rv);
+			rv = xdev->hw.qdma_get_error_code(rv);
+			goto free_list;
+		}
+	}
+
+free_list:
+	kfree(context);
+	kfree(prog);
+	return rv;
+}
+
 int qdma_descq_context_read(struct xlnx_dma_dev *xdev, unsigned int qid_hw,
 			bool st, u8 type, struct qdma_descq_context *context)
 {
@@ -844,8 +929,24 @@ int qdma_intr_context_read(struct xlnx_dma_dev *xdev,
 int qdma_descq_context_program(struct xlnx_dma_dev *xdev, unsigned int qid_hw,
 			bool st, u8 type, struct qdma_descq_context *context)
 {
+	struct qdma_descq_ctxt_prog prog;
 	int rv;
 
+	if (descq_context_batchable(xdev, type)) {
+		/* clear and program sw/pfetch/cmpt under one lock hold */
+		prog.hw_qid = qid_hw;
+		prog.st = st;
+		prog.q_type = (enum qdma_dev_q_type)type;
+		prog.ctxt = context;
+		rv = xdev->hw.qdma_queue_ctxt_prog_batch(xdev, &prog, 1);
+		if (rv < 0) {
+			pr_err("failed to program the context, rv= %d", rv);
+			return xdev->hw.qdma_get_error_code(rv);
+		}
+
+		return 0;
+	}
+
 	/* always clear first */
 	rv = qdma_descq_context_clear(xdev, qid_hw, st, type, 1);
 	if (rv < 0) {
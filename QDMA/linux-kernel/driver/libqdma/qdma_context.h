@@ -73,6 +73,20 @@ int qdma_prog_intr_context(struct xlnx_dma_dev *xdev,
  *****************************************************************************/
 int qdma_descq_context_setup(struct qdma_descq *descq);
 
+/*****************************************************************************/
+/**
+ * qdma_descq_context_setup_list() - set up the contexts of a list of queues,
+ *	batching their indirect context programming where the device allows
+ *
+ * @param[in]	descq_list:	queues of one device
+ * @param[in]	num_q:		number of entries in descq_list
+ *
+ * @return	0: success
+ * @return	<0: failure
+ *****************************************************************************/
+int qdma_descq_context_setup_list(struct qdma_descq **descq_list,
+			unsigned int num_q);
+
 /*****************************************************************************/
 /**
  * qdma_descq_context_clear() - handler to clear the qdma sw descriptor context
@@ -150,6 +150,23 @@ static inline unsigned int incr_pidx(unsigned int pidx, unsigned int incr_val,
 	return pidx;
 }
 
+/*
+ * the pidx deadline timer takes the descq lock, so it has to run in softirq
+ * context. Older kernels only have hard irq hrtimers, the callback has to
+ * try the lock there and retry a little later if it is busy.
+ */
+#if KERNEL_VERSION(4, 16, 0) <= LINUX_VERSION_CODE
+#define QDMA_PIDX_TIMER_MODE	HRTIMER_MODE_REL_SOFT
+#else
+#define QDMA_PIDX_TIMER_MODE	HRTIMER_MODE_REL
+#endif
+
+/*
+ * write descq->pidx_info to the PIDX register unless the update can be held
+ * back: descriptors are accumulated until pidx_acc of them are pending or
+ * the oldest one waited pidx_acc_usecs, whichever comes first.
+ * called with the descq lock held
+ */
 static inline int qdma_pidx_update(struct qdma_descq *descq,
 				unsigned char force)
 {
@@ -164,8 +181,17 @@ static inline int qdma_pidx_update(struct qdma_descq *descq,
 		goto update;
 
 	/* accumulating descs to be submitted */
-	if (descq->desc_pend < descq->conf.pidx_acc)
+	if (descq->desc_pend < descq->conf.pidx_acc) {
+		descq->pidx_db_saved++;
+		if (!descq->pidx_pend_ns) {
+			descq->pidx_pend_ns = ktime_get_ns();
+			hrtimer_start(&descq->pidx_timer,
+				ns_to_ktime((u64)descq->conf.pidx_acc_usecs *
+					    NSEC_PER_USEC),
+				QDMA_PIDX_TIMER_MODE);
+		}
 		goto exit_update;
+	}
 
 update:
 	ret = queue_pidx_update(descq->xdev, descq->conf.qidx,
@@ -176,12 +202,72 @@ update:
 		return -EINVAL;
 	}
 
+	descq->pidx_db_cnt++;
+	if (descq->pidx_pend_ns) {
+		descq->pidx_acc_lat_ns += ktime_get_ns() - descq->pidx_pend_ns;
+		descq->pidx_pend_ns = 0;
+		/* may be the timer itself, it does not re-arm */
+		hrtimer_try_to_cancel(&descq->pidx_timer);
+	}
 	descq->desc_pend = 0;
 
 exit_update:
 	return ret;
 }
 
+static enum hrtimer_restart descq_pidx_timer_fn(struct hrtimer *timer)
+{
+	struct qdma_descq *descq = container_of(timer, struct qdma_descq,
+						pidx_timer);
+	int rv = -ENODATA;
+
+#if KERNEL_VERSION(4, 16, 0) <= LINUX_VERSION_CODE
+	lock_descq(descq);
+#else
+	if (!spin_trylock(&descq->lock)) {
+		hrtimer_forward_now(timer, ns_to_ktime(NSEC_PER_USEC));
+		return HRTIMER_RESTART;
+	}
+#endif
+	if (descq->q_state == Q_STATE_ONLINE && descq->desc_pend) {
+		descq->pidx_db_timeout++;
+		rv = qdma_pidx_update(descq, 1);
+	}
+#if KERNEL_VERSION(4, 16, 0) <= LINUX_VERSION_CODE
+	unlock_descq(descq);
+#else
+	spin_unlock(&descq->lock);
+#endif
+
+	if (!rv && descq->cmplthp)
+		qdma_kthread_wakeup(descq->cmplthp);
+
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * complete the requests left on the submission ring of a queue that is not
+ * online anymore, called with the descq lock held
+ */
+static void descq_cancel_sub_ring(struct qdma_descq *descq)
+{
+	struct qdma_sgt_req_cb *cb;
+	struct qdma_request *req;
+
+	if (!descq->sub_ring.slot)
+		return;
+
+	while ((cb = qdma_req_ring_dequeue(&descq->sub_ring))) {
+		req = (struct qdma_request *)cb;
+		cb->done = 1;
+		cb->status = -ENXIO;
+		if (req->fp_done)
+			req->fp_done(req, 0, -ENXIO);
+		else
+			qdma_waitq_wakeup(&cb->wq);
+	}
+}
+
 static ssize_t descq_mm_proc_request(struct qdma_descq *descq)
 {
 	int rv = 0;
@@ -222,6 +308,7 @@ static ssize_t descq_mm_proc_request(struct qdma_descq *descq)
 		return 0;
 	}
 	if (unlikely(descq->q_state != Q_STATE_ONLINE)) {
+		descq_cancel_sub_ring(descq);
 		unlock_descq(descq);
 		return 0;
 	}
@@ -231,6 +318,8 @@ static ssize_t descq_mm_proc_request(struct qdma_descq *descq)
 		return 0;
 	}
 
+	qdma_work_queue_drain(descq);
+
 	pidx = descq->pidx;
 	desc = (struct qdma_mm_desc *)descq->desc + pidx;
 
@@ -411,8 +500,8 @@ update_pidx:
 	if (desc_written) {
 		descq->pend_list_empty = 0;
 		descq->pidx_info.pidx = descq->pidx;
-		rv = queue_pidx_update(descq->xdev, descq->conf.qidx,
-				descq->conf.q_type, &descq->pidx_info);
+		descq->desc_pend += desc_written;
+		rv = qdma_pidx_update(descq, 0);
 		if (unlikely(rv < 0)) {
 			pr_err("%s: Failed to update pidx\n",
 					descq->conf.name);
@@ -455,11 +544,13 @@ static ssize_t descq_proc_st_h2c_request_qep(struct qdma_descq *descq)
 	}
 
 	if (unlikely(descq->q_state != Q_STATE_ONLINE)) {
+		descq_cancel_sub_ring(descq);
 		unlock_descq(descq);
 		return 0;
 	}
 
 setup_desc:
+	qdma_work_queue_drain(descq);
 	while (qdma_work_queue_len(descq) && descq->avail) {
 		req = qdma_work_queue_first_entry(descq);
 		desc_cnt = descq->conf.fp_bypass_desc_fill(descq,
@@ -476,7 +567,7 @@ setup_desc:
 
 	if (unlikely(!desc_written)) {
 		/* packet queued while holding lock and no interrupt pending */
-		if (unlikely(qdma_work_queue_len(descq) &&
+		if (unlikely(qdma_work_queue_pending(descq) &&
 				descq->avail == descq->conf.rngsz - 1)) {
 			unlock_descq(descq);
 			descq_proc_st_h2c_request_qep(descq);
@@ -497,7 +588,8 @@ setup_desc:
 		return -EINVAL;
 	}
 
-	if (descq->work_req_pend && (desc_written >= descq->conf.pidx_acc)) {
+	if (qdma_work_queue_pending(descq) &&
+			(desc_written >= descq->conf.pidx_acc)) {
 		desc_written = 0;
 		goto setup_desc;
 	}
@@ -529,6 +621,7 @@ static ssize_t descq_proc_st_h2c_request(struct qdma_descq *descq)
 		return 0;
 	}
 	if (unlikely(descq->q_state != Q_STATE_ONLINE)) {
+		descq_cancel_sub_ring(descq);
 		unlock_descq(descq);
 		return 0;
 	}
@@ -538,6 +631,8 @@ static ssize_t descq_proc_st_h2c_request(struct qdma_descq *descq)
 		return 0;
 	}
 
+	qdma_work_queue_drain(descq);
+
 	qdev = xdev_2_qdev(descq->xdev);
 	/* service completion first */
 	descq_poll_mm_n_h2c_cmpl_status(descq);
@@ -695,9 +790,8 @@ update_pidx:
 				pr_err("Err: Tx Time Offset is NULL\n");
 		}
 
-
-		ret = queue_pidx_update(descq->xdev, descq->conf.qidx,
-				descq->conf.q_type, &descq->pidx_info);
+		descq->desc_pend += desc_written;
+		ret = qdma_pidx_update(descq, 0);
 		if (ret < 0) {
 			pr_err("%s: Failed to update pidx\n",
 					descq->conf.name);
@@ -751,6 +845,9 @@ static inline void desc_ring_free(struct xlnx_dma_dev *xdev, int ring_sz,
 			desc, desc_bus);
 }
 
+/* rings are coherent memory and stay on the node of the device,
+ * dma_alloc_coherent() has no node argument
+ */
 static void *desc_ring_alloc(struct xlnx_dma_dev *xdev, int ring_sz,
 			int desc_sz, int cs_sz, dma_addr_t *bus, u8 **cs_pp)
 {
@@ -772,6 +869,24 @@ static void *desc_ring_alloc(struct xlnx_dma_dev *xdev, int ring_sz,
 	return p;
 }
 
+/* NUMA node for the free list and the software state of a queue, the
+ * requested node if it is online, the node of the device otherwise
+ */
+static int descq_numa_node(struct qdma_descq *descq)
+{
+	int node = descq->conf.numa_node;
+
+	if (descq->conf.numa_node_en && node < MAX_NUMNODES &&
+			node_online(node))
+		return node;
+
+	if (descq->conf.numa_node_en)
+		pr_warn("%s, node %d is not online, using the device node.\n",
+			descq->conf.name, node);
+
+	return dev_to_node(&descq->xdev->conf.pdev->dev);
+}
+
 static void desc_alloc_irq(struct qdma_descq *descq)
 {
 	struct xlnx_dma_dev *xdev = descq->xdev;
@@ -904,6 +1019,14 @@ static int descq_mm_n_h2c_cmpl_status(struct qdma_descq *descq)
 
 /* ************** public function definitions ******************************* */
 
+int qdma_descq_pidx_flush(struct qdma_descq *descq)
+{
+	if (!descq->desc_pend)
+		return 0;
+
+	return qdma_pidx_update(descq, 1);
+}
+
 void qdma_descq_init(struct qdma_descq *descq, struct xlnx_dma_dev *xdev,
 			int idx_hw, int idx_sw)
 {
@@ -919,6 +1042,13 @@ void qdma_descq_init(struct qdma_descq *descq, struct xlnx_dma_dev *xdev,
 	INIT_LIST_HEAD(&descq->intr_list);
 	INIT_LIST_HEAD(&descq->legacy_intr_q_list);
 	INIT_WORK(&descq->work, intr_work);
+#if KERNEL_VERSION(6, 13, 0) <= LINUX_VERSION_CODE
+	hrtimer_setup(&descq->pidx_timer, descq_pidx_timer_fn, CLOCK_MONOTONIC,
+			QDMA_PIDX_TIMER_MODE);
+#else
+	hrtimer_init(&descq->pidx_timer, CLOCK_MONOTONIC, QDMA_PIDX_TIMER_MODE);
+	descq->pidx_timer.function = descq_pidx_timer_fn;
+#endif
 	descq->xdev = xdev;
 	descq->channel = 0;
 	descq->qidx_hw = qdev->qbase + idx_hw;
@@ -1069,6 +1199,8 @@ int qdma_descq_alloc_resource(struct qdma_descq *descq)
 	u8 *desc_bypass;
 	u8 bypass_data[DESC_SZ_64B_BYTES];
 #endif
+	descq->node = descq_numa_node(descq);
+
 	/* descriptor ring */
 	if (descq->conf.q_type != Q_CMPT) {
 		descq->desc = desc_ring_alloc(xdev, descq->conf.rngsz,
@@ -1126,9 +1258,9 @@ int qdma_descq_alloc_resource(struct qdma_descq *descq)
 		int i;
 		unsigned int desc_sz = get_desc_size(descq);
 
-		descq->desc_list = kcalloc(descq->conf.rngsz,
+		descq->desc_list = kcalloc_node(descq->conf.rngsz,
 					   sizeof(struct qdma_q_desc_list),
-					   GFP_KERNEL);
+					   GFP_KERNEL, descq->node);
 		if (!descq->desc_list) {
 			pr_err("desc_list allocation failed.OOM");
 			goto err_out;
@@ -1164,6 +1296,22 @@ int qdma_descq_alloc_resource(struct qdma_descq *descq)
 
 	}
 
+	/* lock free submission ring for MM and ST H2C requests */
+	if ((descq->conf.q_type != Q_CMPT) &&
+			!(descq->conf.st && (descq->conf.q_type == Q_C2H))) {
+		struct qdma_req_ring_slot *slot;
+
+		slot = kcalloc_node(QDMA_REQ_RING_SZ,
+			       sizeof(struct qdma_req_ring_slot), GFP_KERNEL,
+			       descq->node);
+		if (!slot) {
+			pr_err("dev %s, descq %s, submission ring OOM.\n",
+				xdev->conf.name, descq->conf.name);
+			goto err_out;
+		}
+		qdma_req_ring_init(&descq->sub_ring, slot, QDMA_REQ_RING_SZ);
+	}
+
 	pr_debug("%s: %u/%u, rng %u,%u, desc 0x%p, cmpl status 0x%p.\n",
 		descq->conf.name, descq->conf.qidx, descq->qidx_hw,
 		descq->conf.rngsz, descq->conf.rngsz_cmpt, descq->desc,
@@ -1220,6 +1368,17 @@ void qdma_descq_free_resource(struct qdma_descq *descq)
 		descq->desc_bus = 0UL;
 	}
 
+	/* a submitter qdma_queue_stop() gave up on may still use the ring,
+	 * it is left to that submitter rather than freed under it
+	 */
+	if (unlikely(atomic_read(&descq->sub_users))) {
+		pr_err("%s: submission ring still in use, leaking it.\n",
+			descq->conf.name);
+	} else {
+		kfree(descq->sub_ring.slot);
+		descq->sub_ring.slot = NULL;
+	}
+
 	if (descq->desc_cmpt) {
 		desc_ring_free(descq->xdev, descq->conf.rngsz_cmpt,
 			descq->cmpt_entry_len,
@@ -1292,6 +1451,16 @@ void qdma_descq_config(struct qdma_descq *descq, struct qdma_queue_conf *qconf,
 		descq->conf.ping_pong_en = qconf->ping_pong_en;
 		descq->conf.aperture_size = qconf->aperture_size;
 		descq->conf.pidx_acc = qconf->pidx_acc;
+		descq->conf.pidx_acc_usecs = qconf->pidx_acc_usecs ?
+			qconf->pidx_acc_usecs : QDMA_PIDX_ACC_USECS_DEFAULT;
+		descq->conf.numa_node_en = qconf->numa_node_en;
+		descq->conf.numa_node = qconf->numa_node;
+		descq->desc_pend = 0;
+		descq->pidx_pend_ns = 0;
+		descq->pidx_db_cnt = 0;
+		descq->pidx_db_saved = 0;
+		descq->pidx_db_timeout = 0;
+		descq->pidx_acc_lat_ns = 0;
 	}
 }
 
@@ -1340,6 +1509,7 @@ int qdma_descq_config_complete(struct qdma_descq *descq)
 		descq->pidx_info.irq_en = 0;
 	else
 		descq->pidx_info.irq_en = descq->conf.irq_en;
+	atomic_set(&descq->intr_polling, 0);
 
 	/* we can never use the full ring because then cidx would equal pidx
 	 * and thus the ring would be interpreted as empty. Thus max number of
@@ -1405,14 +1575,9 @@ int qdma_descq_config_complete(struct qdma_descq *descq)
 	return 0;
 }
 
-int qdma_descq_prog_hw(struct qdma_descq *descq)
+static int descq_prog_pointers(struct qdma_descq *descq)
 {
-	int rv = qdma_descq_context_setup(descq);
-
-	if (rv < 0) {
-		pr_warn("%s failed to program contexts", descq->conf.name);
-		return rv;
-	}
+	int rv = 0;
 
 	/* update pidx/cidx */
 	if ((descq->conf.st && (descq->conf.q_type == Q_C2H)) ||
@@ -1448,6 +1613,39 @@ int qdma_descq_prog_hw(struct qdma_descq *descq)
 	return rv;
 }
 
+int qdma_descq_prog_hw(struct qdma_descq *descq)
+{
+	int rv = qdma_descq_context_setup(descq);
+
+	if (rv < 0) {
+		pr_warn("%s failed to program contexts", descq->conf.name);
+		return rv;
+	}
+
+	return descq_prog_pointers(descq);
+}
+
+int qdma_descq_prog_hw_list(struct qdma_descq **descq_list,
+			unsigned int num_q)
+{
+	unsigned int i;
+	int rv = qdma_descq_context_setup_list(descq_list, num_q);
+
+	if (rv < 0) {
+		pr_warn("%s failed to program contexts of %u queues",
+			descq_list[0]->xdev->conf.name, num_q);
+		return rv;
+	}
+
+	for (i = 0; i < num_q; i++) {
+		rv = descq_prog_pointers(descq_list[i]);
+		if (rv < 0)
+			return rv;
+	}
+
+	return 0;
+}
+
 int qdma_descq_service_cmpl_update(struct qdma_descq *descq, int budget,
 				bool c2h_upd_cmpl)
 {
@@ -1479,7 +1677,7 @@ int qdma_descq_service_cmpl_update(struct qdma_descq *descq, int budget,
 	} else {
 		lock_descq(descq);
 		descq_mm_n_h2c_cmpl_status(descq);
-		if (qdma_work_queue_len(descq) || descq->desc_pend) {
+		if (qdma_work_queue_pending(descq) || descq->desc_pend) {
 			unlock_descq(descq);
 			rv = qdma_descq_proc_sgt_request(descq);
 			return rv;
@@ -1504,6 +1702,55 @@ ssize_t qdma_descq_proc_sgt_request(struct qdma_descq *descq)
 		return -EINVAL;
 }
 
+int qdma_descq_submit_request(struct qdma_descq *descq,
+				struct qdma_sgt_req_cb *cb)
+{
+	int rv;
+
+	if (likely(descq->sub_ring.slot &&
+			!qdma_req_ring_enqueue(&descq->sub_ring, cb)))
+		return 0;
+
+	/*
+	 * ring full, flush it so that the request order is kept. A slot that
+	 * is claimed but not published yet stops the flush, the request then
+	 * has to go on the ring behind it instead of on the work list.
+	 */
+	for (;;) {
+		lock_descq(descq);
+		if (unlikely(descq->q_state != Q_STATE_ONLINE)) {
+			unlock_descq(descq);
+			return -EINVAL;
+		}
+		qdma_work_queue_drain(descq);
+		if (!descq->sub_ring.slot ||
+				READ_ONCE(descq->sub_ring.prod) ==
+				descq->sub_ring.cons) {
+			qdma_work_queue_add(descq, cb);
+			unlock_descq(descq);
+			return 0;
+		}
+		rv = qdma_req_ring_enqueue(&descq->sub_ring, cb);
+		unlock_descq(descq);
+		if (!rv)
+			return 0;
+		cpu_relax();
+	}
+}
+
+void qdma_descq_proc_submitted(struct qdma_descq *descq)
+{
+	while (!atomic_xchg(&descq->sub_proc_busy, 1)) {
+		qdma_descq_proc_sgt_request(descq);
+		atomic_set(&descq->sub_proc_busy, 0);
+		/* pairs with the publish + xchg of a concurrent submitter */
+		smp_mb();
+		if (qdma_req_ring_empty(&descq->sub_ring) ||
+				READ_ONCE(descq->q_stop_wait))
+			break;
+	}
+}
+
 void incr_cmpl_desc_cnt(struct qdma_descq *descq, unsigned int cnt)
 {
 	descq->total_cmpl_descs += cnt;
@@ -1726,6 +1973,7 @@ int qdma_descq_dump(struct qdma_descq *descq, char *buf, int buflen, int detail)
 {
 	char *cur = buf;
 	char *const end = buf + buflen;
+	struct qdma_flq *flq = (struct qdma_flq *)descq->flq;
 
 	if (!buf || !buflen) {
 		pr_info("%s:%s 0x%x/0x%x, desc sz %u/%u, pidx %u, cidx %u\n",
@@ -1750,6 +1998,26 @@ int qdma_descq_dump(struct qdma_descq *descq, char *buf, int buflen, int detail)
 	if (cur >= end)
 		goto handle_truncation;
 
+	if (descq->xdev->intr_hybrid) {
+		cur += snprintf(cur, end - cur,
+			"\thybrid intr: polls %llu, rounds %llu, rearms %llu\n",
+			(u64)atomic64_read(&descq->intr_poll_cnt),
+			descq->intr_poll_rounds,
+			descq->intr_rearm_cnt);
+		if (cur >= end)
+			goto handle_truncation;
+	}
+
+	if (descq->conf.pidx_acc) {
+		cur += snprintf(cur, end - cur,
+			"\tpidx acc %u/%uus: doorbells %llu, saved %llu, deadline %llu, added lat %lluns\n",
+			descq->conf.pidx_acc, descq->conf.pidx_acc_usecs,
+			descq->pidx_db_cnt, descq->pidx_db_saved,
+			descq->pidx_db_timeout, descq->pidx_acc_lat_ns);
+		if (cur >= end)
+			goto handle_truncation;
+	}
+
 	if (descq->conf.st && (descq->conf.q_type == Q_C2H)) {
 		cur += snprintf(cur, end - cur,
 			"\tcmpt desc 0x%p/0x%llx, %u\n",
@@ -1757,6 +2025,13 @@ int qdma_descq_dump(struct qdma_descq *descq, char *buf, int buflen, int detail)
 			descq->conf.rngsz_cmpt);
 		if (cur >= end)
 			goto handle_truncation;
+
+		cur += snprintf(cur, end - cur,
+			"\tflq pages %u, recycled %lu, reused %lu, alloc %lu\n",
+			flq->num_pages, flq->pg_recycled, flq->pg_reused,
+			flq->pg_alloc);
+		if (cur >= end)
+			goto handle_truncation;
 	}
 
 	if (!detail)
@@ -1911,7 +2186,6 @@ int qdma_queue_packet_write(unsigned long dev_hndl, unsigned long id,
 
 	memset(cb, 0, QDMA_REQ_OPAQUE_SIZE);
 	qdma_waitq_init(&cb->wq);
-	qdma_work_queue_add(descq, cb);
 
 	if (!req->dma_mapped) {
 		rv = sgl_map(descq->xdev->conf.pdev, req->sgl, req->sgcnt,
@@ -1924,20 +2198,28 @@ int qdma_queue_packet_write(unsigned long dev_hndl, unsigned long id,
 		cb->unmap_needed = 1;
 	}
 
-	if (!req->check_qstate_disabled) {
-		lock_descq(descq);
-		if (descq->q_state != Q_STATE_ONLINE) {
-			unlock_descq(descq);
-			pr_err("%s descq %s NOT online.\n",
-				descq->xdev->conf.name, descq->conf.name);
-			rv = -EINVAL;
-			goto unmap_sgl;
-		}
-		unlock_descq(descq);
+	/* the submission reference keeps the ring alive, the queue state is
+	 * checked once it is held unless check_qstate_disabled is set
+	 */
+	qdma_descq_submit_ref(descq);
+	if (!req->check_qstate_disabled &&
+			unlikely(READ_ONCE(descq->q_state) != Q_STATE_ONLINE)) {
+		qdma_descq_submit_put(descq);
+		pr_err("%s descq %s NOT online.\n",
+			descq->xdev->conf.name, descq->conf.name);
+		rv = -EINVAL;
+		goto unmap_sgl;
 	}
 
-	qdma_descq_proc_sgt_request(descq);
-
+	rv = qdma_descq_submit_request(descq, cb);
+	if (!rv)
+		qdma_descq_proc_submitted(descq);
+	qdma_descq_submit_put(descq);
+	if (unlikely(rv < 0)) {
+		pr_err("%s descq %s NOT online.\n",
+			descq->xdev->conf.name, descq->conf.name);
+		goto unmap_sgl;
+	}
 
 	pr_debug("%s: cb 0x%p submitted for bytes %u.\n",
 					descq->conf.name, cb, req->count);
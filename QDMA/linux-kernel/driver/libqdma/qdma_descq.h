@@ -26,6 +26,7 @@
  */
 #include <linux/spinlock_types.h>
 #include <linux/types.h>
+#include <linux/hrtimer.h>
 #include "qdma_compat.h"
 #include "libqdma_export.h"
 #include "qdma_regs.h"
@@ -33,6 +34,7 @@
 #include "qdma_nl.h"
 #endif
 #include "qdma_ul_ext.h"
+#include "qdma_req_ring.h"
 
 /**
  * struct q_state_name - Structure to hold the q state and name
@@ -49,7 +51,7 @@ struct q_state_name {
 
 extern struct q_state_name q_state_list[];
 
-#define QDMA_FLQ_SIZE 124
+#define QDMA_FLQ_SIZE 160
 
 /**
  * @struct - qdma_descq
@@ -86,10 +88,22 @@ struct qdma_descq {
 	unsigned int qidx_hw;
 	/** cpu attached to intr_work */
 	unsigned int intr_work_cpu;
+	/** NUMA node of the free list and the software state */
+	int node;
 	/** @q_hndl: Q handle */
 	unsigned long q_hndl;
 	/** queue handler */
 	struct work_struct work;
+	/** hybrid mode: queue handed to the poll loop, interrupt masked */
+	atomic_t intr_polling;
+	/** hybrid mode: interrupts that started a poll loop, bumped from
+	 *  the irq handler outside of the descq lock
+	 */
+	atomic64_t intr_poll_cnt;
+	/** hybrid mode: poll rounds run */
+	u64 intr_poll_rounds;
+	/** hybrid mode: interrupt re-armed after the ring drained */
+	u64 intr_rearm_cnt;
 	/** interrupt list */
 	struct list_head intr_list;
 	/** leagcy interrupt list */
@@ -102,6 +116,12 @@ struct qdma_descq {
 	unsigned int work_req_pend;
 	/* lock to synchonize  work queue access*/
 	spinlock_t work_list_lock;
+	/** lock free submission ring, drained into work_list */
+	struct qdma_req_ring sub_ring;
+	/** a submitter is processing the submission ring */
+	atomic_t sub_proc_busy;
+	/** submitters that saw the queue online, see qdma_descq_submit_get */
+	atomic_t sub_users;
 	/** write back therad list */
 	struct qdma_kthread *cmplthp;
 	/** completion status thread list for the queue */
@@ -140,6 +160,12 @@ struct qdma_descq {
 	unsigned char rsvd[2];
 	/** qdma free list q*/
 	unsigned char flq[QDMA_FLQ_SIZE];
+	/** @zc_ring: ST C2H zero copy receive ring shared with user space */
+	struct qdma_zc_rx_ring *zc_ring;
+	/** @zc_ring_pg: pages backing zc_ring */
+	struct page *zc_ring_pg;
+	/** @zc_ring_order: allocation order of zc_ring_pg */
+	unsigned int zc_ring_order;
 	/**total # of udd outstanding */
 	unsigned int udd_cnt;
 	/** packet count/number of packets to be processed*/
@@ -163,7 +189,19 @@ struct qdma_descq {
 	/** descriptor writeback dma bus address*/
 	u8 *desc_cmpt_cmpl_status;
 	/** @desc_pend: pending desc to be updated processed by hw */
-	unsigned char desc_pend;
+	unsigned int desc_pend;
+	/** @pidx_timer: flushes a held back PIDX update after pidx_acc_usecs */
+	struct hrtimer pidx_timer;
+	/** @pidx_pend_ns: time in ns the oldest held back desc was queued */
+	u64 pidx_pend_ns;
+	/** @pidx_db_cnt: PIDX doorbells written */
+	u64 pidx_db_cnt;
+	/** @pidx_db_saved: PIDX doorbells held back and merged */
+	u64 pidx_db_saved;
+	/** @pidx_db_timeout: PIDX doorbells written by the deadline timer */
+	u64 pidx_db_timeout;
+	/** @pidx_acc_lat_ns: total time descriptors waited for a doorbell */
+	u64 pidx_acc_lat_ns;
 	/** pidx info to be written to PIDX regiser*/
 	struct qdma_q_pidx_reg_info pidx_info;
 	/** cmpt cidx info to be written to CMPT CIDX regiser*/
@@ -289,6 +327,18 @@ int qdma_descq_alloc_resource(struct qdma_descq *descq);
  *****************************************************************************/
 void qdma_descq_free_resource(struct qdma_descq *descq);
 
+/*****************************************************************************/
+/**
+ * qdma_descq_pidx_flush() - write a PIDX update held back by pidx_acc,
+ *	called with the descq lock held
+ *
+ * @param[in]	descq:		pointer to qdma_descq
+ *
+ * @return	0: success
+ * @return	<0: failure
+ *****************************************************************************/
+int qdma_descq_pidx_flush(struct qdma_descq *descq);
+
 /*****************************************************************************/
 /**
  * qdma_descq_prog_hw() - program the hw descriptors
@@ -300,6 +350,20 @@ void qdma_descq_free_resource(struct qdma_descq *descq);
  *****************************************************************************/
 int qdma_descq_prog_hw(struct qdma_descq *descq);
 
+/*****************************************************************************/
+/**
+ * qdma_descq_prog_hw_list() - program the hw contexts of a list of queues
+ *	of one device, the contexts are written as one batch
+ *
+ * @param[in]	descq_list:	queues to program
+ * @param[in]	num_q:		number of entries in descq_list
+ *
+ * @return	0: success
+ * @return	<0: failure
+ *****************************************************************************/
+int qdma_descq_prog_hw_list(struct qdma_descq **descq_list,
+			unsigned int num_q);
+
 /*****************************************************************************/
 /**
  * qdma_descq_context_cleanup() - clean up the queue context
@@ -433,6 +497,40 @@ struct qdma_sgt_req_cb {
  *****************************************************************************/
 ssize_t qdma_descq_proc_sgt_request(struct qdma_descq *descq);
 
+/*****************************************************************************/
+/**
+ * qdma_descq_submit_request() - hand a request to the descq without
+ *				taking the descq lock
+ *
+ * The request is published on the submission ring and picked up by the
+ * next descq_mm_proc_request()/descq_proc_st_h2c_request() run. Only when
+ * the ring is full the lock is taken to flush it into the work list. The
+ * caller must hold a qdma_descq_submit_get() reference.
+ *
+ * @param[in]	descq:	pointer to qdma_descq
+ * @param[in]	cb:		request call back data
+ *
+ * @return	0: success
+ * @return	-EINVAL: the queue went offline, the request was not queued
+ *****************************************************************************/
+int qdma_descq_submit_request(struct qdma_descq *descq,
+				struct qdma_sgt_req_cb *cb);
+
+/*****************************************************************************/
+/**
+ * qdma_descq_proc_submitted() - process the requests handed over with
+ *				qdma_descq_submit_request()
+ *
+ * Only one submitter at a time runs qdma_descq_proc_sgt_request(), the
+ * others return right away and leave their requests to it, so that
+ * concurrent submitters do not queue up on the descq lock.
+ *
+ * @param[in]	descq:	pointer to qdma_descq
+ *
+ * @return	none
+ *****************************************************************************/
+void qdma_descq_proc_submitted(struct qdma_descq *descq);
+
 /*****************************************************************************/
 /**
  * qdma_sgt_req_done() - handler to track the progress of the request
@@ -581,6 +679,63 @@ static inline void qdma_work_queue_del(struct qdma_descq *descq,
 #endif
 }
 
+/*
+ * move the requests published on the submission ring to the work list,
+ * must be called with the descq lock held
+ */
+static inline unsigned int qdma_work_queue_drain(struct qdma_descq *descq)
+{
+	struct qdma_sgt_req_cb *cb;
+	unsigned int cnt = 0;
+
+	if (!descq->sub_ring.slot)
+		return 0;
+
+	while ((cb = qdma_req_ring_dequeue(&descq->sub_ring))) {
+		qdma_work_queue_add(descq, cb);
+		cnt++;
+	}
+
+	return cnt;
+}
+
+/*
+ * take a submission reference on an online queue. qdma_queue_stop() waits
+ * for the references to be dropped before it drains and frees the
+ * submission ring, so the ring may be used without the descq lock until
+ * qdma_descq_submit_put().
+ */
+static inline void qdma_descq_submit_ref(struct qdma_descq *descq)
+{
+	atomic_inc(&descq->sub_users);
+	/* pairs with the barrier after the state change in qdma_queue_stop */
+	smp_mb__after_atomic();
+}
+
+static inline bool qdma_descq_submit_get(struct qdma_descq *descq)
+{
+	qdma_descq_submit_ref(descq);
+	if (likely(READ_ONCE(descq->q_state) == Q_STATE_ONLINE))
+		return true;
+
+	smp_mb__before_atomic();
+	atomic_dec(&descq->sub_users);
+	return false;
+}
+
+static inline void qdma_descq_submit_put(struct qdma_descq *descq)
+{
+	/* ring accesses must be done before the reference is dropped */
+	smp_mb__before_atomic();
+	atomic_dec(&descq->sub_users);
+}
+
+static inline bool qdma_work_queue_pending(struct qdma_descq *descq)
+{
+	return !list_empty(&descq->work_list) ||
+		!qdma_req_ring_empty(&descq->sub_ring);
+}
+
 static inline int qdma_work_queue_len(struct qdma_descq *descq)
 {
 	int count = 0;
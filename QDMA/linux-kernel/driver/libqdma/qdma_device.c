@@ -141,6 +141,19 @@ int qdma_device_interrupt_setup(struct xlnx_dma_dev *xdev)
 {
 	int rv = 0;
 
+	if (xdev->intr_hybrid &&
+			(xdev->conf.qdma_drv_mode == INDIRECT_INTR_MODE) &&
+			xdev->conf.qsets_max &&
+			(xdev->num_vecs > xdev->dvec_start_idx) &&
+			((xdev->num_vecs - xdev->dvec_start_idx) >=
+			 xdev->conf.qsets_max)) {
+		pr_info("dev %s intr vec[%d] >= queues[%d], hybrid mode uses direct interrupts\n",
+			dev_name(&xdev->conf.pdev->dev),
+			(xdev->num_vecs - xdev->dvec_start_idx),
+			xdev->conf.qsets_max);
+		xdev->conf.qdma_drv_mode = DIRECT_INTR_MODE;
+	}
+
 	if ((xdev->conf.qdma_drv_mode == INDIRECT_INTR_MODE) ||
 			(xdev->conf.qdma_drv_mode == AUTO_MODE)) {
 		rv = intr_ring_setup(xdev);
@@ -0,0 +1,1125 @@
+/*
+ * This file is part of the Xilinx DMA IP Core driver for Linux
+ *
+ * Copyright (c) 2017-2022, Xilinx, Inc. All rights reserved.
+ * Copyright (c) 2022-2024, Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#define pr_fmt(fmt)	KBUILD_MODNAME ":%s: " fmt, __func__
+
+#include "qdma_dmaengine.h"
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/delay.h>
+#include <linux/mutex.h>
+#include <linux/scatterlist.h>
+#include "xdev.h"
+#include "qdma_device.h"
+#include "qdma_descq.h"
+
+#ifdef QDMA_DMAENGINE_SUPPORTED
+
+/** serializes channel registration against removal */
+static DEFINE_MUTEX(dmaeng_mutex);
+
+/** time device_synchronize waits for the requests in flight */
+#define QDMA_DMAENG_SYNC_TIMEOUT_MS	5000
+
+#define QDMA_DMAENG_BUSWIDTHS	(BIT(DMA_SLAVE_BUSWIDTH_1_BYTE) | \
+				 BIT(DMA_SLAVE_BUSWIDTH_2_BYTES) | \
+				 BIT(DMA_SLAVE_BUSWIDTH_4_BYTES) | \
+				 BIT(DMA_SLAVE_BUSWIDTH_8_BYTES))
+
+static inline struct qdma_dmaeng_chan *to_qdma_dmaeng_chan(
+						struct dma_chan *chan)
+{
+	return container_of(chan, struct qdma_dmaeng_chan, chan);
+}
+
+static inline struct qdma_dmaeng_dev *to_qdma_dmaeng_dev(
+						struct dma_chan *chan)
+{
+	return container_of(chan->device, struct qdma_dmaeng_dev, dma);
+}
+
+static inline struct qdma_dmaeng_desc *to_qdma_dmaeng_desc(
+					struct dma_async_tx_descriptor *txd)
+{
+	return container_of(txd, struct qdma_dmaeng_desc, txd);
+}
+
+static dma_cookie_t qdma_dmaeng_tx_submit(struct dma_async_tx_descriptor *txd);
+static int qdma_dmaeng_desc_free(struct dma_async_tx_descriptor *txd);
+
+static struct qdma_dmaeng_desc *qdma_dmaeng_desc_alloc(
+				struct qdma_dmaeng_chan *qchan, gfp_t flags)
+{
+	struct qdma_dmaeng_desc *d = kzalloc(sizeof(*d), flags);
+
+	if (!d)
+		return NULL;
+
+	dma_async_tx_descriptor_init(&d->txd, &qchan->chan);
+	d->txd.tx_submit = qdma_dmaeng_tx_submit;
+	d->txd.desc_free = qdma_dmaeng_desc_free;
+	INIT_LIST_HEAD(&d->node);
+
+	spin_lock_bh(&qchan->lock);
+	list_add(&d->all_node, &qchan->all);
+	spin_unlock_bh(&qchan->lock);
+
+	return d;
+}
+
+static void qdma_dmaeng_desc_destroy(struct qdma_dmaeng_desc *d)
+{
+	kfree(d->reqs);
+	kfree(d->sg);
+	kfree(d);
+}
+
+/*****************************************************************************/
+/**
+ * qdma_dmaeng_desc_get() - take an idle descriptor, allocating one if the
+ *	pool ran dry. prep callbacks may be called from atomic context.
+ *
+ * @param[in]	qchan:	channel
+ * @param[in]	dir:	transfer direction
+ * @param[in]	flags:	prep flags
+ *
+ * @return	descriptor or NULL on allocation failure
+ *****************************************************************************/
+static struct qdma_dmaeng_desc *qdma_dmaeng_desc_get(
+		struct qdma_dmaeng_chan *qchan, enum dma_transfer_direction dir,
+		unsigned long flags)
+{
+	struct qdma_dmaeng_desc *d;
+
+	spin_lock_bh(&qchan->lock);
+	d = list_first_entry_or_null(&qchan->free, struct qdma_dmaeng_desc,
+				node);
+	if (d)
+		list_del_init(&d->node);
+	spin_unlock_bh(&qchan->lock);
+
+	if (!d) {
+		d = qdma_dmaeng_desc_alloc(qchan, GFP_NOWAIT);
+		if (!d)
+			return NULL;
+	}
+
+	d->dir = dir;
+	d->err = 0;
+	d->terminated = 0;
+	d->nr_reqs = 0;
+	d->nr_sg = 0;
+	d->len = 0;
+	d->off = 0;
+	d->chunk = 0;
+	d->phase = QDMA_DMAENG_IDLE;
+	atomic_set(&d->pending, 0);
+
+	d->txd.flags = flags;
+	d->txd.cookie = -EBUSY;
+	d->txd.callback = NULL;
+	d->txd.callback_result = NULL;
+	d->txd.callback_param = NULL;
+	d->txd.unmap = NULL;
+
+	return d;
+}
+
+static void qdma_dmaeng_desc_put(struct qdma_dmaeng_chan *qchan,
+				struct qdma_dmaeng_desc *d)
+{
+	spin_lock_bh(&qchan->lock);
+	list_add(&d->node, &qchan->free);
+	spin_unlock_bh(&qchan->lock);
+}
+
+/*****************************************************************************/
+/**
+ * qdma_dmaeng_desc_reserve() - make room for the requests and sg entries of
+ *	a transfer
+ *
+ * @param[in]	d:	descriptor
+ * @param[in]	nr_reqs:	number of requests needed
+ * @param[in]	nr_sg:	number of sg entries needed
+ *
+ * @return	0: success
+ * @return	-ENOMEM: allocation failure
+ *****************************************************************************/
+static int qdma_dmaeng_desc_reserve(struct qdma_dmaeng_desc *d,
+				unsigned int nr_reqs, unsigned int nr_sg)
+{
+	if (nr_reqs > d->max_reqs) {
+		struct qdma_dmaeng_req *reqs;
+
+		reqs = krealloc(d->reqs, nr_reqs * sizeof(*reqs), GFP_NOWAIT);
+		if (!reqs)
+			return -ENOMEM;
+		d->reqs = reqs;
+		d->max_reqs = nr_reqs;
+	}
+
+	if (nr_sg > d->max_sg) {
+		struct qdma_sw_sg *sg;
+
+		sg = krealloc(d->sg, nr_sg * sizeof(*sg), GFP_NOWAIT);
+		if (!sg)
+			return -ENOMEM;
+		d->sg = sg;
+		d->max_sg = nr_sg;
+	}
+
+	return 0;
+}
+
+/*****************************************************************************/
+/**
+ * qdma_dmaeng_req_done() - libqdma completion handler, called with the
+ *	descq lock held so only the bookkeeping is done here
+ *
+ * @param[in]	req:	request completed
+ * @param[in]	bytes_done:	number of bytes transferred
+ * @param[in]	err:	0 or error code
+ *
+ * @return	0
+ *****************************************************************************/
+static int qdma_dmaeng_req_done(struct qdma_request *req,
+				unsigned int bytes_done, int err)
+{
+	struct qdma_dmaeng_req *r = container_of(req, struct qdma_dmaeng_req,
+						req);
+	struct qdma_dmaeng_desc *d = r->desc;
+	struct qdma_dmaeng_chan *qchan = to_qdma_dmaeng_chan(d->txd.chan);
+
+	if (err)
+		WRITE_ONCE(d->err, err);
+	if (atomic_dec_and_test(&d->pending))
+		tasklet_schedule(&qchan->tasklet);
+
+	return 0;
+}
+
+static struct qdma_dmaeng_req *qdma_dmaeng_req_add(
+			struct qdma_dmaeng_desc *d, u64 ep_addr, u8 write)
+{
+	struct qdma_dmaeng_req *r = &d->reqs[d->nr_reqs++];
+
+	memset(r, 0, sizeof(*r));
+	r->desc = d;
+	r->req.fp_done = qdma_dmaeng_req_done;
+	r->req.ep_addr = ep_addr;
+	r->req.write = write;
+	r->req.dma_mapped = 1;
+
+	return r;
+}
+
+static void qdma_dmaeng_sg_add(struct qdma_dmaeng_desc *d,
+			struct qdma_dmaeng_req *r, dma_addr_t addr,
+			unsigned int len)
+{
+	struct qdma_sw_sg *sg = &d->sg[d->nr_sg++];
+
+	memset(sg, 0, sizeof(*sg));
+	sg->dma_addr = addr;
+	sg->len = len;
+	r->req.sgcnt++;
+	r->req.count += len;
+	d->len += len;
+}
+
+/*****************************************************************************/
+/**
+ * qdma_dmaeng_desc_finalize() - point every request at its range of the sg
+ *	array, libqdma walks the sg entries of a request as an array
+ *
+ * @param[in]	d:	descriptor
+ *
+ * @return	none
+ *****************************************************************************/
+static void qdma_dmaeng_desc_finalize(struct qdma_dmaeng_desc *d)
+{
+	struct qdma_sw_sg *sg = d->sg;
+	unsigned int i, j;
+
+	for (i = 0; i < d->nr_reqs; i++) {
+		struct qdma_request *req = &d->reqs[i].req;
+
+		req->sgl = sg;
+		for (j = 0; j < req->sgcnt; j++, sg++)
+			sg->next = (j + 1 < req->sgcnt) ? sg + 1 : NULL;
+	}
+}
+
+/*****************************************************************************/
+/**
+ * qdma_dmaeng_submit() - hand a batch of requests to the queue of the
+ *	channel, requests that could not be queued are completed with the error
+ *
+ * @param[in]	qchan:	channel
+ * @param[in]	write:	H2C if set, C2H otherwise
+ * @param[in]	reqv:	requests
+ * @param[in]	cnt:	number of requests
+ *
+ * @return	none
+ *****************************************************************************/
+static void qdma_dmaeng_submit(struct qdma_dmaeng_chan *qchan, u8 write,
+				struct qdma_request **reqv, unsigned int cnt)
+{
+	unsigned long qhndl = write ? qchan->h2c_qhndl : qchan->c2h_qhndl;
+	ssize_t rv;
+	unsigned int i;
+
+	if (!cnt)
+		return;
+
+	rv = qdma_batch_request_submit((unsigned long)qchan->xdev, qhndl, cnt,
+				reqv);
+	if (rv < 0) {
+		pr_err("%s, qidx %u, %s submit of %u requests failed %zd.\n",
+			dma_chan_name(&qchan->chan), qchan->qidx,
+			write ? "H2C" : "C2H", cnt, rv);
+		for (i = 0; i < cnt; i++)
+			qdma_dmaeng_req_done(reqv[i], 0, (int)rv);
+	}
+}
+
+/*****************************************************************************/
+/**
+ * qdma_dmaeng_memcpy_step() - move a memcpy descriptor to its next phase,
+ *	called with the channel lock held once the previous phase completed
+ *
+ * Only the descriptor at the head of the active list is stepped, so the
+ * staging window is never used by two copies at once.
+ *
+ * @param[in]	qchan:	channel
+ * @param[in]	d:	memcpy descriptor
+ *
+ * @return	true if a request was submitted, false once the copy is done
+ *****************************************************************************/
+static bool qdma_dmaeng_memcpy_step(struct qdma_dmaeng_chan *qchan,
+				struct qdma_dmaeng_desc *d)
+{
+	struct qdma_dmaeng_req *r;
+	struct qdma_request *reqv[1];
+	dma_addr_t addr;
+	u8 write;
+
+	if (d->phase == QDMA_DMAENG_H2C) {
+		/* chunk is in the window, copy it out */
+		d->phase = QDMA_DMAENG_C2H;
+		addr = d->dst + d->off;
+		write = 0;
+	} else {
+		if (d->phase == QDMA_DMAENG_C2H)
+			d->off += d->chunk;
+		if (d->off >= d->len) {
+			d->phase = QDMA_DMAENG_IDLE;
+			return false;
+		}
+		d->chunk = min_t(size_t, d->len - d->off, qchan->win_sz);
+		d->phase = QDMA_DMAENG_H2C;
+		addr = d->src + d->off;
+		write = 1;
+	}
+
+	d->nr_reqs = 0;
+	r = qdma_dmaeng_req_add(d, qchan->win_addr, write);
+	memset(d->sg, 0, sizeof(*d->sg));
+	d->sg[0].dma_addr = addr;
+	d->sg[0].len = d->chunk;
+	r->req.sgl = d->sg;
+	r->req.sgcnt = 1;
+	r->req.count = d->chunk;
+
+	atomic_set(&d->pending, 1);
+	reqv[0] = &r->req;
+	qdma_dmaeng_submit(qchan, write, reqv, 1);
+
+	return true;
+}
+
+static void qdma_dmaeng_cookie_complete(struct qdma_dmaeng_desc *d)
+{
+	d->txd.chan->completed_cookie = d->txd.cookie;
+	d->txd.cookie = 0;
+}
+
+static void qdma_dmaeng_desc_release(struct qdma_dmaeng_chan *qchan,
+				struct qdma_dmaeng_desc *d)
+{
+	/* reusable descriptors stay with the client until desc_free */
+	if (!dmaengine_desc_test_reuse(&d->txd))
+		qdma_dmaeng_desc_put(qchan, d);
+}
+
+/*****************************************************************************/
+/**
+ * qdma_dmaeng_tasklet() - retire completed descriptors in cookie order,
+ *	advance memcpy descriptors and run the client callbacks
+ *
+ * @param[in]	data:	channel
+ *
+ * @return	none
+ *****************************************************************************/
+static void qdma_dmaeng_tasklet(unsigned long data)
+{
+	struct qdma_dmaeng_chan *qchan = (struct qdma_dmaeng_chan *)data;
+	struct qdma_dmaeng_desc *d, *tmp;
+	LIST_HEAD(done);
+
+	spin_lock_bh(&qchan->lock);
+	while (!list_empty(&qchan->active)) {
+		d = list_first_entry(&qchan->active, struct qdma_dmaeng_desc,
+				node);
+		if (atomic_read(&d->pending))
+			break;
+		if (d->dir == DMA_MEM_TO_MEM && !READ_ONCE(d->err) &&
+		    !d->terminated && qdma_dmaeng_memcpy_step(qchan, d))
+			break;
+
+		qdma_dmaeng_cookie_complete(d);
+		list_move_tail(&d->node, &done);
+	}
+	spin_unlock_bh(&qchan->lock);
+
+	list_for_each_entry_safe(d, tmp, &done, node) {
+		struct dmaengine_result res;
+
+		list_del_init(&d->node);
+		dma_descriptor_unmap(&d->txd);
+		if (d->terminated) {
+			qdma_dmaeng_desc_release(qchan, d);
+			continue;
+		}
+
+		res.result = DMA_TRANS_NOERROR;
+		res.residue = 0;
+		if (d->err) {
+			pr_debug("%s, cookie done with error %d.\n",
+				dma_chan_name(&qchan->chan), d->err);
+			res.result = (d->dir == DMA_DEV_TO_MEM) ?
+					DMA_TRANS_READ_FAILED :
+					DMA_TRANS_WRITE_FAILED;
+			res.residue = d->len;
+		}
+
+		if (d->txd.callback_result)
+			d->txd.callback_result(d->txd.callback_param, &res);
+		else if (d->txd.callback)
+			d->txd.callback(d->txd.callback_param);
+
+		qdma_dmaeng_desc_release(qchan, d);
+	}
+}
+
+static dma_cookie_t qdma_dmaeng_tx_submit(struct dma_async_tx_descriptor *txd)
+{
+	struct qdma_dmaeng_desc *d = to_qdma_dmaeng_desc(txd);
+	struct qdma_dmaeng_chan *qchan = to_qdma_dmaeng_chan(txd->chan);
+	struct dma_chan *chan = txd->chan;
+	dma_cookie_t cookie;
+
+	spin_lock_bh(&qchan->lock);
+	cookie = chan->cookie + 1;
+	if (cookie < DMA_MIN_COOKIE)
+		cookie = DMA_MIN_COOKIE;
+	chan->cookie = cookie;
+	txd->cookie = cookie;
+
+	/* a reused descriptor starts over */
+	d->err = 0;
+	d->terminated = 0;
+	if (d->dir == DMA_MEM_TO_MEM) {
+		d->off = 0;
+		d->phase = QDMA_DMAENG_IDLE;
+	}
+	list_add_tail(&d->node, &qchan->submitted);
+	spin_unlock_bh(&qchan->lock);
+
+	return cookie;
+}
+
+static int qdma_dmaeng_desc_free(struct dma_async_tx_descriptor *txd)
+{
+	struct qdma_dmaeng_desc *d = to_qdma_dmaeng_desc(txd);
+
+	qdma_dmaeng_desc_put(to_qdma_dmaeng_chan(txd->chan), d);
+
+	return 0;
+}
+
+/*****************************************************************************/
+/**
+ * qdma_dmaeng_issue_pending() - queue all submitted descriptors
+ *
+ * The requests are handed to libqdma in batches, each batch is written to
+ * the ring with a single PIDX update. A memcpy descriptor is only started
+ * once it reaches the head of the active list.
+ *
+ * @param[in]	chan:	dmaengine channel
+ *
+ * @return	none
+ *****************************************************************************/
+static void qdma_dmaeng_issue_pending(struct dma_chan *chan)
+{
+	struct qdma_dmaeng_chan *qchan = to_qdma_dmaeng_chan(chan);
+	struct qdma_request *h2c[QDMA_DMAENG_SUBMIT_BATCH];
+	struct qdma_request *c2h[QDMA_DMAENG_SUBMIT_BATCH];
+	unsigned int nr_h2c = 0;
+	unsigned int nr_c2h = 0;
+	struct qdma_dmaeng_desc *d, *tmp;
+	bool kick = false;
+	unsigned int i;
+
+	spin_lock_bh(&qchan->lock);
+	list_for_each_entry_safe(d, tmp, &qchan->submitted, node) {
+		list_move_tail(&d->node, &qchan->active);
+		if (d->dir == DMA_MEM_TO_MEM) {
+			kick = true;
+			continue;
+		}
+
+		atomic_set(&d->pending, d->nr_reqs);
+		for (i = 0; i < d->nr_reqs; i++) {
+			struct qdma_request *req = &d->reqs[i].req;
+
+			if (req->write) {
+				h2c[nr_h2c++] = req;
+				if (nr_h2c == QDMA_DMAENG_SUBMIT_BATCH) {
+					qdma_dmaeng_submit(qchan, 1, h2c,
+							nr_h2c);
+					nr_h2c = 0;
+				}
+			} else {
+				c2h[nr_c2h++] = req;
+				if (nr_c2h == QDMA_DMAENG_SUBMIT_BATCH) {
+					qdma_dmaeng_submit(qchan, 0, c2h,
+							nr_c2h);
+					nr_c2h = 0;
+				}
+			}
+		}
+	}
+	qdma_dmaeng_submit(qchan, 1, h2c, nr_h2c);
+	qdma_dmaeng_submit(qchan, 0, c2h, nr_c2h);
+	spin_unlock_bh(&qchan->lock);
+
+	/* memcpy descriptors are started from the tasklet */
+	if (kick)
+		tasklet_schedule(&qchan->tasklet);
+}
+
+static enum dma_status qdma_dmaeng_tx_status(struct dma_chan *chan,
+			dma_cookie_t cookie, struct dma_tx_state *txstate)
+{
+	dma_cookie_t used, complete;
+
+	used = READ_ONCE(chan->cookie);
+	complete = READ_ONCE(chan->completed_cookie);
+	dma_set_tx_state(txstate, complete, used, 0);
+
+	return dma_async_is_complete(cookie, complete, used);
+}
+
+static struct dma_async_tx_descriptor *qdma_dmaeng_prep_slave_sg(
+		struct dma_chan *chan, struct scatterlist *sgl,
+		unsigned int sg_len, enum dma_transfer_direction dir,
+		unsigned long flags, void *context)
+{
+	struct qdma_dmaeng_chan *qchan = to_qdma_dmaeng_chan(chan);
+	struct qdma_dmaeng_req *r = NULL;
+	struct qdma_dmaeng_desc *d;
+	struct scatterlist *sg;
+	u8 write = (dir == DMA_MEM_TO_DEV) ? 1 : 0;
+	u64 ep_addr;
+	unsigned int i;
+
+	if (!sg_len || (dir != DMA_MEM_TO_DEV && dir != DMA_DEV_TO_MEM))
+		return NULL;
+
+	spin_lock_bh(&qchan->lock);
+	ep_addr = write ? qchan->slave.dst_addr : qchan->slave.src_addr;
+	spin_unlock_bh(&qchan->lock);
+
+	d = qdma_dmaeng_desc_get(qchan, dir, flags);
+	if (!d)
+		return NULL;
+	if (qdma_dmaeng_desc_reserve(d, sg_len, sg_len) < 0)
+		goto err_out;
+
+	for_each_sg(sgl, sg, sg_len, i) {
+		unsigned int len = sg_dma_len(sg);
+
+		if (!len)
+			continue;
+		/* the request byte count must not wrap */
+		if (!r || r->req.count + len < r->req.count)
+			r = qdma_dmaeng_req_add(d, ep_addr, write);
+		qdma_dmaeng_sg_add(d, r, sg_dma_address(sg), len);
+		ep_addr += len;
+	}
+	if (!d->len)
+		goto err_out;
+
+	qdma_dmaeng_desc_finalize(d);
+
+	return &d->txd;
+
+err_out:
+	qdma_dmaeng_desc_put(qchan, d);
+	return NULL;
+}
+
+static struct dma_async_tx_descriptor *qdma_dmaeng_prep_interleaved(
+		struct dma_chan *chan, struct dma_interleaved_template *xt,
+		unsigned long flags)
+{
+	struct qdma_dmaeng_chan *qchan = to_qdma_dmaeng_chan(chan);
+	struct qdma_dmaeng_req *r = NULL;
+	struct qdma_dmaeng_desc *d;
+	u8 write = (xt->dir == DMA_MEM_TO_DEV) ? 1 : 0;
+	dma_addr_t host;
+	u64 card, card_next = 0;
+	size_t f, i;
+
+	if (xt->dir != DMA_MEM_TO_DEV && xt->dir != DMA_DEV_TO_MEM)
+		return NULL;
+	if (!xt->numf || !xt->frame_size ||
+	    xt->numf > UINT_MAX / xt->frame_size)
+		return NULL;
+	/* a fixed address on either side would need the keyhole aperture */
+	if (!xt->src_inc || !xt->dst_inc)
+		return NULL;
+
+	d = qdma_dmaeng_desc_get(qchan, xt->dir, flags);
+	if (!d)
+		return NULL;
+	if (qdma_dmaeng_desc_reserve(d, xt->numf * xt->frame_size,
+				xt->numf * xt->frame_size) < 0)
+		goto err_out;
+
+	host = write ? xt->src_start : xt->dst_start;
+	card = write ? xt->dst_start : xt->src_start;
+	for (f = 0; f < xt->numf; f++) {
+		for (i = 0; i < xt->frame_size; i++) {
+			struct data_chunk *chunk = &xt->sgl[i];
+			size_t host_icg, card_icg;
+
+			host_icg = write ? dmaengine_get_src_icg(xt, chunk) :
+					dmaengine_get_dst_icg(xt, chunk);
+			card_icg = write ? dmaengine_get_dst_icg(xt, chunk) :
+					dmaengine_get_src_icg(xt, chunk);
+
+			if (chunk->size) {
+				/* card contiguous chunks share a request */
+				if (!r || card != card_next ||
+				    r->req.count + chunk->size < r->req.count)
+					r = qdma_dmaeng_req_add(d, card, write);
+				qdma_dmaeng_sg_add(d, r, host, chunk->size);
+			}
+			card_next = card + chunk->size;
+			host += chunk->size + host_icg;
+			card += chunk->size + card_icg;
+		}
+	}
+	if (!d->len)
+		goto err_out;
+
+	qdma_dmaeng_desc_finalize(d);
+
+	return &d->txd;
+
+err_out:
+	qdma_dmaeng_desc_put(qchan, d);
+	return NULL;
+}
+
+static struct dma_async_tx_descriptor *qdma_dmaeng_prep_memcpy(
+		struct dma_chan *chan, dma_addr_t dst, dma_addr_t src,
+		size_t len, unsigned long flags)
+{
+	struct qdma_dmaeng_chan *qchan = to_qdma_dmaeng_chan(chan);
+	struct qdma_dmaeng_desc *d;
+
+	if (!len)
+		return NULL;
+
+	d = qdma_dmaeng_desc_get(qchan, DMA_MEM_TO_MEM, flags);
+	if (!d)
+		return NULL;
+	if (qdma_dmaeng_desc_reserve(d, 1, 1) < 0) {
+		qdma_dmaeng_desc_put(qchan, d);
+		return NULL;
+	}
+
+	d->src = src;
+	d->dst = dst;
+	d->len = len;
+
+	return &d->txd;
+}
+
+static int qdma_dmaeng_config(struct dma_chan *chan,
+			struct dma_slave_config *config)
+{
+	struct qdma_dmaeng_chan *qchan = to_qdma_dmaeng_chan(chan);
+
+	spin_lock_bh(&qchan->lock);
+	memcpy(&qchan->slave, config, sizeof(*config));
+	spin_unlock_bh(&qchan->lock);
+
+	return 0;
+}
+
+/*****************************************************************************/
+/**
+ * qdma_dmaeng_terminate_all() - drop all descriptors of the channel
+ *
+ * Requests already handed to libqdma can not be recalled, the descriptors
+ * they belong to are retired without a callback once the requests complete.
+ * device_synchronize waits for that.
+ *
+ * @param[in]	chan:	dmaengine channel
+ *
+ * @return	0
+ *****************************************************************************/
+static int qdma_dmaeng_terminate_all(struct dma_chan *chan)
+{
+	struct qdma_dmaeng_chan *qchan = to_qdma_dmaeng_chan(chan);
+	struct qdma_dmaeng_desc *d, *tmp;
+	LIST_HEAD(head);
+
+	spin_lock_bh(&qchan->lock);
+	list_splice_init(&qchan->submitted, &head);
+	list_for_each_entry(d, &qchan->active, node)
+		d->terminated = 1;
+	spin_unlock_bh(&qchan->lock);
+
+	list_for_each_entry_safe(d, tmp, &head, node) {
+		list_del_init(&d->node);
+		qdma_dmaeng_desc_release(qchan, d);
+	}
+
+	return 0;
+}
+
+static void qdma_dmaeng_synchronize(struct dma_chan *chan)
+{
+	struct qdma_dmaeng_chan *qchan = to_qdma_dmaeng_chan(chan);
+	unsigned int ms = 0;
+	bool busy;
+
+	do {
+		spin_lock_bh(&qchan->lock);
+		busy = !list_empty(&qchan->active);
+		spin_unlock_bh(&qchan->lock);
+		if (!busy)
+			break;
+		msleep(1);
+	} while (++ms < QDMA_DMAENG_SYNC_TIMEOUT_MS);
+
+	if (busy)
+		pr_warn("%s, qidx %u, requests still in flight after %u ms.\n",
+			dma_chan_name(chan), qchan->qidx, ms);
+
+	tasklet_kill(&qchan->tasklet);
+}
+
+static void qdma_dmaeng_chan_user_put(struct qdma_dmaeng_dev *ddev)
+{
+	spin_lock_bh(&ddev->lock);
+	if (!--ddev->chan_users)
+		wake_up(&ddev->wq);
+	spin_unlock_bh(&ddev->lock);
+}
+
+static int qdma_dmaeng_alloc_chan_resources(struct dma_chan *chan)
+{
+	struct qdma_dmaeng_chan *qchan = to_qdma_dmaeng_chan(chan);
+	struct qdma_dmaeng_dev *ddev = to_qdma_dmaeng_dev(chan);
+	struct qdma_dmaeng_desc *d;
+	LIST_HEAD(head);
+	int i;
+
+	spin_lock_bh(&ddev->lock);
+	if (ddev->dying) {
+		spin_unlock_bh(&ddev->lock);
+		return -ENODEV;
+	}
+	ddev->chan_users++;
+	spin_unlock_bh(&ddev->lock);
+
+	for (i = 0; i < QDMA_DMAENG_DESC_PREALLOC; i++) {
+		d = qdma_dmaeng_desc_alloc(qchan, GFP_KERNEL);
+		if (!d)
+			break;
+		list_add(&d->node, &head);
+	}
+	if (!i) {
+		qdma_dmaeng_chan_user_put(ddev);
+		return -ENOMEM;
+	}
+
+	spin_lock_bh(&qchan->lock);
+	list_splice(&head, &qchan->free);
+	spin_unlock_bh(&qchan->lock);
+
+	chan->cookie = DMA_MIN_COOKIE;
+	chan->completed_cookie = DMA_MIN_COOKIE;
+
+	return i;
+}
+
+static void qdma_dmaeng_free_chan_resources(struct dma_chan *chan)
+{
+	struct qdma_dmaeng_chan *qchan = to_qdma_dmaeng_chan(chan);
+	struct qdma_dmaeng_desc *d, *tmp;
+	LIST_HEAD(head);
+
+	qdma_dmaeng_terminate_all(chan);
+	qdma_dmaeng_synchronize(chan);
+
+	/* the reusable descriptors the client did not free go too, only
+	 * the ones libqdma still holds requests of are left behind
+	 */
+	spin_lock_bh(&qchan->lock);
+	list_for_each_entry(d, &qchan->active, node)
+		list_del_init(&d->all_node);
+	list_splice_init(&qchan->all, &head);
+	INIT_LIST_HEAD(&qchan->free);
+	spin_unlock_bh(&qchan->lock);
+
+	list_for_each_entry_safe(d, tmp, &head, all_node) {
+		list_del(&d->all_node);
+		qdma_dmaeng_desc_destroy(d);
+	}
+
+	qdma_dmaeng_chan_user_put(to_qdma_dmaeng_dev(chan));
+}
+
+static void qdma_dmaeng_queues_del(struct qdma_dmaeng_chan *qchan)
+{
+	unsigned long dev_hndl = (unsigned long)qchan->xdev;
+	char ebuf[128];
+
+	if (qchan->h2c_qhndl != QDMA_QUEUE_IDX_INVALID) {
+		qdma_queue_stop(dev_hndl, qchan->h2c_qhndl, ebuf, sizeof(ebuf));
+		qdma_queue_remove(dev_hndl, qchan->h2c_qhndl, ebuf,
+				sizeof(ebuf));
+		qchan->h2c_qhndl = QDMA_QUEUE_IDX_INVALID;
+	}
+	if (qchan->c2h_qhndl != QDMA_QUEUE_IDX_INVALID) {
+		qdma_queue_stop(dev_hndl, qchan->c2h_qhndl, ebuf, sizeof(ebuf));
+		qdma_queue_remove(dev_hndl, qchan->c2h_qhndl, ebuf,
+				sizeof(ebuf));
+		qchan->c2h_qhndl = QDMA_QUEUE_IDX_INVALID;
+	}
+}
+
+static int qdma_dmaeng_queue_add(struct qdma_dmaeng_chan *qchan, u8 q_type,
+				unsigned long *qhndl)
+{
+	unsigned long dev_hndl = (unsigned long)qchan->xdev;
+	struct qdma_queue_conf qconf;
+	char ebuf[128];
+	int rv;
+
+	memset(&qconf, 0, sizeof(qconf));
+	qconf.qidx = qchan->qidx;
+	qconf.st = 0;
+	qconf.q_type = q_type;
+	qconf.wb_status_en = 1;
+	qconf.cmpl_status_acc_en = 1;
+	qconf.cmpl_status_pend_chk = 1;
+
+	rv = qdma_queue_add(dev_hndl, &qconf, qhndl, ebuf, sizeof(ebuf));
+	if (rv < 0)
+		goto err_out;
+	rv = qdma_queue_config(dev_hndl, *qhndl, &qconf, ebuf, sizeof(ebuf));
+	if (rv < 0)
+		goto err_out;
+	rv = qdma_queue_start(dev_hndl, *qhndl, ebuf, sizeof(ebuf));
+	if (rv < 0)
+		goto err_out;
+
+	return 0;
+
+err_out:
+	pr_err("%s, qidx %u, %s queue setup failed %d, %s\n",
+		qchan->xdev->conf.name, qchan->qidx,
+		q_type == Q_H2C ? "H2C" : "C2H", rv, ebuf);
+	return rv;
+}
+
+/*****************************************************************************/
+/**
+ * qdma_dmaeng_free_qidx() - find a queue index with no queue in use, the
+ *	search starts from the top to stay clear of the indices user space
+ *	usually picks
+ *
+ * @param[in]	xdev:	qdma device
+ * @param[in]	below:	search indices below this one
+ *
+ * @return	queue index or -ENOSPC
+ *****************************************************************************/
+static int qdma_dmaeng_free_qidx(struct xlnx_dma_dev *xdev, int below)
+{
+	struct qdma_dev *qdev = xdev_2_qdev(xdev);
+	int i;
+
+	for (i = min_t(int, below, qdev->qmax) - 1; i >= 0; i--) {
+		struct qdma_descq *descqs[3] = {
+			qdev->h2c_descq + i,
+			qdev->c2h_descq + i,
+			qdev->cmpt_descq + i
+		};
+		int j, used = 0;
+
+		for (j = 0; j < 3; j++) {
+			lock_descq(descqs[j]);
+			if (descqs[j]->q_state != Q_STATE_DISABLED)
+				used = 1;
+			unlock_descq(descqs[j]);
+		}
+		if (!used)
+			return i;
+	}
+
+	return -ENOSPC;
+}
+
+static void qdma_dmaeng_dev_free(struct qdma_dmaeng_dev *ddev)
+{
+	unsigned int i;
+
+	for (i = 0; i < ddev->num_chans; i++) {
+		qdma_dmaeng_queues_del(&ddev->chans[i]);
+		tasklet_kill(&ddev->chans[i].tasklet);
+	}
+	kfree(ddev);
+}
+
+int qdma_dmaengine_register(unsigned long dev_hndl, unsigned int num_chans,
+			u64 win_base, unsigned int win_sz)
+{
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	struct qdma_dmaeng_dev *ddev;
+	struct dma_device *dma;
+	int qidx = INT_MAX;
+	unsigned int i;
+	int rv;
+
+	if (!xdev || xdev_check_hndl(__func__, xdev->conf.pdev, dev_hndl) < 0)
+		return -EINVAL;
+	if (!num_chans || !win_sz)
+		return -EINVAL;
+	if (!xdev->dev_cap.mm_en) {
+		pr_err("%s, MM mode not enabled.\n", xdev->conf.name);
+		return -EOPNOTSUPP;
+	}
+
+	mutex_lock(&dmaeng_mutex);
+	if (xdev->dmaeng) {
+		rv = -EEXIST;
+		goto unlock;
+	}
+
+	ddev = kzalloc(sizeof(*ddev) + num_chans * sizeof(ddev->chans[0]),
+			GFP_KERNEL);
+	if (!ddev) {
+		rv = -ENOMEM;
+		goto unlock;
+	}
+	ddev->xdev = xdev;
+	spin_lock_init(&ddev->lock);
+	init_waitqueue_head(&ddev->wq);
+
+	dma = &ddev->dma;
+	dma->dev = &xdev->conf.pdev->dev;
+	INIT_LIST_HEAD(&dma->channels);
+	dma_cap_set(DMA_SLAVE, dma->cap_mask);
+	dma_cap_set(DMA_PRIVATE, dma->cap_mask);
+	dma_cap_set(DMA_MEMCPY, dma->cap_mask);
+	dma_cap_set(DMA_INTERLEAVE, dma->cap_mask);
+	dma->directions = BIT(DMA_MEM_TO_DEV) | BIT(DMA_DEV_TO_MEM) |
+			BIT(DMA_MEM_TO_MEM);
+	dma->src_addr_widths = QDMA_DMAENG_BUSWIDTHS;
+	dma->dst_addr_widths = QDMA_DMAENG_BUSWIDTHS;
+	dma->residue_granularity = DMA_RESIDUE_GRANULARITY_DESCRIPTOR;
+	dma->descriptor_reuse = true;
+	dma->copy_align = DMAENGINE_ALIGN_1_BYTE;
+
+	dma->device_alloc_chan_resources = qdma_dmaeng_alloc_chan_resources;
+	dma->device_free_chan_resources = qdma_dmaeng_free_chan_resources;
+	dma->device_prep_slave_sg = qdma_dmaeng_prep_slave_sg;
+	dma->device_prep_interleaved_dma = qdma_dmaeng_prep_interleaved;
+	dma->device_prep_dma_memcpy = qdma_dmaeng_prep_memcpy;
+	dma->device_config = qdma_dmaeng_config;
+	dma->device_terminate_all = qdma_dmaeng_terminate_all;
+	dma->device_synchronize = qdma_dmaeng_synchronize;
+	dma->device_issue_pending = qdma_dmaeng_issue_pending;
+	dma->device_tx_status = qdma_dmaeng_tx_status;
+
+	for (i = 0; i < num_chans; i++) {
+		struct qdma_dmaeng_chan *qchan = &ddev->chans[i];
+
+		qchan->xdev = xdev;
+		qchan->h2c_qhndl = QDMA_QUEUE_IDX_INVALID;
+		qchan->c2h_qhndl = QDMA_QUEUE_IDX_INVALID;
+		qchan->win_addr = win_base + (u64)i * win_sz;
+		qchan->win_sz = win_sz;
+		spin_lock_init(&qchan->lock);
+		INIT_LIST_HEAD(&qchan->free);
+		INIT_LIST_HEAD(&qchan->submitted);
+		INIT_LIST_HEAD(&qchan->active);
+		INIT_LIST_HEAD(&qchan->all);
+		tasklet_init(&qchan->tasklet, qdma_dmaeng_tasklet,
+				(unsigned long)qchan);
+		ddev->num_chans++;
+
+		qidx = qdma_dmaeng_free_qidx(xdev, qidx);
+		if (qidx < 0) {
+			pr_err("%s, no free MM queue pair for channel %u.\n",
+				xdev->conf.name, i);
+			rv = qidx;
+			goto free_dev;
+		}
+		qchan->qidx = qidx;
+
+		rv = qdma_dmaeng_queue_add(qchan, Q_H2C, &qchan->h2c_qhndl);
+		if (rv < 0)
+			goto free_dev;
+		rv = qdma_dmaeng_queue_add(qchan, Q_C2H, &qchan->c2h_qhndl);
+		if (rv < 0)
+			goto free_dev;
+
+		qchan->chan.device = dma;
+		list_add_tail(&qchan->chan.device_node, &dma->channels);
+	}
+
+	rv = dma_async_device_register(dma);
+	if (rv < 0) {
+		pr_err("%s, dma_async_device_register failed %d.\n",
+			xdev->conf.name, rv);
+		goto free_dev;
+	}
+
+	xdev->dmaeng = ddev;
+	mutex_unlock(&dmaeng_mutex);
+
+	pr_info("%s, %u dmaengine channels, window 0x%llx + %u.\n",
+		xdev->conf.name, num_chans, win_base, win_sz);
+
+	return 0;
+
+free_dev:
+	qdma_dmaeng_dev_free(ddev);
+unlock:
+	mutex_unlock(&dmaeng_mutex);
+	return rv;
+}
+
+static bool qdma_dmaeng_dev_idle(struct qdma_dmaeng_dev *ddev)
+{
+	bool idle;
+
+	spin_lock_bh(&ddev->lock);
+	idle = !ddev->chan_users;
+	spin_unlock_bh(&ddev->lock);
+
+	return idle;
+}
+
+int qdma_dmaengine_unregister(unsigned long dev_hndl, int wait)
+{
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	struct qdma_dmaeng_dev *ddev;
+
+	if (!xdev || xdev_check_hndl(__func__, xdev->conf.pdev, dev_hndl) < 0)
+		return -EINVAL;
+
+	mutex_lock(&dmaeng_mutex);
+	ddev = xdev->dmaeng;
+	if (!ddev) {
+		mutex_unlock(&dmaeng_mutex);
+		return 0;
+	}
+
+	/* from here on no client gets a channel, the ones handed out can
+	 * not be pulled from under their clients
+	 */
+	spin_lock_bh(&ddev->lock);
+	if (ddev->chan_users && !wait) {
+		spin_unlock_bh(&ddev->lock);
+		mutex_unlock(&dmaeng_mutex);
+		return -EBUSY;
+	}
+	ddev->dying = 1;
+	spin_unlock_bh(&ddev->lock);
+
+	while (!wait_event_timeout(ddev->wq, qdma_dmaeng_dev_idle(ddev),
+			msecs_to_jiffies(QDMA_DMAENG_REMOVE_WARN_MS)))
+		pr_warn("%s, waiting for clients to release %u dmaengine channels.\n",
+			xdev->conf.name, READ_ONCE(ddev->chan_users));
+
+	dma_async_device_unregister(&ddev->dma);
+	xdev->dmaeng = NULL;
+	qdma_dmaeng_dev_free(ddev);
+	mutex_unlock(&dmaeng_mutex);
+
+	return 0;
+}
+
+unsigned int qdma_dmaengine_chan_count(unsigned long dev_hndl)
+{
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	unsigned int cnt = 0;
+
+	if (!xdev)
+		return 0;
+
+	mutex_lock(&dmaeng_mutex);
+	if (xdev->dmaeng)
+		cnt = xdev->dmaeng->num_chans;
+	mutex_unlock(&dmaeng_mutex);
+
+	return cnt;
+}
+
+#else /* QDMA_DMAENGINE_SUPPORTED */
+
+int qdma_dmaengine_register(unsigned long dev_hndl, unsigned int num_chans,
+			u64 win_base, unsigned int win_sz)
+{
+	pr_err("dmaengine channels need linux 4.11 or later.\n");
+	return -EOPNOTSUPP;
+}
+
+int qdma_dmaengine_unregister(unsigned long dev_hndl, int wait)
+{
+	return 0;
+}
+
+unsigned int qdma_dmaengine_chan_count(unsigned long dev_hndl)
+{
+	return 0;
+}
+
+#endif /* QDMA_DMAENGINE_SUPPORTED */
@@ -0,0 +1,190 @@
+/*
+ * This file is part of the Xilinx DMA IP Core driver for Linux
+ *
+ * Copyright (c) 2017-2022, Xilinx, Inc. All rights reserved.
+ * Copyright (c) 2022-2024, Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#ifndef __QDMA_DMAENGINE_H__
+#define __QDMA_DMAENGINE_H__
+/**
+ * @file
+ * @brief This file contains the declarations for the dmaengine provider
+ *        built on top of the MM queue pairs
+ *
+ * Every channel owns one MM H2C and one MM C2H queue with the same index.
+ * Slave and interleaved transfers move data between host memory and the
+ * card address taken from the slave config or the interleaved template.
+ * Memory to memory copies are staged through a per channel window of card
+ * memory, one H2C and one C2H request per window sized chunk.
+ *
+ * Requests of a descriptor are queued with qdma_batch_request_submit() when
+ * the client calls issue_pending. Their completion handlers only count down
+ * and schedule the channel tasklet, which retires descriptors in cookie
+ * order and runs the client callbacks.
+ */
+#include <linux/types.h>
+#include <linux/version.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/interrupt.h>
+#include <linux/wait.h>
+#include <linux/dmaengine.h>
+#include "libqdma_export.h"
+
+/** callback_result and descriptor reuse are needed by the provider */
+#if KERNEL_VERSION(4, 11, 0) <= LINUX_VERSION_CODE
+#define QDMA_DMAENGINE_SUPPORTED
+#endif
+
+/** descriptors preallocated per channel */
+#define QDMA_DMAENG_DESC_PREALLOC	64
+/** maximum requests handed to libqdma in one batch */
+#define QDMA_DMAENG_SUBMIT_BATCH	32
+/** interval of the warnings while remove waits for dmaengine clients */
+#define QDMA_DMAENG_REMOVE_WARN_MS	5000
+
+#ifdef QDMA_DMAENGINE_SUPPORTED
+
+struct qdma_dmaeng_desc;
+struct qdma_dmaeng_chan;
+
+/**
+ * struct qdma_dmaeng_req - one libqdma request of a descriptor
+ */
+struct qdma_dmaeng_req {
+	/** @req: request handed to libqdma */
+	struct qdma_request req;
+	/** @desc: descriptor the request belongs to */
+	struct qdma_dmaeng_desc *desc;
+};
+
+/**
+ * enum qdma_dmaeng_phase - progress of a memcpy descriptor
+ */
+enum qdma_dmaeng_phase {
+	/** @QDMA_DMAENG_IDLE: no chunk in flight */
+	QDMA_DMAENG_IDLE,
+	/** @QDMA_DMAENG_H2C: chunk being copied into the card window */
+	QDMA_DMAENG_H2C,
+	/** @QDMA_DMAENG_C2H: chunk being copied out of the card window */
+	QDMA_DMAENG_C2H,
+};
+
+/**
+ * struct qdma_dmaeng_desc - dmaengine descriptor
+ */
+struct qdma_dmaeng_desc {
+	/** @txd: descriptor handed to the client */
+	struct dma_async_tx_descriptor txd;
+	/** @node: link in the free, submitted or active list */
+	struct list_head node;
+	/** @all_node: link in the list of all descriptors of the channel */
+	struct list_head all_node;
+	/** @dir: transfer direction */
+	enum dma_transfer_direction dir;
+	/** @pending: requests not completed yet */
+	atomic_t pending;
+	/** @err: first error reported for the descriptor */
+	int err;
+	/** @terminated: retire without running the callback */
+	u8 terminated;
+	/** @nr_reqs: number of requests in use */
+	unsigned int nr_reqs;
+	/** @max_reqs: number of requests allocated */
+	unsigned int max_reqs;
+	/** @reqs: requests */
+	struct qdma_dmaeng_req *reqs;
+	/** @nr_sg: number of sg entries in use */
+	unsigned int nr_sg;
+	/** @max_sg: number of sg entries allocated */
+	unsigned int max_sg;
+	/** @sg: sg entries, each request covers a contiguous range */
+	struct qdma_sw_sg *sg;
+	/** @len: total number of bytes */
+	size_t len;
+	/** @src: memcpy source */
+	dma_addr_t src;
+	/** @dst: memcpy destination */
+	dma_addr_t dst;
+	/** @off: memcpy bytes done */
+	size_t off;
+	/** @chunk: memcpy bytes of the chunk in flight */
+	unsigned int chunk;
+	/** @phase: memcpy progress */
+	enum qdma_dmaeng_phase phase;
+};
+
+/**
+ * struct qdma_dmaeng_chan - dmaengine channel on a MM queue pair
+ */
+struct qdma_dmaeng_chan {
+	/** @chan: dmaengine channel */
+	struct dma_chan chan;
+	/** @xdev: device the queues belong to */
+	struct xlnx_dma_dev *xdev;
+	/** @qidx: queue index of the pair */
+	unsigned int qidx;
+	/** @h2c_qhndl: H2C queue handle */
+	unsigned long h2c_qhndl;
+	/** @c2h_qhndl: C2H queue handle */
+	unsigned long c2h_qhndl;
+	/** @win_addr: card address of the memcpy staging window */
+	u64 win_addr;
+	/** @win_sz: size of the memcpy staging window */
+	unsigned int win_sz;
+	/** @lock: protects the lists and the cookies */
+	spinlock_t lock;
+	/** @free: idle descriptors */
+	struct list_head free;
+	/** @submitted: descriptors waiting for issue_pending */
+	struct list_head submitted;
+	/** @active: descriptors handed to libqdma, in cookie order */
+	struct list_head active;
+	/** @all: every descriptor of the channel, including the reusable
+	 *  ones a client holds
+	 */
+	struct list_head all;
+	/** @tasklet: retires completed descriptors */
+	struct tasklet_struct tasklet;
+	/** @slave: slave configuration */
+	struct dma_slave_config slave;
+};
+
+/**
+ * struct qdma_dmaeng_dev - dmaengine device of a qdma function
+ */
+struct qdma_dmaeng_dev {
+	/** @dma: dmaengine device */
+	struct dma_device dma;
+	/** @xdev: qdma device */
+	struct xlnx_dma_dev *xdev;
+	/** @num_chans: number of channels */
+	unsigned int num_chans;
+	/** @lock: protects @chan_users and @dying */
+	spinlock_t lock;
+	/** @chan_users: channels allocated to a client */
+	unsigned int chan_users;
+	/** @dying: unregister started, channels are refused to new clients */
+	u8 dying;
+	/** @wq: woken up when the last channel is released */
+	wait_queue_head_t wq;
+	/** @chans: channels */
+	struct qdma_dmaeng_chan chans[];
+};
+
+#endif /* QDMA_DMAENGINE_SUPPORTED */
+
+#endif /* ifndef __QDMA_DMAENGINE_H__ */
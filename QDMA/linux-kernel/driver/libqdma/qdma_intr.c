@@ -151,20 +151,89 @@ static irqreturn_t error_intr_handler(int irq_index, int irq, void *dev_id)
 }
 #endif
 
+static inline void intr_work_schedule(struct qdma_descq *descq)
+{
+	if (descq->cpu_assigned)
+		schedule_work_on(descq->intr_work_cpu, &descq->work);
+	else
+		schedule_work(&descq->work);
+}
+
+static void data_intr_queue(struct qdma_descq *descq)
+{
+	if (descq->conf.fp_descq_isr_top) {
+		descq->conf.fp_descq_isr_top(descq->q_hndl,
+				descq->conf.quld);
+		return;
+	}
+
+	if (descq->xdev->intr_hybrid) {
+		/* the queue is not re-armed until the poll loop drains it,
+		 * an interrupt raced with the poll loop start has nothing
+		 * left to do
+		 */
+		if (atomic_xchg(&descq->intr_polling, 1))
+			return;
+		atomic64_inc(&descq->intr_poll_cnt);
+	}
+
+	intr_work_schedule(descq);
+}
+
+static inline void intr_ring_entry_decode(struct intr_coal_conf *coal_entry,
+		union qdma_intr_ring *ring_entry, u8 *color, u8 *intr_type,
+		u32 *qid)
+{
+	if (coal_entry->cpm4_layout) {
+		*color = ring_entry->ring_cpm.coal_color;
+		*intr_type = ring_entry->ring_cpm.intr_type;
+		*qid = ring_entry->ring_cpm.qid;
+	} else {
+		*color = ring_entry->ring_generic.coal_color;
+		*intr_type = ring_entry->ring_generic.intr_type;
+		*qid = ring_entry->ring_generic.qid;
+	}
+}
+
+static void data_intr_aggregate_queue(struct xlnx_dma_dev *xdev,
+		struct intr_coal_conf *coal_entry, int vidx, int irq,
+		u64 timestamp, u32 qid, u8 intr_type)
+{
+	struct qdma_descq *descq;
+
+	descq = qdma_device_get_descq_by_hw_qid(xdev, qid, intr_type);
+	if (!descq) {
+		pr_err("IRQ[%d]: IVE[%d], Qid = %d: desc not found\n",
+				irq, vidx, qid);
+		return;
+	}
+	coal_entry->cidx_qidx = descq->conf.qidx;
+
+	if (descq->conf.ping_pong_en &&
+		descq->conf.q_type == Q_C2H && descq->conf.st)
+		descq->ping_pong_rx_time = timestamp;
+
+	data_intr_queue(descq);
+}
+
+/*
+ * Drain the interrupt ring in two passes: the valid entries are decoded
+ * into the pending map, which drops repeated entries of the same queue,
+ * then every pending queue is scheduled once and the ring cidx is written
+ * once for the whole drain.
+ */
 static void data_intr_aggregate(struct xlnx_dma_dev *xdev, int vidx, int irq,
 		u64 timestamp)
 {
-	struct qdma_descq *descq = NULL;
-	u32 counter = 0;
 	struct intr_coal_conf *coal_entry =
 			(xdev->intr_coal_list + vidx - xdev->dvec_start_idx);
-	union qdma_intr_ring *ring_entry;
 	struct qdma_intr_cidx_reg_info *intr_cidx_info;
-	uint8_t color = 0;
-	uint8_t intr_type = 0;
-	uint32_t qid = 0;
-	uint32_t num_entries_processed = 0;
-
+	union qdma_intr_ring *ring_entry;
+	unsigned int pend_qs, cidx, nr_entries, bit;
+	unsigned int num_entries_processed = 0;
+	unsigned int num_pend = 0;
+	u8 color, intr_type = 0;
+	u32 qid = 0;
 
 	if (!coal_entry) {
 		pr_err("Failed to locate the coalescing entry for vector = %d\n",
@@ -179,9 +248,6 @@ static void data_intr_aggregate(struct xlnx_dma_dev *xdev, int vidx, int irq,
 		coal_entry->intr_rng_num_entries,
 		intr_cidx_info->sw_cidx);
 
-	pr_debug("vidx = %d, dvec_start_idx = %d\n", vidx,
-		 xdev->dvec_start_idx);
-
 	if ((xdev->msix[vidx].entry) !=  coal_entry->vec_id) {
 		pr_err("msix[%d].entry[%d] != vec_id[%d]\n",
 			vidx, xdev->msix[vidx].entry,
@@ -190,85 +256,64 @@ static void data_intr_aggregate(struct xlnx_dma_dev *xdev, int vidx, int irq,
 		return;
 	}
 
-	counter = intr_cidx_info->sw_cidx;
-	ring_entry = (coal_entry->intr_ring_base + counter);
-	if (!ring_entry) {
-		pr_err("Failed to locate the ring entry for vector = %d\n",
-			vidx);
-		return;
-	}
+	pend_qs = coal_entry->pend_qs;
+	nr_entries = coal_entry->intr_rng_num_entries;
+	cidx = intr_cidx_info->sw_cidx;
+	color = coal_entry->color;
 
-	do {
-		if ((xdev->version_info.ip_type == QDMA_VERSAL_HARD_IP) &&
-				(xdev->version_info.device_type ==
-				 QDMA_DEVICE_VERSAL_CPM4)) {
-			color = ring_entry->ring_cpm.coal_color;
-			intr_type = ring_entry->ring_cpm.intr_type;
-			qid = ring_entry->ring_cpm.qid;
-		} else {
-			color = ring_entry->ring_generic.coal_color;
-			intr_type = ring_entry->ring_generic.intr_type;
-			qid = ring_entry->ring_generic.qid;
-		}
+	/* a ring worth of entries at most, the rest raises a new interrupt
+	 * once the cidx is written
+	 */
+	while (num_entries_processed < nr_entries) {
+		u8 e_color;
 
-		if (color != coal_entry->color)
+		ring_entry = coal_entry->intr_ring_base + cidx;
+		intr_ring_entry_decode(coal_entry, ring_entry, &e_color,
+				&intr_type, &qid);
+		if (e_color != color)
 			break;
-		pr_debug("IRQ[%d]: IVE[%d], Qid = %d, e_color = %d, c_color = %d, intr_type = %d\n",
-				irq, vidx, qid, coal_entry->color,
-				color, intr_type);
-
-		descq = qdma_device_get_descq_by_hw_qid(xdev, qid,
-				intr_type);
-		if (!descq) {
-			pr_err("IRQ[%d]: IVE[%d], Qid = %d: desc not found\n",
-					irq, vidx, qid);
-			return;
-		}
-		xdev->prev_descq = descq;
-		pr_debug("IRQ[%d]: IVE[%d], Qid = %d, e_color = %d, c_color = %d, intr_type = %d\n",
-				irq, vidx, qid, coal_entry->color,
-				color, intr_type);
 
-		if (descq->conf.ping_pong_en &&
-			descq->conf.q_type == Q_C2H && descq->conf.st)
-			descq->ping_pong_rx_time = timestamp;
+		pr_debug("IRQ[%d]: IVE[%d], Qid = %d, e_color = %d, intr_type = %d\n",
+				irq, vidx, qid, e_color, intr_type);
 
-		if (descq->conf.fp_descq_isr_top) {
-			descq->conf.fp_descq_isr_top(descq->q_hndl,
-					descq->conf.quld);
+		if (likely(qid < pend_qs)) {
+			bit = intr_type ? pend_qs + qid : qid;
+			if (!__test_and_set_bit(bit, coal_entry->pend_map))
+				num_pend++;
 		} else {
-			if (descq->cpu_assigned)
-				schedule_work_on(descq->intr_work_cpu,
-						&descq->work);
-			else
-				schedule_work(&descq->work);
+			data_intr_aggregate_queue(xdev, coal_entry, vidx, irq,
+					timestamp, qid, intr_type);
 		}
 
-		if (++intr_cidx_info->sw_cidx ==
-				coal_entry->intr_rng_num_entries) {
-			counter = 0;
-			xdev->intr_coal_list->color =
-				(xdev->intr_coal_list->color) ? 0 : 1;
-			intr_cidx_info->sw_cidx = 0;
-		} else
-			counter++;
+		if (++cidx == nr_entries) {
+			cidx = 0;
+			color ^= 1;
+		}
 		num_entries_processed++;
-		ring_entry = (coal_entry->intr_ring_base + counter);
-	} while (1);
-
-	if (descq) {
-		queue_intr_cidx_update(descq->xdev,
-			descq->conf.qidx, &coal_entry->intr_cidx_info);
-	} else if (num_entries_processed == 0) {
-		pr_debug("No entries processed\n");
-		descq = xdev->prev_descq;
-		if (descq) {
-			pr_debug("Doing stale update\n");
-			queue_intr_cidx_update(descq->xdev,
-				descq->conf.qidx, &coal_entry->intr_cidx_info);
+	}
+
+	coal_entry->color = color;
+	intr_cidx_info->sw_cidx = cidx;
+
+	if (num_pend) {
+		for_each_set_bit(bit, coal_entry->pend_map, 2 * pend_qs) {
+			__clear_bit(bit, coal_entry->pend_map);
+			data_intr_aggregate_queue(xdev, coal_entry, vidx, irq,
+					timestamp, bit % pend_qs, bit >= pend_qs);
+			if (!--num_pend)
+				break;
 		}
 	}
 
+	if (!num_entries_processed)
+		pr_debug("No entries processed, doing stale update\n");
+
+	/* through a queue of this ring, the handler of the vector is the
+	 * only one to touch its coal_entry
+	 */
+	if (coal_entry->cidx_qidx >= 0)
+		queue_intr_cidx_update(xdev, coal_entry->cidx_qidx,
+				intr_cidx_info);
 }
 
 static void data_intr_direct(struct xlnx_dma_dev *xdev, int vidx, int irq,
@@ -289,16 +334,7 @@ static void data_intr_direct(struct xlnx_dma_dev *xdev, int vidx, int irq,
 				descq->conf.q_type == Q_C2H && descq->conf.st)
 			descq->ping_pong_rx_time = timestamp;
 
-		if (descq->conf.fp_descq_isr_top) {
-			descq->conf.fp_descq_isr_top(descq->q_hndl,
-					descq->conf.quld);
-		} else {
-			if (descq->cpu_assigned)
-				schedule_work_on(descq->intr_work_cpu,
-						&descq->work);
-			else
-				schedule_work(&descq->work);
-		}
+		data_intr_queue(descq);
 	}
 	spin_unlock_irqrestore(&xdev->dev_intr_info_list[vidx].vec_q_list,
 			    flags);
@@ -429,7 +465,11 @@ static void intr_context_invalidate(struct xlnx_dma_dev *xdev)
 
 void intr_ring_teardown(struct xlnx_dma_dev *xdev)
 {
+	int i;
+
 	intr_context_invalidate(xdev);
+	for (i = 0; i < QDMA_NUM_DATA_VEC_FOR_INTR_CXT; i++)
+		kfree(xdev->intr_coal_list[i].pend_map);
 	kfree(xdev->intr_coal_list);
 }
 
@@ -899,10 +939,23 @@ int intr_ring_setup(struct xlnx_dma_dev *xdev)
 				goto err_out;
 			}
 
+			intr_coal_list_entry->cpm4_layout =
+				(xdev->version_info.ip_type ==
+				 QDMA_VERSAL_HARD_IP) &&
+				(xdev->version_info.device_type ==
+				 QDMA_DEVICE_VERSAL_CPM4);
+			intr_coal_list_entry->pend_qs = xdev->dev_cap.num_qs;
+			intr_coal_list_entry->pend_map = kcalloc(
+				BITS_TO_LONGS(2 * xdev->dev_cap.num_qs),
+				sizeof(unsigned long), GFP_KERNEL);
+			if (!intr_coal_list_entry->pend_map)
+				intr_coal_list_entry->pend_qs = 0;
+
 			intr_coal_list_entry->vec_id =
 			xdev->msix[counter + xdev->dvec_start_idx].entry;
 			intr_coal_list_entry->intr_cidx_info.sw_cidx = 0;
 			intr_coal_list_entry->color = 1;
+			intr_coal_list_entry->cidx_qidx = -1;
 			intr_coal_list_entry->intr_cidx_info.rng_idx =
 					get_intr_ring_index(xdev,
 					    intr_coal_list_entry->vec_id);
@@ -931,6 +984,7 @@ int intr_ring_setup(struct xlnx_dma_dev *xdev)
 err_out:
 	while (--counter >= 0) {
 		intr_coal_list_entry = (intr_coal_list + counter);
+		kfree(intr_coal_list_entry->pend_map);
 		intr_ring_free(xdev, intr_coal_list_entry->intr_rng_num_entries,
 				sizeof(union qdma_intr_ring),
 				(u8 *)intr_coal_list_entry->intr_ring_base,
@@ -940,11 +994,103 @@ err_out:
 	return -ENOMEM;
 }
 
+/* hybrid mode: the queue has not been serviced completely */
+static bool intr_poll_pending(struct qdma_descq *descq)
+{
+	if (descq->conf.st && (descq->conf.q_type == Q_C2H)) {
+		struct qdma_c2h_cmpt_cmpl_status *cs =
+			(struct qdma_c2h_cmpt_cmpl_status *)
+			descq->desc_cmpt_cmpl_status;
+
+		dma_rmb();
+		return cs->pidx != descq->cidx_cmpt;
+	} else {
+		struct qdma_desc_cmpl_status *cs =
+			(struct qdma_desc_cmpl_status *)
+			descq->desc_cmpl_status;
+
+		dma_rmb();
+		return cs->cidx != descq->cidx;
+	}
+}
+
+/* hybrid mode: keep the cidx/pidx updates of the poll loop from arming */
+static void intr_poll_mask(struct qdma_descq *descq)
+{
+	if (descq->conf.st && (descq->conf.q_type == Q_C2H))
+		descq->cmpt_cidx_info.irq_en = 0;
+	else
+		descq->pidx_info.irq_en = 0;
+}
+
+static int intr_poll_rearm(struct qdma_descq *descq)
+{
+	int rv;
+
+	if (descq->conf.st && (descq->conf.q_type == Q_C2H)) {
+		descq->cmpt_cidx_info.irq_en = descq->conf.cmpl_en_intr;
+		descq->cmpt_cidx_info.wrb_cidx = descq->cidx_cmpt;
+		rv = queue_cmpt_cidx_update(descq->xdev, descq->conf.qidx,
+				&descq->cmpt_cidx_info);
+	} else {
+		descq->pidx_info.irq_en = descq->conf.irq_en;
+		descq->pidx_info.pidx = descq->pidx;
+		rv = queue_pidx_update(descq->xdev, descq->conf.qidx,
+				descq->conf.q_type, &descq->pidx_info);
+	}
+	if (unlikely(rv < 0))
+		pr_err("%s: Failed to re-arm the interrupt, err %d\n",
+				descq->conf.name, rv);
+
+	return rv;
+}
+
+/* hybrid mode: one budgeted round of the poll loop */
+static void intr_poll_work(struct qdma_descq *descq)
+{
+	lock_descq(descq);
+	if (descq->q_state != Q_STATE_ONLINE) {
+		atomic_set(&descq->intr_polling, 0);
+		unlock_descq(descq);
+		return;
+	}
+	intr_poll_mask(descq);
+	descq->intr_poll_rounds++;
+	unlock_descq(descq);
+
+	qdma_descq_service_cmpl_update(descq, QDMA_INTR_POLL_BUDGET, 1);
+
+	lock_descq(descq);
+	if (descq->q_state != Q_STATE_ONLINE) {
+		atomic_set(&descq->intr_polling, 0);
+		unlock_descq(descq);
+		return;
+	}
+	if (intr_poll_pending(descq)) {
+		/* requeue rather than loop, so other work on the cpu runs */
+		unlock_descq(descq);
+		intr_work_schedule(descq);
+		return;
+	}
+	atomic_set(&descq->intr_polling, 0);
+	intr_poll_rearm(descq);
+	descq->intr_rearm_cnt++;
+	/* completions written back before the re-arm landed */
+	if (intr_poll_pending(descq) &&
+			!atomic_xchg(&descq->intr_polling, 1))
+		intr_work_schedule(descq);
+	unlock_descq(descq);
+}
+
 void intr_work(struct work_struct *work)
 {
 	struct qdma_descq *descq;
 
 	descq = container_of(work, struct qdma_descq, work);
+	if (atomic_read(&descq->intr_polling)) {
+		intr_poll_work(descq);
+		return;
+	}
 	qdma_descq_service_cmpl_update(descq, 0, 1);
 }
 
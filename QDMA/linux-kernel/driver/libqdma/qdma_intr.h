@@ -27,6 +27,11 @@
 #include <linux/types.h>
 #include <linux/workqueue.h>
 #include "qdma_descq.h"
+/**
+ * hybrid interrupt mode: max. completions serviced per poll round
+ */
+#define QDMA_INTR_POLL_BUDGET	64
+
 /**
  * forward declaration for xlnx_dma_dev
  */
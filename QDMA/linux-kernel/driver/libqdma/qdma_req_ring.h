@@ -0,0 +1,186 @@
+/*
+ * This file is part of the Xilinx DMA IP Core driver for Linux
+ *
+ * Copyright (c) 2017-2022, Xilinx, Inc. All rights reserved.
+ * Copyright (c) 2022-2024, Advanced Micro Devices, Inc. All rights reserved.
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING".
+ */
+
+#ifndef __QDMA_REQ_RING_H__
+#define __QDMA_REQ_RING_H__
+/**
+ * @file
+ * @brief This file contains the bounded multi producer single consumer
+ *        ring used to hand requests to a descq without taking its lock
+ *
+ * Every slot carries a sequence number. A producer claims the slot at the
+ * producer index with cmpxchg once its sequence equals the index, fills it
+ * and publishes it by advancing the sequence by one. The consumer takes
+ * the slot at the consumer index once its sequence is index + 1 and hands
+ * it back to the producers by advancing the sequence by the ring size.
+ *
+ * There must only be one consumer at a time, the descq lock provides
+ * that. Without __KERNEL__ the includer has to provide READ_ONCE,
+ * smp_load_acquire, smp_store_release, cmpxchg and
+ * ____cacheline_aligned_in_smp.
+ */
+#ifdef __KERNEL__
+#include <linux/types.h>
+#include <linux/compiler.h>
+#include <linux/cache.h>
+#include <linux/atomic.h>
+#include <linux/errno.h>
+#endif
+
+/** default number of request ring entries per descq, power of 2 */
+#define QDMA_REQ_RING_SZ		512
+
+/**
+ * struct qdma_req_ring_slot - request ring entry
+ */
+struct qdma_req_ring_slot {
+	/** @seq: sequence number, see the file description */
+	unsigned int seq;
+	/** @data: request published in this slot */
+	void *data;
+};
+
+/**
+ * struct qdma_req_ring - bounded multi producer single consumer ring
+ */
+struct qdma_req_ring {
+	/** @slot: ring entries */
+	struct qdma_req_ring_slot *slot;
+	/** @mask: number of entries - 1 */
+	unsigned int mask;
+	/** @prod: producer index, shared by all submitters */
+	unsigned int prod ____cacheline_aligned_in_smp;
+	/** @cons: consumer index, owned by the descq lock holder */
+	unsigned int cons ____cacheline_aligned_in_smp;
+};
+
+/*****************************************************************************/
+/**
+ * qdma_req_ring_init() - initialize a request ring
+ *
+ * @ring:	request ring
+ * @slot:	array of @size entries
+ * @size:	number of entries, must be a power of 2
+ *
+ * @return	none
+ *****************************************************************************/
+static inline void qdma_req_ring_init(struct qdma_req_ring *ring,
+				struct qdma_req_ring_slot *slot,
+				unsigned int size)
+{
+	unsigned int i;
+
+	for (i = 0; i < size; i++) {
+		slot[i].seq = i;
+		slot[i].data = NULL;
+	}
+	ring->slot = slot;
+	ring->mask = size - 1;
+	ring->prod = 0;
+	ring->cons = 0;
+}
+
+/*****************************************************************************/
+/**
+ * qdma_req_ring_enqueue() - add a request to the ring, safe to be called
+ *	from any number of contexts concurrently
+ *
+ * @ring:	request ring
+ * @data:	request
+ *
+ * @return	0: success
+ * @return	-ENOSPC: ring is full
+ *****************************************************************************/
+static inline int qdma_req_ring_enqueue(struct qdma_req_ring *ring,
+				void *data)
+{
+	struct qdma_req_ring_slot *slot;
+	unsigned int pos = READ_ONCE(ring->prod);
+	unsigned int seq;
+	int diff;
+
+	for (;;) {
+		slot = &ring->slot[pos & ring->mask];
+		seq = smp_load_acquire(&slot->seq);
+		diff = (int)(seq - pos);
+		if (diff == 0) {
+			unsigned int old = cmpxchg(&ring->prod, pos, pos + 1);
+
+			if (old == pos)
+				break;
+			pos = old;
+		} else if (diff < 0) {
+			/* slot still owned by the consumer one lap behind */
+			return -ENOSPC;
+		} else {
+			pos = READ_ONCE(ring->prod);
+		}
+	}
+
+	slot->data = data;
+	smp_store_release(&slot->seq, pos + 1);
+
+	return 0;
+}
+
+/*****************************************************************************/
+/**
+ * qdma_req_ring_dequeue() - take the oldest request off the ring, caller
+ *	must be the only consumer
+ *
+ * @ring:	request ring
+ *
+ * @return	request or NULL if the ring is empty
+ *****************************************************************************/
+static inline void *qdma_req_ring_dequeue(struct qdma_req_ring *ring)
+{
+	unsigned int pos = ring->cons;
+	struct qdma_req_ring_slot *slot = &ring->slot[pos & ring->mask];
+	void *data;
+
+	if (smp_load_acquire(&slot->seq) != pos + 1)
+		return NULL;
+
+	data = slot->data;
+	smp_store_release(&slot->seq, pos + ring->mask + 1);
+	ring->cons = pos + 1;
+
+	return data;
+}
+
+/*****************************************************************************/
+/**
+ * qdma_req_ring_empty() - check for published requests, may be called
+ *	without being the consumer in which case the result is a hint only
+ *
+ * @ring:	request ring
+ *
+ * @return	true if there is nothing to dequeue
+ *****************************************************************************/
+static inline bool qdma_req_ring_empty(struct qdma_req_ring *ring)
+{
+	unsigned int pos = READ_ONCE(ring->cons);
+
+	if (!ring->slot)
+		return true;
+
+	return smp_load_acquire(&ring->slot[pos & ring->mask].seq) != pos + 1;
+}
+
+#endif /* ifndef __QDMA_REQ_RING_H__ */
@@ -24,6 +24,7 @@
 #include <asm/cacheflush.h>
 #include <linux/kernel.h>
 #include <linux/delay.h>
+#include <linux/mm.h>
 
 #include "qdma_device.h"
 #include "qdma_intr.h"
@@ -33,6 +34,7 @@
 #include "thread.h"
 #include "qdma_compat.h"
 #include "qdma_st_c2h.h"
+#include "qdma_cdev_ioctl.h"
 #include "qdma_access_common.h"
 #include "qdma_ul_ext.h"
 #include "version.h"
@@ -166,10 +168,22 @@ void descq_flq_free_page_resource(struct qdma_descq *descq)
 	unsigned char pg_order = flq->desc_pg_order;
 	int i;
 
+	/* user mappings hold their own page references */
+	if (descq->zc_ring) {
+		__free_pages(descq->zc_ring_pg, descq->zc_ring_order);
+		descq->zc_ring = NULL;
+		descq->zc_ring_pg = NULL;
+	}
+
 	for (i = 0; i < flq->num_pages; i++, pg_sdesc++)
 		flq_free_page_one(pg_sdesc, dev,
 				pg_order, flq->desc_pg_shift);
 
+	for (; flq->park_head != flq->park_tail; flq->park_head++)
+		flq_free_page_one(flq->pg_park +
+				(flq->park_head & flq->num_pgs_mask), dev,
+				pg_order, flq->desc_pg_shift);
+
 	kfree(flq->pg_sdesc);
 	flq->pg_sdesc = NULL;
 
@@ -230,12 +244,24 @@ static inline int flq_fill_page_one(struct qdma_sw_pg_sg *pg_sdesc,
 	return 0;
 }
 
+/*
+ * the free list pages can be mapped to user space as a whole with
+ * QDMA_CDEV_IOCTL_ZC_ENABLE at any time, so they must never carry stale
+ * kernel memory: zero them on allocation unless the upper layer owns the
+ * buffers (fp_descq_c2h_packet), which rules zero copy out. Recycled pages
+ * only ever hold data received on the same queue.
+ */
+static inline gfp_t flq_page_gfp(struct qdma_descq *descq, gfp_t gfp)
+{
+	return descq->conf.fp_descq_c2h_packet ? gfp : gfp | __GFP_ZERO;
+}
+
 int descq_flq_alloc_resource(struct qdma_descq *descq)
 {
 	struct xlnx_dma_dev *xdev = descq->xdev;
 	struct qdma_flq *flq = (struct qdma_flq *)descq->flq;
 	struct device *dev = &xdev->conf.pdev->dev;
-	int node = dev_to_node(dev);
+	int node = descq->node;
 	struct qdma_sw_pg_sg *pg_sdesc = NULL;
 	struct qdma_sw_sg *sdesc, *prev = NULL;
 	struct qdma_sdesc_info *sinfo, *sprev = NULL;
@@ -279,23 +305,28 @@ int descq_flq_alloc_resource(struct qdma_descq *descq)
 			flq->num_pages,
 			flq->size);
 
-	pg_sdesc = kzalloc_node(flq->num_pages *
+	/* page list followed by the park list of the same size */
+	pg_sdesc = kzalloc_node(2 * flq->num_pages *
 				(sizeof(struct qdma_sw_pg_sg)),
 				GFP_KERNEL, node);
 
 	if (!pg_sdesc) {
 		pr_err("%s: OOM, sz %d * %ld.\n",
 				__func__,
-				flq->num_pages,
+				2 * flq->num_pages,
 				(sizeof(struct qdma_sw_pg_sg)));
 		return -ENOMEM;
 	}
 	flq->pg_sdesc = pg_sdesc;
+	flq->pg_park = pg_sdesc + flq->num_pages;
+	flq->park_head = 0;
+	flq->park_tail = 0;
 
 	for (pg_sdesc = flq->pg_sdesc, i = 0;
 			i < flq->num_pages; i++, pg_sdesc++) {
 		rv = flq_fill_page_one(pg_sdesc, dev, node,
-				flq->desc_pg_order, GFP_KERNEL);
+				flq->desc_pg_order,
+				flq_page_gfp(descq, GFP_KERNEL));
 		if (rv < 0) {
 			descq_flq_free_page_resource(descq);
 			return rv;
@@ -344,12 +375,90 @@ int descq_flq_alloc_resource(struct qdma_descq *descq)
 	return 0;
 }
 
+static inline bool flq_page_idle(struct page *pg)
+{
+	/* only the reference taken at allocation time is left */
+#if KERNEL_VERSION(4, 6, 0) < LINUX_VERSION_CODE
+	return page_ref_count(pg) == 1;
+#else
+	return atomic_read(&pg->_count) == 1;
+#endif
+}
+
+static inline void flq_page_reuse(struct qdma_sw_pg_sg *pg_sdesc,
+				struct device *dev, unsigned char pg_order)
+{
+	dma_sync_single_for_device(dev, pg_sdesc->pg_dma_base_addr,
+				PAGE_SIZE << pg_order, DMA_FROM_DEVICE);
+	pg_sdesc->pg_offset = 0;
+}
+
+/*
+ * put a fully consumed page back on the free list. The page keeps its dma
+ * mapping if the upper layer has dropped all of its buffers, otherwise it
+ * is parked, still mapped, and the oldest parked page is taken instead once
+ * it became idle. Only if none is idle a new page is allocated and mapped.
+ */
+static int flq_recycle_page_one(struct qdma_flq *flq,
+				struct qdma_sw_pg_sg *pg_sdesc,
+				struct device *dev, int node, gfp_t gfp)
+{
+	unsigned char pg_order = flq->desc_pg_order;
+	struct qdma_sw_pg_sg busy = *pg_sdesc;
+	struct qdma_sw_pg_sg *park;
+	int rv;
+
+	/* emptied by an earlier allocation failure, nothing to park */
+	if (unlikely(!pg_sdesc->pg_base)) {
+		rv = flq_fill_page_one(pg_sdesc, dev, node, pg_order, gfp);
+		if (unlikely(rv < 0))
+			return rv;
+		flq->pg_alloc++;
+		return 0;
+	}
+
+	if (flq_page_idle(pg_sdesc->pg_base)) {
+		flq_page_reuse(pg_sdesc, dev, pg_order);
+		flq->pg_recycled++;
+		return 0;
+	}
+
+	park = flq->pg_park + (flq->park_head & flq->num_pgs_mask);
+	if (flq->park_head != flq->park_tail && flq_page_idle(park->pg_base)) {
+		*pg_sdesc = *park;
+		flq->park_head++;
+		flq_page_reuse(pg_sdesc, dev, pg_order);
+		flq->pg_reused++;
+	} else {
+		rv = flq_fill_page_one(pg_sdesc, dev, node, pg_order, gfp);
+		if (unlikely(rv < 0)) {
+			/* the buffers still out keep the busy page alive, drop
+			 * its mapping and the free list reference right away
+			 */
+			flq_free_page_one(pg_sdesc, dev, pg_order,
+					flq->desc_pg_shift);
+			return rv;
+		}
+		flq->pg_alloc++;
+
+		/* park list full, give up the mapping of the oldest page */
+		if (flq->park_tail - flq->park_head == flq->num_pages) {
+			flq_free_page_one(park, dev, pg_order,
+					flq->desc_pg_shift);
+			flq->park_head++;
+		}
+	}
+	flq->pg_park[flq->park_tail++ & flq->num_pgs_mask] = busy;
+
+	return 0;
+}
+
 static inline int flq_refill_pages(struct qdma_descq *descq,
 		int count, bool recycle, gfp_t gfp)
 {
 	struct xlnx_dma_dev *xdev = descq->xdev;
 	struct device *dev = &xdev->conf.pdev->dev;
-	int node = dev_to_node(dev);
+	int node = descq->node;
 	struct qdma_flq *flq = (struct qdma_flq *)descq->flq;
 	unsigned int n_recycle_index = flq->recycle_idx;
 	/* find the most significant bit number */
@@ -402,10 +511,8 @@ static inline int flq_refill_pages(struct qdma_descq *descq,
 				flq->recycle_idx == flq->alloc_idx)
 				break;
 
-			flq_unmap_page_one(pg_sdesc, dev, flq->desc_pg_order);
-			put_page(pg_sdesc->pg_base);
-			rv = flq_fill_page_one(pg_sdesc,
-					dev, node, flq->desc_pg_order, gfp);
+			rv = flq_recycle_page_one(flq, pg_sdesc, dev, node,
+					flq_page_gfp(descq, gfp));
 			if (rv < 0)
 				break;
 
@@ -732,6 +839,23 @@ static int get_fl_nr(unsigned int len,
 	return l_fl_nr;
 }
 
+/* describe a packet in the zero copy ring, published by the caller */
+static void rcv_pkt_zc(struct qdma_descq *descq, unsigned int pidx,
+			int fl_nr)
+{
+	struct qdma_flq *flq = (struct qdma_flq *)descq->flq;
+	struct qdma_zc_rx_entry *ent;
+	int i;
+
+	for (i = 0; i < fl_nr; i++) {
+		ent = descq->zc_ring->ent + pidx;
+		ent->len = flq->sdesc[pidx].len;
+		ent->flags = (i ? 0 : QDMA_ZC_RX_F_SOP) |
+			     (i == fl_nr - 1 ? QDMA_ZC_RX_F_EOP : 0);
+		pidx = ring_idx_incr(pidx, 1, descq->conf.rngsz);
+	}
+}
+
 static int rcv_pkt(struct qdma_descq *descq, struct qdma_ul_cmpt_info *cmpl,
 			unsigned int len)
 {
@@ -771,6 +895,8 @@ static int rcv_pkt(struct qdma_descq *descq, struct qdma_ul_cmpt_info *cmpl,
 		if (rv < 0)
 			return rv;
 		flq->pidx_pend = next;
+	} else if (descq->zc_ring) {
+		rcv_pkt_zc(descq, pidx, fl_nr);
 	} else {
 		int i;
 		struct qdma_sdesc_info *sinfo = flq->sdesc_info + pidx;
@@ -1109,6 +1235,7 @@ int descq_process_completion_st_c2h(struct qdma_descq *descq, int budget,
 	flq->pkt_cnt -= proc_cnt;
 
 	if ((xdev->conf.intr_moderation) &&
+			!atomic_read(&descq->intr_polling) &&
 			(descq->cmpt_cidx_info.trig_mode ==
 					TRIG_MODE_COMBO)) {
 		pend = ring_idx_delta(cs->pidx, descq->cidx_cmpt, rngsz_cmpt);
@@ -1141,7 +1268,10 @@ int descq_process_completion_st_c2h(struct qdma_descq *descq, int budget,
 						descq->conf.name);
 				return -EINVAL;
 			}
-			qdma_c2h_packets_proc_dflt(descq);
+			if (descq->zc_ring)
+				smp_store_release(&descq->zc_ring->prod, pidx);
+			else
+				qdma_c2h_packets_proc_dflt(descq);
 		}
 
 		flq->pkt_cnt = ring_idx_delta(cs->pidx, descq->cidx_cmpt,
@@ -1284,3 +1414,261 @@ int qdma_queue_packet_read(unsigned long dev_hndl, unsigned long id,
 
 	return req->count - cb->left;
 }
+
+/*
+ * zero copy receive: the free list pages and a ring describing the received
+ * buffers are mapped read-only into user space. The buffers stay on the
+ * free list until the application releases them, which recycles them in
+ * place as descq_st_c2h_read() does after copying.
+ */
+static struct qdma_descq *zc_descq_get(unsigned long dev_hndl,
+				unsigned long id, const char *fname)
+{
+	struct xlnx_dma_dev *xdev = (struct xlnx_dma_dev *)dev_hndl;
+	struct qdma_descq *descq;
+
+	/** make sure that the dev_hndl passed is Valid */
+	if (!xdev) {
+		pr_err("dev_hndl is NULL");
+		return NULL;
+	}
+
+	if (xdev_check_hndl(fname, xdev->conf.pdev, dev_hndl) < 0) {
+		pr_err("Invalid dev_hndl passed");
+		return NULL;
+	}
+
+	descq = qdma_device_get_descq_by_id(xdev, id, NULL, 0, 0);
+	if (!descq) {
+		pr_err("Invalid qid(%ld)", id);
+		return NULL;
+	}
+
+	if (!descq->conf.st || descq->conf.q_type != Q_C2H) {
+		pr_err("%s: zero copy is ST C2H only\n", descq->conf.name);
+		return NULL;
+	}
+
+	return descq;
+}
+
+/* recycle @cnt entries from the cons index on, called with the lock held */
+static int descq_st_c2h_zc_put(struct qdma_descq *descq, unsigned int cnt)
+{
+	struct qdma_flq *flq = (struct qdma_flq *)descq->flq;
+	int rv;
+
+	incr_cmpl_desc_cnt(descq, cnt);
+	qdma_flq_refill(descq, flq->pidx_pend, cnt, 1, GFP_ATOMIC);
+	flq->pidx_pend = ring_idx_incr(flq->pidx_pend, cnt, flq->size);
+	WRITE_ONCE(descq->zc_ring->cons, flq->pidx_pend);
+
+	descq->pidx_info.pidx = ring_idx_decr(flq->pidx_pend, 1, flq->size);
+	rv = queue_pidx_update(descq->xdev, descq->conf.qidx,
+			descq->conf.q_type, &descq->pidx_info);
+	if (unlikely(rv < 0)) {
+		pr_err("%s: Failed to update pidx\n", descq->conf.name);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int qdma_queue_c2h_zc_enable(unsigned long dev_hndl, unsigned long id,
+			struct qdma_cdev_zc_info *info)
+{
+	struct qdma_descq *descq = zc_descq_get(dev_hndl, id, __func__);
+	struct qdma_flq *flq;
+	struct qdma_zc_rx_ring *ring;
+	struct page *pg;
+	unsigned long long data_off, pg_len;
+	unsigned int order, i, k = 0, n;
+	int rv = 0;
+
+	if (!descq)
+		return -EINVAL;
+
+	/* the upper layer owns the buffers handed to fp_descq_c2h_packet */
+	if (descq->conf.fp_descq_c2h_packet)
+		return -EINVAL;
+
+	order = get_order(sizeof(*ring) +
+			descq->conf.rngsz * sizeof(struct qdma_zc_rx_entry));
+	pg = alloc_pages_node(descq->node,
+			GFP_KERNEL | __GFP_ZERO | __GFP_COMP, order);
+	if (!pg)
+		return -ENOMEM;
+	ring = page_address(pg);
+
+	flq = (struct qdma_flq *)descq->flq;
+	data_off = PAGE_SIZE << order;
+	pg_len = PAGE_SIZE << flq->desc_pg_order;
+
+	lock_descq(descq);
+	if (descq->q_state != Q_STATE_ONLINE || descq->q_stop_wait) {
+		rv = -EINVAL;
+		goto unlock;
+	}
+	if (descq->zc_ring || descq->pidx != flq->pidx_pend ||
+			!list_empty(&descq->pend_list)) {
+		rv = -EBUSY;
+		goto unlock;
+	}
+
+	/* the buffers never move, in place recycling keeps page and offset */
+	for (i = 0; i < flq->size; i++) {
+		struct qdma_sw_sg *sdesc = flq->sdesc + i;
+
+		for (n = 0; n < flq->num_pages &&
+				flq->pg_sdesc[k].pg_base != sdesc->pg; n++)
+			k = (k + 1) & flq->num_pgs_mask;
+		if (n == flq->num_pages) {
+			pr_err("%s: buffer %u page not on the free list\n",
+				descq->conf.name, i);
+			rv = -EINVAL;
+			goto unlock;
+		}
+		ring->ent[i].off = data_off + k * pg_len + sdesc->offset;
+	}
+	ring->prod = flq->pidx_pend;
+	ring->cons = flq->pidx_pend;
+
+	descq->zc_ring = ring;
+	descq->zc_ring_pg = pg;
+	descq->zc_ring_order = order;
+	unlock_descq(descq);
+
+	info->mmap_len = data_off + flq->num_pages * pg_len;
+	info->data_off = data_off;
+	info->size = descq->conf.rngsz;
+	info->buf_sz = descq->conf.c2h_bufsz;
+
+	return 0;
+
+unlock:
+	unlock_descq(descq);
+	__free_pages(pg, order);
+	return rv;
+}
+
+int qdma_queue_c2h_zc_disable(unsigned long dev_hndl, unsigned long id)
+{
+	struct qdma_descq *descq = zc_descq_get(dev_hndl, id, __func__);
+	struct qdma_flq *flq;
+	struct page *pg;
+	unsigned int order;
+	unsigned int pend;
+	int rv = 0;
+
+	if (!descq)
+		return -EINVAL;
+
+	flq = (struct qdma_flq *)descq->flq;
+	lock_descq(descq);
+	if (!descq->zc_ring) {
+		unlock_descq(descq);
+		return 0;
+	}
+
+	pend = ring_idx_delta(descq->pidx, flq->pidx_pend, flq->size);
+	if (pend && descq->q_state == Q_STATE_ONLINE)
+		rv = descq_st_c2h_zc_put(descq, pend);
+
+	pg = descq->zc_ring_pg;
+	order = descq->zc_ring_order;
+	descq->zc_ring = NULL;
+	descq->zc_ring_pg = NULL;
+	unlock_descq(descq);
+
+	__free_pages(pg, order);
+
+	return rv;
+}
+
+int qdma_queue_c2h_zc_mmap(unsigned long dev_hndl, unsigned long id,
+			struct vm_area_struct *vma)
+{
+	struct qdma_descq *descq = zc_descq_get(dev_hndl, id, __func__);
+	unsigned long nr = (vma->vm_end - vma->vm_start) >> PAGE_SHIFT;
+	struct qdma_flq *flq;
+	struct page **pages;
+	unsigned long i, j, k = 0;
+	unsigned int pg_nr;
+	int rv = 0;
+
+	if (!descq)
+		return -EINVAL;
+
+	if (vma->vm_pgoff || !(vma->vm_flags & VM_SHARED))
+		return -EINVAL;
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	pages = kcalloc(nr, sizeof(struct page *), GFP_KERNEL);
+	if (!pages)
+		return -ENOMEM;
+
+	flq = (struct qdma_flq *)descq->flq;
+	pg_nr = 1 << flq->desc_pg_order;
+
+	lock_descq(descq);
+	if (!descq->zc_ring ||
+		nr != (1UL << descq->zc_ring_order) +
+			(unsigned long)flq->num_pages * pg_nr) {
+		unlock_descq(descq);
+		kfree(pages);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < (1UL << descq->zc_ring_order); i++)
+		pages[k++] = descq->zc_ring_pg + i;
+	for (i = 0; i < flq->num_pages; i++)
+		for (j = 0; j < pg_nr; j++)
+			pages[k++] = flq->pg_sdesc[i].pg_base + j;
+	/* keep the pages while inserting them outside of the lock */
+	for (k = 0; k < nr; k++)
+		get_page(pages[k]);
+	unlock_descq(descq);
+
+#if KERNEL_VERSION(6, 3, 0) <= LINUX_VERSION_CODE
+	vm_flags_clear(vma, VM_MAYWRITE);
+#else
+	vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+	for (k = 0; k < nr && !rv; k++)
+		rv = vm_insert_page(vma, vma->vm_start + (k << PAGE_SHIFT),
+				pages[k]);
+
+	for (k = 0; k < nr; k++)
+		put_page(pages[k]);
+	kfree(pages);
+
+	return rv;
+}
+
+int qdma_queue_c2h_zc_release(unsigned long dev_hndl, unsigned long id,
+			unsigned int cnt)
+{
+	struct qdma_descq *descq = zc_descq_get(dev_hndl, id, __func__);
+	struct qdma_flq *flq;
+	int rv;
+
+	if (!descq)
+		return -EINVAL;
+
+	flq = (struct qdma_flq *)descq->flq;
+	lock_descq(descq);
+	if (!descq->zc_ring || descq->q_state != Q_STATE_ONLINE) {
+		unlock_descq(descq);
+		return -EINVAL;
+	}
+	if (cnt > ring_idx_delta(descq->pidx, flq->pidx_pend, flq->size)) {
+		unlock_descq(descq);
+		return -EINVAL;
+	}
+
+	rv = cnt ? descq_st_c2h_zc_put(descq, cnt) : 0;
+	unlock_descq(descq);
+
+	return rv;
+}
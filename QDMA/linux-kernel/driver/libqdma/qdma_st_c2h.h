@@ -130,6 +130,18 @@ struct qdma_flq {
 	unsigned int pidx_pend;
 	/** RW: Page list */
 	struct qdma_sw_pg_sg *pg_sdesc;
+	/** RW: mapped pages retired from pg_sdesc but still held upstream */
+	struct qdma_sw_pg_sg *pg_park;
+	/** RW: oldest parked page */
+	unsigned int park_head;
+	/** RW: next free park slot */
+	unsigned int park_tail;
+	/** RW: # of pages put back on the free list in place */
+	unsigned long pg_recycled;
+	/** RW: # of pages taken back from the park list */
+	unsigned long pg_reused;
+	/** RW: # of pages newly allocated and mapped */
+	unsigned long pg_alloc;
 	/** RW: sw scatter gather list */
 	struct qdma_sw_sg *sdesc;
 	/** RW: sw descriptor info */
@@ -22,6 +22,8 @@
 #include "qdma_thread.h"
 
 #include <linux/kernel.h>
+#include <linux/topology.h>
+#include <linux/nodemask.h>
 
 #include "qdma_descq.h"
 #include "thread.h"
@@ -50,7 +52,8 @@ static int qdma_thread_cmpl_status_pend(struct list_head *work_item)
 	int pend = 0;
 
 	lock_descq(descq);
-	pend = !list_empty(&descq->pend_list) || !list_empty(&descq->work_list);
+	pend = !list_empty(&descq->pend_list) ||
+		qdma_work_queue_pending(descq);
 	unlock_descq(descq);
 
 	return pend;
@@ -65,6 +68,80 @@ static int qdma_thread_cmpl_status_proc(struct list_head *work_item)
 	return 0;
 }
 
+static inline bool qdma_cpu_on_node(unsigned int cpu, int node)
+{
+	return node == NUMA_NO_NODE || cpu_to_node(cpu) == node;
+}
+
+/* least loaded cpu on the node, cpu_count if the node has none */
+static unsigned int qdma_cpu_least_loaded(int node)
+{
+	unsigned int i, idx = cpu_count;
+
+	for (i = cpu_count; i-- > 0;) {
+		if (!qdma_cpu_on_node(i, node))
+			continue;
+		if (idx == cpu_count || per_cpu_qcnt[i] < per_cpu_qcnt[idx]) {
+			idx = i;
+			if (!per_cpu_qcnt[idx])
+				break;
+		}
+	}
+
+	return idx;
+}
+
+/* least loaded thread on a cpu of the node, thread_cnt if there is none */
+static unsigned int qdma_thread_least_loaded(int node)
+{
+	struct qdma_kthread *thp = cs_threads;
+	unsigned int i, v = 0, idx = thread_cnt;
+
+	for (i = 0; i < thread_cnt; i++, thp++) {
+		if (!qdma_cpu_on_node(thp->cpu, node))
+			continue;
+		lock_thread(thp);
+		if (idx == thread_cnt || thp->work_cnt < v) {
+			v = thp->work_cnt;
+			idx = i;
+		}
+		unlock_thread(thp);
+		if (!v)
+			break;
+	}
+
+	return idx;
+}
+
+/* cpu of completion thread i, with fewer threads than cpus the threads
+ * are spread round robin over the nodes so that every node has some
+ */
+static unsigned int qdma_thread_cpu(unsigned int i)
+{
+	unsigned int round, cpu, k, n = 0;
+	int node;
+
+	if (thread_cnt >= cpu_count)
+		return i;
+
+	for (round = 0; round < cpu_count; round++) {
+		for_each_online_node(node) {
+			k = 0;
+			for (cpu = 0; cpu < cpu_count; cpu++) {
+				if (cpu_to_node(cpu) != node)
+					continue;
+				if (k++ < round)
+					continue;
+				if (n++ == i)
+					return cpu;
+				break;
+			}
+		}
+	}
+
+	return i;
+}
+
 /* ********************* public function definitions ************************ */
 
 void qdma_thread_remove_work(struct qdma_descq *descq)
@@ -104,21 +181,17 @@ void qdma_thread_remove_work(struct qdma_descq *descq)
 
 void qdma_thread_add_work(struct qdma_descq *descq)
 {
-	struct qdma_kthread *thp = cs_threads;
-	unsigned int v = 0;
-	int i, idx = thread_cnt;
+	struct qdma_kthread *thp;
+	unsigned int idx;
 
+	/* prefer cpus on the node of the queue rings, the device node
+	 * unless the queue asked for another one
+	 */
 	if (descq->xdev->conf.qdma_drv_mode != POLL_MODE) {
 		spin_lock(&qcnt_lock);
-		idx = cpu_count - 1;
-		v = per_cpu_qcnt[idx];
-		for (i = idx - 1; i >= 0  && v; i--) {
-			if (per_cpu_qcnt[i] < v) {
-				idx = i;
-				v = per_cpu_qcnt[i];
-			}
-		}
-
+		idx = qdma_cpu_least_loaded(descq->node);
+		if (idx == cpu_count)
+			idx = qdma_cpu_least_loaded(NUMA_NO_NODE);
 		per_cpu_qcnt[idx]++;
 		spin_unlock(&qcnt_lock);
 
@@ -127,26 +200,16 @@ void qdma_thread_add_work(struct qdma_descq *descq)
 		descq->intr_work_cpu = idx;
 		unlock_descq(descq);
 
-		pr_debug("%s 0x%p assigned to cpu %u.\n",
-			descq->conf.name, descq, idx);
+		pr_debug("%s 0x%p assigned to cpu %u, node %d.\n",
+			descq->conf.name, descq, idx, descq->node);
 
 		return;
 	}
 
 	/* Polled mode only */
-	for (i = 0; i < thread_cnt; i++, thp++) {
-		lock_thread(thp);
-		if (idx == thread_cnt) {
-			v = thp->work_cnt;
-			idx = i;
-		} else if (!thp->work_cnt) {
-			idx = i;
-			unlock_thread(thp);
-			break;
-		} else if (thp->work_cnt < v)
-			idx = i;
-		unlock_thread(thp);
-	}
+	idx = qdma_thread_least_loaded(descq->node);
+	if (idx == thread_cnt)
+		idx = qdma_thread_least_loaded(NUMA_NO_NODE);
 
 	thp = cs_threads + idx;
 	lock_thread(thp);
@@ -190,7 +253,7 @@ int qdma_threads_create(unsigned int num_threads)
 	/* N dma writeback monitoring threads */
 	thp = cs_threads;
 	for (i = 0; i < thread_cnt; i++, thp++) {
-		thp->cpu = i;
+		thp->cpu = qdma_thread_cpu(i);
 		thp->kth_timeout = 0;
 		rv = qdma_kthread_start(thp, "qdma_cmpl_status_th", i);
 		if (rv < 0)
@@ -634,6 +634,15 @@ static struct xlnx_dma_dev *xdev_alloc(struct qdma_dev_conf *conf)
 	/* create a driver to device reference */
 	memcpy(&xdev->conf, conf, sizeof(*conf));
 
+	/* hybrid mode is interrupt aggregation with polled queue servicing,
+	 * qdma_device_interrupt_setup() moves it to direct interrupts when
+	 * there is a data vector per queue
+	 */
+	if (conf->qdma_drv_mode == HYBRID_INTR_MODE) {
+		xdev->intr_hybrid = 1;
+		xdev->conf.qdma_drv_mode = INDIRECT_INTR_MODE;
+	}
+
 	xdev->magic = QDMA_MAGIC_DEVICE;
 
 	/* !! FIXME default to enabled for everything */
@@ -992,7 +1001,7 @@ int qdma_device_open(const char *mod_name, struct qdma_dev_conf *conf,
 		return -EINVAL;
 	}
 
-	if (conf->qdma_drv_mode > LEGACY_INTR_MODE) {
+	if (conf->qdma_drv_mode > HYBRID_INTR_MODE) {
 		pr_err("%s: driver mode passed in Invalid.\n", mod_name);
 		return -EINVAL;
 	}
@@ -164,6 +164,18 @@ struct intr_coal_conf {
 	u8 color;
 	/**< Interrupt cidx info to be written to INTR CIDX register */
 	struct qdma_intr_cidx_reg_info intr_cidx_info;
+	/**< ring entries use the CPM4 layout, selected at setup */
+	u8 cpm4_layout;
+	/**< queues seen in one ring drain, H2C hw qids then C2H hw qids */
+	unsigned long *pend_map;
+	/**< number of hw qids per direction in pend_map */
+	unsigned int pend_qs;
+	/**< qidx of the last queue seen on this ring, -1 if none yet.
+	 * The ring cidx register is written through it, also when the HW
+	 * raised the interrupt without new entries in the ring, so that
+	 * the interrupt gets triggered again
+	 */
+	int cidx_qidx;
 };
 
 /**
@@ -223,6 +235,8 @@ struct intr_info_t {
 	spinlock_t vec_q_list;
 };
 
+struct qdma_dmaeng_dev;
+
 /**
  * @struct - xlnx_dma_dev
  * @brief	Xilinx DMA device details
@@ -233,14 +247,6 @@ struct xlnx_dma_dev {
 	char mod_name[QDMA_DEV_NAME_MAXLEN];
 	/**< Board id this device belongs to*/
 	u32 dma_device_index;
-	/**< Keeping track of last updated descq
-	 * Used only in case of auto and intr aggr driver mode
-	 * This is required because HW might prematurely raise interrupt
-	 * without actual new entries in the aggr ring and we need to
-	 * provide some update to the sw_cidx of aggr ring so that
-	 * interrupt gets triggered again
-	 */
-	struct qdma_descq *prev_descq;
 	/**< DMA device configuration */
 	struct qdma_dev_conf conf;
 	/**< csr info */
@@ -298,6 +304,8 @@ struct xlnx_dma_dev {
 	struct intr_coal_conf  *intr_coal_list;
 	/**< legacy interrupt vector */
 	int vector_legacy;
+	/**< hybrid interrupt mode, queues are polled until drained */
+	u8 intr_hybrid;
 	/**< error lock */
 	spinlock_t err_lock;
 	/**< flag to indicate the error minitor status */
@@ -327,6 +335,8 @@ struct xlnx_dma_dev {
 	u64 ping_pong_lat_min;
 	/** avg ping_pong latency */
 	u64 ping_pong_lat_total;
+	/**< dmaengine channels on MM queue pairs, NULL if not registered */
+	struct qdma_dmaeng_dev *dmaeng;
 	/**< for upper layer calling function */
 	unsigned int dev_ulf_extra[0];
 
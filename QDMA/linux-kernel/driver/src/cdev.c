@@ -36,12 +36,25 @@
 #include <linux/wait.h>
 #include <linux/kthread.h>
 #include <linux/version.h>
+#include <linux/kref.h>
+#include <linux/vmalloc.h>
+#include <linux/dma-mapping.h>
+#include <linux/mm.h>
+#if KERNEL_VERSION(4, 11, 0) <= LINUX_VERSION_CODE
+#include <linux/sched/mm.h>
+#endif
 #if KERNEL_VERSION(3, 16, 0) <= LINUX_VERSION_CODE
 #include <linux/uio.h>
 #endif
+#if KERNEL_VERSION(6, 8, 0) <= LINUX_VERSION_CODE
+#define QDMA_CDEV_URING_CMD
+#include <linux/blkdev.h>
+#include <linux/io_uring/cmd.h>
+#endif
 
 #include "qdma_mod.h"
 #include "libqdma/xdev.h"
+#include "qdma_cdev_ioctl.h"
 
 /*
  * @struct - xlnx_phy_dev
@@ -71,17 +84,66 @@ struct cdev_async_io {
 	struct work_struct wrk_itm;
 };
 
-enum qdma_cdev_ioctl_cmd {
-	QDMA_CDEV_IOCTL_NO_MEMCPY,
-	QDMA_CDEV_IOCTL_CMDS
+/** max. pages registered per file with QDMA_CDEV_IOCTL_BUF_REG, 1GB */
+#define QDMA_CDEV_BUF_FILE_MAX_PAGES	(1UL << (30 - PAGE_SHIFT))
+
+/*
+ * @struct - qdma_cdev_buf
+ * @brief	user buffer registered with QDMA_CDEV_IOCTL_BUF_REG. The pages
+ *		stay pinned and dma mapped until the buffer is unregistered
+ *		or the file it was registered on is closed, and the last
+ *		request using it completed. They are charged to the
+ *		RLIMIT_MEMLOCK of the registering process while registered.
+ */
+struct qdma_cdev_buf {
+	struct list_head list;	/**< qdma_cdev buf_list */
+	struct kref ref;	/**< list + in flight requests */
+	struct file *file;	/**< file the buffer was registered on */
+	struct device *dev;	/**< device the pages are mapped for */
+	unsigned long addr;	/**< user address */
+	size_t len;		/**< length in bytes */
+	unsigned int pages_nr;	/**< number of pages pinned */
+	struct page **pages;	/**< pinned pages */
+	struct mm_struct *mm;	/**< mm pages_nr is charged to, if any */
+	/** one whole page entry per page, dma mapped and chained */
+	struct qdma_sw_sg *sgl;
+};
+
+#ifdef QDMA_CDEV_URING_CMD
+/** max. requests per direction collected under one submission plug */
+#define CDEV_URING_BATCH_MAX	32
+
+/*
+ * @struct - cdev_uring_io
+ * @brief	one io_uring passthrough command in flight
+ */
+struct cdev_uring_io {
+	struct io_uring_cmd *ioucmd;	/**< io_uring command */
+	ssize_t res;			/**< result posted to the cqe */
+	struct qdma_io_cb qiocb;	/**< sg list and qdma request */
+};
+
+/*
+ * @struct - cdev_uring_plug
+ * @brief	requests collected while io_uring submits a batch of sqes,
+ *		handed to the descq in one go when the submitter unplugs
+ */
+struct cdev_uring_plug {
+	struct blk_plug_cb cb;		/**< cb.data is the qdma_cdev */
+	unsigned int cnt[2];		/**< requests per direction (write) */
+	struct qdma_request *reqv[2][CDEV_URING_BATCH_MAX];
 };
 
+static struct kmem_cache *cdev_uring_cache;
+#endif
+
 static struct class *qdma_class;
 static struct kmem_cache *cdev_cache;
 
 static ssize_t cdev_gen_read_write(struct file *file, char __user *buf,
 		size_t count, loff_t *pos, bool write);
 static void unmap_user_buf(struct qdma_io_cb *iocb, bool write);
+static int cdev_zc_disable(struct qdma_cdev *xcdev, struct file *file);
 static inline void iocb_release(struct qdma_io_cb *iocb);
 
 static inline void xlnx_phy_dev_list_remove(struct xlnx_phy_dev *phy_dev)
@@ -181,6 +243,12 @@ static int cdev_gen_close(struct inode *inode, struct file *file)
 {
 	struct qdma_cdev *xcdev = (struct qdma_cdev *)file->private_data;
 
+	if (xcdev)
+		cdev_buf_release(xcdev, file);
+
+	if (xcdev && xcdev->zc_file == file)
+		cdev_zc_disable(xcdev, file);
+
 	if (xcdev && xcdev->fp_close_extra)
 		return xcdev->fp_close_extra(xcdev);
 
@@ -215,6 +283,388 @@ static loff_t cdev_gen_llseek(struct file *file, loff_t off, int whence)
 	return newpos;
 }
 
+/*
+ * registered user buffers
+ */
+static int cdev_buf_pin(unsigned long addr, unsigned int pages_nr,
+			struct page **pages)
+{
+#if KERNEL_VERSION(5, 6, 0) <= LINUX_VERSION_CODE
+	/* held for as long as the buffer stays registered */
+	return pin_user_pages_fast(addr, pages_nr, FOLL_WRITE | FOLL_LONGTERM,
+				pages);
+#else
+	return get_user_pages_fast(addr, pages_nr, 1/* write */, pages);
+#endif
+}
+
+static void cdev_buf_unpin(struct page **pages, unsigned int pages_nr,
+			bool dirty)
+{
+	unsigned int i;
+
+	for (i = 0; dirty && i < pages_nr; i++)
+		set_page_dirty_lock(pages[i]);
+#if KERNEL_VERSION(5, 6, 0) <= LINUX_VERSION_CODE
+	unpin_user_pages(pages, pages_nr);
+#else
+	for (i = 0; i < pages_nr; i++)
+		put_page(pages[i]);
+#endif
+}
+
+/* charge/uncharge @pages to the locked_vm of @mm, checks RLIMIT_MEMLOCK */
+static int cdev_buf_account(struct mm_struct *mm, unsigned long pages,
+			bool inc)
+{
+#if KERNEL_VERSION(5, 2, 0) <= LINUX_VERSION_CODE
+	return account_locked_vm(mm, pages, inc);
+#else
+	unsigned long limit;
+	int rv = 0;
+
+	down_write(&mm->mmap_sem);
+	if (inc) {
+		limit = rlimit(RLIMIT_MEMLOCK) >> PAGE_SHIFT;
+		if (mm->locked_vm + pages > limit && !capable(CAP_IPC_LOCK))
+			rv = -ENOMEM;
+		else
+			mm->locked_vm += pages;
+	} else {
+		mm->locked_vm -= min(pages, mm->locked_vm);
+	}
+	up_write(&mm->mmap_sem);
+
+	return rv;
+#endif
+}
+
+/*
+ * give the RLIMIT_MEMLOCK charge back once the buffer is off the list,
+ * in process context: the pages themselves may stay pinned a little
+ * longer, until the requests still in flight on them are done.
+ */
+static void cdev_buf_uncharge(struct qdma_cdev_buf *rbuf)
+{
+	if (!rbuf->mm)
+		return;
+
+	cdev_buf_account(rbuf->mm, rbuf->pages_nr, false);
+	mmdrop(rbuf->mm);
+	rbuf->mm = NULL;
+}
+
+static void cdev_buf_free(struct kref *ref)
+{
+	struct qdma_cdev_buf *rbuf = container_of(ref, struct qdma_cdev_buf,
+						ref);
+	unsigned int i;
+
+	for (i = 0; i < rbuf->pages_nr; i++)
+		dma_unmap_page(rbuf->dev, rbuf->sgl[i].dma_addr, PAGE_SIZE,
+				DMA_BIDIRECTIONAL);
+	cdev_buf_unpin(rbuf->pages, rbuf->pages_nr, true);
+	vfree(rbuf->sgl);
+	kfree(rbuf);
+}
+
+static inline void cdev_buf_put(struct qdma_cdev_buf *rbuf)
+{
+	kref_put(&rbuf->ref, cdev_buf_free);
+}
+
+static int cdev_buf_register(struct qdma_cdev *xcdev, struct file *file,
+			unsigned long arg)
+{
+	struct device *dev = &xcdev->xcb->xpdev->pdev->dev;
+	struct qdma_cdev_buf_reg reg;
+	struct qdma_cdev_buf *rbuf, *tmp;
+	unsigned long addr, end;
+	unsigned long file_pages;
+	unsigned int pages_nr;
+	unsigned int i;
+	int rv;
+
+	if (copy_from_user(&reg, (void __user *)arg, sizeof(reg)))
+		return -EFAULT;
+
+	addr = (unsigned long)reg.addr;
+	end = addr + reg.len;
+	if (!reg.len || reg.addr != addr || end < addr ||
+			(reg.len >> PAGE_SHIFT) >= UINT_MAX) {
+		pr_err("%s: invalid buffer 0x%llx, %llu.\n",
+			xcdev->name, reg.addr, reg.len);
+		return -EINVAL;
+	}
+	pages_nr = (offset_in_page(addr) + reg.len + PAGE_SIZE - 1) >>
+			PAGE_SHIFT;
+	if (pages_nr > QDMA_CDEV_BUF_FILE_MAX_PAGES) {
+		pr_err("%s: buffer 0x%llx, %llu too large, %u > %lu pages.\n",
+			xcdev->name, reg.addr, reg.len, pages_nr,
+			QDMA_CDEV_BUF_FILE_MAX_PAGES);
+		return -EINVAL;
+	}
+
+	rbuf = kzalloc(sizeof(struct qdma_cdev_buf), GFP_KERNEL);
+	if (!rbuf)
+		return -ENOMEM;
+	rbuf->sgl = vzalloc(pages_nr * (sizeof(struct qdma_sw_sg) +
+				sizeof(struct page *)));
+	if (!rbuf->sgl) {
+		pr_err("%s: page list allocation failed for %u pages.\n",
+			xcdev->name, pages_nr);
+		kfree(rbuf);
+		return -ENOMEM;
+	}
+	rbuf->pages = (struct page **)(rbuf->sgl + pages_nr);
+	kref_init(&rbuf->ref);
+	rbuf->file = file;
+	rbuf->dev = dev;
+	rbuf->addr = addr;
+	rbuf->len = reg.len;
+
+	rv = cdev_buf_account(current->mm, pages_nr, true);
+	if (rv < 0) {
+		pr_err("%s: %u pages over RLIMIT_MEMLOCK, %d.\n",
+			xcdev->name, pages_nr, rv);
+		vfree(rbuf->sgl);
+		kfree(rbuf);
+		return rv;
+	}
+	rbuf->mm = current->mm;
+#if KERNEL_VERSION(4, 11, 0) <= LINUX_VERSION_CODE
+	mmgrab(rbuf->mm);
+#else
+	atomic_inc(&rbuf->mm->mm_count);
+#endif
+
+	rv = cdev_buf_pin(addr, pages_nr, rbuf->pages);
+	if (rv != pages_nr) {
+		pr_err("%s: unable to pin down all %u user pages, %d.\n",
+			xcdev->name, pages_nr, rv);
+		rbuf->pages_nr = rv > 0 ? rv : 0;
+		rv = -EFAULT;
+		goto unpin;
+	}
+
+	/* the sg list of whole page requests is built once, here */
+	for (i = 0; i < pages_nr; i++) {
+		struct qdma_sw_sg *sg = rbuf->sgl + i;
+
+		if (i && rbuf->pages[i - 1] == rbuf->pages[i]) {
+			pr_err("%s: duplicate pages, %u, %u.\n",
+				xcdev->name, i - 1, i);
+			rbuf->pages_nr = pages_nr;
+			rv = -EFAULT;
+			goto unmap;
+		}
+		flush_dcache_page(rbuf->pages[i]);
+		sg->dma_addr = dma_map_page(dev, rbuf->pages[i], 0,
+					PAGE_SIZE, DMA_BIDIRECTIONAL);
+		if (unlikely(dma_mapping_error(dev, sg->dma_addr))) {
+			pr_err("%s: map page %u failed.\n", xcdev->name, i);
+			rbuf->pages_nr = pages_nr;
+			rv = -EIO;
+			goto unmap;
+		}
+		sg->next = sg + 1;
+		sg->pg = rbuf->pages[i];
+		sg->offset = 0;
+		sg->len = PAGE_SIZE;
+	}
+	rbuf->sgl[pages_nr - 1].next = NULL;
+	rbuf->pages_nr = pages_nr;
+
+	file_pages = pages_nr;
+	spin_lock(&xcdev->buf_lock);
+	list_for_each_entry(tmp, &xcdev->buf_list, list) {
+		if (tmp->file != file)
+			continue;
+		if (addr < tmp->addr + tmp->len && tmp->addr < end) {
+			spin_unlock(&xcdev->buf_lock);
+			pr_err("%s: buffer 0x%lx,%zu overlaps 0x%lx,%zu.\n",
+				xcdev->name, addr, rbuf->len, tmp->addr,
+				tmp->len);
+			rv = -EBUSY;
+			goto release;
+		}
+		file_pages += tmp->pages_nr;
+	}
+	if (file_pages > QDMA_CDEV_BUF_FILE_MAX_PAGES) {
+		spin_unlock(&xcdev->buf_lock);
+		pr_err("%s: %lu pages registered on file, max. %lu.\n",
+			xcdev->name, file_pages, QDMA_CDEV_BUF_FILE_MAX_PAGES);
+		rv = -ENOSPC;
+		goto release;
+	}
+	list_add_tail(&rbuf->list, &xcdev->buf_list);
+	spin_unlock(&xcdev->buf_lock);
+
+	pr_debug("%s: registered 0x%lx,%zu, %u pages.\n",
+		xcdev->name, addr, rbuf->len, pages_nr);
+
+	return 0;
+
+release:
+	cdev_buf_uncharge(rbuf);
+	cdev_buf_put(rbuf);
+	return rv;
+
+unmap:
+	while (i--)
+		dma_unmap_page(dev, rbuf->sgl[i].dma_addr, PAGE_SIZE,
+				DMA_BIDIRECTIONAL);
+unpin:
+	/* pages_nr is the number of pages pinned here, not charged */
+	cdev_buf_account(rbuf->mm, pages_nr, false);
+	mmdrop(rbuf->mm);
+	cdev_buf_unpin(rbuf->pages, rbuf->pages_nr, false);
+	vfree(rbuf->sgl);
+	kfree(rbuf);
+
+	return rv;
+}
+
+static int cdev_buf_unregister(struct qdma_cdev *xcdev, struct file *file,
+			unsigned long arg)
+{
+	struct qdma_cdev_buf_reg reg;
+	struct qdma_cdev_buf *rbuf;
+
+	if (copy_from_user(&reg, (void __user *)arg, sizeof(reg)))
+		return -EFAULT;
+
+	spin_lock(&xcdev->buf_lock);
+	list_for_each_entry(rbuf, &xcdev->buf_list, list) {
+		if (rbuf->file == file && rbuf->addr == reg.addr) {
+			list_del(&rbuf->list);
+			spin_unlock(&xcdev->buf_lock);
+			cdev_buf_uncharge(rbuf);
+			/* freed once the requests in flight are done */
+			cdev_buf_put(rbuf);
+			return 0;
+		}
+	}
+	spin_unlock(&xcdev->buf_lock);
+
+	pr_err("%s: buffer 0x%llx not registered.\n", xcdev->name, reg.addr);
+	return -ENOENT;
+}
+
+/* release the buffers of @file or, with @file NULL, all of them */
+static void cdev_buf_release(struct qdma_cdev *xcdev, struct file *file)
+{
+	struct qdma_cdev_buf *rbuf, *tmp;
+	LIST_HEAD(free_list);
+
+	spin_lock(&xcdev->buf_lock);
+	list_for_each_entry_safe(rbuf, tmp, &xcdev->buf_list, list) {
+		if (!file || rbuf->file == file)
+			list_move_tail(&rbuf->list, &free_list);
+	}
+	spin_unlock(&xcdev->buf_lock);
+
+	list_for_each_entry_safe(rbuf, tmp, &free_list, list) {
+		list_del(&rbuf->list);
+		cdev_buf_uncharge(rbuf);
+		cdev_buf_put(rbuf);
+	}
+}
+
+/* find the registered buffer covering [addr, addr + len), takes a ref */
+static struct qdma_cdev_buf *cdev_buf_get(struct qdma_cdev *xcdev,
+			struct file *file, unsigned long addr, size_t len)
+{
+	struct qdma_cdev_buf *rbuf;
+
+	if (list_empty(&xcdev->buf_list))
+		return NULL;
+
+	spin_lock(&xcdev->buf_lock);
+	list_for_each_entry(rbuf, &xcdev->buf_list, list) {
+		if (rbuf->file == file && addr >= rbuf->addr &&
+				addr - rbuf->addr <= rbuf->len &&
+				len <= rbuf->len - (addr - rbuf->addr)) {
+			kref_get(&rbuf->ref);
+			spin_unlock(&xcdev->buf_lock);
+			return rbuf;
+		}
+	}
+	spin_unlock(&xcdev->buf_lock);
+
+	return NULL;
+}
+
+/*
+ * zero copy st c2h receive, owned by the file that enabled it
+ */
+static int cdev_zc_enable(struct qdma_cdev *xcdev, struct file *file,
+			unsigned long arg)
+{
+	struct qdma_cdev_zc_info info;
+	int rv;
+
+	if (!xcdev->c2h_st || !(xcdev->dir_init & (1 << Q_C2H)))
+		return -EINVAL;
+
+	if (cmpxchg(&xcdev->zc_file, NULL, file))
+		return -EBUSY;
+
+	rv = qdma_queue_c2h_zc_enable(xcdev->xcb->xpdev->dev_hndl,
+				xcdev->c2h_qhndl, &info);
+	if (rv < 0) {
+		xcdev->zc_file = NULL;
+		return rv;
+	}
+
+	if (copy_to_user((void __user *)arg, &info, sizeof(info))) {
+		cdev_zc_disable(xcdev, file);
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
+static int cdev_zc_disable(struct qdma_cdev *xcdev, struct file *file)
+{
+	int rv;
+
+	if (xcdev->zc_file != file)
+		return -EINVAL;
+
+	rv = qdma_queue_c2h_zc_disable(xcdev->xcb->xpdev->dev_hndl,
+				xcdev->c2h_qhndl);
+	xcdev->zc_file = NULL;
+
+	return rv;
+}
+
+static int cdev_zc_release(struct qdma_cdev *xcdev, struct file *file,
+			unsigned long arg)
+{
+	unsigned int cnt;
+
+	if (xcdev->zc_file != file)
+		return -EINVAL;
+
+	if (get_user(cnt, (unsigned int __user *)arg))
+		return -EFAULT;
+
+	return qdma_queue_c2h_zc_release(xcdev->xcb->xpdev->dev_hndl,
+				xcdev->c2h_qhndl, cnt);
+}
+
+static int cdev_gen_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct qdma_cdev *xcdev = (struct qdma_cdev *)file->private_data;
+
+	if (xcdev->zc_file != file)
+		return -EINVAL;
+
+	return qdma_queue_c2h_zc_mmap(xcdev->xcb->xpdev->dev_hndl,
+				xcdev->c2h_qhndl, vma);
+}
+
 static long cdev_gen_ioctl(struct file *file, unsigned int cmd,
 			unsigned long arg)
 {
@@ -224,6 +674,16 @@ static long cdev_gen_ioctl(struct file *file, unsigned int cmd,
 	case QDMA_CDEV_IOCTL_NO_MEMCPY:
 		get_user(xcdev->no_memcpy, (unsigned char *)arg);
 		return 0;
+	case QDMA_CDEV_IOCTL_BUF_REG:
+		return cdev_buf_register(xcdev, file, arg);
+	case QDMA_CDEV_IOCTL_BUF_UNREG:
+		return cdev_buf_unregister(xcdev, file, arg);
+	case QDMA_CDEV_IOCTL_ZC_ENABLE:
+		return cdev_zc_enable(xcdev, file, arg);
+	case QDMA_CDEV_IOCTL_ZC_DISABLE:
+		return cdev_zc_disable(xcdev, file);
+	case QDMA_CDEV_IOCTL_ZC_RELEASE:
+		return cdev_zc_release(xcdev, file, arg);
 	default:
 		break;
 	}
@@ -241,7 +701,8 @@ static inline void iocb_release(struct qdma_io_cb *iocb)
 {
 	if (iocb->pages)
 		iocb->pages = NULL;
-	kfree(iocb->sgl);
+	if (iocb->sgl != iocb->sg_inline)
+		kfree(iocb->sgl);
 	iocb->sgl = NULL;
 	iocb->buf = NULL;
 }
@@ -250,6 +711,25 @@ static void unmap_user_buf(struct qdma_io_cb *iocb, bool write)
 {
 	int i;
 
+	if (iocb->reg_buf) {
+		struct qdma_cdev_buf *rbuf = iocb->reg_buf;
+		struct qdma_sw_sg *sg = iocb->sgl;
+
+		/* ST C2H data is copied by the cpu, not dma'ed */
+		for (i = 0; !write && iocb->req.dma_mapped &&
+				i < iocb->pages_nr; i++, sg++)
+			dma_sync_single_for_cpu(rbuf->dev, sg->dma_addr,
+					sg->len, DMA_BIDIRECTIONAL);
+		/* a whole page request borrows the registered sg list */
+		if (iocb->sgl >= rbuf->sgl &&
+				iocb->sgl < rbuf->sgl + rbuf->pages_nr)
+			iocb->sgl = NULL;
+		iocb->reg_buf = NULL;
+		iocb->pages_nr = 0;
+		cdev_buf_put(rbuf);
+		return;
+	}
+
 	if (!iocb->pages || !iocb->pages_nr)
 		return;
 
@@ -352,6 +832,113 @@ err_out:
 	return rv;
 }
 
+/*
+ * sg list of a request on a registered buffer, no pinning. A dma mapped
+ * request on whole pages uses the list built at registration as is, the
+ * others get a copy trimmed to the request.
+ */
+static void map_reg_buf_to_sgl(struct qdma_io_cb *iocb,
+			struct qdma_cdev_buf *rbuf, bool dma, gfp_t gfp)
+{
+	unsigned long addr = (unsigned long)iocb->buf;
+	unsigned long len = iocb->len;
+	unsigned int pg_off = offset_in_page(addr);
+	unsigned int pages_nr = (len + pg_off + PAGE_SIZE - 1) >> PAGE_SHIFT;
+	unsigned int pg_idx = ((addr & PAGE_MASK) -
+				(rbuf->addr & PAGE_MASK)) >> PAGE_SHIFT;
+	struct qdma_sw_sg *rsg = rbuf->sgl + pg_idx;
+	struct qdma_sw_sg *sg;
+	unsigned int i;
+
+	iocb->reg_buf = rbuf;
+
+	/* libqdma walks dma mapped lists by sgcnt and does not modify them */
+	if (dma && len && !pg_off && !offset_in_page(len)) {
+		for (i = 0; i < pages_nr; i++)
+			dma_sync_single_for_device(rbuf->dev,
+					rsg[i].dma_addr, PAGE_SIZE,
+					DMA_BIDIRECTIONAL);
+		iocb->sgl = rsg;
+		iocb->pages_nr = pages_nr;
+		return;
+	}
+
+	if (len == 0)
+		pages_nr = 1;
+
+	sg = iocb->sg_inline;
+	if (pages_nr > QDMA_IO_CB_SG_INLINE) {
+		sg = kmalloc_array(pages_nr, sizeof(struct qdma_sw_sg), gfp);
+		if (!sg) {
+			iocb->sgl = NULL;
+			iocb->reg_buf = NULL;
+			return;
+		}
+	}
+	iocb->sgl = sg;
+
+	for (i = 0; i < pages_nr; i++, sg++) {
+		unsigned int offset = offset_in_page(addr);
+		unsigned int nbytes = min_t(unsigned int, PAGE_SIZE - offset,
+						len);
+
+		sg->next = sg + 1;
+		sg->pg = rsg[i].pg;
+		sg->offset = offset;
+		sg->len = nbytes;
+		sg->dma_addr = 0UL;
+		if (dma) {
+			sg->dma_addr = rsg[i].dma_addr + offset;
+			dma_sync_single_for_device(rbuf->dev, sg->dma_addr,
+					nbytes, DMA_BIDIRECTIONAL);
+		}
+
+		addr += nbytes;
+		len -= nbytes;
+	}
+	iocb->sgl[pages_nr - 1].next = NULL;
+	iocb->pages_nr = pages_nr;
+}
+
+/*
+ * map the user buffer of @iocb from the registered buffer covering it,
+ * -ENOENT if there is none. Nothing is pinned, so with @gfp GFP_NOWAIT
+ * this does not sleep.
+ */
+static int cdev_map_reg_buf(struct qdma_cdev *xcdev, struct file *file,
+			struct qdma_io_cb *iocb, bool write, gfp_t gfp)
+{
+	struct qdma_cdev_buf *rbuf;
+	bool dma = write || !xcdev->c2h_st;
+
+	rbuf = cdev_buf_get(xcdev, file, (unsigned long)iocb->buf, iocb->len);
+	if (!rbuf)
+		return -ENOENT;
+
+	map_reg_buf_to_sgl(iocb, rbuf, dma, gfp);
+	if (!iocb->sgl) {
+		cdev_buf_put(rbuf);
+		return -ENOMEM;
+	}
+	iocb->req.dma_mapped = dma ? 1 : 0;
+
+	return 0;
+}
+
+/*
+ * map the user buffer of @iocb, from a registered buffer if there is one
+ * covering it, otherwise by pinning its pages
+ */
+static int cdev_map_user_buf(struct qdma_cdev *xcdev, struct file *file,
+			struct qdma_io_cb *iocb, bool write)
+{
+	if (!cdev_map_reg_buf(xcdev, file, iocb, write, GFP_KERNEL))
+		return 0;
+
+	iocb->req.dma_mapped = 0;
+	return map_user_buf_to_sgl(iocb, write);
+}
+
 static ssize_t cdev_gen_read_write(struct file *file, char __user *buf,
 		size_t count, loff_t *pos, bool write)
 {
@@ -383,14 +970,13 @@ static ssize_t cdev_gen_read_write(struct file *file, char __user *buf,
 	memset(&iocb, 0, sizeof(struct qdma_io_cb));
 	iocb.buf = buf;
 	iocb.len = count;
-	rv = map_user_buf_to_sgl(&iocb, write);
+	rv = cdev_map_user_buf(xcdev, file, &iocb, write);
 	if (rv < 0)
 		return rv;
 
 	req->sgcnt = iocb.pages_nr;
 	req->sgl = iocb.sgl;
 	req->write = write ? 1 : 0;
-	req->dma_mapped = 0;
 	req->udd_len = 0;
 	req->ep_addr = (u64)*pos;
 	req->count = count;
@@ -458,14 +1044,14 @@ static ssize_t cdev_aio_write(struct kiocb *iocb, const struct iovec *io,
 		caio->reqv[i] = &(caio->qiocb[i].req);
 		caio->qiocb[i].buf = io[i].iov_base;
 		caio->qiocb[i].len = io[i].iov_len;
-		rv = map_user_buf_to_sgl(&(caio->qiocb[i]), true);
+		rv = cdev_map_user_buf(xcdev, iocb->ki_filp,
+				&(caio->qiocb[i]), true);
 		if (rv < 0)
 			break;
 
 		caio->reqv[i]->write = 1;
 		caio->reqv[i]->sgcnt = caio->qiocb[i].pages_nr;
 		caio->reqv[i]->sgl = caio->qiocb[i].sgl;
-		caio->reqv[i]->dma_mapped = false;
 		caio->reqv[i]->udd_len = 0;
 		caio->reqv[i]->ep_addr = (u64)pos;
 		pos += io[i].iov_len;
@@ -533,14 +1119,14 @@ static ssize_t cdev_aio_read(struct kiocb *iocb, const struct iovec *io,
 		caio->reqv[i] = &(caio->qiocb[i].req);
 		caio->qiocb[i].buf = io[i].iov_base;
 		caio->qiocb[i].len = io[i].iov_len;
-		rv = map_user_buf_to_sgl(&(caio->qiocb[i]), false);
+		rv = cdev_map_user_buf(xcdev, iocb->ki_filp,
+				&(caio->qiocb[i]), false);
 		if (rv < 0)
 			break;
 
 		caio->reqv[i]->write = 0;
 		caio->reqv[i]->sgcnt = caio->qiocb[i].pages_nr;
 		caio->reqv[i]->sgl = caio->qiocb[i].sgl;
-		caio->reqv[i]->dma_mapped = false;
 		caio->reqv[i]->udd_len = 0;
 		caio->reqv[i]->ep_addr = (u64)pos;
 		pos += io[i].iov_len;
@@ -607,6 +1193,253 @@ static ssize_t cdev_read_iter(struct kiocb *iocb, struct iov_iter *io)
 }
 #endif
 
+#ifdef QDMA_CDEV_URING_CMD
+/*
+ * io_uring passthrough: QDMA_CDEV_URING_CMD_READ/_WRITE sqes are queued to
+ * the descq without blocking. All sqes of one io_uring_enter() are collected
+ * under the submitter's plug, so they share a single pidx doorbell, and the
+ * cqes are posted from lazy task work so completions are batched too.
+ */
+static void cdev_uring_cmd_done(struct io_uring_cmd *ioucmd,
+				unsigned int issue_flags)
+{
+	struct cdev_uring_io *io = *(struct cdev_uring_io **)ioucmd->pdu;
+	ssize_t res = io->res;
+
+	unmap_user_buf(&io->qiocb, io->qiocb.req.write);
+	iocb_release(&io->qiocb);
+	kmem_cache_free(cdev_uring_cache, io);
+
+#if KERNEL_VERSION(6, 18, 0) <= LINUX_VERSION_CODE
+	io_uring_cmd_done(ioucmd, res, issue_flags);
+#else
+	io_uring_cmd_done(ioucmd, res, 0, issue_flags);
+#endif
+}
+
+static int cdev_uring_req_completed(struct qdma_request *req,
+				unsigned int bytes_done, int err)
+{
+	struct cdev_uring_io *io = container_of(req, struct cdev_uring_io,
+						qiocb.req);
+
+	io->res = (err < 0) ? err : bytes_done;
+	io_uring_cmd_do_in_task_lazy(io->ioucmd, cdev_uring_cmd_done);
+
+	return 0;
+}
+
+static void cdev_uring_submit_batch(struct qdma_cdev *xcdev, bool write,
+				unsigned int count, struct qdma_request **reqv)
+{
+	unsigned long qhndl = write ? xcdev->h2c_qhndl : xcdev->c2h_qhndl;
+	unsigned int i;
+	ssize_t rv;
+
+	rv = xcdev->fp_aiorw(xcdev->xcb->xpdev->dev_hndl, qhndl, count, reqv);
+	if (rv >= 0)
+		return;
+
+	pr_err("%s, %s batch of %u failed %zd.\n", xcdev->name,
+		write ? "W" : "R", count, rv);
+	for (i = 0; i < count; i++)
+		reqv[i]->fp_done(reqv[i], 0, rv);
+}
+
+/*
+ * called from blk_finish_plug() at the end of io_uring_enter(), or when the
+ * submitter is about to sleep. Queueing to the descq never sleeps, so the
+ * batch is submitted right away in both cases.
+ */
+static void cdev_uring_unplug(struct blk_plug_cb *cb, bool from_schedule)
+{
+	struct cdev_uring_plug *plug = container_of(cb, struct cdev_uring_plug,
+						cb);
+	struct qdma_cdev *xcdev = cb->data;
+	int i;
+
+	for (i = 0; i < 2; i++)
+		if (plug->cnt[i])
+			cdev_uring_submit_batch(xcdev, i, plug->cnt[i],
+						plug->reqv[i]);
+	kfree(plug);
+}
+
+static void cdev_uring_submit(struct qdma_cdev *xcdev,
+				struct qdma_request *req)
+{
+	struct cdev_uring_plug *plug;
+	int dir = req->write ? 1 : 0;
+
+	plug = (struct cdev_uring_plug *)blk_check_plugged(cdev_uring_unplug,
+						xcdev, sizeof(*plug));
+	if (!plug) {
+		cdev_uring_submit_batch(xcdev, dir, 1, &req);
+		return;
+	}
+
+	plug->reqv[dir][plug->cnt[dir]++] = req;
+	if (plug->cnt[dir] == CDEV_URING_BATCH_MAX) {
+		cdev_uring_submit_batch(xcdev, dir, plug->cnt[dir],
+					plug->reqv[dir]);
+		plug->cnt[dir] = 0;
+	}
+}
+
+/* build the sg list of a request on an io_uring fixed buffer */
+static int cdev_uring_map_fixed(struct qdma_io_cb *iocb,
+				struct iov_iter *iter, gfp_t gfp)
+{
+	const struct bio_vec *bv = iter->bvec;
+	size_t skip = iter->iov_offset;
+	size_t left = iov_iter_count(iter);
+	struct qdma_sw_sg *sg;
+	unsigned int pages_nr = 0;
+	unsigned int i;
+
+	for (i = 0; left; i++, skip = 0) {
+		unsigned int pos = bv[i].bv_offset + skip;
+		size_t seg = min_t(size_t, bv[i].bv_len - skip, left);
+
+		pages_nr += (offset_in_page(pos) + seg + PAGE_SIZE - 1) >>
+				PAGE_SHIFT;
+		left -= seg;
+	}
+	if (!pages_nr)
+		return -EINVAL;
+
+	sg = iocb->sg_inline;
+	if (pages_nr > QDMA_IO_CB_SG_INLINE) {
+		sg = kmalloc_array(pages_nr, sizeof(struct qdma_sw_sg), gfp);
+		if (!sg)
+			return -ENOMEM;
+	}
+	iocb->sgl = sg;
+
+	skip = iter->iov_offset;
+	left = iov_iter_count(iter);
+	for (i = 0; left; i++, skip = 0) {
+		unsigned int pos = bv[i].bv_offset + skip;
+		size_t seg = min_t(size_t, bv[i].bv_len - skip, left);
+
+		left -= seg;
+		while (seg) {
+			unsigned int offset = offset_in_page(pos);
+			unsigned int nbytes = min_t(size_t,
+						PAGE_SIZE - offset, seg);
+
+			sg->next = sg + 1;
+			sg->pg = bv[i].bv_page + (pos >> PAGE_SHIFT);
+			sg->offset = offset;
+			sg->len = nbytes;
+			sg->dma_addr = 0UL;
+			sg++;
+
+			pos += nbytes;
+			seg -= nbytes;
+		}
+	}
+	iocb->sgl[pages_nr - 1].next = NULL;
+	/* the pages stay pinned by io_uring, nothing to release */
+	iocb->pages = NULL;
+	iocb->pages_nr = pages_nr;
+	iocb->req.dma_mapped = 0;
+
+	return 0;
+}
+
+static int cdev_uring_cmd(struct io_uring_cmd *ioucmd,
+				unsigned int issue_flags)
+{
+	struct qdma_cdev *xcdev =
+		(struct qdma_cdev *)ioucmd->file->private_data;
+	const struct qdma_cdev_uring_cmd *cmd;
+	bool nonblock = issue_flags & IO_URING_F_NONBLOCK;
+	gfp_t gfp = nonblock ? GFP_NOWAIT : GFP_KERNEL;
+	struct cdev_uring_io *io;
+	struct qdma_request *req;
+	bool write;
+	u64 addr;
+	int rv;
+
+	if (!xcdev || !xcdev->fp_aiorw)
+		return -EINVAL;
+	/* the payload does not fit the 16 bytes of a regular sqe */
+	if (!(issue_flags & IO_URING_F_SQE128))
+		return -EINVAL;
+
+	switch (ioucmd->cmd_op) {
+	case QDMA_CDEV_URING_CMD_READ:
+		write = false;
+		break;
+	case QDMA_CDEV_URING_CMD_WRITE:
+		write = true;
+		break;
+	default:
+		return -ENOTTY;
+	}
+	if (!(write ? xcdev->h2c_qhndl : xcdev->c2h_qhndl))
+		return -EINVAL;
+
+	cmd = io_uring_sqe_cmd(ioucmd->sqe);
+	addr = READ_ONCE(cmd->addr);
+
+	/*
+	 * inline, non blocking issue only takes io_uring fixed buffers and
+	 * buffers registered with QDMA_CDEV_IOCTL_BUF_REG, anything that
+	 * needs pinning or a sleeping allocation is punted to io-wq.
+	 */
+	io = kmem_cache_zalloc(cdev_uring_cache, gfp);
+	if (!io)
+		return nonblock ? -EAGAIN : -ENOMEM;
+	io->ioucmd = ioucmd;
+	io->qiocb.buf = u64_to_user_ptr(addr);
+	io->qiocb.len = READ_ONCE(cmd->len);
+	req = &io->qiocb.req;
+
+	if (ioucmd->flags & IORING_URING_CMD_FIXED) {
+		struct iov_iter iter;
+
+		rv = io_uring_cmd_import_fixed(addr, io->qiocb.len,
+				write ? ITER_SOURCE : ITER_DEST,
+#if KERNEL_VERSION(6, 15, 0) <= LINUX_VERSION_CODE
+				&iter, ioucmd, issue_flags);
+#else
+				&iter, ioucmd);
+#endif
+		if (rv >= 0)
+			rv = cdev_uring_map_fixed(&io->qiocb, &iter, gfp);
+	} else if (nonblock) {
+		rv = cdev_map_reg_buf(xcdev, ioucmd->file, &io->qiocb, write,
+				gfp);
+	} else {
+		rv = cdev_map_user_buf(xcdev, ioucmd->file, &io->qiocb, write);
+	}
+	if (rv < 0) {
+		if (nonblock && (rv == -ENOENT || rv == -ENOMEM))
+			rv = -EAGAIN;
+		kmem_cache_free(cdev_uring_cache, io);
+		return rv;
+	}
+
+	req->write = write ? 1 : 0;
+	req->sgcnt = io->qiocb.pages_nr;
+	req->sgl = io->qiocb.sgl;
+	req->udd_len = 0;
+	req->ep_addr = READ_ONCE(cmd->ep_addr);
+	req->no_memcpy = xcdev->no_memcpy ? 1 : 0;
+	req->count = io->qiocb.len;
+	req->timeout_ms = 10 * 1000;	/* 10 seconds */
+	req->h2c_eot = 1;
+	req->fp_done = cdev_uring_req_completed;
+
+	*(struct cdev_uring_io **)ioucmd->pdu = io;
+	cdev_uring_submit(xcdev, req);
+
+	return -EIOCBQUEUED;
+}
+#endif
+
 static const struct file_operations cdev_gen_fops = {
 	.owner = THIS_MODULE,
 	.open = cdev_gen_open,
@@ -624,6 +1457,10 @@ static const struct file_operations cdev_gen_fops = {
 	.aio_read = cdev_aio_read,
 #endif
 	.unlocked_ioctl = cdev_gen_ioctl,
+	.mmap = cdev_gen_mmap,
+#ifdef QDMA_CDEV_URING_CMD
+	.uring_cmd = cdev_uring_cmd,
+#endif
 	.llseek = cdev_gen_llseek,
 };
 
@@ -640,6 +1477,8 @@ void qdma_cdev_destroy(struct qdma_cdev *xcdev)
 	}
 	pr_debug("destroying cdev %p", xcdev);
 
+	cdev_buf_release(xcdev, NULL);
+
 	if (xcdev->sys_device)
 		device_destroy(qdma_class, xcdev->cdevno);
 
@@ -678,6 +1517,10 @@ int qdma_cdev_create(struct qdma_cdev_cb *xcb, struct pci_dev *pdev,
 			&xcdev->c2h_qhndl : &xcdev->h2c_qhndl;
 	*priv_data = qhndl;
 	xcdev->dir_init = (1 << qconf->q_type);
+	if (qconf->q_type == Q_C2H)
+		xcdev->c2h_st = qconf->st;
+	spin_lock_init(&xcdev->buf_lock);
+	INIT_LIST_HEAD(&xcdev->buf_list);
 	strcpy(xcdev->name, qconf->name);
 
 	xcdev->minor = minor;
@@ -847,6 +1690,19 @@ int qdma_cdev_init(void)
 		pr_err("failed to allocate cdev_cache\n");
 		return -ENOMEM;
 	}
+#ifdef QDMA_CDEV_URING_CMD
+	cdev_uring_cache = kmem_cache_create("cdev_uring_cache",
+					sizeof(struct cdev_uring_io),
+					0,
+					SLAB_HWCACHE_ALIGN,
+					NULL);
+	if (!cdev_uring_cache) {
+		pr_err("failed to allocate cdev_uring_cache\n");
+		kmem_cache_destroy(cdev_cache);
+		cdev_cache = NULL;
+		return -ENOMEM;
+	}
+#endif
 
 	return 0;
 }
@@ -863,6 +1719,9 @@ void qdma_cdev_cleanup(void)
 	}
 
 	kmem_cache_destroy(cdev_cache);
+#ifdef QDMA_CDEV_URING_CMD
+	kmem_cache_destroy(cdev_uring_cache);
+#endif
 	if (qdma_class)
 		class_destroy(qdma_class);
 
@@ -35,6 +35,13 @@
 #define QDMA_CDEV_CLASS_NAME  DRV_MODULE_NAME
 /** QDMA character device max minor number to support 4k queues */
 #define QDMA_MINOR_MAX (4096)
+/** inline sg entries of an io request, kept small as the cb of a read or
+ * write lives on the stack, longer lists are allocated
+ */
+#define QDMA_IO_CB_SG_INLINE	(4)
+
+/** user buffer registered with QDMA_CDEV_IOCTL_BUF_REG, see cdev.c */
+struct qdma_cdev_buf;
 
 /* per pci device control */
 /**
@@ -77,6 +84,14 @@ struct qdma_cdev {
 	unsigned short dir_init;
 	/* flag to indicate if memcpy is required */
 	unsigned char no_memcpy;
+	/** c2h queue is in streaming mode */
+	unsigned char c2h_st;
+	/** lock to protect buf_list */
+	spinlock_t buf_lock;
+	/** user buffers registered on this device */
+	struct list_head buf_list;
+	/** file that switched the c2h queue to zero copy receive */
+	struct file *zc_file;
 	/** call back function for open a device */
 	int (*fp_open_extra)(struct qdma_cdev *xcdev);
 	/** call back function for close a device */
@@ -109,6 +124,10 @@ struct qdma_io_cb {
 	struct qdma_sw_sg *sgl;
 	/** pages allocated to accommodate the scatter gather list */
 	struct page **pages;
+	/** registered buffer the request is mapped from, NULL if pinned */
+	struct qdma_cdev_buf *reg_buf;
+	/** scatter gather entries for requests on registered buffers */
+	struct qdma_sw_sg sg_inline[QDMA_IO_CB_SG_INLINE];
 	/** qdma request */
 	struct qdma_request req;
 };
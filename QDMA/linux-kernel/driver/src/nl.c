@@ -102,6 +102,9 @@ static struct nla_policy xnl_policy[XNL_ATTR_MAX] = {
 	[XNL_ATTR_ERROR]   =		{ .type = NLA_U32 },
 	[XNL_ATTR_PING_PONG_EN]   =	{ .type = NLA_U32 },
 	[XNL_ATTR_APERTURE_SZ]   =      { .type = NLA_U32 },
+	[XNL_ATTR_PIDX_ACC]      =      { .type = NLA_U32 },
+	[XNL_ATTR_PIDX_ACC_USECS] =     { .type = NLA_U32 },
+	[XNL_ATTR_NUMA_NODE]     =      { .type = NLA_U32 },
 	[XNL_ATTR_DEV_STAT_PING_PONG_LATMIN1]   =       { .type = NLA_U32 },
 	[XNL_ATTR_DEV_STAT_PING_PONG_LATMIN2]   =       { .type = NLA_U32 },
 	[XNL_ATTR_DEV_STAT_PING_PONG_LATMAX1]   =       { .type = NLA_U32 },
@@ -183,6 +186,9 @@ static struct nla_policy xnl_policy[XNL_ATTR_MAX] = {
 	[XNL_ATTR_ERROR]   =		{ .type = NLA_U32 },
 	[XNL_ATTR_PING_PONG_EN]   =	{ .type = NLA_U32 },
 	[XNL_ATTR_APERTURE_SZ]   =	{ .type = NLA_U32 },
+	[XNL_ATTR_PIDX_ACC]      =	{ .type = NLA_U32 },
+	[XNL_ATTR_PIDX_ACC_USECS] =	{ .type = NLA_U32 },
+	[XNL_ATTR_NUMA_NODE]     =	{ .type = NLA_U32 },
 	[XNL_ATTR_DEV_STAT_PING_PONG_LATMIN1]   =	{ .type = NLA_U32 },
 	[XNL_ATTR_DEV_STAT_PING_PONG_LATMIN2]   =	{ .type = NLA_U32 },
 	[XNL_ATTR_DEV_STAT_PING_PONG_LATMAX1]   =	{ .type = NLA_U32 },
@@ -883,10 +889,12 @@ static int xnl_chk_attr(enum xnl_attr_t xnl_attr, struct genl_info *info,
 	return rv;
 }
 
-static void xnl_extract_extra_config_attr(struct genl_info *info,
-					struct qdma_queue_conf *qconf)
+static int xnl_extract_extra_config_attr(struct genl_info *info,
+					struct qdma_queue_conf *qconf,
+					char *buf, int buflen)
 {
 	u32 f = nla_get_u32(info->attrs[XNL_ATTR_QFLAG]);
+	u32 v;
 
 	qconf->desc_bypass = (f & XNL_F_DESC_BYPASS_EN) ? 1 : 0;
 	qconf->pfetch_bypass = (f & XNL_F_PFETCH_BYPASS_EN) ? 1 : 0;
@@ -936,12 +944,42 @@ static void xnl_extract_extra_config_attr(struct genl_info *info,
 					 info, qconf->qidx, NULL, 0) == 0)
 		qconf->aperture_size =
 			nla_get_u32(info->attrs[XNL_ATTR_APERTURE_SZ]);
+	if (xnl_chk_attr(XNL_ATTR_PIDX_ACC,
+					 info, qconf->qidx, NULL, 0) == 0) {
+		v = nla_get_u32(info->attrs[XNL_ATTR_PIDX_ACC]);
+		/* pidx_acc is an 8 bit field */
+		if (v > U8_MAX) {
+			snprintf(buf, buflen,
+				"pidx_acc %u exceeds %u\n", v, U8_MAX);
+			return -EINVAL;
+		}
+		qconf->pidx_acc = v;
+	}
+	if (xnl_chk_attr(XNL_ATTR_PIDX_ACC_USECS,
+					 info, qconf->qidx, NULL, 0) == 0) {
+		v = nla_get_u32(info->attrs[XNL_ATTR_PIDX_ACC_USECS]);
+		/* pidx_acc_usecs is a 16 bit field */
+		if (v > U16_MAX) {
+			snprintf(buf, buflen,
+				"pidx_acc_us %u exceeds %u\n", v, U16_MAX);
+			return -EINVAL;
+		}
+		qconf->pidx_acc_usecs = v;
+	}
+	if (xnl_chk_attr(XNL_ATTR_NUMA_NODE,
+					 info, qconf->qidx, NULL, 0) == 0) {
+		qconf->numa_node_en = 1;
+		qconf->numa_node =
+			nla_get_u32(info->attrs[XNL_ATTR_NUMA_NODE]);
+	}
 	if (xnl_chk_attr(XNL_ATTR_CMPT_TRIG_MODE, info,
 				qconf->qidx, NULL, 0) == 0)
 		qconf->cmpl_trig_mode =
 			nla_get_u32(info->attrs[XNL_ATTR_CMPT_TRIG_MODE]);
 	else
 		qconf->cmpl_trig_mode = 1;
+
+	return 0;
 }
 
 static int xnl_dev_list(struct sk_buff *skb2, struct genl_info *info)
@@ -1721,7 +1759,10 @@ static int xnl_q_start(struct sk_buff *skb2, struct genl_info *info)
 		goto send_resp;
 	num_q = nla_get_u32(info->attrs[XNL_ATTR_NUM_Q]);
 
-	xnl_extract_extra_config_attr(info, &qconf);
+	rv = xnl_extract_extra_config_attr(info, &qconf, buf,
+					XNL_RESP_BUFLEN_MIN);
+	if (rv < 0)
+		goto send_resp;
 
 	if (qconf.st && (qconf.q_type == Q_CMPT)) {
 		rv += snprintf(buf, 40, "MM CMPL is valid only for MM Mode");
@@ -796,7 +796,84 @@ static ssize_t set_qmax(struct device *dev,
 }
 #endif
 
+/*****************************************************************************/
+/**
+ * funcname() -  handler to show the number of dmaengine channels
+ *
+ * @dev :   PCIe device handle
+ * @attr:   dmaeng_chans configuration value
+ * @buf :   buffer to hold the configured value
+ *
+ * Handler function to show the dmaeng_chans
+ *
+ * @note    none
+ *
+ * Return:  Returns length of the buffer on success, <0 on failure
+ *
+ *****************************************************************************/
+static ssize_t show_dmaeng_chans(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct xlnx_pci_dev *xpdev;
+
+	xpdev = (struct xlnx_pci_dev *)dev_get_drvdata(dev);
+	if (!xpdev)
+		return -EINVAL;
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n",
+			qdma_dmaengine_chan_count(xpdev->dev_hndl));
+}
+
+/*****************************************************************************/
+/**
+ * funcname() -  handler to set the number of dmaengine channels
+ *
+ * @dev :   PCIe device handle
+ * @attr:   dmaeng_chans configuration value
+ * @buf :   "<channels> [<window base> [<window size>]]", the window
+ *          base and size are hex
+ *
+ * Handler function to set the dmaeng_chans, 0 removes the channels. The
+ * channels are rebuilt on every write, which fails with -EBUSY while a
+ * client holds one of them.
+ *
+ * @note    none
+ *
+ * Return:  Returns length of the buffer on success, <0 on failure
+ *
+ *****************************************************************************/
+static ssize_t set_dmaeng_chans(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct xlnx_pci_dev *xpdev;
+	unsigned int chans = 0;
+	unsigned long long win_base = 0;
+	unsigned int win_sz = QDMA_DMAENG_WIN_SZ_DEFAULT;
+	int err;
+
+	xpdev = (struct xlnx_pci_dev *)dev_get_drvdata(dev);
+	if (!xpdev)
+		return -EINVAL;
+
+	if (sscanf(buf, "%u %llx %x", &chans, &win_base, &win_sz) < 1) {
+		pr_err("invalid dmaeng_chans input\n");
+		return -EINVAL;
+	}
+
+	err = qdma_dmaengine_unregister(xpdev->dev_hndl, 0);
+	if (err < 0)
+		return err;
+
+	if (chans)
+		err = qdma_dmaengine_register(xpdev->dev_hndl, chans,
+				win_base, win_sz);
+
+	return err ? err : count;
+}
+
 static DEVICE_ATTR(qmax, S_IWUSR | S_IRUGO, show_qmax, set_qmax);
+static DEVICE_ATTR(dmaeng_chans, S_IWUSR | S_IRUGO,
+			show_dmaeng_chans, set_dmaeng_chans);
 static DEVICE_ATTR(intr_rngsz, S_IWUSR | S_IRUGO,
 			show_intr_rngsz, set_intr_rngsz);
 #ifndef __QDMA_VF__
@@ -815,12 +892,14 @@ static DEVICE_ATTR(cmpl_status_acc, S_IWUSR | S_IRUGO,
 static struct attribute *pci_device_attrs[] = {
 		&dev_attr_qmax.attr,
 		&dev_attr_intr_rngsz.attr,
+		&dev_attr_dmaeng_chans.attr,
 		NULL,
 };
 
 static struct attribute *pci_master_device_attrs[] = {
 		&dev_attr_qmax.attr,
 		&dev_attr_intr_rngsz.attr,
+		&dev_attr_dmaeng_chans.attr,
 #ifndef __QDMA_VF__
 		&dev_attr_buf_sz.attr,
 		&dev_attr_glbl_rng_sz.attr,
@@ -1181,6 +1260,8 @@ int xpdev_queue_add(struct xlnx_pci_dev *xpdev, struct qdma_queue_conf *qconf,
 						&qdata->xcdev->h2c_qhndl;
 				*priv_data = qhndl;
 				qdata->xcdev->dir_init |= (1 << qconf->q_type);
+				if (qconf->q_type == Q_C2H)
+					qdata->xcdev->c2h_st = qconf->st;
 
 				spin_unlock(&xpdev->cdev_lock);
 				return 0;
@@ -1221,10 +1302,22 @@ static void nl_work_handler_q_start(struct work_struct *work)
 	unsigned int qidx = qctrl->qidx;
 	u8 is_qp = qctrl->is_qp;
 	u8 q_type = qctrl->q_type;
+	unsigned long *qhndl_list;
+	unsigned int num_q = 0;
 	int i;
 	char *ebuf = nl_work->buf;
 	int rv = 0;
 
+	/* the queues are started as one list, their contexts are batched */
+	qhndl_list = kcalloc(qctrl->qcnt * 2, sizeof(unsigned long),
+			GFP_KERNEL);
+	if (!qhndl_list) {
+		rv = -ENOMEM;
+		snprintf(ebuf, nl_work->buflen, "OOM, %u queues.\n",
+			qctrl->qcnt);
+		goto send_resp;
+	}
+
 	for (i = 0; i < qctrl->qcnt; i++, qidx++) {
 		struct xlnx_qdata *qdata;
 
@@ -1238,20 +1331,10 @@ q_start:
 			snprintf(ebuf, nl_work->buflen,
 				"Q idx %u, q_type %s, get failed.\n",
 				qidx, q_type_list[q_type].name);
-			goto send_resp;
+			goto free_list;
 		}
 
-		rv = qdma_queue_start(xpdev->dev_hndl, qdata->qhndl, ebuf,
-				      nl_work->buflen);
-		if (rv < 0) {
-			pr_err("%s, idx %u, q_type %s, start failed %d.\n",
-				dev_name(&xpdev->pdev->dev), qidx,
-				q_type_list[q_type].name, rv);
-			snprintf(ebuf, nl_work->buflen,
-				"Q idx %u, q_type %s, start failed %d.\n",
-				qidx, q_type_list[q_type].name, rv);
-			goto send_resp;
-		}
+		qhndl_list[num_q++] = qdata->qhndl;
 		if (qctrl->q_type != Q_CMPT) {
 			if (is_qp && q_type == qctrl->q_type) {
 				q_type = !qctrl->q_type;
@@ -1262,10 +1345,26 @@ q_start:
 		}
 	}
 
+	if (num_q)
+		rv = qdma_queue_start_list(xpdev->dev_hndl, qhndl_list, num_q,
+					ebuf, nl_work->buflen);
+	if (rv < 0) {
+		pr_err("%s, idx %u ~ %u, q_type %s, start failed %d.\n",
+			dev_name(&xpdev->pdev->dev), qctrl->qidx, qidx - 1,
+			q_type_list[qctrl->q_type].name, rv);
+		snprintf(ebuf, nl_work->buflen,
+			"Q idx %u ~ %u, q_type %s, start failed %d.\n",
+			qctrl->qidx, qidx - 1, q_type_list[qctrl->q_type].name,
+			rv);
+		goto free_list;
+	}
+
 	snprintf(ebuf, nl_work->buflen,
 		 "%u Queues started, idx %u ~ %u.\n",
 		qctrl->qcnt, qctrl->qidx, qidx - 1);
 
+free_list:
+	kfree(qhndl_list);
 send_resp:
 	nl_work->q_start_handled = 1;
 	nl_work->ret = rv;
@@ -1683,6 +1782,9 @@ static void remove_one(struct pci_dev *pdev)
 	else
 		sysfs_remove_group(&pdev->dev.kobj, &pci_device_attr_group);
 
+	/* remove can not fail, wait for the dmaengine clients to let go */
+	qdma_dmaengine_unregister(xpdev->dev_hndl, 1);
+
 	qdma_cdev_device_cleanup(&xpdev->cdev_cb);
 
 	xpdev_device_cleanup(xpdev);
@@ -133,6 +133,16 @@ int xdma_user_isr_disable(void *dev_hndl, unsigned int mask);
 ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 			struct sg_table *sgt, bool dma_mapped, int timeout_ms);
 
+/*
+ * xdma_xfer_submit_striped - blocking transfer split over the AXI MM channels
+ *	of one direction. Each idle channel moves one contiguous slice of the
+ *	card address range [ep_addr, ep_addr + length of sgt).
+ * return # of bytes transfered, counted up to the first failed slice, or
+ *	 < 0 in case of error
+ */
+ssize_t xdma_xfer_submit_striped(void *dev_hndl, bool write, u64 ep_addr,
+			struct sg_table *sgt, bool dma_mapped, int timeout_ms);
+
 ssize_t xdma_xfer_submit_nowait(void *cb_hndl, void *dev_hndl, int channel, bool write, u64 ep_addr,
 			struct sg_table *sgt, bool dma_mapped, int timeout_ms);
 
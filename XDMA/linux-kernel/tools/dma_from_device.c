@@ -23,6 +23,7 @@
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/ioctl.h>
+#include <poll.h>
 
 #include "../xdma/cdev_sgdma.h"
 
@@ -31,6 +32,7 @@
 #define DEVICE_NAME_DEFAULT "/dev/xdma0_c2h_0"
 #define SIZE_DEFAULT (32)
 #define COUNT_DEFAULT (1)
+#define CAPTURE_RING_SIZE (64)
 
 static struct option const long_opts[] = {
 	{"device", required_argument, NULL, 'd'},
@@ -41,6 +43,7 @@ static struct option const long_opts[] = {
 	{"count", required_argument, NULL, 'c'},
 	{"file", required_argument, NULL, 'f'},
 	{"eop_flush", no_argument, NULL, 'e'},
+	{"capture", no_argument, NULL, 'x'},
 	{"help", no_argument, NULL, 'h'},
 	{"verbose", no_argument, NULL, 'v'},
 	{0, 0, 0, 0}
@@ -49,7 +52,10 @@ static struct option const long_opts[] = {
 static int test_dma(char *devname, uint64_t addr, uint64_t aperture, 
 		uint64_t size, uint64_t offset, uint64_t count,
 		char *ofname);
+static int capture_dma(char *devname, uint64_t size, uint64_t count,
+		char *ofname);
 static int eop_flush = 0;
+static int capture = 0;
 
 static void usage(const char *name)
 {
@@ -89,6 +95,13 @@ static void usage(const char *name)
 	fprintf(stdout,
 		 "\t\t* acutal # of bytes dma'ed could be smaller than specified\n");
 	i++;
+	fprintf(stdout,
+		 "  -%c (--%s) ST only, receive count buffers of size bytes\n",
+		long_opts[i].val, long_opts[i].name);
+	fprintf(stdout,
+		 "\t\t  through the mmap'd capture ring of %d buffers\n",
+		CAPTURE_RING_SIZE);
+	i++;
 	fprintf(stdout, "  -%c (--%s) print usage help and exit\n",
 		long_opts[i].val, long_opts[i].name);
 	i++;
@@ -113,7 +126,7 @@ int main(int argc, char *argv[])
 	uint64_t count = COUNT_DEFAULT;
 	char *ofname = NULL;
 
-	while ((cmd_opt = getopt_long(argc, argv, "vhec:f:d:a:k:s:o:", long_opts,
+	while ((cmd_opt = getopt_long(argc, argv, "vhexc:f:d:a:k:s:o:", long_opts,
 			    NULL)) != -1) {
 		switch (cmd_opt) {
 		case 0:
@@ -153,6 +166,9 @@ int main(int argc, char *argv[])
 		case 'e':
 			eop_flush = 1;
 			break;
+		case 'x':
+			capture = 1;
+			break;
 		case 'h':
 		default:
 			usage(argv[0]);
@@ -166,9 +182,118 @@ int main(int argc, char *argv[])
 		"count %lu\n",
 		device, address, aperture, size, offset, count);
 
+	if (capture)
+		return capture_dma(device, size, count, ofname);
+
 	return test_dma(device, address, aperture, size, offset, count, ofname);
 }
 
+static int capture_dma(char *devname, uint64_t size, uint64_t count,
+			char *ofname)
+{
+	struct xdma_capture_ioctl conf;
+	struct xdma_capture_ring *ring;
+	struct xdma_capture_result *res;
+	char *base = MAP_FAILED;
+	char *data;
+	size_t out_offset = 0;
+	uint64_t received = 0;
+	uint32_t cons = 0;
+	int out_fd = -1;
+	int fpga_fd;
+	int rc;
+
+	fpga_fd = open(devname, O_RDWR);
+	if (fpga_fd < 0) {
+		fprintf(stderr, "unable to open device %s, %d.\n",
+			devname, fpga_fd);
+		perror("open device");
+		return -EINVAL;
+	}
+
+	if (ofname) {
+		out_fd = open(ofname, O_RDWR | O_CREAT | O_TRUNC, 0666);
+		if (out_fd < 0) {
+			fprintf(stderr, "unable to open output file %s, %d.\n",
+				ofname, out_fd);
+			perror("open output file");
+			rc = -EINVAL;
+			goto out;
+		}
+	}
+
+	conf.size = CAPTURE_RING_SIZE;
+	conf.buf_sz = size;
+	rc = ioctl(fpga_fd, IOCTL_XDMA_CAPTURE_START, &conf);
+	if (rc < 0) {
+		perror("IOCTL_XDMA_CAPTURE_START");
+		goto out;
+	}
+
+	base = mmap(NULL, conf.mmap_len, PROT_READ, MAP_SHARED, fpga_fd, 0);
+	if (base == MAP_FAILED) {
+		perror("mmap");
+		rc = -EIO;
+		goto out;
+	}
+	ring = (struct xdma_capture_ring *)base;
+	res = (struct xdma_capture_result *)(base + ring->res_off);
+	data = base + ring->data_off;
+
+	while (received < count) {
+		struct pollfd pfd = { .fd = fpga_fd, .events = POLLIN };
+		uint32_t prod, n;
+
+		rc = poll(&pfd, 1, -1);
+		if (rc < 0) {
+			perror("poll");
+			goto out;
+		}
+		if (ring->err || (pfd.revents & POLLERR)) {
+			fprintf(stderr, "capture stopped, %d.\n", ring->err);
+			rc = -EIO;
+			goto out;
+		}
+
+		prod = __atomic_load_n(&ring->prod, __ATOMIC_ACQUIRE);
+		for (n = 0; cons + n != prod && received < count;
+		     n++, received++) {
+			uint32_t idx = (cons + n) & (ring->size - 1);
+
+			if (verbose)
+				fprintf(stdout, "#%lu: %u bytes%s\n", received,
+					res[idx].length,
+					(res[idx].status & 1) ? ", eop" : "");
+			if (out_fd < 0)
+				continue;
+			rc = write_from_buffer(ofname, out_fd,
+					data + (size_t)idx * ring->buf_sz,
+					res[idx].length, out_offset);
+			if (rc < 0)
+				goto out;
+			out_offset += res[idx].length;
+		}
+
+		rc = ioctl(fpga_fd, IOCTL_XDMA_CAPTURE_RELEASE, &n);
+		if (rc < 0) {
+			perror("IOCTL_XDMA_CAPTURE_RELEASE");
+			goto out;
+		}
+		cons += n;
+	}
+	rc = 0;
+
+out:
+	if (base != MAP_FAILED)
+		munmap(base, conf.mmap_len);
+	/* closing the device stops the capture */
+	close(fpga_fd);
+	if (out_fd >= 0)
+		close(out_fd);
+
+	return rc;
+}
+
 static int test_dma(char *devname, uint64_t addr, uint64_t aperture,
 			uint64_t size, uint64_t offset, uint64_t count,
 			char *ofname)
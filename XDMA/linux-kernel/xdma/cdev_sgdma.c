@@ -31,6 +31,11 @@
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 16, 0)
 #include <linux/uio.h>
 #endif
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 8, 0)
+#define XDMA_URING_CMD_SUPPORT
+#include <linux/blkdev.h>
+#include <linux/io_uring/cmd.h>
+#endif
 #include "libxdma_api.h"
 #include "xdma_cdev.h"
 #include "cdev_sgdma.h"
@@ -776,6 +781,77 @@ static int ioctl_do_align_get(struct xdma_engine *engine, unsigned long arg)
 	return put_user(engine->addr_align, (int __user *)arg);
 }
 
+static int ioctl_do_poll_stats_get(struct xdma_engine *engine,
+				unsigned long arg)
+{
+	struct xdma_poll_stats *stats;
+	struct xdma_poll_stats_ioctl ps;
+
+	if (!engine) {
+		pr_err("Invalid DMA engine\n");
+		return -EINVAL;
+	}
+
+	stats = &engine->poll_stats;
+	ps.polls = stats->polls;
+	ps.spin_hits = stats->spin_hits;
+	ps.sleep_hits = stats->sleep_hits;
+	ps.spin_misses = stats->spin_misses;
+	ps.spin_wasted_ns = stats->spin_wasted_ns;
+	ps.sleeps = stats->sleeps;
+	ps.lat_avg_ns = stats->lat_avg_ns;
+
+	if (copy_to_user((void __user *)arg, &ps, sizeof(ps)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static int ioctl_do_capture_start(struct xdma_engine *engine,
+				unsigned long arg)
+{
+	struct xdma_capture_ioctl conf;
+	int rv;
+
+	if (!engine) {
+		pr_err("Invalid DMA engine\n");
+		return -EINVAL;
+	}
+
+	if (copy_from_user(&conf, (struct xdma_capture_ioctl __user *)arg,
+			   sizeof(conf)))
+		return -EFAULT;
+
+	rv = xdma_capture_start(engine, &conf);
+	if (rv < 0)
+		return rv;
+
+	if (copy_to_user((struct xdma_capture_ioctl __user *)arg, &conf,
+			 sizeof(conf))) {
+		xdma_capture_stop(engine);
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
+static int ioctl_do_capture_release(struct xdma_engine *engine,
+				unsigned long arg)
+{
+	unsigned int cnt;
+	int rv;
+
+	if (!engine) {
+		pr_err("Invalid DMA engine\n");
+		return -EINVAL;
+	}
+
+	rv = get_user(cnt, (unsigned int __user *)arg);
+	if (rv)
+		return rv;
+
+	return xdma_capture_release(engine, cnt);
+}
 
 static int ioctl_do_aperture_dma(struct xdma_engine *engine, unsigned long arg,
 				bool write)
@@ -882,6 +958,18 @@ static long char_sgdma_ioctl(struct file *file, unsigned int cmd,
 	case IOCTL_XDMA_APERTURE_W:
 		rv = ioctl_do_aperture_dma(engine, arg, 1);
 		break;
+	case IOCTL_XDMA_POLL_STATS_GET:
+		rv = ioctl_do_poll_stats_get(engine, arg);
+		break;
+	case IOCTL_XDMA_CAPTURE_START:
+		rv = ioctl_do_capture_start(engine, arg);
+		break;
+	case IOCTL_XDMA_CAPTURE_STOP:
+		rv = xdma_capture_stop(engine);
+		break;
+	case IOCTL_XDMA_CAPTURE_RELEASE:
+		rv = ioctl_do_capture_release(engine, arg);
+		break;
 	default:
 		dbg_perf("Unsupported operation\n");
 		rv = -EINVAL;
@@ -924,11 +1012,246 @@ static int char_sgdma_close(struct inode *inode, struct file *file)
 
 	engine = xcdev->engine;
 
-	if (engine->streaming && engine->dir == DMA_FROM_DEVICE)
+	if (engine->streaming && engine->dir == DMA_FROM_DEVICE) {
+		/* a capture ends with the file that started it */
+		xdma_capture_stop(engine);
 		engine->device_open = 0;
+	}
+
+	return 0;
+}
+
+/* ST C2H capture buffers, see IOCTL_XDMA_CAPTURE_START */
+static int char_sgdma_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct xdma_cdev *xcdev = (struct xdma_cdev *)file->private_data;
+	int rv;
+
+	rv = xcdev_check(__func__, xcdev, 1);
+	if (rv < 0)
+		return rv;
+
+	return xdma_capture_mmap(xcdev->engine, vma);
+}
+
+static unsigned int char_sgdma_poll(struct file *file, poll_table *wait)
+{
+	struct xdma_cdev *xcdev = (struct xdma_cdev *)file->private_data;
+	struct xdma_engine *engine;
+
+	if (xcdev_check(__func__, xcdev, 1) < 0)
+		return POLLERR;
+	engine = xcdev->engine;
+
+	/* only a capture has something to wait for */
+	if (!READ_ONCE(engine->capture))
+		return POLLIN | POLLRDNORM | POLLOUT | POLLWRNORM;
+
+	return xdma_capture_poll(engine, file, wait);
+}
+
+#ifdef XDMA_URING_CMD_SUPPORT
+/*
+ * io_uring passthrough, XDMA_URING_CMD_READ/_WRITE. Every sqe is queued on
+ * the engine right away, the completion thread is woken up once when
+ * io_uring finishes submitting the batch (the submitter's plug is flushed)
+ * and the cqes are posted from lazy task work.
+ */
+struct cdev_uring_io {
+	struct io_uring_cmd *ioucmd;
+	struct xdma_cdev *xcdev;
+	ssize_t res;
+	bool done;
+	struct xdma_io_cb cb;
+};
+
+static void cdev_uring_cmd_done(struct io_uring_cmd *ioucmd,
+				unsigned int issue_flags)
+{
+	struct cdev_uring_io *io = *(struct cdev_uring_io **)ioucmd->pdu;
+	ssize_t res = io->res;
+
+	char_sgdma_unmap_user_buf(&io->cb, io->cb.write);
+	kfree(io);
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 18, 0)
+	io_uring_cmd_done(ioucmd, res, issue_flags);
+#else
+	io_uring_cmd_done(ioucmd, res, 0, issue_flags);
+#endif
+}
+
+static void uring_io_handler(unsigned long cb_hndl, int err)
+{
+	struct xdma_io_cb *cb = (struct xdma_io_cb *)cb_hndl;
+	struct cdev_uring_io *io = (struct cdev_uring_io *)cb->private;
+	struct xdma_cdev *xcdev = io->xcdev;
+
+	io->res = err;
+	if (!err)
+		io->res = xdma_xfer_completion((void *)cb, xcdev->xdev,
+				xcdev->engine->channel, cb->write,
+				cb->ep_addr, &cb->sgt, 0,
+				cb->write ? h2c_timeout * 1000 :
+					    c2h_timeout * 1000);
+	io->done = true;
+
+	io_uring_cmd_do_in_task_lazy(io->ioucmd, cdev_uring_cmd_done);
+}
+
+static void cdev_uring_unplug(struct blk_plug_cb *cb, bool from_schedule)
+{
+	struct xdma_engine *engine = (struct xdma_engine *)cb->data;
+
+	if (engine->cmplthp)
+		xdma_kthread_wakeup(engine->cmplthp);
+	kfree(cb);
+}
+
+/* build the sg table of a request on an io_uring fixed buffer */
+static int cdev_uring_map_fixed(struct xdma_io_cb *cb, struct iov_iter *iter)
+{
+	const struct bio_vec *bv = iter->bvec;
+	size_t skip = iter->iov_offset;
+	size_t left = iov_iter_count(iter);
+	struct scatterlist *sg;
+	unsigned int nents = 0;
+	unsigned int i;
+
+	for (i = 0; left; i++, skip = 0) {
+		left -= min_t(size_t, bv[i].bv_len - skip, left);
+		nents++;
+	}
+	if (!nents)
+		return -EINVAL;
 
+	if (sg_alloc_table(&cb->sgt, nents, GFP_KERNEL)) {
+		pr_err("sgl OOM.\n");
+		return -ENOMEM;
+	}
+
+	skip = iter->iov_offset;
+	left = iov_iter_count(iter);
+	sg = cb->sgt.sgl;
+	for (i = 0; i < nents; i++, skip = 0, sg = sg_next(sg)) {
+		unsigned int pos = bv[i].bv_offset + skip;
+		size_t seg = min_t(size_t, bv[i].bv_len - skip, left);
+
+		/* a bvec may span several pages of one folio */
+		sg_set_page(sg, bv[i].bv_page + (pos >> PAGE_SHIFT), seg,
+			    offset_in_page(pos));
+		left -= seg;
+	}
+
+	/* the pages stay pinned by io_uring, nothing to release */
+	cb->pages = NULL;
+	cb->pages_nr = 0;
 	return 0;
 }
+
+static int char_sgdma_uring_cmd(struct io_uring_cmd *ioucmd,
+				unsigned int issue_flags)
+{
+	struct xdma_cdev *xcdev =
+		(struct xdma_cdev *)ioucmd->file->private_data;
+	const struct xdma_uring_cmd *cmd;
+	struct xdma_engine *engine;
+	struct cdev_uring_io *io;
+	struct blk_plug_cb *plug;
+	bool write;
+	u64 addr;
+	int rv;
+
+	rv = xcdev_check(__func__, xcdev, 1);
+	if (rv < 0)
+		return rv;
+	engine = xcdev->engine;
+
+	/* the payload does not fit the 16 bytes of a regular sqe */
+	if (!(issue_flags & IO_URING_F_SQE128))
+		return -EINVAL;
+
+	switch (ioucmd->cmd_op) {
+	case XDMA_URING_CMD_READ:
+		write = false;
+		break;
+	case XDMA_URING_CMD_WRITE:
+		write = true;
+		break;
+	default:
+		return -ENOTTY;
+	}
+
+	if ((write && engine->dir != DMA_TO_DEVICE) ||
+	    (!write && engine->dir != DMA_FROM_DEVICE)) {
+		pr_err("r/w mismatch. W %d, dir %d.\n", write, engine->dir);
+		return -EINVAL;
+	}
+
+	cmd = io_uring_sqe_cmd(ioucmd->sqe);
+	addr = READ_ONCE(cmd->addr);
+
+	io = kzalloc(sizeof(*io), GFP_KERNEL);
+	if (!io)
+		return -ENOMEM;
+	io->ioucmd = ioucmd;
+	io->xcdev = xcdev;
+	io->cb.buf = u64_to_user_ptr(addr);
+	io->cb.len = READ_ONCE(cmd->len);
+	io->cb.ep_addr = READ_ONCE(cmd->ep_addr);
+	io->cb.write = write;
+	io->cb.private = io;
+	io->cb.io_done = uring_io_handler;
+
+	rv = check_transfer_align(engine, io->cb.buf, io->cb.len,
+				  io->cb.ep_addr, 1);
+	if (rv) {
+		pr_info("Invalid transfer alignment detected\n");
+		goto free_io;
+	}
+
+	if (ioucmd->flags & IORING_URING_CMD_FIXED) {
+		struct iov_iter iter;
+
+		rv = io_uring_cmd_import_fixed(addr, io->cb.len,
+				write ? ITER_SOURCE : ITER_DEST,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 15, 0)
+				&iter, ioucmd, issue_flags);
+#else
+				&iter, ioucmd);
+#endif
+		if (rv >= 0)
+			rv = cdev_uring_map_fixed(&io->cb, &iter);
+	} else {
+		rv = char_sgdma_map_user_buf_to_sgl(&io->cb, write);
+	}
+	if (rv < 0)
+		goto free_io;
+
+	*(struct cdev_uring_io **)ioucmd->pdu = io;
+	rv = xdma_xfer_submit_nowait((void *)&io->cb, xcdev->xdev,
+				engine->channel, write, io->cb.ep_addr,
+				&io->cb.sgt, 0,
+				write ? h2c_timeout * 1000 :
+					c2h_timeout * 1000);
+	if (rv != -EIOCBQUEUED && !io->done) {
+		char_sgdma_unmap_user_buf(&io->cb, write);
+		goto free_io;
+	}
+
+	/* wake up the completion thread once per batch of sqes */
+	plug = blk_check_plugged(cdev_uring_unplug, engine, sizeof(*plug));
+	if (!plug && engine->cmplthp)
+		xdma_kthread_wakeup(engine->cmplthp);
+
+	return -EIOCBQUEUED;
+
+free_io:
+	kfree(io);
+	return rv;
+}
+#endif
+
 static const struct file_operations sgdma_fops = {
 	.owner = THIS_MODULE,
 	.open = char_sgdma_open,
@@ -946,6 +1269,11 @@ static const struct file_operations sgdma_fops = {
 	.aio_read = cdev_aio_read,
 #endif
 	.unlocked_ioctl = char_sgdma_ioctl,
+#ifdef XDMA_URING_CMD_SUPPORT
+	.uring_cmd = char_sgdma_uring_cmd,
+#endif
+	.mmap = char_sgdma_mmap,
+	.poll = char_sgdma_poll,
 	.llseek = char_sgdma_llseek,
 };
 
@@ -953,3 +1281,80 @@ void cdev_sgdma_init(struct xdma_cdev *xcdev)
 {
 	cdev_init(&xcdev->cdev, &sgdma_fops);
 }
+
+/*
+ * striped nodes: the request is spread over all AXI MM engines of the
+ * direction, xcdev->engine is only the first of them and used for the
+ * alignment checks.
+ */
+static ssize_t char_sgdma_stripe_read_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *pos, bool write)
+{
+	int rv;
+	ssize_t res = 0;
+	struct xdma_cdev *xcdev = (struct xdma_cdev *)file->private_data;
+	struct xdma_io_cb cb;
+
+	rv = xcdev_check(__func__, xcdev, 1);
+	if (rv < 0)
+		return rv;
+
+	dbg_tfr("file 0x%p, buf 0x%p,%llu, pos %llu, W %d, striped.\n",
+		file, buf, (u64)count, (u64)*pos, write);
+
+	if ((write && xcdev->engine->dir != DMA_TO_DEVICE) ||
+	    (!write && xcdev->engine->dir != DMA_FROM_DEVICE)) {
+		pr_err("r/w mismatch. W %d, dir %d.\n",
+			write, xcdev->engine->dir);
+		return -EINVAL;
+	}
+
+	rv = check_transfer_align(xcdev->engine, buf, count, *pos, 1);
+	if (rv) {
+		pr_info("Invalid transfer alignment detected\n");
+		return rv;
+	}
+
+	memset(&cb, 0, sizeof(struct xdma_io_cb));
+	cb.buf = (char __user *)buf;
+	cb.len = count;
+	cb.ep_addr = (u64)*pos;
+	cb.write = write;
+	rv = char_sgdma_map_user_buf_to_sgl(&cb, write);
+	if (rv < 0)
+		return rv;
+
+	res = xdma_xfer_submit_striped(xcdev->xdev, write, *pos, &cb.sgt, 0,
+				       write ? h2c_timeout * 1000 :
+					       c2h_timeout * 1000);
+
+	char_sgdma_unmap_user_buf(&cb, write);
+
+	return res;
+}
+
+static ssize_t char_sgdma_stripe_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *pos)
+{
+	return char_sgdma_stripe_read_write(file, buf, count, pos, 1);
+}
+
+static ssize_t char_sgdma_stripe_read(struct file *file, char __user *buf,
+				size_t count, loff_t *pos)
+{
+	return char_sgdma_stripe_read_write(file, buf, count, pos, 0);
+}
+
+static const struct file_operations sgdma_stripe_fops = {
+	.owner = THIS_MODULE,
+	.open = char_open,
+	.release = char_close,
+	.write = char_sgdma_stripe_write,
+	.read = char_sgdma_stripe_read,
+	.llseek = char_sgdma_llseek,
+};
+
+void cdev_sgdma_stripe_init(struct xdma_cdev *xcdev)
+{
+	cdev_init(&xcdev->cdev, &sgdma_stripe_fops);
+}
@@ -58,6 +58,19 @@ struct xdma_performance_ioctl {
 	uint64_t pending_count;
 };
 
+/*
+ * io_uring passthrough command payload, carried in the command area of a
+ * 128 byte sqe (IORING_SETUP_SQE128) with sqe->cmd_op set to
+ * XDMA_URING_CMD_READ or XDMA_URING_CMD_WRITE. With IORING_URING_CMD_FIXED
+ * addr/len has to lie within the registered buffer sqe->buf_index.
+ */
+struct xdma_uring_cmd {
+	uint64_t addr;		/* user buffer */
+	uint64_t ep_addr;	/* card address, as the file offset */
+	uint32_t len;		/* bytes to transfer */
+	uint32_t rsvd;		/* must be 0 */
+};
+
 struct xdma_aperture_ioctl {
 	uint64_t ep_addr;
 	unsigned int aperture;
@@ -67,6 +80,52 @@ struct xdma_aperture_ioctl {
 	unsigned long done;
 };
 
+/* poll mode completion statistics of an engine, see poll_spin_max_us */
+struct xdma_poll_stats_ioctl {
+	uint64_t polls;		/* completions waited for */
+	uint64_t spin_hits;	/* completion seen within the spin budget */
+	uint64_t sleep_hits;	/* completion seen after sleeping */
+	uint64_t spin_misses;	/* spin budget used up without completion */
+	uint64_t spin_wasted_ns;	/* time spent in missed spin budgets */
+	uint64_t sleeps;	/* sleeps between writeback checks */
+	uint64_t lat_avg_ns;	/* running average of completion latency */
+};
+
+/*
+ * ST C2H capture, IOCTL_XDMA_CAPTURE_START. The engine keeps running over a
+ * ring of buffers until IOCTL_XDMA_CAPTURE_STOP or close(). The node is then
+ * mapped read-only, MAP_SHARED, at offset 0 with mmap_len bytes:
+ *   struct xdma_capture_ring at 0,
+ *   struct xdma_capture_result res[size] at res_off,
+ *   buffer i at data_off + i * buf_sz.
+ * Buffer prod - 1 is the last one filled. The application consumes the
+ * buffers from cons on and hands them back with IOCTL_XDMA_CAPTURE_RELEASE.
+ * The engine stalls the stream, instead of overwriting, when all buffers
+ * are waiting to be released.
+ */
+struct xdma_capture_ioctl {
+	uint32_t size;		/* in: number of buffers, power of 2 */
+	uint32_t buf_sz;	/* in: buffer size, power of 2, >= page size */
+	uint64_t mmap_len;	/* out: length to mmap() */
+};
+
+struct xdma_capture_result {
+	uint32_t status;	/* bit 0 set: buffer ends a packet (EOP) */
+	uint32_t length;	/* bytes received into the buffer */
+	uint32_t rsvd[6];
+};
+
+struct xdma_capture_ring {
+	uint32_t prod;		/* buffers filled, free running */
+	uint32_t cons;		/* buffers released, free running */
+	uint32_t size;
+	uint32_t buf_sz;
+	uint64_t res_off;
+	uint64_t data_off;
+	int32_t err;		/* < 0 once the engine stopped on an error */
+	uint32_t rsvd;
+};
+
 
 /* IOCTL codes */
 
@@ -79,4 +138,15 @@ struct xdma_aperture_ioctl {
 #define IOCTL_XDMA_APERTURE_R   _IOW('q', 7, struct xdma_aperture_ioctl *)
 #define IOCTL_XDMA_APERTURE_W   _IOW('q', 8, struct xdma_aperture_ioctl *)
 
+/* io_uring passthrough commands */
+#define XDMA_URING_CMD_READ     _IOR('q', 9, struct xdma_uring_cmd)
+#define XDMA_URING_CMD_WRITE    _IOW('q', 10, struct xdma_uring_cmd)
+
+#define IOCTL_XDMA_POLL_STATS_GET _IOR('q', 11, struct xdma_poll_stats_ioctl *)
+
+/* ST C2H capture */
+#define IOCTL_XDMA_CAPTURE_START   _IOWR('q', 12, struct xdma_capture_ioctl *)
+#define IOCTL_XDMA_CAPTURE_STOP    _IO('q', 13)
+#define IOCTL_XDMA_CAPTURE_RELEASE _IOW('q', 14, unsigned int)
+
 #endif /* _XDMA_IOCALLS_POSIX_H_ */
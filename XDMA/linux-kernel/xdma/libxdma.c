@@ -27,6 +27,10 @@
 #include <linux/errno.h>
 #include <linux/sched.h>
 #include <linux/vmalloc.h>
+#include <linux/completion.h>
+#include <linux/delay.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
 
 #include "libxdma.h"
 #include "libxdma_api.h"
@@ -53,6 +57,21 @@ module_param(desc_blen_max, uint, 0644);
 MODULE_PARM_DESC(desc_blen_max,
 		 "per descriptor max. buffer length, default is (1 << 28) - 1");
 
+static unsigned int xfer_pipeline = 1;
+module_param(xfer_pipeline, uint, 0644);
+MODULE_PARM_DESC(xfer_pipeline,
+	"Set 0 to run one descriptor chain at a time, default is 1 (two chains in flight for large requests, interrupt mode and not ST C2H only)");
+
+static unsigned int poll_spin_max_us = 50;
+module_param(poll_spin_max_us, uint, 0644);
+MODULE_PARM_DESC(poll_spin_max_us,
+	"poll mode: max. time to spin on the writeback before sleeping, default is 50us");
+
+static unsigned int poll_sleep_max_us = 500;
+module_param(poll_sleep_max_us, uint, 0644);
+MODULE_PARM_DESC(poll_sleep_max_us,
+	"poll mode: max. sleep between writeback checks, 0 spins until completion, default is 500us");
+
 #define XDMA_PERF_NUM_DESC 128
 
 /* Kernel version adaptative code */
@@ -979,6 +998,12 @@ engine_service_final_transfer(struct xdma_engine *engine,
 
 			engine->desc_dequeued += transfer->desc_cmpl;
 
+		} else if (engine->running) {
+			/* chained transfer, the engine is still processing it */
+			dbg_tfr("%s, xfer 0x%p in progress, %d/%d.\n",
+				engine->name, transfer, *pdesc_completed,
+				transfer->desc_num);
+			return transfer;
 		} else {
 			transfer->state = TRANSFER_STATE_FAILED;
 			pr_info("%s, xfer 0x%p, stopped half-way, %d/%d.\n",
@@ -1088,6 +1113,59 @@ static int engine_service_resume(struct xdma_engine *engine)
 	return 0;
 }
 
+/*
+ * engine_service_capture() - publish the capture buffers filled since the
+ * last call. Must be called with engine->lock already acquired.
+ */
+static int engine_service_capture(struct xdma_engine *engine)
+{
+	struct xdma_capture *cap = engine->capture;
+	struct device *dev = &engine->xdev->pdev->dev;
+	u32 count, n, i;
+	int rv;
+
+	rv = engine_status_read(engine, 1, 0);
+	if (rv < 0) {
+		pr_err("Failed to read engine status\n");
+		return rv;
+	}
+
+	if (!engine->running)
+		return 0;
+
+	if (engine->status & XDMA_STAT_C2H_ERR_MASK) {
+		pr_info("engine %s, capture status error 0x%x.\n",
+			engine->name, engine->status);
+		engine_status_dump(engine);
+		xdma_engine_stop(engine);
+		cap->err = -EIO;
+		WRITE_ONCE(cap->ring->err, cap->err);
+		wake_up_interruptible(&engine->capture_wq);
+		return 0;
+	}
+
+	count = read_register(&engine->regs->completed_desc_count);
+	n = (count - cap->desc_done) & WB_COUNT_MASK;
+	if (!n)
+		return 0;
+	cap->desc_done = count;
+
+	for (i = 0; i < n; i++) {
+		unsigned int idx = (cap->prod + i) & (cap->size - 1);
+
+		dma_sync_single_range_for_cpu(dev, cap->res_bus,
+				idx * sizeof(struct xdma_result),
+				sizeof(struct xdma_result), DMA_FROM_DEVICE);
+		dma_sync_single_for_cpu(dev, cap->buf_bus[idx], cap->buf_sz,
+					DMA_FROM_DEVICE);
+	}
+	cap->prod += n;
+	smp_store_release(&cap->ring->prod, cap->prod);
+	wake_up_interruptible(&engine->capture_wq);
+
+	return 0;
+}
+
 /**
  * engine_service() - service an SG DMA engine
  *
@@ -1108,6 +1186,10 @@ static int engine_service(struct xdma_engine *engine, int desc_writeback)
 		return -EINVAL;
 	}
 
+	/* a capture runs its own ring */
+	if (engine->capture)
+		return engine_service_capture(engine);
+
 	/* Service the engine */
 	if (!engine->running) {
 		pr_err("Engine was not running!!! Clearing status\n");
@@ -1242,19 +1324,42 @@ unlock:
 	spin_unlock_irqrestore(&engine->lock, flags);
 }
 
+/*
+ * spin budget for the next completion: twice the average latency when that
+ * fits within poll_spin_max_us. Completions expected later get a short spin
+ * only, so a shift to shorter latencies is still noticed.
+ */
+static u64 engine_poll_spin_budget(struct xdma_engine *engine)
+{
+	u64 max = (u64)poll_spin_max_us * NSEC_PER_USEC;
+	u64 avg = engine->poll_stats.lat_avg_ns;
+
+	if (!avg)
+		return max;
+	if (avg * 2 <= max)
+		return avg * 2;
+	return max >> 3;
+}
+
 static u32 engine_service_wb_monitor(struct xdma_engine *engine,
 				     u32 expected_wb)
 {
 	struct xdma_poll_wb *wb_data;
+	struct xdma_poll_stats *stats;
 	u32 desc_wb = 0;
 	u32 sched_limit = 0;
 	unsigned long timeout;
+	unsigned int sleep_us = POLL_SLEEP_MIN_US;
+	bool spinning = true;
+	u64 budget, lat;
+	ktime_t start;
 
 	if (!engine) {
 		pr_err("dma engine NULL\n");
 		return -EINVAL;
 	}
 	wb_data = (struct xdma_poll_wb *)engine->poll_mode_addr_virt;
+	stats = &engine->poll_stats;
 
 	/*
 	 * Poll the writeback location for the expected number of
@@ -1262,9 +1367,14 @@ static u32 engine_service_wb_monitor(struct xdma_engine *engine,
 	 * where the expected_desc_count passed in is zero, since it cannot be
 	 * determined before the function is called
 	 */
+	if (!expected_wb)
+		return 0;
 
+	/* spin for the learnt budget first, then back off with sleeps */
+	budget = engine_poll_spin_budget(engine);
+	start = ktime_get();
 	timeout = jiffies + (POLL_TIMEOUT_SECONDS * HZ);
-	while (expected_wb != 0) {
+	while (1) {
 		desc_wb = wb_data->completed_desc_count;
 
 		if (desc_wb)
@@ -1286,16 +1396,48 @@ static u32 engine_service_wb_monitor(struct xdma_engine *engine,
 			break;
 		}
 
-		/*
-		 * Define NUM_POLLS_PER_SCHED to limit how much time is spent
-		 * in the scheduler
-		 */
+		if (spinning) {
+			u64 spent = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+			if (spent >= budget && poll_sleep_max_us) {
+				spinning = false;
+				stats->spin_misses++;
+				stats->spin_wasted_ns += spent;
+				continue;
+			}
 
-		if (sched_limit != 0) {
-			if ((sched_limit % NUM_POLLS_PER_SCHED) == 0)
-				schedule();
+			/*
+			 * Define NUM_POLLS_PER_SCHED to limit how much time
+			 * is spent in the scheduler
+			 */
+			if (sched_limit != 0) {
+				if ((sched_limit % NUM_POLLS_PER_SCHED) == 0)
+					schedule();
+			}
+			sched_limit++;
+			cpu_relax();
+			continue;
 		}
-		sched_limit++;
+
+		usleep_range(sleep_us, sleep_us + (sleep_us >> 1));
+		stats->sleeps++;
+		sleep_us = min(sleep_us << 1, max_t(unsigned int,
+				poll_sleep_max_us, POLL_SLEEP_MIN_US));
+	}
+
+	if (!(desc_wb & WB_ERR_MASK)) {
+		lat = ktime_to_ns(ktime_sub(ktime_get(), start));
+		stats->polls++;
+		if (spinning)
+			stats->spin_hits++;
+		else
+			stats->sleep_hits++;
+		/* running average, 1/8 weight for the new sample */
+		if (stats->lat_avg_ns)
+			stats->lat_avg_ns = stats->lat_avg_ns -
+				(stats->lat_avg_ns >> 3) + (lat >> 3);
+		else
+			stats->lat_avg_ns = lat;
 	}
 
 	return desc_wb;
@@ -2439,6 +2581,96 @@ static int transfer_abort(struct xdma_engine *engine,
 	return 0;
 }
 
+/* transfer_chain() - Link a transfer behind one the engine is running
+ *
+ * The last descriptor of @prev is pointed at the first descriptor of @next
+ * and its stop bit is cleared last, so the engine either stops on @prev as
+ * before or moves on to @next without being restarted. A chain made after
+ * the engine fetched the last descriptor of @prev is harmless, the engine
+ * is then restarted on @next from engine_service_resume().
+ *
+ * engine->lock must be taken
+ */
+static void transfer_chain(struct xdma_transfer *prev,
+			   struct xdma_transfer *next)
+{
+	struct xdma_desc *last = prev->desc_virt + prev->desc_num - 1;
+	u32 next_adj = xdma_get_next_adj(next->desc_adjacent,
+				cpu_to_le32(PCI_DMA_L(next->desc_bus)));
+
+	xdma_desc_link(last, next->desc_virt, next->desc_bus);
+	xdma_desc_adjacent(last, next_adj);
+	/* next pointer must be visible before the stop bit is cleared */
+	wmb();
+	xdma_desc_control_set(last, XDMA_DESC_EOP | XDMA_DESC_COMPLETED);
+}
+
+/*
+ * ST C2H stops on EOP and poll mode stops the engine on every writeback, the
+ * engine is restarted for each transfer there instead.
+ */
+static inline bool engine_chain_enabled(struct xdma_engine *engine)
+{
+	return !poll_mode &&
+	       !(engine->streaming && engine->dir == DMA_FROM_DEVICE);
+}
+
+/* transfer_queue_locked() - Queue a built DMA transfer on the engine
+ *
+ * The transfer is chained behind the last one queued while the engine runs,
+ * whichever request that one belongs to.
+ *
+ * engine->lock must be taken
+ */
+static int transfer_queue_locked(struct xdma_engine *engine,
+				 struct xdma_transfer *transfer)
+{
+	struct xdma_transfer *transfer_started;
+
+	engine->prev_cpu = get_cpu();
+	put_cpu();
+
+	/* engine is being shutdown; do not accept new transfers */
+	if (engine->shutdown & ENGINE_SHUTDOWN_REQUEST) {
+		pr_info("engine %s offline, transfer 0x%p not queued.\n",
+			engine->name, transfer);
+		return -EBUSY;
+	}
+
+	/* mark the transfer as submitted */
+	transfer->state = TRANSFER_STATE_SUBMITTED;
+	/* let the running engine continue into the new transfer */
+	if (engine->running && engine_chain_enabled(engine) &&
+	    !list_empty(&engine->transfer_list)) {
+		struct xdma_transfer *tail = list_last_entry(
+				&engine->transfer_list, struct xdma_transfer,
+				entry);
+
+		if (!tail->cyclic)
+			transfer_chain(tail, transfer);
+	}
+	/* add transfer to the tail of the engine transfer queue */
+	list_add_tail(&transfer->entry, &engine->transfer_list);
+
+	/* engine is idle? */
+	if (!engine->running) {
+		/* start engine */
+		dbg_tfr("%s(): starting %s engine.\n", __func__, engine->name);
+		transfer_started = engine_start(engine);
+		if (!transfer_started) {
+			pr_err("Failed to start dma engine\n");
+			return 0;
+		}
+		dbg_tfr("transfer=0x%p started %s engine with transfer 0x%p.\n",
+			transfer, engine->name, transfer_started);
+	} else {
+		dbg_tfr("transfer=0x%p queued, with %s engine running.\n",
+			transfer, engine->name);
+	}
+
+	return 0;
+}
+
 /* transfer_queue() - Queue a DMA transfer on the engine
  *
  * @engine DMA engine doing the transfer
@@ -2450,7 +2682,6 @@ static int transfer_queue(struct xdma_engine *engine,
 			  struct xdma_transfer *transfer)
 {
 	int rv = 0;
-	struct xdma_transfer *transfer_started;
 	struct xdma_dev *xdev;
 	unsigned long flags;
 
@@ -2485,44 +2716,66 @@ static int transfer_queue(struct xdma_engine *engine,
 
 	/* lock the engine state */
 	spin_lock_irqsave(&engine->lock, flags);
+	rv = transfer_queue_locked(engine, transfer);
+	/* unlock the engine state */
+	dbg_tfr("engine->running = %d\n", engine->running);
+	spin_unlock_irqrestore(&engine->lock, flags);
+	return rv;
+}
 
-	engine->prev_cpu = get_cpu();
-	put_cpu();
+/* transfer_unlink() - take a transfer off the queue of a stopped engine
+ *
+ * A transfer queued behind it is chained to the one before it instead.
+ *
+ * engine->lock must be taken
+ */
+static void transfer_unlink(struct xdma_engine *engine,
+			    struct xdma_transfer *xfer)
+{
+	struct xdma_transfer *prev, *next = NULL;
+	struct xdma_desc *last;
 
-	/* engine is being shutdown; do not accept new transfers */
-	if (engine->shutdown & ENGINE_SHUTDOWN_REQUEST) {
-		pr_info("engine %s offline, transfer 0x%p not queued.\n",
-			engine->name, transfer);
-		rv = -EBUSY;
-		goto shutdown;
+	if (engine_chain_enabled(engine) &&
+	    engine->transfer_list.next != &xfer->entry) {
+		prev = list_prev_entry(xfer, entry);
+		if (!list_is_last(&xfer->entry, &engine->transfer_list))
+			next = list_next_entry(xfer, entry);
+
+		if (next) {
+			transfer_chain(prev, next);
+		} else {
+			last = prev->desc_virt + prev->desc_num - 1;
+			xdma_desc_link(last, NULL, 0);
+			xdma_desc_control_set(last, XDMA_DESC_STOPPED |
+					XDMA_DESC_EOP | XDMA_DESC_COMPLETED);
+		}
 	}
+	list_del(&xfer->entry);
+}
 
-	/* mark the transfer as submitted */
-	transfer->state = TRANSFER_STATE_SUBMITTED;
-	/* add transfer to the tail of the engine transfer queue */
-	list_add_tail(&transfer->entry, &engine->transfer_list);
+/* transfer_timeout() - pull a timed out transfer off the engine
+ *
+ * The engine is stopped, the transfer removed from the queue and the engine
+ * restarted on the transfers other requests have queued.
+ *
+ * engine->lock must be taken
+ */
+static void transfer_timeout(struct xdma_engine *engine,
+			     struct xdma_transfer *xfer)
+{
+	if (engine_status_read(engine, 0, 1) < 0)
+		pr_err("Failed to read engine status\n");
 
-	/* engine is idle? */
-	if (!engine->running) {
-		/* start engine */
-		dbg_tfr("%s(): starting %s engine.\n", __func__, engine->name);
-		transfer_started = engine_start(engine);
-		if (!transfer_started) {
-			pr_err("Failed to start dma engine\n");
-			goto shutdown;
-		}
-		dbg_tfr("transfer=0x%p started %s engine with transfer 0x%p.\n",
-			transfer, engine->name, transfer_started);
-	} else {
-		dbg_tfr("transfer=0x%p queued, with %s engine running.\n",
-			transfer, engine->name);
+	if (engine->running && xdma_engine_stop(engine) < 0)
+		pr_err("Failed to stop engine\n");
+
+	if (xfer->state == TRANSFER_STATE_SUBMITTED) {
+		transfer_unlink(engine, xfer);
+		xfer->state = TRANSFER_STATE_ABORTED;
 	}
 
-shutdown:
-	/* unlock the engine state */
-	dbg_tfr("engine->running = %d\n", engine->running);
-	spin_unlock_irqrestore(&engine->lock, flags);
-	return rv;
+	if (engine_service_resume(engine) < 0)
+		pr_err("Failed to resume engine\n");
 }
 
 static void engine_alignments(struct xdma_engine *engine)
@@ -2603,6 +2856,8 @@ static int engine_destroy(struct xdma_dev *xdev, struct xdma_engine *engine)
 
 	dbg_sg("Shutting down engine %s%d", engine->name, engine->channel);
 
+	xdma_capture_stop(engine);
+
 	/* Disable interrupts to stop processing new events during shutdown */
 	write_register(0x0, &engine->regs->interrupt_enable_mask,
 		       (unsigned long)(&engine->regs->interrupt_enable_mask) -
@@ -2922,6 +3177,96 @@ static void transfer_destroy(struct xdma_dev *xdev, struct xdma_transfer *xfer)
 	}
 }
 
+/* engine_desc_avail() - contiguous free descriptors at engine->desc_idx
+ *
+ * Descriptors are handed out in ring order and stay reserved until their
+ * transfer is released, the oldest reservation bounds the free space.
+ *
+ * engine->lock must be taken
+ */
+static unsigned int engine_desc_avail(struct xdma_engine *engine)
+{
+	struct xdma_transfer *oldest;
+
+	if (list_empty(&engine->desc_rsv_list)) {
+		engine->desc_idx = 0;
+		return engine->desc_max;
+	}
+
+	oldest = list_first_entry(&engine->desc_rsv_list,
+				  struct xdma_transfer, desc_entry);
+	if (oldest->desc_index > engine->desc_idx)
+		return oldest->desc_index - engine->desc_idx;
+	if (oldest->desc_index == engine->desc_idx)
+		return 0;
+	return engine->desc_max - engine->desc_idx;
+}
+
+/* engine_desc_fits() - whether @desc_cnt descriptors can be reserved now
+ *
+ * The free space may wrap around the end of the ring, in which case it
+ * takes two transfers.
+ *
+ * engine->lock must be taken
+ */
+static bool engine_desc_fits(struct xdma_engine *engine,
+			     unsigned int desc_cnt)
+{
+	unsigned int avail = engine_desc_avail(engine);
+	struct xdma_transfer *oldest;
+
+	if (avail >= desc_cnt)
+		return true;
+	/* free space ends before the ring does */
+	if (!avail || engine->desc_idx + avail != engine->desc_max)
+		return false;
+
+	oldest = list_first_entry(&engine->desc_rsv_list,
+				  struct xdma_transfer, desc_entry);
+	return avail + oldest->desc_index >= desc_cnt;
+}
+
+/* engine_desc_commit() - reserve the descriptors built for a transfer
+ *
+ * engine->lock must be taken
+ */
+static void engine_desc_commit(struct xdma_engine *engine,
+			       struct xdma_transfer *xfer)
+{
+	list_add_tail(&xfer->desc_entry, &engine->desc_rsv_list);
+	engine->desc_idx = (engine->desc_idx + xfer->desc_num) %
+				engine->desc_max;
+	engine->desc_used += xfer->desc_num;
+}
+
+static bool engine_desc_space(struct xdma_engine *engine)
+{
+	unsigned long flags;
+	bool space;
+
+	spin_lock_irqsave(&engine->lock, flags);
+	space = engine_desc_avail(engine) > 0;
+	spin_unlock_irqrestore(&engine->lock, flags);
+
+	return space;
+}
+
+/* transfer_release() - free a reaped transfer and its ring descriptors */
+static void transfer_release(struct xdma_engine *engine,
+			     struct xdma_transfer *xfer)
+{
+	unsigned long flags;
+
+	transfer_destroy(engine->xdev, xfer);
+
+	spin_lock_irqsave(&engine->lock, flags);
+	list_del_init(&xfer->desc_entry);
+	engine->desc_used -= xfer->desc_num;
+	spin_unlock_irqrestore(&engine->lock, flags);
+
+	wake_up_interruptible(&engine->desc_wq);
+}
+
 static int transfer_build(struct xdma_engine *engine,
 			struct xdma_request_cb *req, struct xdma_transfer *xfer,
 			unsigned int desc_max)
@@ -2961,21 +3306,32 @@ static int transfer_build(struct xdma_engine *engine,
 }
 
 
-static int transfer_init(struct xdma_engine *engine,
-			struct xdma_request_cb *req, struct xdma_transfer *xfer)
+/* transfer_init_locked() - reserve ring descriptors and build a transfer
+ *
+ * engine->lock must be taken
+ */
+static int transfer_init_locked(struct xdma_engine *engine,
+			struct xdma_request_cb *req, struct xdma_transfer *xfer,
+			unsigned int desc_limit)
 {
 	unsigned int desc_max = min_t(unsigned int,
 				req->sw_desc_cnt - req->sw_desc_idx,
-				engine->desc_max);
+				desc_limit);
 	int i = 0;
 	int last = 0;
 	u32 control;
-	unsigned long flags;
 
 	memset(xfer, 0, sizeof(*xfer));
 
-	/* lock the engine state */
-	spin_lock_irqsave(&engine->lock, flags);
+	/* the ring belongs to a running capture */
+	if (engine->capture)
+		return -EBUSY;
+
+	/* ring is full, retry once a transfer is released */
+	desc_max = min(desc_max, engine_desc_avail(engine));
+	if (!desc_max)
+		return -EAGAIN;
+
 	/* initialize wait queue */
 #if HAS_SWAKE_UP
 	init_swait_queue_head(&xfer->wq);
@@ -2993,11 +3349,6 @@ static int transfer_init(struct xdma_engine *engine,
 			(sizeof(struct xdma_result) * engine->desc_idx);
 	xfer->desc_index = engine->desc_idx;
 
-	/* Need to handle desc_used >= engine->desc_max */
-
-	if ((engine->desc_idx + desc_max) >= engine->desc_max)
-		desc_max = engine->desc_max - engine->desc_idx;
-
 	transfer_desc_init(xfer, desc_max);
 
 	dbg_sg("xfer= %p transfer->desc_bus = 0x%llx.\n",
@@ -3023,8 +3374,7 @@ static int transfer_init(struct xdma_engine *engine,
 		xfer->desc_cmpl_th = desc_max;
 
 	xfer->desc_num = desc_max;
-	engine->desc_idx = (engine->desc_idx + desc_max) % engine->desc_max;
-	engine->desc_used += desc_max;
+	engine_desc_commit(engine, xfer);
 
 	/* fill in adjacent numbers */
 	for (i = 0; i < xfer->desc_num; i++) {
@@ -3035,10 +3385,40 @@ static int transfer_init(struct xdma_engine *engine,
 		xdma_desc_adjacent(xfer->desc_virt + i, next_adj);
 	}
 
-	spin_unlock_irqrestore(&engine->lock, flags);
 	return 0;
 }
 
+static int transfer_init(struct xdma_engine *engine,
+			struct xdma_request_cb *req, struct xdma_transfer *xfer,
+			unsigned int desc_limit)
+{
+	unsigned long flags;
+	int rv;
+
+	/* lock the engine state */
+	spin_lock_irqsave(&engine->lock, flags);
+	rv = transfer_init_locked(engine, req, xfer, desc_limit);
+	spin_unlock_irqrestore(&engine->lock, flags);
+
+	return rv;
+}
+
+/* transfer_init_wait() - transfer_init(), sleeping while the ring is full */
+static int transfer_init_wait(struct xdma_engine *engine,
+			struct xdma_request_cb *req, struct xdma_transfer *xfer,
+			unsigned int desc_limit)
+{
+	int rv;
+
+	while ((rv = transfer_init(engine, req, xfer, desc_limit)) ==
+	       -EAGAIN) {
+		if (wait_event_interruptible(engine->desc_wq,
+					     engine_desc_space(engine)))
+			return -ERESTARTSYS;
+	}
+	return rv;
+}
+
 #ifdef __LIBXDMA_DEBUG__
 static void sgt_dump(struct sg_table *sgt)
 {
@@ -3164,6 +3544,7 @@ ssize_t xdma_xfer_aperture(struct xdma_engine *engine, bool write, u64 ep_addr,
 	enum dma_data_direction dir = write ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
 	unsigned int maxlen = min_t(unsigned int, aperture, desc_blen_max);
 	unsigned int sg_max;
+	unsigned int avail;
 	unsigned int tlen = 0;
 	u64 ep_addr_max = ep_addr + aperture - 1;
 	ssize_t done = 0;
@@ -3233,8 +3614,6 @@ ssize_t xdma_xfer_aperture(struct xdma_engine *engine, bool write, u64 ep_addr,
 
 	dbg_tfr("%s, aperture: sg cnt %u.\n", engine->name, sgt->nents);
 
-	mutex_lock(&engine->desc_lock);
-
 	while (req->offset < req->total_len) {
 		unsigned long flags;
 		struct xdma_transfer *xfer = &req->tfer[0];
@@ -3256,8 +3635,27 @@ ssize_t xdma_xfer_aperture(struct xdma_engine *engine, bool write, u64 ep_addr,
 
 		spin_lock_irqsave(&engine->lock, flags);
 
+		/* the ring belongs to a running capture */
+		if (engine->capture) {
+			spin_unlock_irqrestore(&engine->lock, flags);
+			rv = -EBUSY;
+			goto unmap_sgl;
+		}
+
+		avail = engine_desc_avail(engine);
+		if (!avail) {
+			spin_unlock_irqrestore(&engine->lock, flags);
+			if (wait_event_interruptible(engine->desc_wq,
+					engine_desc_space(engine))) {
+				rv = -ERESTARTSYS;
+				goto unmap_sgl;
+			}
+			continue;
+		}
+
+		/* build within the free part of the ring */
 		desc_idx = engine->desc_idx;
-		desc_max = engine->desc_max;
+		desc_max = desc_idx + avail;
 
 		xfer->desc_virt = desc_virt = engine->desc + desc_idx;
 		xfer->res_virt = engine->cyclic_result + desc_idx;
@@ -3322,7 +3720,6 @@ ssize_t xdma_xfer_aperture(struct xdma_engine *engine, bool write, u64 ep_addr,
 
 		xfer->desc_adjacent = desc_cnt;
 		xfer->desc_num = desc_cnt;
-		engine->desc_used += desc_cnt;
 
 		/* create the desc linked list */
 		for (i = 0; i < (desc_cnt - 1); i++, desc_virt++) {
@@ -3350,7 +3747,7 @@ ssize_t xdma_xfer_aperture(struct xdma_engine *engine, bool write, u64 ep_addr,
         	        xdma_desc_adjacent(xfer->desc_virt + i, next_adj);
         	}
 
-		engine->desc_idx = (engine->desc_idx + desc_cnt) % desc_max;
+		engine_desc_commit(engine, xfer);
 		spin_unlock_irqrestore(&engine->lock, flags);
 
 		/* last transfer for the given request? */
@@ -3365,8 +3762,8 @@ ssize_t xdma_xfer_aperture(struct xdma_engine *engine, bool write, u64 ep_addr,
 
 		rv = transfer_queue(engine, xfer);
 		if (rv < 0) {
-			mutex_unlock(&engine->desc_lock);
 			pr_info("unable to submit %s, %d.\n", engine->name, rv);
+			transfer_release(engine, xfer);
 			goto unmap_sgl;
 		}
 
@@ -3410,20 +3807,7 @@ ssize_t xdma_xfer_aperture(struct xdma_engine *engine, bool write, u64 ep_addr,
 			/* transfer can still be in-flight */
 			pr_info("xfer 0x%p,%u, s 0x%x timed out, ep 0x%llx.\n",
 				xfer, xfer->len, xfer->state, req->ep_addr);
-			rv = engine_status_read(engine, 0, 1);
-			if (rv < 0) {
-				pr_err("Failed to read engine status\n");
-			} else if (rv == 0) {
-				//engine_status_dump(engine);
-				rv = transfer_abort(engine, xfer);
-				if (rv < 0) {
-					pr_err("Failed to stop engine\n");
-				} else if (rv == 0) {
-					rv = xdma_engine_stop(engine);
-					if (rv < 0)
-						pr_err("Failed to stop engine\n");
-				}
-			}
+			transfer_timeout(engine, xfer);
 			spin_unlock_irqrestore(&engine->lock, flags);
 
 #ifdef __LIBXDMA_DEBUG__
@@ -3434,15 +3818,11 @@ ssize_t xdma_xfer_aperture(struct xdma_engine *engine, bool write, u64 ep_addr,
 			break;
 		}
 
-		engine->desc_used -= xfer->desc_num;
-		transfer_destroy(xdev, xfer);
+		transfer_release(engine, xfer);
 
-		if (rv < 0) {
-			mutex_unlock(&engine->desc_lock);
+		if (rv < 0)
 			goto unmap_sgl;
-		}
 	} /* while (sg) */
-	mutex_unlock(&engine->desc_lock);
 
 unmap_sgl:
 	if (!dma_mapped && sgt->nents) {
@@ -3461,17 +3841,171 @@ unmap_sgl:
 	return done ? done : rv;
 }
 
-ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
-			 struct sg_table *sgt, bool dma_mapped, int timeout_ms)
+/*
+ * Requests larger than one descriptor chain are split into chains of at most
+ * half the descriptor ring, so the next chain can be built and linked while
+ * the engine works on the current one.
+ */
+static inline bool xdma_xfer_pipelined(struct xdma_engine *engine,
+				       struct xdma_request_cb *req)
 {
-	struct xdma_dev *xdev = (struct xdma_dev *)dev_hndl;
-	struct xdma_engine *engine = NULL;
-	int rv = 0, tfer_idx = 0, i;
-	ssize_t done = 0;
-	struct scatterlist *sg = sgt->sgl;
-	int nents;
-	enum dma_data_direction dir = write ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
-	struct xdma_request_cb *req = NULL;
+	if (!xfer_pipeline || req->sw_desc_cnt <= engine->desc_max)
+		return false;
+	if (engine_chain_enabled(engine))
+		return true;
+
+	if (!READ_ONCE(engine->chain_off_logged)) {
+		WRITE_ONCE(engine->chain_off_logged, 1);
+		pr_info("%s: %s, xfer_pipeline off, one chain at a time.\n",
+			engine->name,
+			poll_mode ? "poll mode" : "ST C2H stops on EOP");
+	}
+	return false;
+}
+
+/* transfer_wait() - wait for a queued transfer and reap its status
+ *
+ * Returns 0 on completion or a negative error, the transfer is no longer on
+ * the engine queue in either case.
+ */
+static int transfer_wait(struct xdma_engine *engine,
+			 struct xdma_transfer *xfer, int timeout_ms)
+{
+	unsigned long flags;
+	int rv;
+
+	if (timeout_ms > 0)
+		xlx_wait_event_interruptible_timeout(xfer->wq,
+			(xfer->state != TRANSFER_STATE_SUBMITTED),
+			msecs_to_jiffies(timeout_ms));
+	else
+		xlx_wait_event_interruptible(xfer->wq,
+			(xfer->state != TRANSFER_STATE_SUBMITTED));
+
+	spin_lock_irqsave(&engine->lock, flags);
+
+	switch (xfer->state) {
+	case TRANSFER_STATE_COMPLETED:
+		rv = 0;
+		break;
+	case TRANSFER_STATE_FAILED:
+		pr_info("xfer 0x%p,%u, failed.\n", xfer, xfer->len);
+		rv = -EIO;
+		break;
+	default:
+		/* transfer can still be in-flight */
+		pr_info("xfer 0x%p,%u, s 0x%x timed out.\n", xfer, xfer->len,
+			xfer->state);
+		transfer_timeout(engine, xfer);
+		rv = -ETIMEDOUT;
+		break;
+	}
+
+	spin_unlock_irqrestore(&engine->lock, flags);
+
+#ifdef __LIBXDMA_DEBUG__
+	if (rv < 0)
+		transfer_dump(xfer);
+#endif
+	return rv;
+}
+
+/* xdma_xfer_submit_pipeline() - run a request with two chains in flight
+ *
+ * The chains alternate between req->tfer[0] and req->tfer[1]. A chain that
+ * does not find room in the descriptor ring waits for the older one to be
+ * reaped instead.
+ */
+static int xdma_xfer_submit_pipeline(struct xdma_engine *engine,
+				     struct xdma_request_cb *req,
+				     struct sg_table *sgt, bool dma_mapped,
+				     int timeout_ms, ssize_t *done)
+{
+	unsigned int chunk = engine->desc_max / 2;
+	unsigned int nents = req->sw_desc_cnt;
+	struct xdma_transfer *xfer;
+	int head = 0, tail = 0, inflight = 0;
+	int rv = 0;
+
+	while (nents || inflight) {
+		/* top up the engine queue to two chains */
+		while (nents && inflight < 2) {
+			xfer = &req->tfer[tail];
+			if (inflight)
+				rv = transfer_init(engine, req, xfer, chunk);
+			else
+				rv = transfer_init_wait(engine, req, xfer,
+							chunk);
+			if (rv == -EAGAIN)
+				break;
+			if (rv < 0)
+				goto drain;
+
+			if (!dma_mapped)
+				xfer->flags = XFER_FLAG_NEED_UNMAP;
+
+			nents -= xfer->desc_num;
+			if (!nents) {
+				xfer->last_in_request = 1;
+				xfer->sgt = sgt;
+			}
+
+			dbg_tfr("xfer %u, ep 0x%llx, sg %u/%u, %d in flight.\n",
+				xfer->len, req->ep_addr, req->sw_desc_idx,
+				req->sw_desc_cnt, inflight);
+
+			rv = transfer_queue(engine, xfer);
+			if (rv < 0) {
+				pr_info("unable to submit %s, %d.\n",
+					engine->name, rv);
+				transfer_release(engine, xfer);
+				goto drain;
+			}
+
+			if (engine->cmplthp)
+				xdma_kthread_wakeup(engine->cmplthp);
+
+			tail ^= 1;
+			inflight++;
+		}
+
+		/* chains complete in order, reap the oldest one */
+		xfer = &req->tfer[head];
+		rv = transfer_wait(engine, xfer, timeout_ms);
+		transfer_release(engine, xfer);
+		inflight--;
+		head ^= 1;
+		if (rv < 0)
+			goto drain;
+
+		*done += xfer->len;
+	}
+
+	return 0;
+
+drain:
+	/* the chain queued behind a failed one still owns ring descriptors */
+	while (inflight--) {
+		xfer = &req->tfer[head];
+		transfer_wait(engine, xfer, timeout_ms);
+		transfer_release(engine, xfer);
+		head ^= 1;
+	}
+	return rv;
+}
+
+ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
+			 struct sg_table *sgt, bool dma_mapped, int timeout_ms)
+{
+	struct xdma_dev *xdev = (struct xdma_dev *)dev_hndl;
+	struct xdma_engine *engine = NULL;
+	int rv = 0, tfer_idx = 0, i;
+	ssize_t done = 0;
+	struct scatterlist *sg = sgt->sgl;
+	int nents;
+	enum dma_data_direction dir = write ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
+	struct xdma_request_cb *req = NULL;
+	bool serialize;
 
 	if (!dev_hndl)
 		return -EINVAL;
@@ -3550,16 +4084,31 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 
 	sg = sgt->sgl;
 	nents = req->sw_desc_cnt;
-	mutex_lock(&engine->desc_lock);
+
+	if (xdma_xfer_pipelined(engine, req)) {
+		rv = xdma_xfer_submit_pipeline(engine, req, sgt, dma_mapped,
+					       timeout_ms, &done);
+		goto unmap_sgl;
+	}
+
+	/*
+	 * ST C2H requests end on EOP and read their results from the ring,
+	 * one at a time. Other requests share the ring and the engine queue.
+	 */
+	serialize = engine->streaming && engine->dir == DMA_FROM_DEVICE;
+	if (serialize)
+		mutex_lock(&engine->desc_lock);
 
 	while (nents) {
 		unsigned long flags;
 		struct xdma_transfer *xfer;
 
 		/* build transfer */
-		rv = transfer_init(engine, req, &req->tfer[0]);
+		rv = transfer_init_wait(engine, req, &req->tfer[0],
+					engine->desc_max);
 		if (rv < 0) {
-			mutex_unlock(&engine->desc_lock);
+			if (serialize)
+				mutex_unlock(&engine->desc_lock);
 			goto unmap_sgl;
 		}
 		xfer = &req->tfer[0];
@@ -3583,8 +4132,10 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 
 		rv = transfer_queue(engine, xfer);
 		if (rv < 0) {
-			mutex_unlock(&engine->desc_lock);
+			if (serialize)
+				mutex_unlock(&engine->desc_lock);
 			pr_info("unable to submit %s, %d.\n", engine->name, rv);
+			transfer_release(engine, xfer);
 			goto unmap_sgl;
 		}
 
@@ -3640,20 +4191,7 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 			/* transfer can still be in-flight */
 			pr_info("xfer 0x%p,%u, s 0x%x timed out, ep 0x%llx.\n",
 				xfer, xfer->len, xfer->state, req->ep_addr);
-			rv = engine_status_read(engine, 0, 1);
-			if (rv < 0) {
-				pr_err("Failed to read engine status\n");
-			} else if (rv == 0) {
-				//engine_status_dump(engine);
-				rv = transfer_abort(engine, xfer);
-				if (rv < 0) {
-					pr_err("Failed to stop engine\n");
-				} else if (rv == 0) {
-					rv = xdma_engine_stop(engine);
-					if (rv < 0)
-						pr_err("Failed to stop engine\n");
-				}
-			}
+			transfer_timeout(engine, xfer);
 			spin_unlock_irqrestore(&engine->lock, flags);
 
 #ifdef __LIBXDMA_DEBUG__
@@ -3664,8 +4202,7 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 			break;
 		}
 
-		engine->desc_used -= xfer->desc_num;
-		transfer_destroy(xdev, xfer);
+		transfer_release(engine, xfer);
 
 		/* use multiple transfers per request if we could not fit
 		 * all data within single descriptor chain.
@@ -3673,11 +4210,13 @@ ssize_t xdma_xfer_submit(void *dev_hndl, int channel, bool write, u64 ep_addr,
 		tfer_idx++;
 
 		if (rv < 0) {
-			mutex_unlock(&engine->desc_lock);
+			if (serialize)
+				mutex_unlock(&engine->desc_lock);
 			goto unmap_sgl;
 		}
 	} /* while (sg) */
-	mutex_unlock(&engine->desc_lock);
+	if (serialize)
+		mutex_unlock(&engine->desc_lock);
 
 unmap_sgl:
 	if (!dma_mapped && sgt->nents) {
@@ -3696,6 +4235,248 @@ unmap_sgl:
 	return done ? done : rv;
 }
 
+/*
+ * Striping: one request is cut into contiguous card address slices, one per
+ * AXI MM engine of the direction. The first slice runs in the caller's
+ * context, the others on the unbound workqueue.
+ */
+#define XDMA_STRIPE_MIN		(64 * 1024)
+
+struct xdma_stripe {
+	struct work_struct work;
+	struct completion done;
+	struct xdma_dev *xdev;
+	int channel;
+	bool write;
+	u64 ep_addr;
+	struct sg_table sgt;
+	size_t len;
+	int timeout_ms;
+	ssize_t res;
+};
+
+static void xdma_stripe_work(struct work_struct *work)
+{
+	struct xdma_stripe *st = container_of(work, struct xdma_stripe, work);
+
+	st->res = xdma_xfer_submit(st->xdev, st->channel, st->write,
+				   st->ep_addr, &st->sgt, true, st->timeout_ms);
+	complete(&st->done);
+}
+
+/*
+ * collect the AXI MM incremental engines of one direction, idle engines
+ * first. Busy engines are only used when none of them is idle.
+ */
+static int xdma_stripe_channels(struct xdma_dev *xdev, bool write,
+				int *channels)
+{
+	int max = write ? xdev->h2c_channel_max : xdev->c2h_channel_max;
+	int busy[XDMA_CHANNEL_NUM_MAX];
+	int nr_idle = 0, nr_busy = 0;
+	int i;
+
+	for (i = 0; i < max; i++) {
+		struct xdma_engine *engine = write ? &xdev->engine_h2c[i] :
+						     &xdev->engine_c2h[i];
+		unsigned long flags;
+		bool idle;
+
+		if (engine->magic != MAGIC_ENGINE || engine->streaming ||
+		    engine->non_incr_addr)
+			continue;
+
+		spin_lock_irqsave(&engine->lock, flags);
+		idle = !engine->running && list_empty(&engine->transfer_list);
+		spin_unlock_irqrestore(&engine->lock, flags);
+
+		if (idle)
+			channels[nr_idle++] = i;
+		else
+			busy[nr_busy++] = i;
+	}
+
+	if (nr_idle)
+		return nr_idle;
+
+	memcpy(channels, busy, nr_busy * sizeof(int));
+	return nr_busy;
+}
+
+/* build a dma mapped sg table covering [off, off + len) of sgt */
+static int xdma_stripe_sgt(struct sg_table *sgt, size_t off, size_t len,
+			   struct sg_table *sub)
+{
+	struct scatterlist *sg, *dst;
+	size_t pos = 0, end = off + len;
+	unsigned int n = 0;
+	int i, rv;
+
+	for_each_sg(sgt->sgl, sg, sgt->nents, i) {
+		size_t sg_end = pos + sg_dma_len(sg);
+
+		if (sg_end > off && pos < end)
+			n++;
+		pos = sg_end;
+	}
+
+	rv = sg_alloc_table(sub, n, GFP_KERNEL);
+	if (rv < 0)
+		return rv;
+
+	pos = 0;
+	dst = sub->sgl;
+	for_each_sg(sgt->sgl, sg, sgt->nents, i) {
+		size_t sg_end = pos + sg_dma_len(sg);
+
+		if (sg_end > off && pos < end) {
+			size_t start = max(pos, off);
+			unsigned int tlen = min(sg_end, end) - start;
+
+			sg_dma_address(dst) = sg_dma_address(sg) + (start - pos);
+			sg_dma_len(dst) = tlen;
+			dst->length = tlen;
+			dst = sg_next(dst);
+		}
+		pos = sg_end;
+		if (pos >= end)
+			break;
+	}
+	sub->nents = n;
+
+	return 0;
+}
+
+ssize_t xdma_xfer_submit_striped(void *dev_hndl, bool write, u64 ep_addr,
+				 struct sg_table *sgt, bool dma_mapped,
+				 int timeout_ms)
+{
+	struct xdma_dev *xdev = (struct xdma_dev *)dev_hndl;
+	enum dma_data_direction dir = write ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
+	int channels[XDMA_CHANNEL_NUM_MAX];
+	struct xdma_stripe *stripes = NULL;
+	struct scatterlist *sg;
+	size_t total = 0, slice, off;
+	ssize_t done = 0, rv = 0;
+	int nr, i;
+
+	if (!dev_hndl)
+		return -EINVAL;
+
+	if (debug_check_dev_hndl(__func__, xdev->pdev, dev_hndl) < 0)
+		return -EINVAL;
+
+	if (xdma_device_flag_check(xdev, XDEV_FLAG_OFFLINE)) {
+		pr_info("xdev 0x%p, offline.\n", xdev);
+		return -EBUSY;
+	}
+
+	nr = xdma_stripe_channels(xdev, write, channels);
+	if (!nr) {
+		pr_err("no AXI MM %s engine to stripe over.\n",
+		       write ? "H2C" : "C2H");
+		return -ENODEV;
+	}
+
+	if (!dma_mapped) {
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5, 16, 0)
+		sgt->nents = pci_map_sg(xdev->pdev, sgt->sgl, sgt->orig_nents,
+					dir);
+#else
+		sgt->nents = dma_map_sg(&xdev->pdev->dev, sgt->sgl,
+					sgt->orig_nents, dir);
+#endif
+		if (!sgt->nents) {
+			pr_info("map sgl failed, sgt 0x%p.\n", sgt);
+			return -EIO;
+		}
+	} else if (!sgt->nents) {
+		pr_err("sg table has invalid number of entries 0x%p.\n", sgt);
+		return -EIO;
+	}
+
+	for_each_sg(sgt->sgl, sg, sgt->nents, i)
+		total += sg_dma_len(sg);
+
+	/* page aligned slices keep the buffer and card address alignment */
+	slice = max_t(size_t, ALIGN(DIV_ROUND_UP(total, nr), PAGE_SIZE),
+		      XDMA_STRIPE_MIN);
+	nr = total ? DIV_ROUND_UP(total, slice) : 1;
+
+	if (nr == 1) {
+		rv = xdma_xfer_submit(xdev, channels[0], write, ep_addr, sgt,
+				      true, timeout_ms);
+		goto unmap_sgl;
+	}
+
+	stripes = kcalloc(nr, sizeof(*stripes), GFP_KERNEL);
+	if (!stripes) {
+		rv = -ENOMEM;
+		goto unmap_sgl;
+	}
+
+	for (i = 0, off = 0; i < nr; i++, off += slice) {
+		struct xdma_stripe *st = &stripes[i];
+
+		st->xdev = xdev;
+		st->channel = channels[i];
+		st->write = write;
+		st->ep_addr = ep_addr + off;
+		st->len = min(slice, total - off);
+		st->timeout_ms = timeout_ms;
+		INIT_WORK(&st->work, xdma_stripe_work);
+		init_completion(&st->done);
+
+		rv = xdma_stripe_sgt(sgt, off, st->len, &st->sgt);
+		if (rv < 0)
+			goto free_sgt;
+	}
+
+	dbg_tfr("%s, len %zu striped over %d channels, %zu each.\n",
+		write ? "H2C" : "C2H", total, nr, slice);
+
+	for (i = 1; i < nr; i++)
+		queue_work(system_unbound_wq, &stripes[i].work);
+	xdma_stripe_work(&stripes[0].work);
+
+	for (i = 0; i < nr; i++)
+		wait_for_completion(&stripes[i].done);
+
+	/* only the leading run of complete slices counts as done */
+	for (i = 0; i < nr; i++) {
+		struct xdma_stripe *st = &stripes[i];
+
+		if (st->res > 0)
+			done += st->res;
+		if (st->res != st->len) {
+			rv = st->res < 0 ? st->res : -EIO;
+			break;
+		}
+	}
+	i = nr;
+
+free_sgt:
+	while (--i >= 0)
+		sg_free_table(&stripes[i].sgt);
+	kfree(stripes);
+
+unmap_sgl:
+	if (!dma_mapped && sgt->nents) {
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5, 16, 0)
+		pci_unmap_sg(xdev->pdev, sgt->sgl, sgt->orig_nents, dir);
+#else
+		dma_unmap_sg(&xdev->pdev->dev, sgt->sgl, sgt->orig_nents, dir);
+#endif
+		sgt->nents = 0;
+	}
+
+	if (rv > 0)
+		done = rv;
+
+	/* as long as some data is processed, return the count */
+	return done ? done : rv;
+}
+
 ssize_t xdma_xfer_completion(void *cb_hndl, void *dev_hndl, int channel,
 			bool write, u64 ep_addr, struct sg_table *sgt,
 			bool dma_mapped, int timeout_ms)
@@ -3795,8 +4576,7 @@ ssize_t xdma_xfer_completion(void *cb_hndl, void *dev_hndl, int channel,
 			break;
 		}
 
-		transfer_destroy(xdev, xfer);
-		engine->desc_used -= xfer->desc_num;
+		transfer_release(engine, xfer);
 
 		tfer_idx++;
 
@@ -3833,6 +4613,9 @@ ssize_t xdma_xfer_submit_nowait(void *cb_hndl, void *dev_hndl, int channel,
 	int nents;
 	enum dma_data_direction dir = write ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
 	struct xdma_request_cb *req = NULL;
+	struct xdma_transfer *xfer;
+	unsigned long flags;
+	int i;
 
 	if (!dev_hndl)
 		return -EINVAL;
@@ -3908,42 +4691,43 @@ ssize_t xdma_xfer_submit_nowait(void *cb_hndl, void *dev_hndl, int channel,
 		goto unmap_sgl;
 	}
 
+	/*
+	 * the descriptors of a request are only released once all of its
+	 * transfers completed, it has to fit the ring at once
+	 */
+	if (req->sw_desc_cnt > engine->desc_max) {
+		pr_info("%s, %u descriptors exceed the ring of %u.\n",
+			engine->name, req->sw_desc_cnt, engine->desc_max);
+		rv = -EINVAL;
+		goto unmap_sgl;
+	}
+
 	//used when doing completion.
 	req->cb = cb;
 	cb->req = req;
 	dbg_tfr("%s, len %u sg cnt %u.\n",
 		engine->name, req->total_len, req->sw_desc_cnt);
 
-	sg = sgt->sgl;
-	nents = req->sw_desc_cnt;
-	while (nents) {
-
-		struct xdma_transfer *xfer;
+	/*
+	 * reserve and queue all transfers of the request under one lock hold,
+	 * either the whole request is queued or none of it. A full ring is
+	 * reported instead of waited for, the descriptors of concurrent
+	 * nowait requests are only released on their completion.
+	 */
+	spin_lock_irqsave(&engine->lock, flags);
+	if (engine->capture || (engine->shutdown & ENGINE_SHUTDOWN_REQUEST))
+		rv = -EBUSY;
+	else if (!engine_desc_fits(engine, req->sw_desc_cnt))
+		rv = -EAGAIN;
 
+	nents = req->sw_desc_cnt;
+	while (!rv && nents) {
 		/* one transfer at a time */
 		xfer = &req->tfer[tfer_idx];
 		/* build transfer */
-		rv = transfer_init(engine, req, xfer);
-		if (rv < 0) {
-			pr_info("transfer_init failed\n");
-
-			if (!dma_mapped && sgt->nents) {
-#if LINUX_VERSION_CODE < KERNEL_VERSION(5, 16, 0)
-				pci_unmap_sg(xdev->pdev, sgt->sgl,
-						sgt->orig_nents, dir);
-#else
-				dma_unmap_sg(&xdev->pdev->dev, sgt->sgl,
-						sgt->orig_nents, dir);
-#endif
-				sgt->nents = 0;
-			}
-
-			/* Transfer failed return BUSY */
-			if (cb->io_done)
-				cb->io_done((unsigned long)cb, -EBUSY);
-
-			goto rel_req;
-		}
+		rv = transfer_init_locked(engine, req, xfer, engine->desc_max);
+		if (rv < 0)
+			break;
 
 		xfer->cb = cb;
 
@@ -3965,18 +4749,52 @@ ssize_t xdma_xfer_submit_nowait(void *cb_hndl, void *dev_hndl, int channel,
 		transfer_dump(xfer);
 #endif
 
-		rv = transfer_queue(engine, xfer);
-		if (rv < 0) {
-			pr_info("unable to submit %s, %d.\n", engine->name, rv);
-			goto unmap_sgl;
-		}
-
 		/* use multiple transfers per request if we could not fit all
 		 * data within single descriptor chain.
 		 */
 		tfer_idx++;
 	}
 
+	if (!rv) {
+		/* nothing can fail past the checks above */
+		for (i = 0; i < tfer_idx; i++)
+			transfer_queue_locked(engine, &req->tfer[i]);
+	} else if (tfer_idx) {
+		/* not expected once engine_desc_fits() held, give the newest
+		 * reservations back
+		 */
+		for (i = 0; i < tfer_idx; i++) {
+			xfer = &req->tfer[i];
+			xdma_desc_done(xfer->desc_virt, xfer->desc_num);
+			list_del_init(&xfer->desc_entry);
+			engine->desc_used -= xfer->desc_num;
+		}
+		engine->desc_idx = req->tfer[0].desc_index;
+	}
+	spin_unlock_irqrestore(&engine->lock, flags);
+
+	if (rv < 0) {
+		pr_info("%s, request of %u descriptors not queued, %d.\n",
+			engine->name, req->sw_desc_cnt, rv);
+
+		if (!dma_mapped && sgt->nents) {
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5, 16, 0)
+			pci_unmap_sg(xdev->pdev, sgt->sgl, sgt->orig_nents,
+				     dir);
+#else
+			dma_unmap_sg(&xdev->pdev->dev, sgt->sgl,
+				     sgt->orig_nents, dir);
+#endif
+			sgt->nents = 0;
+		}
+
+		/* Transfer failed, complete the request with the error */
+		if (cb->io_done)
+			cb->io_done((unsigned long)cb, rv);
+
+		goto rel_req;
+	}
+
 	return -EIOCBQUEUED;
 
 unmap_sgl:
@@ -4127,6 +4945,381 @@ err_engine_transfer:
 	return rv;
 }
 
+/*
+ * ST C2H capture: the engine runs over a closed loop of descriptors, one per
+ * capture buffer, with descriptor credit mode enabled on the channel. The
+ * buffers and their results are mapped into user space and every buffer
+ * released gives the engine one credit back, so the engine stalls the
+ * stream instead of overwriting buffers that are not consumed yet.
+ */
+static void capture_credit_mode(struct xdma_engine *engine, bool enable)
+{
+	struct xdma_dev *xdev = engine->xdev;
+	u32 reg_value = (0x1 << engine->channel) << 16;
+	struct sgdma_common_regs *reg =
+		(struct sgdma_common_regs *)(xdev->bar[xdev->config_bar_idx] +
+					     (0x6 * TARGET_SPACING));
+
+	/* the credit feature keeps the channel in credit mode */
+	if (enable_st_c2h_credit)
+		return;
+
+	if (enable)
+		write_register(reg_value, &reg->credit_mode_enable_w1s, 0);
+	else
+		write_register(reg_value, &reg->credit_mode_enable_w1c, 0);
+}
+
+static void capture_free(struct xdma_engine *engine, struct xdma_capture *cap)
+{
+	struct device *dev = &engine->xdev->pdev->dev;
+	unsigned int i;
+
+	/* user mappings hold their own page references */
+	if (cap->buf_pg) {
+		for (i = 0; i < cap->size; i++) {
+			if (!cap->buf_pg[i])
+				break;
+			if (cap->buf_bus[i])
+				dma_unmap_page(dev, cap->buf_bus[i],
+					       cap->buf_sz, DMA_FROM_DEVICE);
+			__free_pages(cap->buf_pg[i], cap->buf_order);
+		}
+	}
+	if (cap->res_bus)
+		dma_unmap_page(dev, cap->res_bus,
+			       cap->size * sizeof(struct xdma_result),
+			       DMA_FROM_DEVICE);
+	if (cap->ring_pg)
+		__free_pages(cap->ring_pg, cap->ring_order);
+	kfree(cap->buf_bus);
+	kfree(cap->buf_pg);
+	kfree(cap);
+}
+
+static struct xdma_capture *capture_alloc(struct xdma_engine *engine,
+					  unsigned int size,
+					  unsigned int buf_sz)
+{
+	struct device *dev = &engine->xdev->pdev->dev;
+	int node = dev_to_node(dev);
+	struct xdma_capture *cap;
+	unsigned int i;
+
+	cap = kzalloc(sizeof(*cap), GFP_KERNEL);
+	if (!cap)
+		return NULL;
+	cap->size = size;
+	cap->buf_sz = buf_sz;
+	cap->buf_order = get_order(buf_sz);
+
+	cap->buf_pg = kcalloc(size, sizeof(struct page *), GFP_KERNEL);
+	cap->buf_bus = kcalloc(size, sizeof(dma_addr_t), GFP_KERNEL);
+	if (!cap->buf_pg || !cap->buf_bus)
+		goto err_out;
+
+	/* the header page, then the results */
+	cap->ring_order = get_order(PAGE_SIZE +
+				    size * sizeof(struct xdma_result));
+	cap->ring_pg = alloc_pages_node(node,
+			GFP_KERNEL | __GFP_ZERO | __GFP_COMP, cap->ring_order);
+	if (!cap->ring_pg)
+		goto err_out;
+	cap->ring = page_address(cap->ring_pg);
+	cap->res = page_address(cap->ring_pg) + PAGE_SIZE;
+	cap->res_bus = dma_map_page(dev, cap->ring_pg + 1, 0,
+				    size * sizeof(struct xdma_result),
+				    DMA_FROM_DEVICE);
+	if (dma_mapping_error(dev, cap->res_bus)) {
+		cap->res_bus = 0;
+		goto err_out;
+	}
+
+	for (i = 0; i < size; i++) {
+		cap->buf_pg[i] = alloc_pages_node(node,
+				GFP_KERNEL | __GFP_ZERO | __GFP_COMP,
+				cap->buf_order);
+		if (!cap->buf_pg[i])
+			goto err_out;
+		cap->buf_bus[i] = dma_map_page(dev, cap->buf_pg[i], 0, buf_sz,
+					       DMA_FROM_DEVICE);
+		if (dma_mapping_error(dev, cap->buf_bus[i])) {
+			cap->buf_bus[i] = 0;
+			goto err_out;
+		}
+	}
+
+	cap->ring->size = size;
+	cap->ring->buf_sz = buf_sz;
+	cap->ring->res_off = PAGE_SIZE;
+	cap->ring->data_off = PAGE_SIZE << cap->ring_order;
+
+	return cap;
+
+err_out:
+	capture_free(engine, cap);
+	return NULL;
+}
+
+/* build the closed descriptor loop over engine->desc */
+static void capture_build(struct xdma_engine *engine, struct xdma_capture *cap)
+{
+	struct xdma_transfer *xfer = &cap->xfer;
+	dma_addr_t bus = cap->res_bus;
+	unsigned int i;
+
+#if HAS_SWAKE_UP
+	init_swait_queue_head(&xfer->wq);
+#else
+	init_waitqueue_head(&xfer->wq);
+#endif
+	INIT_LIST_HEAD(&xfer->entry);
+	xfer->dir = engine->dir;
+	xfer->desc_virt = engine->desc;
+	xfer->desc_bus = engine->desc_bus;
+	xfer->desc_num = cap->size;
+	xfer->desc_adjacent = cap->size;
+	xfer->cyclic = 1;
+
+	transfer_desc_init(xfer, cap->size);
+	for (i = 0; i < cap->size; i++) {
+		struct xdma_desc *desc = xfer->desc_virt + i;
+
+		xdma_desc_set(desc, cap->buf_bus[i], 0, cap->buf_sz,
+			      engine->dir);
+		/* ST C2H results are written to the source address */
+		desc->src_addr_lo = cpu_to_le32(PCI_DMA_L(bus));
+		desc->src_addr_hi = cpu_to_le32(PCI_DMA_H(bus));
+		bus += sizeof(struct xdma_result);
+		/* interrupt on every buffer */
+		xdma_desc_control_set(desc, XDMA_DESC_COMPLETED);
+	}
+	/* create a linked loop */
+	xdma_desc_link(xfer->desc_virt + cap->size - 1, xfer->desc_virt,
+		       xfer->desc_bus);
+
+	for (i = 0; i < cap->size; i++) {
+		u32 next_adj = xdma_get_next_adj(cap->size - i - 1,
+						(xfer->desc_virt + i)->next_lo);
+
+		xdma_desc_adjacent(xfer->desc_virt + i, next_adj);
+	}
+}
+
+int xdma_capture_start(struct xdma_engine *engine,
+		       struct xdma_capture_ioctl *conf)
+{
+	struct xdma_capture *cap;
+	unsigned long flags;
+	int rv;
+
+	if (!engine->streaming || engine->dir != DMA_FROM_DEVICE) {
+		pr_info("%s, capture is AXI ST C2H only.\n", engine->name);
+		return -EINVAL;
+	}
+	/* the completion thread waits for the end of a transfer */
+	if (poll_mode)
+		return -EOPNOTSUPP;
+
+	if (!conf->size || !is_power_of_2(conf->size) ||
+	    conf->size > XDMA_CAPTURE_SIZE_MAX ||
+	    conf->size > engine->desc_max ||
+	    conf->buf_sz < PAGE_SIZE || !is_power_of_2(conf->buf_sz) ||
+	    conf->buf_sz > XDMA_CAPTURE_BUF_MAX)
+		return -EINVAL;
+
+	cap = capture_alloc(engine, conf->size, conf->buf_sz);
+	if (!cap)
+		return -ENOMEM;
+
+	mutex_lock(&engine->desc_lock);
+
+	/* take the engine over only while it has nothing to do */
+	spin_lock_irqsave(&engine->lock, flags);
+	if (engine->capture || engine->xdma_perf || engine->running ||
+	    !list_empty(&engine->transfer_list) ||
+	    !list_empty(&engine->desc_rsv_list)) {
+		spin_unlock_irqrestore(&engine->lock, flags);
+		rv = -EBUSY;
+		goto err_out;
+	}
+	engine->capture = cap;
+	spin_unlock_irqrestore(&engine->lock, flags);
+
+	capture_build(engine, cap);
+	capture_credit_mode(engine, true);
+
+	rv = transfer_queue(engine, &cap->xfer);
+	if (rv < 0) {
+		pr_err("%s, failed to start capture, %d.\n", engine->name, rv);
+		capture_credit_mode(engine, false);
+		spin_lock_irqsave(&engine->lock, flags);
+		list_del_init(&cap->xfer.entry);
+		engine->capture = NULL;
+		spin_unlock_irqrestore(&engine->lock, flags);
+		goto err_out;
+	}
+	/* one credit per buffer, returned by xdma_capture_release() */
+	write_register(cap->size, &engine->sgdma_regs->credits, 0);
+	mutex_unlock(&engine->desc_lock);
+
+	conf->mmap_len = (PAGE_SIZE << cap->ring_order) +
+			 (u64)cap->size * cap->buf_sz;
+
+	dbg_tfr("%s capture, %u x %u bytes.\n", engine->name, cap->size,
+		cap->buf_sz);
+	return 0;
+
+err_out:
+	mutex_unlock(&engine->desc_lock);
+	capture_free(engine, cap);
+	return rv;
+}
+
+int xdma_capture_stop(struct xdma_engine *engine)
+{
+	struct xdma_capture *cap;
+	unsigned long flags;
+	int i;
+
+	mutex_lock(&engine->desc_lock);
+	cap = engine->capture;
+	if (!cap) {
+		mutex_unlock(&engine->desc_lock);
+		return 0;
+	}
+
+	spin_lock_irqsave(&engine->lock, flags);
+	xdma_engine_stop(engine);
+	spin_unlock_irqrestore(&engine->lock, flags);
+
+	/* let the last buffer write land before unmapping */
+	for (i = 0; i < 10; i++) {
+		if (!(read_register(&engine->regs->status) & XDMA_STAT_BUSY))
+			break;
+		msleep(1);
+	}
+	capture_credit_mode(engine, false);
+	/* a scheduled service still sees the capture */
+	flush_work(&engine->work);
+
+	spin_lock_irqsave(&engine->lock, flags);
+	list_del_init(&cap->xfer.entry);
+	engine->capture = NULL;
+	spin_unlock_irqrestore(&engine->lock, flags);
+	mutex_unlock(&engine->desc_lock);
+
+	wake_up_interruptible(&engine->capture_wq);
+	capture_free(engine, cap);
+	return 0;
+}
+
+int xdma_capture_release(struct xdma_engine *engine, unsigned int cnt)
+{
+	struct device *dev = &engine->xdev->pdev->dev;
+	struct xdma_capture *cap;
+	unsigned long flags;
+	unsigned int i;
+	int rv = 0;
+
+	spin_lock_irqsave(&engine->lock, flags);
+	cap = engine->capture;
+	if (!cap || cap->err) {
+		rv = cap ? cap->err : -EINVAL;
+		goto unlock;
+	}
+	if (cnt > cap->prod - cap->cons) {
+		rv = -EINVAL;
+		goto unlock;
+	}
+
+	for (i = 0; i < cnt; i++) {
+		unsigned int idx = (cap->cons + i) & (cap->size - 1);
+
+		dma_sync_single_range_for_device(dev, cap->res_bus,
+				idx * sizeof(struct xdma_result),
+				sizeof(struct xdma_result), DMA_FROM_DEVICE);
+		dma_sync_single_for_device(dev, cap->buf_bus[idx], cap->buf_sz,
+					   DMA_FROM_DEVICE);
+	}
+	cap->cons += cnt;
+	WRITE_ONCE(cap->ring->cons, cap->cons);
+	if (cnt)
+		write_register(cnt, &engine->sgdma_regs->credits, 0);
+
+unlock:
+	spin_unlock_irqrestore(&engine->lock, flags);
+	return rv;
+}
+
+int xdma_capture_mmap(struct xdma_engine *engine, struct vm_area_struct *vma)
+{
+	unsigned long nr = (vma->vm_end - vma->vm_start) >> PAGE_SHIFT;
+	struct xdma_capture *cap;
+	struct page **pages;
+	unsigned long i, j, k = 0;
+	unsigned int pg_nr;
+	int rv = 0;
+
+	if (vma->vm_pgoff || !(vma->vm_flags & VM_SHARED))
+		return -EINVAL;
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	pages = kcalloc(nr, sizeof(struct page *), GFP_KERNEL);
+	if (!pages)
+		return -ENOMEM;
+
+	mutex_lock(&engine->desc_lock);
+	cap = engine->capture;
+	pg_nr = cap ? 1 << cap->buf_order : 0;
+	if (!cap || nr != (1UL << cap->ring_order) +
+			  (unsigned long)cap->size * pg_nr) {
+		mutex_unlock(&engine->desc_lock);
+		kfree(pages);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < (1UL << cap->ring_order); i++)
+		pages[k++] = cap->ring_pg + i;
+	for (i = 0; i < cap->size; i++)
+		for (j = 0; j < pg_nr; j++)
+			pages[k++] = cap->buf_pg[i] + j;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0)
+	vm_flags_clear(vma, VM_MAYWRITE);
+#else
+	vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+	for (k = 0; k < nr && !rv; k++)
+		rv = vm_insert_page(vma, vma->vm_start + (k << PAGE_SHIFT),
+				    pages[k]);
+	mutex_unlock(&engine->desc_lock);
+
+	kfree(pages);
+	return rv;
+}
+
+unsigned int xdma_capture_poll(struct xdma_engine *engine, struct file *file,
+			       poll_table *wait)
+{
+	struct xdma_capture *cap;
+	unsigned long flags;
+	unsigned int mask = 0;
+
+	poll_wait(file, &engine->capture_wq, wait);
+
+	spin_lock_irqsave(&engine->lock, flags);
+	cap = engine->capture;
+	if (!cap || cap->err)
+		mask = POLLERR;
+	else if (cap->prod != cap->cons)
+		mask = POLLIN | POLLRDNORM;
+	spin_unlock_irqrestore(&engine->lock, flags);
+
+	return mask;
+}
+
 static struct xdma_dev *alloc_dev_instance(struct pci_dev *pdev)
 {
 	int i;
@@ -4170,6 +5363,9 @@ static struct xdma_dev *alloc_dev_instance(struct pci_dev *pdev)
 		spin_lock_init(&engine->lock);
 		mutex_init(&engine->desc_lock);
 		INIT_LIST_HEAD(&engine->transfer_list);
+		INIT_LIST_HEAD(&engine->desc_rsv_list);
+		init_waitqueue_head(&engine->desc_wq);
+		init_waitqueue_head(&engine->capture_wq);
 #if HAS_SWAKE_UP
 		init_swait_queue_head(&engine->shutdown_wq);
 		init_swait_queue_head(&engine->xdma_perf_wq);
@@ -4184,6 +5380,9 @@ static struct xdma_dev *alloc_dev_instance(struct pci_dev *pdev)
 		spin_lock_init(&engine->lock);
 		mutex_init(&engine->desc_lock);
 		INIT_LIST_HEAD(&engine->transfer_list);
+		INIT_LIST_HEAD(&engine->desc_rsv_list);
+		init_waitqueue_head(&engine->desc_wq);
+		init_waitqueue_head(&engine->capture_wq);
 #if HAS_SWAKE_UP
 		init_swait_queue_head(&engine->shutdown_wq);
 		init_swait_queue_head(&engine->xdma_perf_wq);
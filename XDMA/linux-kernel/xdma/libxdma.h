@@ -32,6 +32,7 @@
 #include <linux/kernel.h>
 #include <linux/pci.h>
 #include <linux/workqueue.h>
+#include <linux/poll.h>
 
 /* Add compatibility checking for RHEL versions */
 #if defined(RHEL_RELEASE_CODE)
@@ -204,6 +205,8 @@
 #define WB_COUNT_MASK 0x00ffffffUL
 #define WB_ERR_MASK (1UL << 31)
 #define POLL_TIMEOUT_SECONDS 10
+/* first sleep of the poll backoff, doubled up to poll_sleep_max_us */
+#define POLL_SLEEP_MIN_US 5
 
 #define MAX_USER_IRQ 16
 
@@ -440,6 +443,7 @@ struct sw_desc {
 #define XFER_FLAG_ST_C2H_EOP_RCVED	0x2	/* ST c2h only */ 
 struct xdma_transfer {
 	struct list_head entry;		/* queue of non-completed transfers */
+	struct list_head desc_entry;	/* descriptor ring reservations */
 	struct xdma_desc *desc_virt;	/* virt addr of the 1st descriptor */
 	struct xdma_result *res_virt;   /* virt addr of result, c2h streaming */
 	dma_addr_t res_bus;		/* bus addr for result descriptors */
@@ -491,6 +495,41 @@ struct xdma_request_cb {
 #endif
 };
 
+/* ST C2H capture ring, see xdma_capture_start() */
+#define XDMA_CAPTURE_SIZE_MAX	512
+#define XDMA_CAPTURE_BUF_MAX	(1 << 20)
+
+struct xdma_capture {
+	unsigned int size;		/* number of buffers, power of 2 */
+	unsigned int buf_sz;		/* bytes per buffer, power of 2 */
+	unsigned int buf_order;
+	/* struct xdma_capture_ring, followed by the results from page 1 */
+	struct page *ring_pg;
+	unsigned int ring_order;
+	struct xdma_capture_ring *ring;
+	struct xdma_result *res;
+	dma_addr_t res_bus;
+	struct page **buf_pg;
+	dma_addr_t *buf_bus;
+	u32 desc_done;			/* completed descriptor count seen */
+	u32 prod;			/* buffers filled, free running */
+	u32 cons;			/* buffers released, free running */
+	int err;
+	/* cyclic transfer over engine->desc, keeps the engine queue busy */
+	struct xdma_transfer xfer;
+};
+
+/* adaptive completion polling, poll mode only */
+struct xdma_poll_stats {
+	u64 polls;		/* completions waited for */
+	u64 spin_hits;		/* completion seen within the spin budget */
+	u64 sleep_hits;		/* completion seen after sleeping */
+	u64 spin_misses;	/* spin budget used up without completion */
+	u64 spin_wasted_ns;	/* time spent in missed spin budgets */
+	u64 sleeps;		/* usleep_range() calls */
+	u64 lat_avg_ns;		/* running average of completion latency */
+};
+
 struct xdma_engine {
 	unsigned long magic;	/* structure ID for sanity checks */
 	struct xdma_dev *xdev;	/* parent device */
@@ -515,6 +554,7 @@ struct xdma_engine {
 	u8 non_incr_addr:1;	/* flag if non-incremental addressing used */
 	u8 eop_flush:1;		/* st c2h only, flush up the data with eop */
 	u8 filler:1;
+	u8 chain_off_logged;	/* xfer_pipeline downgrade reported */
 
 	int max_extra_adj;	/* descriptor prefetch capability */
 	int desc_dequeued;	/* num descriptors of completed transfers */
@@ -535,6 +575,7 @@ struct xdma_engine {
 	/* Members associated with polled mode support */
 	u8 *poll_mode_addr_virt;	/* virt addr for descriptor writeback */
 	dma_addr_t poll_mode_bus;	/* bus addr for descriptor writeback */
+	struct xdma_poll_stats poll_stats;
 
 	/* Members associated with interrupt mode support */
 #if	HAS_SWAKE_UP
@@ -548,11 +589,14 @@ struct xdma_engine {
 	u32 irq_bitmask;		/* IRQ bit mask for this engine */
 	struct work_struct work;	/* Work queue for interrupt handling */
 
-	struct mutex desc_lock;		/* protects concurrent access */
+	struct mutex desc_lock;		/* serializes ST C2H requests */
 	dma_addr_t desc_bus;
 	struct xdma_desc *desc;
 	int desc_idx;			/* current descriptor index */
 	int desc_used;			/* total descriptors used */
+	/* transfers holding ring descriptors, in ring order */
+	struct list_head desc_rsv_list;
+	wait_queue_head_t desc_wq;	/* wait for free ring descriptors */
 
 	/* for performance test support */
 	struct xdma_performance_ioctl *xdma_perf;	/* perf test control */
@@ -562,6 +606,10 @@ struct xdma_engine {
 	wait_queue_head_t xdma_perf_wq;	/* Perf test sync */
 #endif
 
+	/* ST C2H capture, serialized by desc_lock */
+	struct xdma_capture *capture;
+	wait_queue_head_t capture_wq;	/* capture buffers filled */
+
 	struct xdma_kthread *cmplthp;
 	/* completion status thread list for the queue */
 	struct list_head cmplthp_list;
@@ -687,6 +735,13 @@ void xdma_device_offline(struct pci_dev *pdev, void *dev_handle);
 void xdma_device_online(struct pci_dev *pdev, void *dev_handle);
 
 int xdma_performance_submit(struct xdma_dev *xdev, struct xdma_engine *engine);
+int xdma_capture_start(struct xdma_engine *engine,
+		       struct xdma_capture_ioctl *conf);
+int xdma_capture_stop(struct xdma_engine *engine);
+int xdma_capture_release(struct xdma_engine *engine, unsigned int cnt);
+int xdma_capture_mmap(struct xdma_engine *engine, struct vm_area_struct *vma);
+unsigned int xdma_capture_poll(struct xdma_engine *engine, struct file *file,
+			       poll_table *wait);
 struct xdma_transfer *engine_cyclic_stop(struct xdma_engine *engine);
 void enable_perf(struct xdma_engine *engine);
 void get_perf_stats(struct xdma_engine *engine);
@@ -35,6 +35,8 @@ enum cdev_type {
 	CHAR_BYPASS_H2C,
 	CHAR_BYPASS_C2H,
 	CHAR_BYPASS,
+	CHAR_XDMA_H2C_STRIPE,
+	CHAR_XDMA_C2H_STRIPE,
 };
 
 static const char * const devnode_names[] = {
@@ -47,6 +49,8 @@ static const char * const devnode_names[] = {
 	XDMA_NODE_NAME "%d_bypass_h2c_%d",
 	XDMA_NODE_NAME "%d_bypass_c2h_%d",
 	XDMA_NODE_NAME "%d_bypass",
+	XDMA_NODE_NAME "%d_h2c_striped",
+	XDMA_NODE_NAME "%d_c2h_striped",
 };
 
 enum xpdev_flags_bits {
@@ -56,6 +60,8 @@ enum xpdev_flags_bits {
 	XDF_CDEV_EVENT,
 	XDF_CDEV_SG,
 	XDF_CDEV_BYPASS,
+	XDF_CDEV_SG_H2C_STRIPE,
+	XDF_CDEV_SG_C2H_STRIPE,
 };
 
 static inline void xpdev_flag_set(struct xdma_pci_dev *xpdev,
@@ -113,6 +119,8 @@ static int config_kobject(struct xdma_cdev *xcdev, enum cdev_type type)
 	case CHAR_USER:
 	case CHAR_CTRL:
 	case CHAR_XVC:
+	case CHAR_XDMA_H2C_STRIPE:
+	case CHAR_XDMA_C2H_STRIPE:
 		rv = kobject_set_name(&xcdev->cdev.kobj, devnode_names[type],
 			xdev->idx);
 		break;
@@ -350,6 +358,14 @@ static int create_xcdev(struct xdma_pci_dev *xpdev, struct xdma_cdev *xcdev,
 		minor = 100;
 		cdev_bypass_init(xcdev);
 		break;
+	case CHAR_XDMA_H2C_STRIPE:
+		minor = 40;
+		cdev_sgdma_stripe_init(xcdev);
+		break;
+	case CHAR_XDMA_C2H_STRIPE:
+		minor = 41;
+		cdev_sgdma_stripe_init(xcdev);
+		break;
 	default:
 		pr_info("type 0x%x NOT supported.\n", type);
 		return -EINVAL;
@@ -382,6 +398,31 @@ unregister_region:
 	return rv;
 }
 
+/*
+ * first AXI MM incremental engine of a direction, if the direction has more
+ * than one of them to stripe over
+ */
+static struct xdma_engine *xdma_stripe_engine(int channel_max,
+					      struct xdma_engine *engines)
+{
+	struct xdma_engine *first = NULL;
+	int nr = 0;
+	int i;
+
+	for (i = 0; i < channel_max; i++) {
+		struct xdma_engine *engine = &engines[i];
+
+		if (engine->magic != MAGIC_ENGINE || engine->streaming ||
+		    engine->non_incr_addr)
+			continue;
+		if (!first)
+			first = engine;
+		nr++;
+	}
+
+	return nr > 1 ? first : NULL;
+}
+
 void xpdev_destroy_interfaces(struct xdma_pci_dev *xpdev)
 {
 	int i = 0;
@@ -407,6 +448,20 @@ void xpdev_destroy_interfaces(struct xdma_pci_dev *xpdev)
 		}
 	}
 
+	if (xpdev_flag_test(xpdev, XDF_CDEV_SG_H2C_STRIPE)) {
+		rv = destroy_xcdev(&xpdev->sgdma_h2c_stripe_cdev);
+		if (rv < 0)
+			pr_err("Failed to destroy h2c striped xcdev error 0x%x\n",
+				rv);
+	}
+
+	if (xpdev_flag_test(xpdev, XDF_CDEV_SG_C2H_STRIPE)) {
+		rv = destroy_xcdev(&xpdev->sgdma_c2h_stripe_cdev);
+		if (rv < 0)
+			pr_err("Failed to destroy c2h striped xcdev error 0x%x\n",
+				rv);
+	}
+
 	if (xpdev_flag_test(xpdev, XDF_CDEV_EVENT)) {
 		for (i = 0; i < xpdev->user_max; i++) {
 			rv = destroy_xcdev(&xpdev->events_cdev[i]);
@@ -522,6 +577,29 @@ int xpdev_create_interfaces(struct xdma_pci_dev *xpdev)
 	}
 	xpdev_flag_set(xpdev, XDF_CDEV_SG);
 
+	/* striped nodes, only worth it with more than one AXI MM channel */
+	engine = xdma_stripe_engine(xpdev->h2c_channel_max, xdev->engine_h2c);
+	if (engine) {
+		rv = create_xcdev(xpdev, &xpdev->sgdma_h2c_stripe_cdev, 0,
+				  engine, CHAR_XDMA_H2C_STRIPE);
+		if (rv < 0) {
+			pr_err("create char h2c striped failed, %d.\n", rv);
+			goto fail;
+		}
+		xpdev_flag_set(xpdev, XDF_CDEV_SG_H2C_STRIPE);
+	}
+
+	engine = xdma_stripe_engine(xpdev->c2h_channel_max, xdev->engine_c2h);
+	if (engine) {
+		rv = create_xcdev(xpdev, &xpdev->sgdma_c2h_stripe_cdev, 0,
+				  engine, CHAR_XDMA_C2H_STRIPE);
+		if (rv < 0) {
+			pr_err("create char c2h striped failed, %d.\n", rv);
+			goto fail;
+		}
+		xpdev_flag_set(xpdev, XDF_CDEV_SG_C2H_STRIPE);
+	}
+
 	/* Initialize Bypass Character Device */
 	if (xdev->bypass_bar_idx > 0) {
 		for (i = 0; i < xpdev->h2c_channel_max; i++) {
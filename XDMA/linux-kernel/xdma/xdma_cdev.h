@@ -40,6 +40,7 @@ void cdev_ctrl_init(struct xdma_cdev *xcdev);
 void cdev_xvc_init(struct xdma_cdev *xcdev);
 void cdev_event_init(struct xdma_cdev *xcdev);
 void cdev_sgdma_init(struct xdma_cdev *xcdev);
+void cdev_sgdma_stripe_init(struct xdma_cdev *xcdev);
 void cdev_bypass_init(struct xdma_cdev *xcdev);
 long char_ctrl_ioctl(struct file *filp, unsigned int cmd, unsigned long arg);
 
@@ -88,6 +88,8 @@ struct xdma_pci_dev {
 	struct xdma_cdev ctrl_cdev;
 	struct xdma_cdev sgdma_c2h_cdev[XDMA_CHANNEL_NUM_MAX];
 	struct xdma_cdev sgdma_h2c_cdev[XDMA_CHANNEL_NUM_MAX];
+	struct xdma_cdev sgdma_c2h_stripe_cdev;
+	struct xdma_cdev sgdma_h2c_stripe_cdev;
 	struct xdma_cdev events_cdev[16];
 
 	struct xdma_cdev user_cdev;